@@ -0,0 +1,65 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "http_transport.hpp"
+#include "virtual_time.hpp"
+
+// Cost of a simulated request fan-out through InMemoryTransport: building
+// the transport URL, the route lookup, copying the canned bytes and
+// parsing them back into a response, as HttpClientManager does for every
+// request when a transport is set.
+// - BM_TransportFanOut: Arg(0) exchanges with no delay; completions are
+//   posted and drained in one run.
+// - BM_TransportFanOutVirtualLatency: Arg(0) exchanges, each with a 50 ms
+//   response delay on the virtual clock, so no wall time is spent waiting.
+
+using namespace std::chrono_literals;
+namespace http = boost::beast::http;
+
+namespace {
+
+template <class Timer>
+void fan_out(benchmark::State& state, std::chrono::milliseconds delay) {
+  const auto n = state.range(0);
+  boost::asio::io_context ioc;
+  client_async::InMemoryTransport<Timer> transport(ioc.get_executor());
+  transport.add(client_async::transport_url("http", "api.test", 80, "/items"),
+                {200, {{"Content-Type", "application/json"}},
+                 std::string(512, 'x'), delay});
+  for (auto _ : state) {
+    std::int64_t bytes = 0;
+    for (std::int64_t i = 0; i < n; ++i) {
+      client_async::TransportRequest req;
+      req.url = client_async::transport_url("http", "api.test", 80, "/items");
+      transport.exchange(std::move(req), [&bytes](int ec, std::string wire) {
+        if (ec != 0) return;
+        boost::system::error_code perr;
+        auto res = client_async::parse_transport_response<http::string_body>(
+            wire, perr);
+        if (!perr) bytes += static_cast<std::int64_t>(res.body().size());
+      });
+    }
+    monad::run_virtual(ioc);
+    benchmark::DoNotOptimize(bytes);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+}  // namespace
+
+static void BM_TransportFanOut(benchmark::State& state) {
+  fan_out<boost::asio::steady_timer>(state, 0ms);
+}
+BENCHMARK(BM_TransportFanOut)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+static void BM_TransportFanOutVirtualLatency(benchmark::State& state) {
+  fan_out<monad::VirtualTimer>(state, 50ms);
+}
+BENCHMARK(BM_TransportFanOutVirtualLatency)
+    ->Arg(10000)
+    ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,51 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+
+#include "io_monad.hpp"
+#include "io_monad_poll_with_state.hpp"
+
+// Per-call overhead of the IO timer combinators.
+// - BM_TimeoutPureIO: 1M pure IOs, each wrapped in timeout(); a pure IO
+//   completes inline, so the timer is never armed and this is the cost of
+//   the per-call state (one allocation) and the wrapped callback only.
+// - BM_PollLoop: one poll_if loop of Arg(0) attempts with a zero interval.
+
+using namespace std::chrono_literals;
+
+static void BM_TimeoutPureIO(benchmark::State& state) {
+  const auto n = state.range(0);
+  boost::asio::io_context ioc;
+  for (auto _ : state) {
+    std::int64_t sum = 0;
+    for (std::int64_t i = 0; i < n; ++i) {
+      monad::IO<int>::pure(1).timeout(ioc, 30s).run(
+          [&sum](monad::IO<int>::IOResult r) { sum += r.value(); });
+    }
+    ioc.restart();
+    ioc.run();  // nothing queued unless a timer was armed
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+BENCHMARK(BM_TimeoutPureIO)->Arg(1 << 20)->Unit(benchmark::kMillisecond);
+
+static void BM_PollLoop(benchmark::State& state) {
+  const int attempts = static_cast<int>(state.range(0));
+  boost::asio::io_context ioc;
+  for (auto _ : state) {
+    int seen = 0;
+    monad::IO<int>::pure(1)
+        .poll_if(
+            attempts, 0ms, ioc,
+            [&seen, attempts](const int&) { return ++seen == attempts; })
+        .run([](monad::IO<int>::IOResult) {});
+    ioc.restart();
+    ioc.run();
+    benchmark::DoNotOptimize(seen);
+  }
+  state.SetItemsProcessed(state.iterations() * attempts);
+}
+BENCHMARK(BM_PollLoop)->Arg(10000)->Unit(benchmark::kMillisecond);
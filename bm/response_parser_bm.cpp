@@ -0,0 +1,231 @@
+#include <benchmark/benchmark.h>
+
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+#include "fast_response_parser.hpp"
+
+// beast::http::response_parser vs client_async::fast_http on responses shaped
+// like real captures (header sets and sizes kept, values anonymised).
+// - Arg 0: which capture (see kCaptures).
+
+namespace http = boost::beast::http;
+namespace fast_http = client_async::fast_http;
+
+namespace {
+
+std::string nginx_json() {
+  const std::string body =
+      R"({"code":0,"message":"ok","data":{"id":4182,"name":"edge-01",)"
+      R"("status":"running","tags":["prod","eu-west"],"updated":1760695200}})";
+  return "HTTP/1.1 200 OK\r\n"
+         "Server: nginx/1.24.0\r\n"
+         "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+         "Content-Type: application/json; charset=utf-8\r\n"
+         "Content-Length: " +
+         std::to_string(body.size()) +
+         "\r\n"
+         "Connection: keep-alive\r\n"
+         "Vary: Accept-Encoding\r\n"
+         "X-Request-Id: 6f1c2a9e-3b7d-4e21-9a0f-5d8c7b6a4e32\r\n"
+         "\r\n" +
+         body;
+}
+
+std::string cdn_html() {
+  const std::string body(2048, 'x');
+  std::string r =
+      "HTTP/1.1 200 OK\r\n"
+      "Content-Type: text/html; charset=utf-8\r\n"
+      "Content-Length: " +
+      std::to_string(body.size()) +
+      "\r\n"
+      "Connection: keep-alive\r\n"
+      "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+      "Cache-Control: private, no-cache, no-store, must-revalidate, "
+      "max-age=0\r\n"
+      "Content-Security-Policy: default-src 'self'; script-src 'self' "
+      "'unsafe-inline' https://cdn.example.com https://www.googletagmanager"
+      ".com https://static.example.net; style-src 'self' 'unsafe-inline' "
+      "https://fonts.googleapis.com; img-src 'self' data: https:; "
+      "connect-src 'self' https://api.example.com wss://ws.example.com; "
+      "frame-ancestors 'none'; upgrade-insecure-requests\r\n"
+      "Strict-Transport-Security: max-age=63072000; includeSubDomains; "
+      "preload\r\n"
+      "X-Frame-Options: DENY\r\n"
+      "X-Content-Type-Options: nosniff\r\n"
+      "Referrer-Policy: strict-origin-when-cross-origin\r\n"
+      "Permissions-Policy: geolocation=(), microphone=(), camera=()\r\n"
+      "ETag: W/\"a81f-18b2c3d4e5f\"\r\n"
+      "Last-Modified: Fri, 16 Oct 2026 22:13:05 GMT\r\n"
+      "Vary: Accept-Encoding, Cookie\r\n"
+      "Age: 37\r\n"
+      "Via: 1.1 varnish, 1.1 7f3e.cdn.example.net (Varnish/7.4)\r\n"
+      "X-Cache: HIT, MISS\r\n"
+      "X-Cache-Hits: 4, 0\r\n"
+      "X-Served-By: cache-fra-etou8220041-FRA, cache-lcy-eglc8600048-LCY\r\n"
+      "X-Timer: S1760695200.118041,VS0,VE2\r\n"
+      "Alt-Svc: h3=\":443\"; ma=86400\r\n"
+      "Server-Timing: cdn-cache;desc=HIT, edge;dur=1, origin;dur=0\r\n";
+  for (int i = 0; i < 4; ++i) {
+    r += "Set-Cookie: session_" + std::to_string(i) + "=" +
+         std::string(160, 'a' + i) +
+         "; Path=/; Expires=Sun, 18 Oct 2026 10:00:00 GMT; Secure; HttpOnly;"
+         " SameSite=Lax\r\n";
+  }
+  return r + "\r\n" + body;
+}
+
+std::string github_chunked() {
+  std::string r =
+      "HTTP/1.1 200 OK\r\n"
+      "Server: GitHub.com\r\n"
+      "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+      "Content-Type: application/json; charset=utf-8\r\n"
+      "Transfer-Encoding: chunked\r\n"
+      "Cache-Control: public, max-age=60, s-maxage=60\r\n"
+      "Vary: Accept, Accept-Encoding, Accept, X-Requested-With\r\n"
+      "ETag: W/\"5c1f0e7d2a9b8c6d4e3f2a1b0c9d8e7f\"\r\n"
+      "X-GitHub-Media-Type: github.v3; format=json\r\n"
+      "Link: <https://api.github.com/repositories/1/issues?page=2>; "
+      "rel=\"next\", <https://api.github.com/repositories/1/issues?page=34>; "
+      "rel=\"last\"\r\n"
+      "x-ratelimit-limit: 60\r\n"
+      "x-ratelimit-remaining: 57\r\n"
+      "x-ratelimit-reset: 1760698800\r\n"
+      "x-ratelimit-used: 3\r\n"
+      "x-ratelimit-resource: core\r\n"
+      "X-GitHub-Request-Id: C0A1:2B3C:4D5E6F:7A8B9C:68F21A30\r\n"
+      "\r\n";
+  char size[16];
+  for (int i = 0; i < 16; ++i) {
+    const std::string chunk(1024 + 13 * i, '{');
+    std::snprintf(size, sizeof size, "%zx\r\n", chunk.size());
+    r += size + chunk + "\r\n";
+  }
+  return r + "0\r\n\r\n";
+}
+
+const std::string& capture(std::int64_t which) {
+  static const std::string kCaptures[] = {nginx_json(), cdn_html(),
+                                          github_chunked()};
+  return kCaptures[which];
+}
+
+void set_label(benchmark::State& state) {
+  static const char* kNames[] = {"nginx_json", "cdn_html", "github_chunked"};
+  state.SetLabel(kNames[state.range(0)]);
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          capture(state.range(0)).size());
+}
+
+void BM_BeastHead(benchmark::State& state) {
+  const auto& raw = capture(state.range(0));
+  for (auto _ : state) {
+    http::response_parser<http::string_body> p;
+    p.eager(false);
+    boost::system::error_code ec;
+    p.put(boost::asio::buffer(raw), ec);
+    benchmark::DoNotOptimize(p.get().result_int());
+    if (ec || !p.is_header_done()) state.SkipWithError("beast head failed");
+  }
+  set_label(state);
+}
+
+void BM_FastHead(benchmark::State& state) {
+  const auto& raw = capture(state.range(0));
+  fast_http::ResponseHead head;
+  for (auto _ : state) {
+    head.clear();
+    const int n = fast_http::parse_response_head(raw.data(), raw.size(), head);
+    benchmark::DoNotOptimize(n);
+    if (n <= 0) state.SkipWithError("fast head failed");
+  }
+  set_label(state);
+}
+
+void BM_BeastFull(benchmark::State& state) {
+  const auto& raw = capture(state.range(0));
+  for (auto _ : state) {
+    http::response_parser<http::string_body> p;
+    p.eager(true);
+    boost::system::error_code ec;
+    std::size_t used = 0;
+    while (!ec && !p.is_done() && used < raw.size()) {
+      used += p.put(boost::asio::buffer(raw.data() + used, raw.size() - used),
+                    ec);
+    }
+    benchmark::DoNotOptimize(p.get().body().data());
+    if (ec || !p.is_done()) state.SkipWithError("beast full failed");
+  }
+  set_label(state);
+}
+
+// Head + body into a reused FastResponse, as the session fast path does.
+void BM_FastFull(benchmark::State& state) {
+  const auto& raw = capture(state.range(0));
+  fast_http::FastResponse res;
+  for (auto _ : state) {
+    res.clear();
+    const int n =
+        fast_http::parse_response_head(raw.data(), raw.size(), res.head);
+    if (n <= 0) {
+      state.SkipWithError("fast head failed");
+      break;
+    }
+    const char* body = raw.data() + n;
+    const std::size_t avail = raw.size() - static_cast<std::size_t>(n);
+    if (res.head.chunked) {
+      fast_http::ChunkedDecoder dec;
+      std::size_t used = 0;
+      if (dec.decode(body, avail, res.body, used, UINT64_MAX) !=
+          fast_http::ChunkedDecoder::Result::done) {
+        state.SkipWithError("chunked decode failed");
+      }
+    } else {
+      res.body.assign(body, *res.head.content_length);
+    }
+    benchmark::DoNotOptimize(res.body.data());
+  }
+  set_label(state);
+}
+
+// Full fast parse plus materialising the beast::http::response the session
+// callbacks receive.
+void BM_FastFullToBeast(benchmark::State& state) {
+  const auto& raw = capture(state.range(0));
+  for (auto _ : state) {
+    fast_http::FastResponse res;
+    const int n =
+        fast_http::parse_response_head(raw.data(), raw.size(), res.head);
+    if (n <= 0) {
+      state.SkipWithError("fast head failed");
+      break;
+    }
+    const char* body = raw.data() + n;
+    const std::size_t avail = raw.size() - static_cast<std::size_t>(n);
+    if (res.head.chunked) {
+      fast_http::ChunkedDecoder dec;
+      std::size_t used = 0;
+      dec.decode(body, avail, res.body, used, UINT64_MAX);
+    } else {
+      res.body.assign(body, *res.head.content_length);
+    }
+    auto beast_res = std::move(res).to_beast();
+    benchmark::DoNotOptimize(beast_res.body().data());
+  }
+  set_label(state);
+}
+
+}  // namespace
+
+BENCHMARK(BM_BeastHead)->DenseRange(0, 2);
+BENCHMARK(BM_FastHead)->DenseRange(0, 2);
+BENCHMARK(BM_BeastFull)->DenseRange(0, 2);
+BENCHMARK(BM_FastFull)->DenseRange(0, 2);
+BENCHMARK(BM_FastFullToBeast)->DenseRange(0, 2);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,154 @@
+#include <benchmark/benchmark.h>
+#include <unistd.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "beast_connection_pool.hpp"
+
+// Loopback TCP vs Unix domain socket for local sidecar traffic, through
+// beast_pool::ConnectionPool.
+// - Arg 0: response body size in bytes.
+// - Arg 1: 1 = keep-alive (pooled connection), 0 = server closes after
+//   every response, so each request pays for connect (and, on TCP, an
+//   ephemeral port).
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+
+namespace {
+
+template <class Protocol>
+class SidecarServer {
+ public:
+  explicit SidecarServer(typename Protocol::endpoint ep) : acceptor_(ioc_) {
+    acceptor_.open(ep.protocol());
+    if constexpr (std::is_same_v<Protocol, net::ip::tcp>) {
+      acceptor_.set_option(net::socket_base::reuse_address(true));
+    }
+    acceptor_.bind(ep);
+    acceptor_.listen();
+    thread_ = std::thread([this] {
+      accept();
+      ioc_.run();
+    });
+  }
+  ~SidecarServer() {
+    ioc_.stop();
+    thread_.join();
+  }
+  typename Protocol::endpoint local_endpoint() const {
+    return acceptor_.local_endpoint();
+  }
+
+ private:
+  struct Conn : std::enable_shared_from_this<Conn> {
+    explicit Conn(typename Protocol::socket s) : sock(std::move(s)) {}
+    typename Protocol::socket sock;
+    boost::beast::flat_buffer buf;
+    http::request<http::string_body> req;
+    http::response<http::string_body> res;
+
+    void read() {
+      req = {};
+      http::async_read(sock, buf, req,
+                       [self = this->shared_from_this()](
+                           boost::system::error_code ec, std::size_t) {
+                         if (!ec) self->respond();
+                       });
+    }
+    void respond() {
+      // Target: /<body size>[/close]
+      std::string target(req.target());
+      const bool close = target.find("/close") != std::string::npos;
+      res = {http::status::ok, 11};
+      res.body().assign(std::stoul(target.substr(1)), 'x');
+      res.keep_alive(!close);
+      res.prepare_payload();
+      http::async_write(sock, res,
+                        [self = this->shared_from_this(), close](
+                            boost::system::error_code ec, std::size_t) {
+                          if (ec) return;
+                          if (close) {
+                            self->sock.shutdown(net::socket_base::shutdown_both,
+                                                ec);
+                            return;
+                          }
+                          self->read();
+                        });
+    }
+  };
+
+  void accept() {
+    acceptor_.async_accept(
+        [this](boost::system::error_code ec, typename Protocol::socket s) {
+          if (ec) return;
+          std::make_shared<Conn>(std::move(s))->read();
+          accept();
+        });
+  }
+
+  net::io_context ioc_;
+  typename Protocol::acceptor acceptor_;
+  std::thread thread_;
+};
+
+void run_requests(benchmark::State& state, beast_pool::Origin origin) {
+  const auto body_size = static_cast<std::size_t>(state.range(0));
+  const bool keep_alive = state.range(1) != 0;
+  net::io_context ioc;
+  beast_pool::PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  beast_pool::ConnectionPool pool(ioc, cfg);
+  http::request<http::string_body> req{
+      http::verb::get,
+      "/" + std::to_string(body_size) + (keep_alive ? "" : "/close"), 11};
+  req.set(http::field::host, "localhost");
+
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    pool.async_request(origin, req,
+                       [&](boost::system::error_code ec, auto, auto res) {
+                         if (ec) {
+                           state.SkipWithError(ec.message().c_str());
+                           return;
+                         }
+                         bytes += res.body().size();
+                       });
+    ioc.run();
+    ioc.restart();
+  }
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+  state.SetItemsProcessed(state.iterations());
+}
+
+void BM_LoopbackTcp(benchmark::State& state) {
+  SidecarServer<net::ip::tcp> server(
+      {net::ip::make_address("127.0.0.1"), 0});
+  run_requests(state,
+               beast_pool::Origin{"http", "127.0.0.1",
+                                  server.local_endpoint().port()});
+}
+
+void BM_UnixSocket(benchmark::State& state) {
+  const std::string path =
+      "/tmp/httpclient_bm_" + std::to_string(::getpid()) + ".sock";
+  ::unlink(path.c_str());
+  {
+    SidecarServer<net::local::stream_protocol> server(
+        net::local::stream_protocol::endpoint{path});
+    run_requests(state, beast_pool::Origin{"http", "localhost", 80, path});
+  }
+  ::unlink(path.c_str());
+}
+
+}  // namespace
+
+BENCHMARK(BM_LoopbackTcp)->ArgsProduct({{64, 64 << 10}, {1, 0}});
+BENCHMARK(BM_UnixSocket)->ArgsProduct({{64, 64 << 10}, {1, 0}});
+
+BENCHMARK_MAIN();
@@ -10,6 +10,7 @@
 
 #include "httpclient_error_codes.hpp"
 #include "io_monad.hpp"
+#include "json_list_body.hpp"
 #include "resp_datastruct.hpp"
 #include "result_monad.hpp"
 
@@ -108,6 +109,27 @@ struct ApiDataResponse {
   }
 };
 
+// A list payload to send as a chunked, incrementally serialized body (see
+// json_list_body). The JSON is the same as ApiDataResponse<T> holding a
+// vector; use it for list endpoints that can return many elements.
+template <typename T>
+struct ApiListStream {
+  typename json_list_body<T>::value_type body;
+
+  ApiListStream(std::vector<T>&& vec)
+      : ApiListStream(std::move(vec),
+                      resp::DataMeta{static_cast<int64_t>(vec.size()), 0,
+                                     vec.size()}) {}
+  ApiListStream(const std::vector<T>&) = delete;
+
+  ApiListStream(std::vector<T>&& vec, resp::DataMeta meta)
+      : body{std::move(vec), std::move(meta)} {}
+
+  ApiListStream(resp::ListResult<T>&& result)
+      : body{std::move(result.data), std::move(result.meta)} {}
+  ApiListStream(const resp::ListResult<T>&) = delete;
+};
+
 struct NoContent {};
 
 struct Success {
@@ -172,6 +194,19 @@ struct ResponseGenerator {
     return make_io_response(std::move(res));
   }
 
+  // ApiListStream<T> → chunked json_list_body<T>
+  template <typename T>
+  auto operator()(ApiListStream<T>&& list,
+                  http::status status = http::status::ok) const {
+    http::response<json_list_body<T>> res;
+    res.version(11);
+    res.result(status);
+    res.set(http::field::content_type, "application/json");
+    res.body() = std::move(list.body);
+    res.chunked(true);
+    return make_io_response(std::move(res));
+  }
+
   // Download → string_body
   auto operator()(DownloadInline&& d,
                   http::status status = http::status::ok) const {
@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace client_async {
+
+struct BatchOptions {
+  // Requests running at once across the whole batch.
+  std::size_t max_in_flight{64};
+  // Requests running at once per origin. Keep this at or below the pool's
+  // max_idle_per_origin so every connection is reused.
+  std::size_t max_in_flight_per_origin{6};
+  // Open connections (one DNS lookup per origin) before sending.
+  bool prewarm{true};
+};
+
+// Runs a batch of jobs grouped by key (an origin id), honouring a global and
+// a per-key concurrency cap. Keys with runnable work take turns, so one
+// large origin cannot starve the rest. A key can start closed and be opened
+// later, e.g. once its connections are warm.
+//
+// Completions may arrive on any thread. Jobs are always started outside the
+// scheduler lock, and jobs that finish synchronously do not recurse.
+class BatchScheduler : public std::enable_shared_from_this<BatchScheduler> {
+ public:
+  using Key = std::uint32_t;
+  // Starts job `index`; `done` must be called exactly once when it finishes.
+  using start_fn =
+      std::function<void(std::size_t index, std::function<void()> done)>;
+
+  static std::shared_ptr<BatchScheduler> create(const std::vector<Key>& keys,
+                                                BatchOptions opts,
+                                                start_fn start,
+                                                std::function<void()> on_done,
+                                                bool start_open = true) {
+    return std::shared_ptr<BatchScheduler>(new BatchScheduler(
+        keys, opts, std::move(start), std::move(on_done), start_open));
+  }
+
+  BatchScheduler(const BatchScheduler&) = delete;
+  BatchScheduler& operator=(const BatchScheduler&) = delete;
+
+  // Starts as many jobs as the caps allow. An empty batch completes here.
+  void run() {
+    bool empty = false;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      started_ = true;
+      if (total_ == 0 && !finished_) {
+        finished_ = true;
+        empty = true;
+      }
+    }
+    if (empty) {
+      if (on_done_) on_done_();
+      return;
+    }
+    pump();
+  }
+
+  // Lets jobs for `key` start. Opening an unknown or open key is a no-op.
+  void open(Key key) {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      auto it = index_.find(key);
+      if (it == index_.end()) return;
+      Group& g = groups_[it->second];
+      if (g.open) return;
+      g.open = true;
+      enqueue_locked(it->second);
+    }
+    pump();
+  }
+
+  std::size_t in_flight() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return in_flight_;
+  }
+
+  std::size_t completed() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return completed_;
+  }
+
+ private:
+  struct Group {
+    std::deque<std::size_t> pending;
+    std::size_t in_flight = 0;
+    bool open = true;
+    bool queued = false;  // present in ring_
+  };
+
+  BatchScheduler(const std::vector<Key>& keys, BatchOptions opts,
+                 start_fn start, std::function<void()> on_done,
+                 bool start_open)
+      : opts_(opts),
+        start_(std::move(start)),
+        on_done_(std::move(on_done)),
+        total_(keys.size()) {
+    if (opts_.max_in_flight == 0) opts_.max_in_flight = 1;
+    if (opts_.max_in_flight_per_origin == 0) opts_.max_in_flight_per_origin = 1;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      auto [it, inserted] = index_.try_emplace(keys[i], groups_.size());
+      if (inserted) {
+        groups_.emplace_back();
+        groups_.back().open = start_open;
+      }
+      groups_[it->second].pending.push_back(i);
+    }
+    for (std::size_t g = 0; g < groups_.size(); ++g) enqueue_locked(g);
+  }
+
+  bool runnable_locked(const Group& g) const {
+    return g.open && !g.pending.empty() &&
+           g.in_flight < opts_.max_in_flight_per_origin;
+  }
+
+  void enqueue_locked(std::size_t g) {
+    Group& group = groups_[g];
+    if (group.queued || !runnable_locked(group)) return;
+    group.queued = true;
+    ring_.push_back(g);
+  }
+
+  // Only one thread drains at a time; others leave a note and return.
+  void pump() {
+    std::vector<std::pair<std::size_t, std::size_t>> batch;  // (group, job)
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (!started_) return;
+      if (pumping_) {
+        repump_ = true;
+        return;
+      }
+      pumping_ = true;
+    }
+    for (;;) {
+      batch.clear();
+      {
+        std::lock_guard<std::mutex> lk(mu_);
+        while (in_flight_ < opts_.max_in_flight && !ring_.empty()) {
+          const std::size_t g = ring_.front();
+          ring_.pop_front();
+          Group& group = groups_[g];
+          group.queued = false;
+          if (!runnable_locked(group)) continue;
+          batch.emplace_back(g, group.pending.front());
+          group.pending.pop_front();
+          ++group.in_flight;
+          ++in_flight_;
+          enqueue_locked(g);  // back of the ring: next key goes first
+        }
+        if (batch.empty() && !repump_) {
+          pumping_ = false;
+          return;
+        }
+        repump_ = false;
+      }
+      for (auto const& [g, job] : batch) {
+        start_(job, [self = shared_from_this(), g = g]() { self->finish(g); });
+      }
+    }
+  }
+
+  void finish(std::size_t g) {
+    bool all_done = false;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      --groups_[g].in_flight;
+      --in_flight_;
+      ++completed_;
+      enqueue_locked(g);
+      if (completed_ == total_ && !finished_) {
+        finished_ = true;
+        all_done = true;
+      }
+    }
+    if (all_done) {
+      if (on_done_) on_done_();
+      return;
+    }
+    pump();
+  }
+
+  mutable std::mutex mu_;
+  BatchOptions opts_;
+  start_fn start_;
+  std::function<void()> on_done_;
+  const std::size_t total_;
+  std::vector<Group> groups_;
+  std::unordered_map<Key, std::size_t> index_;
+  std::deque<std::size_t> ring_;  // groups that can start a job now
+  std::size_t in_flight_ = 0;
+  std::size_t completed_ = 0;
+  bool started_ = false;
+  bool pumping_ = false;
+  bool repump_ = false;
+  bool finished_ = false;
+};
+
+}  // namespace client_async
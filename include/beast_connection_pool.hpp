@@ -8,14 +8,25 @@
 #include <boost/beast/ssl.hpp>
 #include <boost/beast/version.hpp>
 #include <boost/system/error_code.hpp>
+#include <algorithm>
+#include <charconv>
 #include <chrono>
 #include <cstdint>
 #include <deque>
 #include <functional>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <shared_mutex>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
+
+#include "endpoint_set.hpp"
+#include "origin_table.hpp"
+#include "request_priority.hpp"
+#include "warm_start_state.hpp"
 
 namespace beast_pool {
 
@@ -24,29 +35,7 @@ namespace beast = boost::beast;
 namespace http = beast::http;
 namespace ssl = boost::asio::ssl;
 using tcp = net::ip::tcp;
-
-// ------------------------------------
-// Origin key
-// ------------------------------------
-struct Origin {
-  std::string scheme;  // "http" or "https" (lowercase)
-  std::string host;    // authority host name (used for SNI)
-  std::uint16_t port;
-
-  bool operator==(const Origin& o) const noexcept {
-    return scheme == o.scheme && host == o.host && port == o.port;
-  }
-};
-struct OriginHash {
-  std::size_t operator()(Origin const& o) const noexcept {
-    std::size_t h = std::hash<std::string>{}(o.scheme);
-    h ^= std::hash<std::string>{}(o.host) + 0x9e3779b9 + (h << 6) + (h >> 2);
-    h ^= std::hash<std::uint16_t>{}(o.port) + 0x9e3779b9 + (h << 6) + (h >> 2);
-    return h;
-  }
-};
-
-inline bool is_https(Origin const& o) noexcept { return o.scheme == "https"; }
+using client_async::RequestPriority;
 
 // ------------------------------------
 // Config
@@ -60,20 +49,49 @@ struct PoolConfig {
   std::chrono::seconds connect_timeout{10};
   std::chrono::seconds handshake_timeout{10};
   std::chrono::seconds io_timeout{30};  // write/read timeout
+  // Cap on connections checked out or connecting, across origins (0 = no
+  // cap). Past it, acquire() queues and waiters are served by weighted fair
+  // queueing over their RequestPriority.
+  std::size_t max_active{0};
+  client_async::PriorityWeights priority_weights{16, 4, 1};
+  // Waiters queued longer than this are served first regardless of weight.
+  std::chrono::milliseconds priority_max_wait{2000};
+  // Which resolved address new requests go to. The balanced policies track
+  // outstanding requests per address and re-resolve every endpoint_refresh.
+  EndpointPolicy endpoint_policy{EndpointPolicy::first};
+  std::chrono::seconds endpoint_refresh{30};
+  // Close connections older than this instead of reusing them (0 = never),
+  // so load spreads onto backends added after the connection was opened.
+  std::chrono::seconds max_connection_lifetime{0};
+  // Passive health checks per resolved address (off by default). Enabling
+  // it tracks addresses even with EndpointPolicy::first, which then skips
+  // ejected ones.
+  OutlierDetection outlier_detection{};
+  // How long addresses cached in a WarmStartState are trusted. The resolver
+  // reports no TTLs, so this stands in for them.
+  std::chrono::seconds warm_dns_ttl{300};
 };
 
 // ------------------------------------
-// Connection (TCP or TLS over TCP)
+// Connection (TCP, TLS over TCP, or a Unix domain socket)
 // ------------------------------------
 class Connection : public std::enable_shared_from_this<Connection> {
  public:
   using Ptr = std::shared_ptr<Connection>;
   using TcpStream = beast::tcp_stream;
   using SslStream = ssl::stream<beast::tcp_stream>;
-  using StreamVariant = std::variant<TcpStream, SslStream>;
+  using UnixStream = beast::basic_stream<net::local::stream_protocol>;
+  using StreamVariant = std::variant<TcpStream, SslStream, UnixStream>;
 
-  Connection(net::any_io_executor ex, ssl::context* ssl_ctx, Origin origin)
-      : stream_(TcpStream(ex)), ssl_ctx_(ssl_ctx), origin_(std::move(origin)) {}
+  Connection(net::any_io_executor ex, ssl::context* ssl_ctx, OriginId id)
+      : stream_(TcpStream(ex)),
+        ssl_ctx_(ssl_ctx),
+        origin_id_(id),
+        origin_(&OriginTable::global().get(id)) {}
+  Connection(net::any_io_executor ex, ssl::context* ssl_ctx,
+             Origin const& origin)
+      : Connection(std::move(ex), ssl_ctx,
+                   OriginTable::global().intern(origin)) {}
 
   bool is_ssl() const noexcept {
     return std::holds_alternative<SslStream>(stream_);
@@ -84,7 +102,9 @@ class Connection : public std::enable_shared_from_this<Connection> {
   void prepare_stream() {
     // Always build new stream on the same executor as the current one
     auto ex = executor();
-    if (is_https(origin_) && ssl_ctx_) {
+    if (is_unix(*origin_)) {
+      stream_.template emplace<UnixStream>(ex);
+    } else if (is_https(*origin_) && ssl_ctx_) {
       // Replace TcpStream with SslStream bound to the strand/io_context
       stream_.template emplace<SslStream>(ex, *ssl_ctx_);
     } else {
@@ -96,21 +116,6 @@ class Connection : public std::enable_shared_from_this<Connection> {
     return std::visit([](auto& s) { return s.get_executor(); }, stream_);
   }
 
-  tcp::socket& lowest_socket() {
-    return std::visit(
-        [](auto& s) -> tcp::socket& {
-          return beast::get_lowest_layer(s).socket();
-        },
-        stream_);
-  }
-  const tcp::socket& lowest_socket() const {
-    return std::visit(
-        [](auto& s) -> const tcp::socket& {
-          return beast::get_lowest_layer(s).socket();
-        },
-        stream_);
-  }
-
   void set_busy(bool b) {
     busy_ = b;
     if (!b) last_used_ = std::chrono::steady_clock::now();
@@ -121,7 +126,29 @@ class Connection : public std::enable_shared_from_this<Connection> {
     return (std::chrono::steady_clock::now() - last_used_) > idle_keep_alive;
   }
 
-  bool alive() const { return lowest_socket().is_open(); }
+  // True once the connection has outlived `lifetime` (0 = unlimited).
+  bool past_lifetime(std::chrono::seconds lifetime) const {
+    return lifetime.count() > 0 &&
+           (std::chrono::steady_clock::now() - created_) > lifetime;
+  }
+
+  // Resolved address this connection was opened to (unset for Unix
+  // sockets).
+  tcp::endpoint const& endpoint() const { return endpoint_; }
+  void set_endpoint(tcp::endpoint ep) { endpoint_ = std::move(ep); }
+
+  // Whether this connection's TLS session was already handed to the
+  // WarmStartState.
+  bool session_saved() const { return session_saved_; }
+  void mark_session_saved() { session_saved_ = true; }
+
+  bool alive() const {
+    return std::visit(
+        [](auto const& s) {
+          return beast::get_lowest_layer(s).socket().is_open();
+        },
+        stream_);
+  }
 
   void close() {
     beast::error_code ec;
@@ -135,7 +162,7 @@ class Connection : public std::enable_shared_from_this<Connection> {
                 tcp::socket::shutdown_both, ec);
             beast::get_lowest_layer(s).socket().close(ec);
           } else {
-            s.socket().shutdown(tcp::socket::shutdown_both, ec);
+            s.socket().shutdown(net::socket_base::shutdown_both, ec);
             s.socket().close(ec);
           }
         },
@@ -143,8 +170,12 @@ class Connection : public std::enable_shared_from_this<Connection> {
   }
 
   StreamVariant& stream() { return stream_; }
-  Origin const& origin() const { return origin_; }
-  void set_origin(Origin o) { origin_ = std::move(o); }
+  Origin const& origin() const { return *origin_; }
+  OriginId origin_id() const { return origin_id_; }
+  void set_origin(Origin const& o) {
+    origin_id_ = OriginTable::global().intern(o);
+    origin_ = &OriginTable::global().get(origin_id_);
+  }
 
   // Upgrade an existing TCP stream to SSL, preserving the underlying socket.
   // Returns pointer to the SSL stream, or nullptr on failure (no ssl_ctx_ or
@@ -162,10 +193,15 @@ class Connection : public std::enable_shared_from_this<Connection> {
   }
 
  private:
-  StreamVariant stream_;  // TCP or TLS over TCP
+  StreamVariant stream_;  // TCP, TLS over TCP, or Unix domain socket
   ssl::context* ssl_ctx_ = nullptr;
-  Origin origin_;
+  OriginId origin_id_;
+  Origin const* origin_;  // interned, see OriginTable
   bool busy_ = false;
+  bool session_saved_ = false;
+  tcp::endpoint endpoint_{};
+  std::chrono::steady_clock::time_point created_{
+      std::chrono::steady_clock::now()};
   std::chrono::steady_clock::time_point last_used_{
       std::chrono::steady_clock::now()};
 };
@@ -175,12 +211,11 @@ class Connection : public std::enable_shared_from_this<Connection> {
 // ------------------------------------
 class ConnectionPool {
   // Monadic acquire: returns IO<Connection::Ptr>
-  monad::IO<Connection::Ptr> acquire_monad(Origin origin) {
-    return monad::IO<Connection::Ptr>([this, origin = std::move(origin)](
-                                          auto cb) mutable {
-      this->acquire(std::move(origin), [cb = std::move(cb)](
-                                           boost::system::error_code ec,
-                                           Connection::Ptr c) mutable {
+  monad::IO<Connection::Ptr> acquire_monad(Origin const& origin) {
+    const OriginId id = OriginTable::global().intern(origin);
+    return monad::IO<Connection::Ptr>([this, id](auto cb) mutable {
+      this->acquire(id, [cb = std::move(cb)](boost::system::error_code ec,
+                                             Connection::Ptr c) mutable {
         if (ec || !c) {
           cb(monad::Result<Connection::Ptr, monad::Error>::Err(
               monad::Error{ec.value(), ec.message()}));
@@ -193,13 +228,14 @@ class ConnectionPool {
 
   // Monadic async_request: returns IO<http::response<ResBody>>
   template <class Request>
-  auto async_request_monad(Origin origin, Request req) {
+  auto async_request_monad(Origin const& origin, Request req) {
     using ResBody = typename Request::body_type;
     using ResponseT = http::response<ResBody>;
-    return monad::IO<ResponseT>([this, origin = std::move(origin),
+    const OriginId id = OriginTable::global().intern(origin);
+    return monad::IO<ResponseT>([this, id,
                                  req = std::move(req)](auto cb) mutable {
       this->async_request(
-          std::move(origin), std::move(req),
+          id, std::move(req),
           [cb = std::move(cb)](boost::system::error_code ec, auto,
                                ResponseT res) mutable {
             if (ec) {
@@ -222,70 +258,173 @@ class ConnectionPool {
         strand_(net::make_strand(ioc)),
         cfg_(cfg),
         ssl_ctx_(ssl_ctx),
-        reap_timer_(ioc) {
+        reap_timer_(ioc),
+        waiters_(cfg.priority_weights, cfg.priority_max_wait) {
     // Reaper is armed lazily when the first idle connection appears.
   }
 
   // Expose read-only config
   const PoolConfig& config() const { return cfg_; }
 
+  // Pool bookkeeping, pooled connections and acquire() handlers all run on
+  // this strand.
+  net::strand<net::io_context::executor_type> executor() const {
+    return strand_;
+  }
+
+  // Resume TLS sessions, reuse DNS answers and record origin usage through
+  // `state`, typically loaded from an earlier run. Call before the first
+  // request.
+  void set_warm_start(std::shared_ptr<WarmStartState> state) {
+    warm_ = std::move(state);
+  }
+  const std::shared_ptr<WarmStartState>& warm_start() const { return warm_; }
+
   // Expose helper to set per-op timeout on the connection's lowest layer
   void set_op_timeout(Connection& c, std::chrono::seconds t) {
     std::visit([t](auto& s) { beast::get_lowest_layer(s).expires_after(t); },
                c.stream());
   }
 
-  // Acquire a ready connection for the origin (reuses or creates).
-  void acquire(Origin origin, AcquireHandler handler) {
-    net::post(strand_, [this, origin = std::move(origin),
+  // Acquire a ready connection for the origin (reuses or creates). With
+  // cfg.max_active set, waits for a free slot; `priority` orders the wait.
+  void acquire(Origin const& origin, AcquireHandler handler,
+               RequestPriority priority = RequestPriority::normal) {
+    acquire(OriginTable::global().intern(origin), std::move(handler),
+            priority);
+  }
+  // Same, for an already interned origin: no string hashing or copies.
+  void acquire(OriginId id, AcquireHandler handler,
+               RequestPriority priority = RequestPriority::normal) {
+    net::post(strand_, [this, id, priority,
                         handler = std::move(handler)]() mutable {
-      // 1) Try idle list
-      auto& dq = idle_[origin];
-      while (!dq.empty()) {
-        auto c = dq.back();
-        dq.pop_back();
-        if (c && c->alive() && !c->is_expired(cfg_.idle_keep_alive)) {
-          c->set_busy(true);
-          return handler({}, std::move(c));
-        } else if (c) {
-          c->close();
-        }
+      if (!waiters_.empty() || !has_active_slot()) {
+        waiters_.push(priority, Waiter{id, std::move(handler)});
+        return;
       }
-      // 2) Create new
-      auto c = std::make_shared<Connection>(strand_, ssl_ctx_, origin);
-      c->prepare_stream();  // choose TCP vs TLS stream
-      do_resolve_connect(std::move(c), std::move(handler));
+      start_acquire(id, std::move(handler));
     });
   }
 
-  // Return a connection to the pool (if healthy & reusable).
-  void release(Connection::Ptr c, bool can_reuse) {
-    net::post(strand_, [this, c = std::move(c), can_reuse]() mutable {
+  // Return a connection to the pool (if healthy & reusable). Every
+  // connection handed out by acquire() must come back through here.
+  // `outcome` feeds outlier detection for the connection's address.
+  void release(Connection::Ptr c, bool can_reuse,
+               std::optional<RequestOutcome> outcome = std::nullopt) {
+    net::post(strand_, [this, c = std::move(c), can_reuse,
+                        outcome]() mutable {
       if (!c) return;
-      if (!can_reuse || !c->alive()) {
+      if (active_ > 0) --active_;
+      save_tls_session(*c);
+      // A connection to an address DNS no longer returns is not kept.
+      const bool listed = release_endpoint(*c, outcome);
+      if (!can_reuse || !listed || !c->alive() ||
+          c->past_lifetime(cfg_.max_connection_lifetime)) {
         c->close();
+      } else {
+        park_idle(std::move(c));
+      }
+      serve_waiters();
+    });
+  }
+
+  // Take `c` out of the pool for good, e.g. after a protocol upgrade, and
+  // hand its stream to the caller, who closes it when done. Frees the active
+  // slot like release(). Call from a handler running on the pool strand, as
+  // acquire() handlers and pooled I/O handlers do.
+  Connection::StreamVariant detach(Connection::Ptr c) {
+    if (active_ > 0) --active_;
+    save_tls_session(*c);
+    release_endpoint(*c, std::nullopt);
+    auto stream = std::move(c->stream());
+    net::post(strand_, [this] { serve_waiters(); });
+    return stream;
+  }
+
+  // Outcome of a request that started at `started`, for outlier detection.
+  static RequestOutcome outcome_of(
+      boost::system::error_code ec, unsigned status,
+      std::chrono::steady_clock::time_point started) {
+    return RequestOutcome{
+        ec || status >= 500,
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started)};
+  }
+
+  // Use these addresses for `origin` instead of resolving its host (like
+  // curl --resolve). Pinned origins always go through endpoint tracking.
+  void set_endpoints(Origin const& origin, std::vector<tcp::endpoint> eps) {
+    const OriginId id = OriginTable::global().intern(origin);
+    net::post(strand_, [this, id, eps = std::move(eps)]() {
+      auto& state = endpoints_for(id);
+      state.set.pin(eps, std::chrono::steady_clock::now());
+      auto waiting = std::move(state.waiting);
+      state.waiting.clear();
+      for (auto& w : waiting) w({});
+    });
+  }
+
+  // Open connections to `id` ahead of use and park them idle. Idle
+  // connections already there count towards `n`, and the total never exceeds
+  // max_idle_per_origin. All new connections share one DNS lookup. `done`
+  // runs on the pool strand once every attempt has finished, with the first
+  // error seen.
+  void prewarm(OriginId id, std::size_t n,
+               std::function<void(boost::system::error_code)> done) {
+    net::post(strand_, [this, id, n, done = std::move(done)]() mutable {
+      const std::size_t target = std::min(n, cfg_.max_idle_per_origin);
+      const std::size_t idle = idle_for(id).size();
+      if (idle >= target) {
+        done({});
         return;
       }
-      c->set_busy(false);
-      auto& dq = idle_[c->origin()];
-      // Respect per-origin cap
-      if (dq.size() >= cfg_.max_idle_per_origin) {
-        // Drop the oldest
-        auto old = dq.front();
-        dq.pop_front();
-        if (old) old->close();
+      const std::size_t want = target - idle;
+      auto const& origin = OriginTable::global().get(id);
+      if (is_unix(origin) || pinned(id)) {
+        open_warm(id, want, {}, std::move(done));
+        return;
       }
-      dq.push_back(c);
-      shrink_global_if_needed();
-      arm_reap_if_needed_locked();
+      if (auto cached = cached_addresses(origin); !cached.empty()) {
+        if (tracks_endpoints(id)) endpoints_for(id).from_warm_cache = true;
+        // A saved address may be stale: if opening fails, forget it and
+        // prewarm again through DNS.
+        open_warm(id, want, std::move(cached),
+                  [this, id, n, done = std::move(done)](
+                      boost::system::error_code ec) mutable {
+                    if (!ec) return done({});
+                    forget_cached_addresses(id);
+                    prewarm(id, n, std::move(done));
+                  });
+        return;
+      }
+      auto resolver = std::make_shared<tcp::resolver>(strand_);
+      resolver->async_resolve(
+          origin.host, std::to_string(origin.port),
+          net::bind_executor(
+              strand_, [this, id, want, resolver, done = std::move(done)](
+                           boost::system::error_code ec,
+                           tcp::resolver::results_type results) mutable {
+                if (ec) {
+                  done(ec);
+                  return;
+                }
+                remember_addresses(OriginTable::global().get(id), results);
+                open_warm(id, want, {results.begin(), results.end()},
+                          std::move(done));
+              }));
     });
   }
 
   // Convenience: async one-shot request using a pooled connection.
   template <class Request, class ResponseHandler>
-  void async_request(Origin origin, Request req,
+  void async_request(Origin const& origin, Request req,
                      ResponseHandler&& on_response) {
-    acquire(std::move(origin), [this, req = std::move(req),
+    async_request(OriginTable::global().intern(origin), std::move(req),
+                  std::forward<ResponseHandler>(on_response));
+  }
+  template <class Request, class ResponseHandler>
+  void async_request(OriginId id, Request req, ResponseHandler&& on_response) {
+    acquire(id, [this, req = std::move(req),
                                 on_response = std::forward<ResponseHandler>(
                                     on_response)](boost::system::error_code ec,
                                                   Connection::Ptr c) mutable {
@@ -306,20 +445,23 @@ class ConnectionPool {
 
       // Write with per-operation timeout
       set_op_timeout(*c, cfg_.io_timeout);
+      const auto started = std::chrono::steady_clock::now();
 
       std::visit(
-          [this, c, buffer, res, req_ptr, on_response](auto& s) mutable {
+          [this, c, buffer, res, req_ptr, on_response,
+           started](auto& s) mutable {
             using S = std::decay_t<decltype(s)>;
 
             http::async_write(
                 s, *req_ptr,
                 net::bind_executor(
                     c->executor(),
-                    [this, c, buffer, res, req_ptr, on_response](
+                    [this, c, buffer, res, req_ptr, on_response, started](
                         boost::system::error_code ec, std::size_t) {
                       if (ec) {
                         c->close();
-                        this->release(c, /*can_reuse=*/false);
+                        this->release(c, /*can_reuse=*/false,
+                                      RequestOutcome{true, {}});
                         on_response(
                             ec, Request{},
                             http::response<typename Request::body_type>{});
@@ -329,17 +471,22 @@ class ConnectionPool {
                       set_op_timeout(*c, cfg_.io_timeout);
 
                       std::visit(
-                          [this, c, buffer, res, on_response](auto& s2) {
+                          [this, c, buffer, res, on_response,
+                           started](auto& s2) {
                             http::async_read(
                                 s2, *buffer, *res,
                                 net::bind_executor(
                                     c->executor(),
-                                    [this, c, res, on_response](
-                                        boost::system::error_code ec,
-                                        std::size_t) {
+                                    // The buffer must outlive the read.
+                                    [this, c, buffer, res, on_response,
+                                     started](boost::system::error_code ec,
+                                              std::size_t) {
                                       bool reusable = !ec && res->keep_alive();
                                       if (!reusable) c->close();
-                                      this->release(c, reusable);
+                                      this->release(
+                                          c, reusable,
+                                          outcome_of(ec, res->result_int(),
+                                                     started));
                                       on_response(ec, Request{}, *res);
                                     }));
                           },
@@ -352,6 +499,27 @@ class ConnectionPool {
 
  private:
   void do_resolve_connect(Connection::Ptr c, AcquireHandler handler) {
+    if (is_unix(c->origin())) return do_connect_unix(std::move(c), handler);
+    if (auto cached = cached_addresses(c->origin()); !cached.empty()) {
+      // The saved address may be stale (the server moved since it was
+      // cached): on failure forget it and retry once through DNS.
+      const OriginId id = c->origin_id();
+      return do_connect(
+          std::move(c), cached.front(),
+          [this, id, handler](boost::system::error_code ec,
+                              Connection::Ptr conn) {
+            if (!ec) return handler({}, std::move(conn));
+            forget_cached_addresses(id);
+            auto fresh = std::make_shared<Connection>(strand_, ssl_ctx_, id);
+            fresh->prepare_stream();
+            resolve_connect(std::move(fresh), handler);
+          });
+    }
+    resolve_connect(std::move(c), std::move(handler));
+  }
+
+  // Look up the origin's host, then connect to the first address.
+  void resolve_connect(Connection::Ptr c, AcquireHandler handler) {
     auto resolver = std::make_shared<tcp::resolver>(strand_);
     // Apply resolve timeout via cancellation timer (optional). Simpler: rely on
     // OS + connect timeout.
@@ -364,67 +532,428 @@ class ConnectionPool {
             handler(ec, {});
             return;
           }
+          remember_addresses(c->origin(), results);
+          do_connect(c, results.begin()->endpoint(), handler);
+        }));
+  }
 
-          // Connect with timeout
-          std::visit(
-              [this, c, results, handler](auto& s) {
-                using S = std::decay_t<decltype(s)>;
-                if constexpr (std::is_same_v<S, Connection::SslStream>) {
-                  beast::get_lowest_layer(s).expires_after(
-                      cfg_.connect_timeout);
-                  s.lowest_layer().async_connect(
-                      results.begin()->endpoint(),
-                      net::bind_executor(
-                          c->executor(),
-                          [this, c, handler, host = c->origin().host](
-                              boost::system::error_code ec) mutable {
-                            if (ec) {
-                              handler(ec, {});
-                              return;
-                            }
-
-                            // Set SNI on the current SSL stream
-                            auto& ssl_s =
-                                std::get<Connection::SslStream>(c->stream());
-                            SSL_set_tlsext_host_name(ssl_s.native_handle(),
-                                                     host.c_str());
-
-                            // Handshake
-                            beast::get_lowest_layer(ssl_s).expires_after(
-                                cfg_.handshake_timeout);
-                            ssl_s.async_handshake(
-                                ssl::stream_base::client,
-                                net::bind_executor(
-                                    c->executor(),
-                                    [c, handler](boost::system::error_code ec) {
-                                      if (ec) {
-                                        handler(ec, {});
-                                        return;
-                                      }
-                                      c->set_busy(true);
-                                      handler({}, c);
-                                    }));
-                          }));
-                } else {
-                  s.expires_after(cfg_.connect_timeout);
-                  s.async_connect(
-                      results.begin()->endpoint(),
-                      net::bind_executor(
-                          c->executor(),
-                          [c, handler](boost::system::error_code ec) {
-                            if (ec) {
-                              handler(ec, {});
-                              return;
-                            }
-                            c->set_busy(true);
-                            handler({}, c);
-                          }));
-                }
-              },
-              c->stream());
+  // Connect (and handshake for TLS) to an already resolved address.
+  void do_connect(Connection::Ptr c, tcp::endpoint ep,
+                  AcquireHandler handler) {
+    c->set_endpoint(ep);
+    // Connect with timeout
+    std::visit(
+        [this, c, ep, handler](auto& s) {
+          using S = std::decay_t<decltype(s)>;
+          if constexpr (std::is_same_v<S, Connection::SslStream>) {
+            beast::get_lowest_layer(s).expires_after(cfg_.connect_timeout);
+            s.lowest_layer().async_connect(
+                ep,
+                net::bind_executor(
+                    c->executor(),
+                    [this, c, handler, host = c->origin().host](
+                        boost::system::error_code ec) mutable {
+                      if (ec) {
+                        handler(ec, {});
+                        return;
+                      }
+
+                      // Set SNI on the current SSL stream
+                      auto& ssl_s =
+                          std::get<Connection::SslStream>(c->stream());
+                      SSL_set_tlsext_host_name(ssl_s.native_handle(),
+                                               host.c_str());
+                      resume_tls_session(*c, ssl_s.native_handle());
+
+                      // Handshake
+                      beast::get_lowest_layer(ssl_s).expires_after(
+                          cfg_.handshake_timeout);
+                      ssl_s.async_handshake(
+                          ssl::stream_base::client,
+                          net::bind_executor(
+                              c->executor(),
+                              [c, handler](boost::system::error_code ec) {
+                                if (ec) {
+                                  handler(ec, {});
+                                  return;
+                                }
+                                c->set_busy(true);
+                                handler({}, c);
+                              }));
+                    }));
+          } else if constexpr (std::is_same_v<S, Connection::UnixStream>) {
+            // Unix origins never get here (see do_connect_unix).
+            handler(net::error::operation_not_supported, {});
+          } else {
+            s.expires_after(cfg_.connect_timeout);
+            s.async_connect(
+                ep,
+                net::bind_executor(c->executor(),
+                                   [c, handler](boost::system::error_code ec) {
+                                     if (ec) {
+                                       handler(ec, {});
+                                       return;
+                                     }
+                                     c->set_busy(true);
+                                     handler({}, c);
+                                   }));
+          }
+        },
+        c->stream());
+  }
+
+  // Must be called on strand_.
+  bool has_active_slot() const {
+    return cfg_.max_active == 0 || active_ < cfg_.max_active;
+  }
+
+  bool reusable(Connection const& c) const {
+    return c.alive() && !c.is_expired(cfg_.idle_keep_alive) &&
+           !c.past_lifetime(cfg_.max_connection_lifetime);
+  }
+
+  // Must be called on strand_.
+  bool tracks_endpoints(OriginId id) const {
+    if (is_unix(OriginTable::global().get(id))) return false;
+    return cfg_.endpoint_policy != EndpointPolicy::first ||
+           cfg_.outlier_detection.enabled() || pinned(id);
+  }
+
+  // Must be called on strand_.
+  bool pinned(OriginId id) const {
+    auto it = endpoints_.find(id);
+    return it != endpoints_.end() && it->second.set.pinned();
+  }
+
+  // Must be called on strand_. Takes an active slot until release(), or
+  // until the connect fails.
+  void start_acquire(OriginId id, AcquireHandler handler) {
+    ++active_;
+    if (warm_) {
+      auto const& origin = OriginTable::global().get(id);
+      if (!is_unix(origin)) warm_->note_use(warm_ref(origin));
+    }
+    if (tracks_endpoints(id)) {
+      return start_acquire_tracked(id, std::move(handler));
+    }
+    // 1) Try idle list
+    auto& dq = idle_for(id);
+    while (!dq.empty()) {
+      auto c = dq.back();
+      dq.pop_back();
+      if (c && reusable(*c)) {
+        c->set_busy(true);
+        return handler({}, std::move(c));
+      } else if (c) {
+        c->close();
+      }
+    }
+    // 2) Create new
+    auto c = std::make_shared<Connection>(strand_, ssl_ctx_, id);
+    c->prepare_stream();  // choose TCP vs TLS stream
+    do_resolve_connect(std::move(c), release_slot_on_error(std::move(handler)));
+  }
+
+  // Connect handlers run on strand_, so the slot can be returned inline.
+  AcquireHandler release_slot_on_error(AcquireHandler handler) {
+    return [this, handler = std::move(handler)](boost::system::error_code ec,
+                                                Connection::Ptr conn) {
+      if (ec) {
+        if (active_ > 0) --active_;
+        serve_waiters();
+      }
+      handler(ec, std::move(conn));
+    };
+  }
+
+  // Must be called on strand_. Uses the cached address list, refreshing it
+  // in the background once stale; only the first lookup is waited for.
+  void start_acquire_tracked(OriginId id, AcquireHandler handler) {
+    auto& state = endpoints_for(id);
+    auto& set = state.set;
+    if (set.empty()) {
+      auto cached = cached_addresses(OriginTable::global().get(id));
+      if (!cached.empty()) {
+        set.update(cached, std::chrono::steady_clock::now());
+        state.from_warm_cache = true;
+      }
+    }
+    if (set.empty()) {
+      endpoints_for(id).waiting.push_back(
+          [this, id, handler = std::move(handler)](
+              boost::system::error_code ec) mutable {
+            if (ec) return release_slot_on_error(std::move(handler))(ec, {});
+            acquire_on_endpoint(id, std::move(handler));
+          });
+      refresh_endpoints(id);
+      return;
+    }
+    if (set.stale(cfg_.endpoint_refresh, std::chrono::steady_clock::now())) {
+      refresh_endpoints(id);
+    }
+    acquire_on_endpoint(id, std::move(handler));
+  }
+
+  // Must be called on strand_. Requires a non-empty address list.
+  void acquire_on_endpoint(OriginId id, AcquireHandler handler) {
+    auto& set = endpoints_for(id).set;
+    const auto now = std::chrono::steady_clock::now();
+    const tcp::endpoint ep =
+        set.loads()[set.pick(cfg_.endpoint_policy, now)].endpoint;
+    ++set.find(ep)->active;
+    // Reuse an idle connection to the chosen address, newest first.
+    auto& dq = idle_for(id);
+    for (auto it = dq.end(); it != dq.begin();) {
+      --it;
+      if (!*it || (*it)->endpoint() != ep) continue;
+      auto c = std::move(*it);
+      it = dq.erase(it);
+      if (reusable(*c)) {
+        c->set_busy(true);
+        return handler({}, std::move(c));
+      }
+      c->close();
+    }
+    auto c = std::make_shared<Connection>(strand_, ssl_ctx_, id);
+    c->prepare_stream();
+    do_connect(std::move(c), ep,
+               [this, id, ep, handler = std::move(handler)](
+                   boost::system::error_code ec,
+                   Connection::Ptr conn) mutable {
+                 if (ec) {
+                   auto& state = endpoints_for(id);
+                   if (auto* l = state.set.find(ep)) {
+                     if (l->active > 0) --l->active;
+                   }
+                   if (state.from_warm_cache) {
+                     // The saved addresses may be stale: forget them and
+                     // retry once through DNS, keeping the active slot.
+                     forget_cached_addresses(id);
+                     return start_acquire_tracked(id, std::move(handler));
+                   }
+                   state.set.report(ep, RequestOutcome{true, {}},
+                                    cfg_.outlier_detection,
+                                    std::chrono::steady_clock::now());
+                 }
+                 release_slot_on_error(std::move(handler))(ec,
+                                                           std::move(conn));
+               });
+  }
+
+  // Must be called on strand_. At most one lookup per origin is in flight.
+  void refresh_endpoints(OriginId id) {
+    auto& state = endpoints_for(id);
+    if (state.resolving) return;
+    state.resolving = true;
+    auto const& origin = OriginTable::global().get(id);
+    auto resolver = std::make_shared<tcp::resolver>(strand_);
+    resolver->async_resolve(
+        origin.host, std::to_string(origin.port),
+        net::bind_executor(strand_, [this, id, resolver](
+                                        boost::system::error_code ec,
+                                        tcp::resolver::results_type results) {
+          auto& state = endpoints_for(id);
+          state.resolving = false;
+          const auto now = std::chrono::steady_clock::now();
+          if (!ec && !results.empty()) {
+            state.set.update(results, now);
+            state.from_warm_cache = false;
+            remember_addresses(OriginTable::global().get(id), results);
+          } else {
+            // Keep serving the last good list; retry after endpoint_refresh.
+            state.set.touch(now);
+            if (!ec) ec = net::error::host_not_found;
+          }
+          auto waiting = std::move(state.waiting);
+          state.waiting.clear();
+          const auto result = state.set.empty() ? ec
+                                                : boost::system::error_code{};
+          for (auto& w : waiting) w(result);
         }));
   }
 
+  // Must be called on strand_. Returns false when the connection's address
+  // has dropped out of DNS or was just ejected, so it should not be pooled
+  // again.
+  bool release_endpoint(Connection const& c,
+                        std::optional<RequestOutcome> const& outcome) {
+    if (!tracks_endpoints(c.origin_id())) return true;
+    auto& set = endpoints_for(c.origin_id()).set;
+    auto* load = set.find(c.endpoint());
+    if (!load) return false;
+    if (load->active > 0) --load->active;
+    if (!outcome) return true;
+    return !set.report(c.endpoint(), *outcome, cfg_.outlier_detection,
+                       std::chrono::steady_clock::now());
+  }
+
+  // Must be called on strand_.
+  void serve_waiters() {
+    while (!waiters_.empty() && has_active_slot()) {
+      Waiter w = waiters_.pop();
+      start_acquire(w.id, std::move(w.handler));
+    }
+  }
+
+  // Must be called on strand_.
+  void park_idle(Connection::Ptr c) {
+    c->set_busy(false);
+    auto& dq = idle_for(c->origin_id());
+    // Respect per-origin cap
+    if (dq.size() >= cfg_.max_idle_per_origin) {
+      // Drop the oldest
+      auto old = dq.front();
+      dq.pop_front();
+      if (old) old->close();
+    }
+    dq.push_back(std::move(c));
+    shrink_global_if_needed();
+    arm_reap_if_needed_locked();
+  }
+
+  // Must be called on strand_. `addresses` is unused for Unix origins. With
+  // endpoint tracking the connections are spread over all usable addresses.
+  void open_warm(OriginId id, std::size_t want,
+                 std::vector<tcp::endpoint> addresses,
+                 std::function<void(boost::system::error_code)> done) {
+    std::vector<tcp::endpoint> targets;
+    if (!is_unix(OriginTable::global().get(id))) {
+      if (tracks_endpoints(id)) {
+        auto& set = endpoints_for(id).set;
+        const auto now = std::chrono::steady_clock::now();
+        if (!set.pinned()) set.update(addresses, now);
+        for (auto const& l : set.loads()) {
+          if (!set.ejected(l, now)) targets.push_back(l.endpoint);
+        }
+      } else if (!addresses.empty()) {
+        targets.push_back(addresses.front());
+      }
+      if (targets.empty()) {
+        done(net::error::host_not_found);
+        return;
+      }
+    }
+    struct Progress {
+      std::size_t remaining;
+      boost::system::error_code first_ec;
+      std::function<void(boost::system::error_code)> done;
+    };
+    auto progress = std::make_shared<Progress>(
+        Progress{want, {}, std::move(done)});
+    for (std::size_t i = 0; i < want; ++i) {
+      auto c = std::make_shared<Connection>(strand_, ssl_ctx_, id);
+      c->prepare_stream();
+      auto on_open = [this, progress](boost::system::error_code ec,
+                                      Connection::Ptr conn) {
+        if (ec) {
+          if (!progress->first_ec) progress->first_ec = ec;
+        } else {
+          park_idle(std::move(conn));  // never held an active slot
+        }
+        if (--progress->remaining == 0) progress->done(progress->first_ec);
+      };
+      if (is_unix(c->origin())) {
+        do_connect_unix(std::move(c), std::move(on_open));
+      } else {
+        do_connect(std::move(c), targets[i % targets.size()],
+                   std::move(on_open));
+      }
+    }
+  }
+
+  static WarmOriginRef warm_ref(Origin const& o) {
+    return WarmOriginRef{o.scheme, o.host, o.port};
+  }
+
+  // Must be called on strand_. Drops addresses taken from the warm-start
+  // cache after connecting to them failed, so the next attempt resolves.
+  void forget_cached_addresses(OriginId id) {
+    if (warm_) warm_->forget_addresses(warm_ref(OriginTable::global().get(id)));
+    auto it = endpoints_.find(id);
+    if (it != endpoints_.end() && it->second.from_warm_cache) {
+      it->second.set = EndpointSet{};
+      it->second.from_warm_cache = false;
+    }
+  }
+
+  // Addresses from an earlier run still within warm_dns_ttl, if any.
+  std::vector<tcp::endpoint> cached_addresses(Origin const& o) const {
+    if (!warm_) return {};
+    return warm_->addresses(warm_ref(o));
+  }
+
+  void remember_addresses(Origin const& o,
+                          tcp::resolver::results_type const& results) {
+    if (!warm_) return;
+    std::vector<tcp::endpoint> eps;
+    for (auto const& r : results) eps.push_back(r.endpoint());
+    warm_->set_addresses(warm_ref(o), eps, cfg_.warm_dns_ttl);
+  }
+
+  // Offer a saved session for abbreviated handshakes. A session the server
+  // no longer accepts just costs a full handshake.
+  void resume_tls_session(Connection const& c, SSL* ssl) {
+    if (!warm_) return;
+    const std::string der = warm_->tls_session(warm_ref(c.origin()));
+    if (der.empty()) return;
+    auto const* p = reinterpret_cast<const unsigned char*>(der.data());
+    SSL_SESSION* session =
+        d2i_SSL_SESSION(nullptr, &p, static_cast<long>(der.size()));
+    if (!session) return;
+    SSL_set_session(ssl, session);
+    SSL_SESSION_free(session);
+  }
+
+  // Must be called on strand_. Called on release, once the first response
+  // has been read, so TLS 1.3 tickets sent after the handshake are in.
+  void save_tls_session(Connection& c) {
+    if (!warm_ || c.session_saved() || !c.is_ssl() || !c.alive() ||
+        !is_https(c.origin())) {
+      return;
+    }
+    c.mark_session_saved();
+    auto& s = std::get<Connection::SslStream>(c.stream());
+    SSL_SESSION* session = SSL_get1_session(s.native_handle());
+    if (!session) return;
+    if (SSL_SESSION_is_resumable(session)) {
+      const int len = i2d_SSL_SESSION(session, nullptr);
+      if (len > 0) {
+        std::string der(static_cast<std::size_t>(len), '\0');
+        auto* p = reinterpret_cast<unsigned char*>(der.data());
+        i2d_SSL_SESSION(session, &p);
+        warm_->set_tls_session(
+            warm_ref(c.origin()), std::move(der),
+            static_cast<std::int64_t>(SSL_SESSION_get_time(session)) +
+                static_cast<std::int64_t>(SSL_SESSION_get_timeout(session)));
+      }
+    }
+    SSL_SESSION_free(session);
+  }
+
+  // Local sidecars: no lookup, just connect to the socket path.
+  void do_connect_unix(Connection::Ptr c, AcquireHandler handler) {
+    net::local::stream_protocol::endpoint ep;
+    try {
+      ep = net::local::stream_protocol::endpoint(c->origin().socket_path);
+    } catch (const boost::system::system_error& e) {
+      // Path longer than sun_path.
+      handler(e.code(), {});
+      return;
+    }
+    auto& s = std::get<Connection::UnixStream>(c->stream());
+    s.expires_after(cfg_.connect_timeout);
+    s.async_connect(ep, net::bind_executor(
+                            c->executor(),
+                            [c, handler](boost::system::error_code ec) {
+                              if (ec) {
+                                handler(ec, {});
+                                return;
+                              }
+                              c->set_busy(true);
+                              handler({}, c);
+                            }));
+  }
+
   void schedule_reap() {
     if (cfg_.idle_reap_interval.count() <= 0) {
       reaper_armed_ = false;
@@ -434,26 +963,21 @@ class ConnectionPool {
     reap_timer_.async_wait(
         net::bind_executor(strand_, [this](boost::system::error_code) {
           // Per-origin prune
-          for (auto it = idle_.begin(); it != idle_.end();) {
-            auto& dq = it->second;
-            for (auto it2 = dq.begin(); it2 != dq.end();) {
-              auto& c = *it2;
+          for (auto& [id, dq] : idle_) {
+            for (auto it = dq.begin(); it != dq.end();) {
+              auto& c = *it;
               if (!c || !c->alive() || c->is_expired(cfg_.idle_keep_alive)) {
                 if (c) c->close();
-                it2 = dq.erase(it2);
+                it = dq.erase(it);
               } else {
-                ++it2;
+                ++it;
               }
             }
-            if (dq.empty())
-              it = idle_.erase(it);
-            else
-              ++it;
           }
           shrink_global_if_needed();
+          forget_unused_origins();
           // Re-arm only if we still have idle connections and reaper enabled
-          std::size_t total = 0;
-          for (auto const& kv : idle_) total += kv.second.size();
+          const std::size_t total = total_idle();
           if (total > 0 && cfg_.idle_reap_interval.count() > 0) {
             schedule_reap();
           } else {
@@ -464,8 +988,7 @@ class ConnectionPool {
 
   void shrink_global_if_needed() {
     // Coarse global idle cap: drop oldest across origins if needed
-    std::size_t total = 0;
-    for (auto const& kv : idle_) total += kv.second.size();
+    std::size_t total = total_idle();
     if (total <= cfg_.max_total_idle) return;
 
     // Repeatedly remove from the largest deques first.
@@ -479,7 +1002,38 @@ class ConnectionPool {
       it->second.pop_front();
       if (c) c->close();
       --total;
-      if (it->second.empty()) idle_.erase(it);
+    }
+  }
+
+  // Must be called on strand_. Adds an entry on first use of an id.
+  std::deque<Connection::Ptr>& idle_for(OriginId id) { return idle_[id]; }
+
+  std::size_t total_idle() const {
+    std::size_t total = 0;
+    for (auto const& [id, dq] : idle_) total += dq.size();
+    return total;
+  }
+
+  // Must be called on strand_. Drops the per-origin entries of origins with
+  // no idle connections and, for address lists, nothing in flight, pending
+  // or ejected, so a pool that has talked to many hosts does not keep a
+  // slot for each. Pinned address lists are configuration and stay.
+  void forget_unused_origins() {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = endpoints_.begin(); it != endpoints_.end();) {
+      auto const& st = it->second;
+      auto idle = idle_.find(it->first);
+      const bool in_use =
+          st.set.pinned() || st.resolving || !st.waiting.empty() ||
+          (idle != idle_.end() && !idle->second.empty()) ||
+          std::any_of(st.set.loads().begin(), st.set.loads().end(),
+                      [&](auto const& l) {
+                        return l.active > 0 || st.set.ejected(l, now);
+                      });
+      it = in_use ? std::next(it) : endpoints_.erase(it);
+    }
+    for (auto it = idle_.begin(); it != idle_.end();) {
+      it = it->second.empty() ? idle_.erase(it) : std::next(it);
     }
   }
 
@@ -491,15 +1045,40 @@ class ConnectionPool {
   net::steady_timer reap_timer_;
   bool reaper_armed_ = false;
 
-  std::unordered_map<Origin, std::deque<Connection::Ptr>, OriginHash> idle_;
+  // Idle connections per OriginId; empty entries are dropped by the reaper.
+  std::unordered_map<OriginId, std::deque<Connection::Ptr>> idle_;
+
+  // Connections checked out or connecting; bounded by cfg_.max_active.
+  struct Waiter {
+    OriginId id;
+    AcquireHandler handler;
+  };
+  std::size_t active_ = 0;
+  client_async::WeightedFairQueue<Waiter> waiters_;
+
+  // Resolved addresses per OriginId (only for origins that track them).
+  // Node-based, so references survive inserts; the reaper drops unused
+  // entries.
+  struct OriginEndpoints {
+    EndpointSet set;
+    bool resolving = false;
+    // `set` came from the warm-start cache and no lookup has confirmed it.
+    bool from_warm_cache = false;
+    // Acquires waiting for the first lookup.
+    std::vector<std::function<void(boost::system::error_code)>> waiting;
+  };
+  std::unordered_map<OriginId, OriginEndpoints> endpoints_;
+
+  std::shared_ptr<WarmStartState> warm_;  // optional
+
+  // Must be called on strand_.
+  OriginEndpoints& endpoints_for(OriginId id) { return endpoints_[id]; }
 
   // Must be called on strand_
   void arm_reap_if_needed_locked() {
     if (cfg_.idle_reap_interval.count() <= 0) return;  // disabled
     if (reaper_armed_) return;
-    std::size_t total = 0;
-    for (auto const& kv : idle_) total += kv.second.size();
-    if (total == 0) return;
+    if (total_idle() == 0) return;
     reaper_armed_ = true;
     schedule_reap();
   }
@@ -0,0 +1,497 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/fields.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "http_date.hpp"
+
+namespace client_async {
+
+// One stored cookie (RFC 6265 section 5.3).
+struct Cookie {
+  using clock = std::chrono::system_clock;
+
+  std::string name;
+  std::string value;
+  std::string domain;  // lowercase, no leading dot
+  std::string path;
+  std::optional<clock::time_point> expires;  // nullopt = session cookie
+  bool host_only = true;  // no Domain attribute: exact host only
+  bool secure = false;
+  bool http_only = false;
+  clock::time_point created{};
+  std::uint64_t seq = 0;  // set by the jar; orders equal creation times
+};
+
+// Cookies received through Set-Cookie, replayed on later requests to
+// matching origins. Each Set-Cookie header is parsed once into a Cookie;
+// cookies are bucketed by reversed domain ("com.example.api"), so a lookup
+// only visits the buckets for the request host's own suffixes, and each
+// bucket is kept in RFC 6265 send order (longest path first). Expiry is
+// driven by a min-heap, so stale cookies are dropped without scanning the
+// jar.
+//
+// There is no public suffix list: a Domain attribute must be a suffix of
+// the request host with at least one dot, which stops "com" but not
+// "co.uk". Thread-safe.
+class CookieJar {
+ public:
+  using clock = Cookie::clock;
+  using fields = boost::beast::http::fields;
+
+  explicit CookieJar(std::size_t max_per_domain = 50)
+      : max_per_domain_(max_per_domain) {}
+
+  // Leading "name=value" of a Set-Cookie header, trimmed. Name is empty if
+  // the header has no '='.
+  static std::pair<std::string_view, std::string_view> cookie_pair(
+      std::string_view header) {
+    const auto semi = header.find(';');
+    auto pair = header.substr(0, semi);
+    const auto eq = pair.find('=');
+    if (eq == std::string_view::npos) return {};
+    return {trim(pair.substr(0, eq)), trim(pair.substr(eq + 1))};
+  }
+
+  // Parse one Set-Cookie header sent in response to a request for
+  // `request_path` on `request_host` (lowercase). Returns nullopt for
+  // headers a user agent must ignore.
+  static std::optional<Cookie> parse_set_cookie(std::string_view header,
+                                                std::string_view request_host,
+                                                std::string_view request_path,
+                                                clock::time_point now) {
+    auto [name, value] = cookie_pair(header);
+    if (name.empty()) return std::nullopt;
+    Cookie c;
+    c.name = std::string(name);
+    c.value = std::string(value);
+    c.created = now;
+    std::optional<clock::time_point> expires_attr;
+    std::optional<clock::time_point> max_age_attr;
+    std::string_view domain_attr;
+    std::string_view path_attr;
+
+    auto rest = header.substr(std::min(header.find(';'), header.size()));
+    while (!rest.empty()) {
+      rest.remove_prefix(1);  // ';'
+      const auto end = std::min(rest.find(';'), rest.size());
+      const auto av = rest.substr(0, end);
+      rest.remove_prefix(end);
+      const auto eq = av.find('=');
+      const auto key = trim(av.substr(0, eq));
+      const auto val = eq == std::string_view::npos
+                           ? std::string_view{}
+                           : trim(av.substr(eq + 1));
+      if (iequals(key, "expires")) {
+        expires_attr = http_date::parse(val);
+      } else if (iequals(key, "max-age")) {
+        if (auto secs = parse_int(val)) {
+          max_age_attr = *secs <= 0 ? clock::time_point{}
+                                    : now + std::chrono::seconds(*secs);
+        }
+      } else if (iequals(key, "domain")) {
+        domain_attr = val;
+      } else if (iequals(key, "path")) {
+        path_attr = val;
+      } else if (iequals(key, "secure")) {
+        c.secure = true;
+      } else if (iequals(key, "httponly")) {
+        c.http_only = true;
+      }
+    }
+    // Max-Age wins over Expires.
+    c.expires = max_age_attr ? max_age_attr : expires_attr;
+
+    if (!domain_attr.empty() && domain_attr.front() == '.') {
+      domain_attr.remove_prefix(1);
+    }
+    if (domain_attr.empty()) {
+      c.domain = std::string(request_host);
+    } else {
+      c.domain = lower(domain_attr);
+      if (!domain_match(request_host, c.domain)) return std::nullopt;
+      if (c.domain != request_host &&
+          c.domain.find('.') == std::string::npos) {
+        return std::nullopt;  // Domain=com
+      }
+      c.host_only = false;
+    }
+    c.path = !path_attr.empty() && path_attr.front() == '/'
+                 ? std::string(path_attr)
+                 : default_path(request_path);
+    return c;
+  }
+
+  // Store every Set-Cookie of a response to `request_target` (origin-form,
+  // query allowed) on `host`.
+  void store(std::string_view host, std::string_view request_target,
+             const fields& response_fields,
+             clock::time_point now = clock::now()) {
+    const std::string h = lower(host);
+    const auto path = target_path(request_target);
+    auto range =
+        response_fields.equal_range(boost::beast::http::field::set_cookie);
+    if (range.first == range.second) return;
+    std::lock_guard<std::mutex> lk(mu_);
+    for (auto it = range.first; it != range.second; ++it) {
+      const auto header = it->value();
+      if (auto c = parse_set_cookie(
+              std::string_view(header.data(), header.size()), h, path, now)) {
+        add_locked(std::move(*c), now);
+      }
+    }
+  }
+
+  void add(Cookie c, clock::time_point now = clock::now()) {
+    std::lock_guard<std::mutex> lk(mu_);
+    add_locked(std::move(c), now);
+  }
+
+  // Value of the Cookie request header for `request_target` on `host`
+  // ("a=1; b=2"), or empty when nothing matches. `secure` is true for https.
+  std::string cookie_header(std::string_view host,
+                            std::string_view request_target, bool secure,
+                            clock::time_point now = clock::now()) {
+    const std::string h = lower(host);
+    const auto path = target_path(request_target);
+    std::lock_guard<std::mutex> lk(mu_);
+    purge_expired_locked(now);
+    if (buckets_.empty()) return {};
+    std::vector<const Cookie*> matched;
+    std::size_t buckets_hit = 0;
+    std::size_t bytes = 0;
+    for_each_suffix(h, [&](const std::string& rdomain) {
+      auto it = buckets_.find(rdomain);
+      if (it == buckets_.end()) return;
+      bool hit = false;
+      for (auto const& c : it->second) {
+        if (c.host_only && c.domain != h) continue;
+        if (c.secure && !secure) continue;
+        if (!path_match(path, c.path)) continue;
+        matched.push_back(&c);
+        bytes += c.name.size() + c.value.size() + 3;
+        hit = true;
+      }
+      if (hit) ++buckets_hit;
+    });
+    if (buckets_hit > 1) {
+      std::stable_sort(matched.begin(), matched.end(), send_order);
+    }
+    std::string out;
+    out.reserve(bytes);
+    for (auto const* c : matched) {
+      if (!out.empty()) out.append("; ");
+      out.append(c->name).push_back('=');
+      out.append(c->value);
+    }
+    return out;
+  }
+
+  // Add the jar's cookies for the request to its Cookie header, after any
+  // cookies the caller set.
+  template <class Request>
+  void apply(Request& req, std::string_view host, bool secure,
+             clock::time_point now = clock::now()) {
+    const auto target = req.target();
+    auto header = cookie_header(
+        host, std::string_view(target.data(), target.size()), secure, now);
+    if (header.empty()) return;
+    auto existing = req.find(boost::beast::http::field::cookie);
+    if (existing != req.end() && !existing->value().empty()) {
+      std::string merged(existing->value());
+      merged.append("; ").append(header);
+      header = std::move(merged);
+    }
+    req.set(boost::beast::http::field::cookie, header);
+  }
+
+  // Value of cookie `name` that would be sent to `host` at `path`.
+  std::optional<std::string> get(std::string_view name, std::string_view host,
+                                 std::string_view path = "/",
+                                 clock::time_point now = clock::now()) {
+    const std::string h = lower(host);
+    std::lock_guard<std::mutex> lk(mu_);
+    purge_expired_locked(now);
+    std::optional<std::string> found;
+    for_each_suffix(h, [&](const std::string& rdomain) {
+      auto it = buckets_.find(rdomain);
+      if (found || it == buckets_.end()) return;
+      for (auto const& c : it->second) {
+        if (c.name == name && (!c.host_only || c.domain == h) &&
+            path_match(path, c.path)) {
+          found = c.value;
+          return;
+        }
+      }
+    });
+    return found;
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return cookies_;
+  }
+
+  // Queued expiry deadlines, live or left by replaced cookies. Kept within
+  // a small multiple of size().
+  std::size_t pending_expiries() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return expiry_.size();
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lk(mu_);
+    buckets_.clear();
+    expiry_ = {};
+    cookies_ = 0;
+  }
+
+  // Drop expired cookies now instead of on the next lookup.
+  void purge_expired(clock::time_point now = clock::now()) {
+    std::lock_guard<std::mutex> lk(mu_);
+    purge_expired_locked(now);
+  }
+
+  // "com.example.api" for "api.example.com".
+  static std::string reverse_domain(std::string_view domain) {
+    std::string out;
+    out.reserve(domain.size());
+    std::size_t end = domain.size();
+    while (true) {
+      const auto dot = domain.rfind('.', end == 0 ? 0 : end - 1);
+      if (dot == std::string_view::npos || end == 0) {
+        out.append(domain.substr(0, end));
+        break;
+      }
+      out.append(domain.substr(dot + 1, end - dot - 1));
+      out.push_back('.');
+      end = dot;
+    }
+    return out;
+  }
+
+
+ private:
+  struct Expiry {
+    clock::time_point at;
+    std::string rdomain;
+    std::string name;
+    std::string path;
+    bool operator>(const Expiry& o) const { return at > o.at; }
+  };
+
+  // Must hold mu_.
+  void add_locked(Cookie c, clock::time_point now) {
+    const std::string rdomain = reverse_domain(c.domain);
+    auto& bucket = buckets_[rdomain];
+    auto same =
+        std::find_if(bucket.begin(), bucket.end(), [&](const Cookie& o) {
+          return o.name == c.name && o.path == c.path &&
+                 o.host_only == c.host_only;
+        });
+    // A replaced cookie with the same deadline already has its entry.
+    bool queued = false;
+    if (same != bucket.end()) {
+      c.created = same->created;  // keeps its place in send order
+      c.seq = same->seq;
+      queued = same->expires && same->expires == c.expires;
+      bucket.erase(same);
+      --cookies_;
+    } else {
+      c.seq = ++seq_;
+    }
+    if (c.expires && *c.expires <= now) {
+      // An expired Set-Cookie is how servers delete cookies.
+      if (bucket.empty()) buckets_.erase(rdomain);
+      return;
+    }
+    if (c.expires && !queued) {
+      expiry_.push(Expiry{*c.expires, rdomain, c.name, c.path});
+    }
+    auto pos =
+        std::upper_bound(bucket.begin(), bucket.end(), c, send_order_ref);
+    bucket.insert(pos, std::move(c));
+    ++cookies_;
+    if (bucket.size() > max_per_domain_) {
+      auto oldest = std::min_element(
+          bucket.begin(), bucket.end(), [](const Cookie& a, const Cookie& b) {
+            return a.created != b.created ? a.created < b.created
+                                          : a.seq < b.seq;
+          });
+      bucket.erase(oldest);
+      --cookies_;
+    }
+    compact_expiry_locked();
+  }
+
+  // Must hold mu_. Replaced and evicted cookies leave their entries in
+  // expiry_ until the old deadline; a server that slides a long-lived
+  // cookie on every response would pile them up. Rebuild from the live
+  // cookies once stale entries dominate (amortized O(1) per add).
+  void compact_expiry_locked() {
+    if (expiry_.size() <= 2 * cookies_ + kExpirySlack) return;
+    std::vector<Expiry> live;
+    live.reserve(cookies_);
+    for (auto const& [rdomain, bucket] : buckets_) {
+      for (auto const& c : bucket) {
+        if (c.expires) {
+          live.push_back(Expiry{*c.expires, rdomain, c.name, c.path});
+        }
+      }
+    }
+    expiry_ = decltype(expiry_)(std::greater<Expiry>{}, std::move(live));
+  }
+
+  // Must hold mu_.
+  void purge_expired_locked(clock::time_point now) {
+    while (!expiry_.empty() && expiry_.top().at <= now) {
+      const Expiry e = expiry_.top();
+      expiry_.pop();
+      auto it = buckets_.find(e.rdomain);
+      if (it == buckets_.end()) continue;
+      auto& bucket = it->second;
+      // Entries for replaced cookies are stale; only drop an exact match.
+      auto dead = std::remove_if(bucket.begin(), bucket.end(),
+                                 [&](const Cookie& c) {
+                                   return c.name == e.name &&
+                                          c.path == e.path && c.expires &&
+                                          *c.expires == e.at;
+                                 });
+      cookies_ -= static_cast<std::size_t>(bucket.end() - dead);
+      bucket.erase(dead, bucket.end());
+      if (bucket.empty()) buckets_.erase(it);
+    }
+  }
+
+  // Calls f with the reversed form of each domain `host` belongs to,
+  // shortest first: "com", "com.example", "com.example.api".
+  template <class F>
+  static void for_each_suffix(const std::string& host, F&& f) {
+    const std::string rhost = reverse_domain(host);
+    for (std::size_t pos = rhost.find('.'); pos != std::string::npos;
+         pos = rhost.find('.', pos + 1)) {
+      f(rhost.substr(0, pos));
+    }
+    f(rhost);
+  }
+
+  static bool send_order(const Cookie* a, const Cookie* b) {
+    return send_order_ref(*a, *b);
+  }
+  // Longer paths first, then older cookies first (RFC 6265 5.4 step 2).
+  static bool send_order_ref(const Cookie& a, const Cookie& b) {
+    if (a.path.size() != b.path.size()) return a.path.size() > b.path.size();
+    if (a.created != b.created) return a.created < b.created;
+    return a.seq < b.seq;
+  }
+
+  static bool domain_match(std::string_view host, std::string_view domain) {
+    if (host == domain) return true;
+    if (is_ip_literal(host)) return false;
+    return host.size() > domain.size() &&
+           host.compare(host.size() - domain.size(), domain.size(), domain) ==
+               0 &&
+           host[host.size() - domain.size() - 1] == '.';
+  }
+
+  static bool path_match(std::string_view request_path,
+                         std::string_view cookie_path) {
+    if (request_path.compare(0, cookie_path.size(), cookie_path) != 0) {
+      return false;
+    }
+    return request_path.size() == cookie_path.size() ||
+           cookie_path.back() == '/' ||
+           request_path[cookie_path.size()] == '/';
+  }
+
+  static std::string default_path(std::string_view request_path) {
+    if (request_path.empty() || request_path.front() != '/') return "/";
+    const auto slash = request_path.rfind('/');
+    if (slash == 0) return "/";
+    return std::string(request_path.substr(0, slash));
+  }
+
+  static std::string_view target_path(std::string_view target) {
+    target = target.substr(0, std::min(target.find('?'), target.size()));
+    return target.empty() ? std::string_view("/") : target;
+  }
+
+  static bool is_ip_literal(std::string_view host) {
+    return host.find(':') != std::string_view::npos ||
+           std::all_of(host.begin(), host.end(), [](char ch) {
+             return (ch >= '0' && ch <= '9') || ch == '.';
+           });
+  }
+
+  static std::string_view trim(std::string_view s) {
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+      s.remove_prefix(1);
+    }
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+      s.remove_suffix(1);
+    }
+    return s;
+  }
+
+  static char lower_char(char ch) {
+    return (ch >= 'A' && ch <= 'Z') ? static_cast<char>(ch - 'A' + 'a') : ch;
+  }
+
+  static std::string lower(std::string_view s) {
+    std::string out(s);
+    for (auto& ch : out) ch = lower_char(ch);
+    return out;
+  }
+
+  static bool iequals(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (std::size_t i = 0; i < a.size(); ++i) {
+      if (lower_char(a[i]) != lower_char(b[i])) return false;
+    }
+    return true;
+  }
+
+  static std::optional<long long> parse_int(std::string_view s) {
+    bool negative = false;
+    if (!s.empty() && s.front() == '-') {
+      negative = true;
+      s.remove_prefix(1);
+    }
+    if (s.empty() || s.size() > 18 || leading_digits(s) != s.size()) {
+      return std::nullopt;
+    }
+    long long v = 0;
+    for (char ch : s) v = v * 10 + (ch - '0');
+    return negative ? -v : v;
+  }
+
+  static std::size_t leading_digits(std::string_view s) {
+    std::size_t n = 0;
+    while (n < s.size() && s[n] >= '0' && s[n] <= '9') ++n;
+    return n;
+  }
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, std::vector<Cookie>> buckets_;
+  std::priority_queue<Expiry, std::vector<Expiry>, std::greater<Expiry>>
+      expiry_;
+  std::size_t max_per_domain_;
+  std::uint64_t seq_ = 0;
+  std::size_t cookies_ = 0;  // across buckets_
+  static constexpr std::size_t kExpirySlack = 64;
+};
+
+}  // namespace client_async
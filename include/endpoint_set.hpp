@@ -0,0 +1,233 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio/ip/tcp.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+namespace beast_pool {
+
+// How ConnectionPool spreads connections over the addresses a host
+// resolves to.
+enum class EndpointPolicy {
+  first,              // always the first resolved address (classic behaviour)
+  least_outstanding,  // fewest in-flight requests, round-robin on ties
+  power_of_two,       // lighter of two random addresses
+};
+
+// Passive health checking of resolved addresses. An address that fails
+// `consecutive_failures` requests in a row (5xx, transport error, or a
+// latency outlier) is ejected from selection for base_ejection, doubling on
+// each repeat ejection up to max_ejection.
+struct OutlierDetection {
+  std::size_t consecutive_failures{0};  // 0 = disabled
+  std::chrono::milliseconds base_ejection{30000};
+  std::chrono::milliseconds max_ejection{300000};
+  // Never eject more than this share of an origin's addresses (rounded
+  // down, so an origin with a single address is never ejected).
+  double max_ejected_fraction{0.5};
+  // Count a response as a failure when the address's smoothed latency
+  // exceeds latency_factor times the mean of its peers (0 = off). Needs
+  // latency_min_samples samples on the address first.
+  double latency_factor{0};
+  std::size_t latency_min_samples{20};
+
+  bool enabled() const { return consecutive_failures > 0; }
+};
+
+// What a finished request says about the address it used.
+struct RequestOutcome {
+  bool failed = false;                   // 5xx or transport error
+  std::chrono::milliseconds latency{0};  // 0 = not measured
+};
+
+// Resolved addresses of one origin with the number of requests currently
+// outstanding on each, plus their health. Not thread-safe; ConnectionPool
+// keeps one per origin and only touches it on its strand.
+class EndpointSet {
+ public:
+  using tcp = boost::asio::ip::tcp;
+  using clock = std::chrono::steady_clock;
+
+  struct Load {
+    tcp::endpoint endpoint;
+    std::size_t active = 0;
+    // Health (see OutlierDetection).
+    std::size_t consecutive_failures = 0;
+    std::size_t consecutive_successes = 0;
+    std::size_t ejections = 0;  // drives the exponential ejection time
+    clock::time_point ejected_until{};
+    double latency_ms = 0;  // EWMA
+    std::size_t latency_samples = 0;
+  };
+
+  bool empty() const { return loads_.empty(); }
+  std::size_t size() const { return loads_.size(); }
+  const std::vector<Load>& loads() const { return loads_; }
+
+  // Replace the address list after a lookup. Addresses that survive keep
+  // their outstanding counts and health; dropped ones are forgotten, so
+  // their connections are closed on release rather than pooled.
+  template <class Endpoints>
+  void update(const Endpoints& endpoints, clock::time_point now) {
+    std::vector<Load> next;
+    for (auto const& e : endpoints) {
+      tcp::endpoint ep(e);
+      bool seen = false;
+      for (auto const& n : next) seen = seen || n.endpoint == ep;
+      if (seen) continue;  // resolvers may repeat an address per socket type
+      Load load{ep};
+      if (auto* old = find(ep)) load = *old;
+      next.push_back(load);
+    }
+    loads_ = std::move(next);
+    if (cursor_ >= loads_.size()) cursor_ = 0;
+    resolved_at_ = now;
+  }
+
+  // Fixed addresses that are never re-resolved.
+  template <class Endpoints>
+  void pin(const Endpoints& endpoints, clock::time_point now) {
+    update(endpoints, now);
+    pinned_ = true;
+  }
+  bool pinned() const { return pinned_; }
+
+  // Mark a lookup attempt (failed or not) so refreshes back off.
+  void touch(clock::time_point now) { resolved_at_ = now; }
+
+  bool stale(std::chrono::seconds refresh, clock::time_point now) const {
+    return !pinned_ && refresh.count() > 0 && now - resolved_at_ >= refresh;
+  }
+
+  Load* find(const tcp::endpoint& ep) {
+    for (auto& l : loads_) {
+      if (l.endpoint == ep) return &l;
+    }
+    return nullptr;
+  }
+
+  bool ejected(const Load& l, clock::time_point now) const {
+    return l.ejected_until > now;
+  }
+
+  std::size_t ejected_count(clock::time_point now) const {
+    return static_cast<std::size_t>(
+        std::count_if(loads_.begin(), loads_.end(),
+                      [&](const Load& l) { return ejected(l, now); }));
+  }
+
+  // Index of the address to use next, skipping ejected ones. Requires
+  // !empty().
+  std::size_t pick(EndpointPolicy policy,
+                   clock::time_point now = clock::now()) {
+    const std::size_t n = loads_.size();
+    if (n == 1) return 0;
+    auto usable = [&](std::size_t i) { return !ejected(loads_[i], now); };
+    if (policy == EndpointPolicy::first) {
+      for (std::size_t i = 0; i < n; ++i) {
+        if (usable(i)) return i;
+      }
+      return 0;
+    }
+    if (policy == EndpointPolicy::power_of_two) {
+      std::vector<std::size_t> eligible;
+      for (std::size_t i = 0; i < n; ++i) {
+        if (usable(i)) eligible.push_back(i);
+      }
+      if (eligible.empty()) eligible.push_back(0);
+      if (eligible.size() == 1) return eligible.front();
+      std::uniform_int_distribution<std::size_t> dist(0, eligible.size() - 1);
+      const std::size_t a = dist(rng_);
+      std::size_t b = dist(rng_);
+      if (b == a) b = (a + 1) % eligible.size();
+      return loads_[eligible[b]].active < loads_[eligible[a]].active
+                 ? eligible[b]
+                 : eligible[a];
+    }
+    // least_outstanding: scan from the cursor so ties rotate.
+    std::size_t best = n;
+    for (std::size_t k = 0; k < n; ++k) {
+      const std::size_t i = (cursor_ + k) % n;
+      if (!usable(i)) continue;
+      if (best == n || loads_[i].active < loads_[best].active) best = i;
+    }
+    if (best == n) best = cursor_ % n;
+    cursor_ = (best + 1) % n;
+    return best;
+  }
+
+  // Record a finished request on `ep`. Returns true if this ejected it.
+  bool report(const tcp::endpoint& ep, RequestOutcome outcome,
+              const OutlierDetection& od, clock::time_point now) {
+    Load* l = find(ep);
+    if (!l || !od.enabled()) return false;
+    bool failed = outcome.failed;
+    if (!failed && outcome.latency.count() > 0) {
+      failed = record_latency(*l, outcome.latency, od);
+    }
+    if (!failed) {
+      l->consecutive_failures = 0;
+      // A healthy streak as long as the ejection threshold earns back one
+      // step of the ejection backoff.
+      if (l->ejections > 0 &&
+          ++l->consecutive_successes >= od.consecutive_failures) {
+        --l->ejections;
+        l->consecutive_successes = 0;
+      }
+      return false;
+    }
+    l->consecutive_successes = 0;
+    if (ejected(*l, now)) return false;
+    if (++l->consecutive_failures < od.consecutive_failures) return false;
+    const auto limit = static_cast<std::size_t>(
+        static_cast<double>(loads_.size()) * od.max_ejected_fraction);
+    if (ejected_count(now) >= limit) return false;
+    auto duration = od.base_ejection;
+    for (std::size_t i = 0; i < l->ejections && duration < od.max_ejection;
+         ++i) {
+      duration *= 2;
+    }
+    duration = std::min(duration, od.max_ejection);
+    l->ejected_until = now + duration;
+    ++l->ejections;
+    l->consecutive_failures = 0;
+    return true;
+  }
+
+ private:
+  // Returns true when `l` is now a latency outlier against its peers.
+  bool record_latency(Load& l, std::chrono::milliseconds latency,
+                      const OutlierDetection& od) {
+    constexpr double kAlpha = 0.2;
+    const double ms = static_cast<double>(latency.count());
+    l.latency_ms = l.latency_samples == 0
+                       ? ms
+                       : kAlpha * ms + (1 - kAlpha) * l.latency_ms;
+    ++l.latency_samples;
+    if (od.latency_factor <= 0 || l.latency_samples < od.latency_min_samples) {
+      return false;
+    }
+    double sum = 0;
+    std::size_t peers = 0;
+    for (auto const& other : loads_) {
+      if (&other == &l || other.latency_samples < od.latency_min_samples) {
+        continue;
+      }
+      sum += other.latency_ms;
+      ++peers;
+    }
+    return peers > 0 && l.latency_ms > od.latency_factor * (sum / peers);
+  }
+
+  std::vector<Load> loads_;
+  std::size_t cursor_ = 0;
+  clock::time_point resolved_at_{};
+  bool pinned_ = false;
+  std::minstd_rand rng_{std::random_device{}()};
+};
+
+}  // namespace beast_pool
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <boost/asio/error.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+#include "sendfile_body.hpp"
+
+namespace client_async {
+
+// Opt-in `Expect: 100-continue` for large request bodies.
+// - threshold: bodies of at least this many bytes (or of unknown length, i.e.
+//   chunked) are held back until the server answers the header. Unset = off.
+// - wait: how long to wait for `100 Continue` or a final status before
+//   sending the body anyway (RFC 9110 §10.1.1 allows either).
+struct ExpectContinuePolicy {
+  std::optional<std::uint64_t> threshold = std::nullopt;
+  std::chrono::milliseconds wait{1000};
+};
+
+// True when `req` should be sent with `Expect: 100-continue`.
+template <class Body, class Fields>
+bool wants_expect_continue(
+    const boost::beast::http::request<Body, Fields>& req,
+    const ExpectContinuePolicy& policy) {
+  namespace http = boost::beast::http;
+  if constexpr (std::is_same_v<Body, http::empty_body>) {
+    return false;
+  } else {
+    if (!policy.threshold) return false;
+    if (req.chunked()) return true;
+    auto len = req.payload_size();
+    return len.has_value() && *len > 0 && *len >= *policy.threshold;
+  }
+}
+
+struct ExpectContinueOutcome {
+  // The request body went out (after `100 Continue` or the wait timer).
+  bool body_sent = false;
+  // The failure, if any, happened while reading rather than writing.
+  bool read_failed = false;
+};
+
+namespace expect_detail {
+
+template <class Stream, class DynamicBuffer, class Body, class Fields,
+          class InterimParser, class Handler>
+class op : public std::enable_shared_from_this<
+               op<Stream, DynamicBuffer, Body, Fields, InterimParser, Handler>> {
+  using request_t = boost::beast::http::request<Body, Fields>;
+  using interim_t = std::optional<InterimParser>;
+
+ public:
+  op(Stream& stream, DynamicBuffer& buffer, request_t& req, interim_t& interim,
+     std::chrono::steady_clock::duration wait,
+     std::chrono::steady_clock::duration io_timeout, Handler handler)
+      : stream_(stream),
+        buffer_(buffer),
+        req_(req),
+        interim_(interim),
+        timer_(stream.get_executor()),
+        wait_(wait),
+        io_timeout_(io_timeout),
+        handler_(std::move(handler)) {}
+
+  void start() {
+    req_.set(boost::beast::http::field::expect, "100-continue");
+    sr_.emplace(req_);
+    boost::beast::http::async_write_header(
+        stream_, *sr_,
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t) {
+          if (ec) return self->done(ec);
+          self->interim_.emplace();
+          self->await_answer();
+        });
+  }
+
+ private:
+  void await_answer() {
+    timed_out_ = false;
+    timer_.expires_after(wait_);
+    timer_.async_wait([self = this->shared_from_this()](
+                          const boost::system::error_code& ec) {
+      if (ec) return;
+      self->timed_out_ = true;
+      boost::beast::get_lowest_layer(self->stream_).cancel();
+    });
+    boost::beast::http::async_read_header(
+        stream_, buffer_, *interim_,
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t) {
+          self->timer_.cancel();
+          if (ec == boost::asio::error::operation_aborted &&
+              self->timed_out_) {
+            // No answer in time: send the body anyway. A partially parsed
+            // header stays in `interim_` and is finished afterwards.
+            return self->send_body();
+          }
+          if (ec) return self->done(ec, true);
+          const unsigned status = self->interim_->get().result_int();
+          if (status == 100) {
+            self->interim_.reset();
+            return self->send_body();
+          }
+          if (status / 100 == 1 && status != 101) {
+            // Other informational responses (e.g. 103) are skipped.
+            self->interim_.emplace();
+            return self->await_answer();
+          }
+          // Final status before the body: the upload is skipped.
+          self->done({});
+        });
+  }
+
+  void send_body() {
+    outcome_.body_sent = true;
+    boost::beast::get_lowest_layer(stream_).expires_after(io_timeout_);
+    auto on_sent = [self = this->shared_from_this()](
+                       boost::beast::error_code ec, std::size_t) {
+      if (ec) {
+        self->outcome_.body_sent = false;
+        return self->done(ec);
+      }
+      self->after_body();
+    };
+    if constexpr (std::is_same_v<Body, sendfile_body>) {
+      async_write_sendfile(stream_, *sr_, io_timeout_, std::move(on_sent));
+    } else {
+      boost::beast::http::async_write(stream_, *sr_, std::move(on_sent));
+    }
+  }
+
+  void after_body() {
+    if (!interim_ || !interim_->got_some()) {
+      interim_.reset();
+      return done({});
+    }
+    boost::beast::get_lowest_layer(stream_).expires_after(io_timeout_);
+    boost::beast::http::async_read_header(
+        stream_, buffer_, *interim_,
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t) {
+          if (ec) return self->done(ec, true);
+          if (self->interim_->get().result_int() / 100 == 1) {
+            self->interim_.reset();
+          }
+          self->done({});
+        });
+  }
+
+  void done(boost::beast::error_code ec, bool reading = false) {
+    outcome_.read_failed = ec && reading;
+    handler_(ec, outcome_);
+  }
+
+  Stream& stream_;
+  DynamicBuffer& buffer_;
+  request_t& req_;
+  interim_t& interim_;
+  std::optional<boost::beast::http::request_serializer<Body, Fields>> sr_;
+  boost::asio::steady_timer timer_;
+  std::chrono::steady_clock::duration wait_;
+  std::chrono::steady_clock::duration io_timeout_;
+  Handler handler_;
+  ExpectContinueOutcome outcome_{};
+  bool timed_out_ = false;
+};
+
+}  // namespace expect_detail
+
+// Send `req` with `Expect: 100-continue`: write the header, wait up to `wait`
+// for an answer, and send the body only on `100 Continue` or timeout.
+// `interim` is a header-only (empty_body) response parser slot. On return it
+// holds the final response header if the server answered before the body
+// was read, so the caller can continue reading the body from it; otherwise
+// it is empty. A connection whose body was skipped must not be reused.
+// The stream must be a beast::tcp_stream, optionally under TLS; its expiry
+// is refreshed with `io_timeout` before each phase.
+// Handler: void(error_code, ExpectContinueOutcome).
+template <class Stream, class DynamicBuffer, class Body, class Fields,
+          class InterimParser, class Handler>
+void async_send_expect_continue(
+    Stream& stream, DynamicBuffer& buffer,
+    boost::beast::http::request<Body, Fields>& req,
+    std::optional<InterimParser>& interim,
+    std::chrono::steady_clock::duration wait,
+    std::chrono::steady_clock::duration io_timeout, Handler&& handler) {
+  using op_t = expect_detail::op<Stream, DynamicBuffer, Body, Fields,
+                                 InterimParser, std::decay_t<Handler>>;
+  std::make_shared<op_t>(stream, buffer, req, interim, wait, io_timeout,
+                         std::forward<Handler>(handler))
+      ->start();
+}
+
+}  // namespace client_async
@@ -0,0 +1,89 @@
+#pragma once
+
+// Explicit instantiations of the session templates for the body pairs most
+// callers use. src/session_instantiations.cpp expands the INSTANTIATE_*
+// macros once into the http_client_sessions library; the session headers
+// expand the EXTERN_* macros when HTTP_CLIENT_PREBUILT_SESSIONS is defined
+// (linking the library defines it), so including translation units reuse
+// the prebuilt code instead of compiling it again.
+//
+// Expand inside namespace client_async, after the class is declared.
+
+#include <boost/beast/http/fields.hpp>
+#include <boost/beast/http/message.hpp>
+#include <functional>
+#include <memory>
+#include <optional>
+
+// Each transport is listed with its CRTP base: instantiating a class does
+// not instantiate the members it inherits.
+#define HTTP_CLIENT_SESSION_TEMPLATE_(Prefix, Session, Req, Res)          \
+  Prefix class session<Session<Req, Res, std::allocator<char>>, Req, Res, \
+                       std::allocator<char>>;                             \
+  Prefix class Session<Req, Res, std::allocator<char>>;
+
+#define HTTP_CLIENT_SESSION_TEMPLATES_(Prefix, Req, Res)          \
+  HTTP_CLIENT_SESSION_TEMPLATE_(Prefix, session_plain, Req, Res)  \
+  HTTP_CLIENT_SESSION_TEMPLATE_(Prefix, session_ssl, Req, Res)    \
+  HTTP_CLIENT_SESSION_TEMPLATE_(Prefix, session_unix, Req, Res)
+
+#define HTTP_CLIENT_SESSION_POOLED_TEMPLATE_(Prefix, Req, Res) \
+  Prefix class http_session_pooled<Req, Res, std::allocator<char>>;
+
+// Stream sessions replace the base's read path with their own, so only the
+// derived class is instantiated; the base members they use are not.
+#define HTTP_CLIENT_SESSION_STREAM_TEMPLATES_(Prefix, Req)      \
+  Prefix class session_stream_plain<Req, std::allocator<char>>; \
+  Prefix class session_stream_ssl<Req, std::allocator<char>>;   \
+  Prefix class session_stream_unix<Req, std::allocator<char>>;
+
+#define HTTP_CLIENT_MANAGER_REQUEST_TEMPLATES_(Prefix, Req, Res)           \
+  Prefix void HttpClientManager::http_request<Req, Res>(                   \
+      const urls::url_view&, instantiated_request_t<Req>&&,                \
+      instantiated_callback_t<Res>&&, HttpClientRequestParams&&,           \
+      const cjj365::ProxySetting*);                                        \
+  Prefix void HttpClientManager::http_request_pooled<Req, Res>(            \
+      beast_pool::OriginId, instantiated_request_t<Req>&&,                 \
+      instantiated_callback_t<Res>&&, HttpClientRequestParams&&,           \
+      const cjj365::ProxySetting*);
+
+namespace client_async {
+
+// Spell out the manager's parameter types in the macros above.
+template <class Body>
+using instantiated_request_t = boost::beast::http::request<
+    Body, boost::beast::http::basic_fields<std::allocator<char>>>;
+
+template <class Body>
+using instantiated_callback_t = std::function<void(
+    std::optional<boost::beast::http::response<
+        Body, boost::beast::http::basic_fields<std::allocator<char>>>>&&,
+    int)>;
+
+}  // namespace client_async
+
+// session_plain / session_ssl / session_unix (http_session.hpp).
+#define INSTANTIATE_HTTP_SESSION(Req, Res) \
+  HTTP_CLIENT_SESSION_TEMPLATES_(template, Req, Res)
+#define EXTERN_HTTP_SESSION(Req, Res) \
+  HTTP_CLIENT_SESSION_TEMPLATES_(extern template, Req, Res)
+
+// http_session_pooled (http_session_pooled.hpp).
+#define INSTANTIATE_HTTP_SESSION_POOLED(Req, Res) \
+  HTTP_CLIENT_SESSION_POOLED_TEMPLATE_(template, Req, Res)
+#define EXTERN_HTTP_SESSION_POOLED(Req, Res) \
+  HTTP_CLIENT_SESSION_POOLED_TEMPLATE_(extern template, Req, Res)
+
+// session_stream_plain / session_stream_ssl / session_stream_unix
+// (http_session_stream.hpp).
+#define INSTANTIATE_HTTP_SESSION_STREAM(Req) \
+  HTTP_CLIENT_SESSION_STREAM_TEMPLATES_(template, Req)
+#define EXTERN_HTTP_SESSION_STREAM(Req) \
+  HTTP_CLIENT_SESSION_STREAM_TEMPLATES_(extern template, Req)
+
+// HttpClientManager::http_request / http_request_pooled
+// (http_client_manager.hpp).
+#define INSTANTIATE_CLIENTPOOL_HTTP_REQUEST(Req, Res) \
+  HTTP_CLIENT_MANAGER_REQUEST_TEMPLATES_(template, Req, Res)
+#define EXTERN_CLIENTPOOL_HTTP_REQUEST(Req, Res) \
+  HTTP_CLIENT_MANAGER_REQUEST_TEMPLATES_(extern template, Req, Res)
@@ -0,0 +1,971 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <boost/asio/error.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Vector width used to scan header values and chunk lines: AVX2 when the
+// build enables it, SSE2 (baseline on x86-64) otherwise, scalar elsewhere.
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define HTTPCLIENT_FAST_PARSER_SIMD 2
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define HTTPCLIENT_FAST_PARSER_SIMD 1
+#else
+#define HTTPCLIENT_FAST_PARSER_SIMD 0
+#endif
+
+#include "response_memory_budget.hpp"
+
+namespace client_async {
+namespace fast_http {
+
+// Fast-path HTTP/1.x response reader, an opt-in alternative to
+// http::response_parser for small, high-rate responses:
+// - parse_response_head(): picohttpparser-style single pass over the head,
+//   SIMD scanning of field values, no allocation per field;
+// - FlatHeaderTable: string_views into one arena, with O(1) lookup of the
+//   common fields and case-insensitive lookup of the rest;
+// - ChunkedDecoder: incremental chunked transfer decoding;
+// - async_read_fast_response(): reads a whole response, optionally admitted
+//   against a BudgetLease like async_read_budgeted().
+
+inline constexpr int kParseError = -1;
+inline constexpr int kParseIncomplete = -2;
+
+namespace detail {
+
+constexpr std::array<bool, 256> make_token_table() {
+  std::array<bool, 256> t{};
+  for (int c = '0'; c <= '9'; ++c) t[c] = true;
+  for (int c = 'a'; c <= 'z'; ++c) t[c] = true;
+  for (int c = 'A'; c <= 'Z'; ++c) t[c] = true;
+  for (char c : std::string_view("!#$%&'*+-.^_`|~")) {
+    t[static_cast<unsigned char>(c)] = true;
+  }
+  return t;
+}
+inline constexpr std::array<bool, 256> kTokenChars = make_token_table();
+
+constexpr std::array<unsigned char, 256> make_lower_table() {
+  std::array<unsigned char, 256> t{};
+  for (int c = 0; c < 256; ++c) {
+    t[c] = static_cast<unsigned char>(c >= 'A' && c <= 'Z' ? c + 32 : c);
+  }
+  return t;
+}
+inline constexpr std::array<unsigned char, 256> kLower = make_lower_table();
+
+inline bool iequals(std::string_view a, std::string_view b) noexcept {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); ++i) {
+    if (kLower[static_cast<unsigned char>(a[i])] !=
+        kLower[static_cast<unsigned char>(b[i])]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+inline bool is_value_end(unsigned char c) noexcept {
+  return (c < 0x20 && c != '\t') || c == 0x7f;
+}
+
+// First byte in [p, end) that ends a field value: CR, LF, or any other
+// control character (HTAB and obs-text are allowed). `end` if none.
+inline const char* find_value_end(const char* p, const char* end) noexcept {
+#if HTTPCLIENT_FAST_PARSER_SIMD == 2
+  {
+    const __m256i ctl = _mm256_set1_epi8(0x1f);
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i del = _mm256_set1_epi8(0x7f);
+    while (end - p >= 32) {
+      const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+      // Unsigned v <= 0x1f, minus HTAB, plus DEL.
+      __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(v, ctl), v);
+      hit = _mm256_andnot_si256(_mm256_cmpeq_epi8(v, tab), hit);
+      hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, del));
+      const auto mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+      if (mask) return p + __builtin_ctz(mask);
+      p += 32;
+    }
+  }
+#endif
+#if HTTPCLIENT_FAST_PARSER_SIMD >= 1
+  {
+    const __m128i ctl = _mm_set1_epi8(0x1f);
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i del = _mm_set1_epi8(0x7f);
+    while (end - p >= 16) {
+      const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+      __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(v, ctl), v);
+      hit = _mm_andnot_si128(_mm_cmpeq_epi8(v, tab), hit);
+      hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, del));
+      const auto mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+      if (mask) return p + __builtin_ctz(mask);
+      p += 16;
+    }
+  }
+#endif
+  for (; p != end; ++p) {
+    if (is_value_end(static_cast<unsigned char>(*p))) return p;
+  }
+  return end;
+}
+
+inline bool parse_decimal(std::string_view s, std::uint64_t& out) noexcept {
+  if (s.empty()) return false;
+  std::uint64_t v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9') return false;
+    const std::uint64_t d = static_cast<std::uint64_t>(c - '0');
+    if (v > (UINT64_MAX - d) / 10) return false;
+    v = v * 10 + d;
+  }
+  out = v;
+  return true;
+}
+
+inline std::string_view trim_ows(std::string_view s) noexcept {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t'))
+    s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t'))
+    s.remove_suffix(1);
+  return s;
+}
+
+// Calls fn(token) for each comma-separated list element.
+template <class Fn>
+void for_each_token(std::string_view list, Fn&& fn) {
+  while (!list.empty()) {
+    const auto comma = list.find(',');
+    fn(trim_ows(list.substr(0, comma)));
+    if (comma == std::string_view::npos) break;
+    list.remove_prefix(comma + 1);
+  }
+}
+
+}  // namespace detail
+
+// Fields the client itself looks at, resolved once while parsing.
+enum class KnownField : std::uint8_t {
+  content_length,
+  transfer_encoding,
+  connection,
+  content_type,
+  content_encoding,
+  location,
+  etag,
+  last_modified,
+  retry_after,
+  cache_control,
+  unknown
+};
+inline constexpr std::size_t kKnownFieldCount =
+    static_cast<std::size_t>(KnownField::unknown);
+
+inline KnownField classify_field(std::string_view name) noexcept {
+  using detail::iequals;
+  switch (name.size()) {
+    case 4:
+      if (iequals(name, "etag")) return KnownField::etag;
+      break;
+    case 8:
+      if (iequals(name, "location")) return KnownField::location;
+      break;
+    case 10:
+      if (iequals(name, "connection")) return KnownField::connection;
+      break;
+    case 11:
+      if (iequals(name, "retry-after")) return KnownField::retry_after;
+      break;
+    case 12:
+      if (iequals(name, "content-type")) return KnownField::content_type;
+      break;
+    case 13:
+      if (iequals(name, "last-modified")) return KnownField::last_modified;
+      if (iequals(name, "cache-control")) return KnownField::cache_control;
+      break;
+    case 14:
+      if (iequals(name, "content-length")) return KnownField::content_length;
+      break;
+    case 16:
+      if (iequals(name, "content-encoding"))
+        return KnownField::content_encoding;
+      break;
+    case 17:
+      if (iequals(name, "transfer-encoding"))
+        return KnownField::transfer_encoding;
+      break;
+    default:
+      break;
+  }
+  return KnownField::unknown;
+}
+
+struct HeaderField {
+  std::string_view name;
+  std::string_view value;
+  KnownField kind = KnownField::unknown;
+};
+
+// Parsed header fields as views into a caller-owned arena. The storage is
+// reused across parses, so steady-state parsing does not allocate.
+class FlatHeaderTable {
+ public:
+  FlatHeaderTable() {
+    fields_.reserve(16);
+    known_.fill(kNone);
+  }
+
+  void clear() noexcept {
+    fields_.clear();
+    known_.fill(kNone);
+  }
+
+  void add(std::string_view name, std::string_view value) {
+    const KnownField kind = classify_field(name);
+    if (kind != KnownField::unknown) {
+      auto& slot = known_[static_cast<std::size_t>(kind)];
+      if (slot == kNone) slot = static_cast<std::uint16_t>(fields_.size());
+    }
+    fields_.push_back(HeaderField{name, value, kind});
+  }
+
+  // First value of a known field.
+  std::optional<std::string_view> find(KnownField kind) const noexcept {
+    if (kind == KnownField::unknown) return std::nullopt;
+    const auto slot = known_[static_cast<std::size_t>(kind)];
+    if (slot == kNone) return std::nullopt;
+    return fields_[slot].value;
+  }
+
+  // First value of any field, case-insensitive.
+  std::optional<std::string_view> find(std::string_view name) const noexcept {
+    const KnownField kind = classify_field(name);
+    if (kind != KnownField::unknown) return find(kind);
+    for (const auto& f : fields_) {
+      if (detail::iequals(f.name, name)) return f.value;
+    }
+    return std::nullopt;
+  }
+
+  // Point every view at `to` instead of `from` (same layout).
+  void rebase(const char* from, const char* to) noexcept {
+    for (auto& f : fields_) {
+      f.name = std::string_view(to + (f.name.data() - from), f.name.size());
+      f.value = std::string_view(to + (f.value.data() - from), f.value.size());
+    }
+  }
+
+  std::size_t size() const noexcept { return fields_.size(); }
+  bool empty() const noexcept { return fields_.empty(); }
+  const HeaderField& operator[](std::size_t i) const { return fields_[i]; }
+  auto begin() const noexcept { return fields_.begin(); }
+  auto end() const noexcept { return fields_.end(); }
+
+ private:
+  static constexpr std::uint16_t kNone = 0xffff;
+  std::vector<HeaderField> fields_;
+  std::array<std::uint16_t, kKnownFieldCount> known_{};
+};
+
+struct ResponseHead {
+  unsigned version = 11;  // 10 or 11, as in beast
+  unsigned status = 0;
+  std::string_view reason;
+  FlatHeaderTable headers;
+  // Message framing, derived from the fields above.
+  std::optional<std::uint64_t> content_length;
+  bool chunked = false;
+  bool keep_alive = true;
+
+  void clear() noexcept {
+    version = 11;
+    status = 0;
+    reason = {};
+    headers.clear();
+    content_length.reset();
+    chunked = false;
+    keep_alive = true;
+  }
+
+  void rebase(const char* from, const char* to) noexcept {
+    if (!reason.empty()) {
+      reason = std::string_view(to + (reason.data() - from), reason.size());
+    }
+    headers.rebase(from, to);
+  }
+};
+
+namespace detail {
+
+// CRLF or bare LF at p. Returns the byte after it, nullptr on error, or
+// `end` with `incomplete` set.
+inline const char* skip_eol(const char* p, const char* end,
+                            bool& incomplete) noexcept {
+  if (p == end) {
+    incomplete = true;
+    return end;
+  }
+  if (*p == '\n') return p + 1;
+  if (*p != '\r') return nullptr;
+  if (++p == end) {
+    incomplete = true;
+    return end;
+  }
+  return *p == '\n' ? p + 1 : nullptr;
+}
+
+// Content-Length / Transfer-Encoding / Connection.
+inline bool derive_framing(ResponseHead& head) noexcept {
+  bool close = false;
+  bool keep_alive_token = false;
+  for (const auto& f : head.headers) {
+    switch (f.kind) {
+      case KnownField::content_length: {
+        std::uint64_t v = 0;
+        if (!parse_decimal(f.value, v)) return false;
+        if (head.content_length && *head.content_length != v) return false;
+        head.content_length = v;
+        break;
+      }
+      case KnownField::transfer_encoding: {
+        // Chunked only counts as the final coding.
+        bool last_chunked = false;
+        for_each_token(f.value, [&](std::string_view t) {
+          if (!t.empty()) last_chunked = iequals(t, "chunked");
+        });
+        head.chunked = last_chunked;
+        break;
+      }
+      case KnownField::connection:
+        for_each_token(f.value, [&](std::string_view t) {
+          if (iequals(t, "close")) close = true;
+          if (iequals(t, "keep-alive")) keep_alive_token = true;
+        });
+        break;
+      default:
+        break;
+    }
+  }
+  // Transfer-Encoding overrides Content-Length (RFC 9112 §6.3).
+  if (head.chunked) head.content_length.reset();
+  head.keep_alive = head.version >= 11 ? !close : keep_alive_token && !close;
+  return true;
+}
+
+}  // namespace detail
+
+// Parse a response status line and header block from [buf, buf + len).
+// Returns the number of bytes consumed (including the empty line),
+// kParseIncomplete if more bytes are needed, or kParseError. On success
+// `head` holds views into `buf`.
+inline int parse_response_head(const char* buf, std::size_t len,
+                               ResponseHead& head) {
+  using namespace detail;
+  head.clear();
+  const char* p = buf;
+  const char* const end = buf + len;
+  bool incomplete = false;
+
+  // "HTTP/1.x SP"
+  static constexpr std::string_view kPrefix = "HTTP/1.";
+  const std::size_t have = std::min(len, kPrefix.size());
+  if (std::string_view(p, have) != kPrefix.substr(0, have)) return kParseError;
+  if (len < kPrefix.size() + 2) return kParseIncomplete;
+  p += kPrefix.size();
+  if (*p != '0' && *p != '1') return kParseError;
+  head.version = 10 + static_cast<unsigned>(*p - '0');
+  if (*++p != ' ') return kParseError;
+  ++p;
+
+  // 3DIGIT
+  if (end - p < 4) return kParseIncomplete;
+  unsigned status = 0;
+  for (int i = 0; i < 3; ++i, ++p) {
+    if (*p < '0' || *p > '9') return kParseError;
+    status = status * 10 + static_cast<unsigned>(*p - '0');
+  }
+  head.status = status;
+
+  // [SP reason-phrase] EOL
+  if (*p == ' ') {
+    const char* r = ++p;
+    p = find_value_end(p, end);
+    if (p == end) return kParseIncomplete;
+    head.reason = std::string_view(r, static_cast<std::size_t>(p - r));
+  }
+  p = skip_eol(p, end, incomplete);
+  if (incomplete) return kParseIncomplete;
+  if (!p) return kParseError;
+
+  for (;;) {
+    if (p == end) return kParseIncomplete;
+    if (*p == '\r' || *p == '\n') {
+      p = skip_eol(p, end, incomplete);
+      if (incomplete) return kParseIncomplete;
+      if (!p) return kParseError;
+      break;
+    }
+    // field-name ":" OWS field-value OWS EOL; obs-fold is rejected.
+    const char* name = p;
+    while (p != end && kTokenChars[static_cast<unsigned char>(*p)]) ++p;
+    if (p == end) return kParseIncomplete;
+    if (*p != ':' || p == name) return kParseError;
+    const std::string_view field_name(name, static_cast<std::size_t>(p - name));
+    ++p;
+    while (p != end && (*p == ' ' || *p == '\t')) ++p;
+    const char* value = p;
+    p = find_value_end(p, end);
+    if (p == end) return kParseIncomplete;
+    if (*p != '\r' && *p != '\n') return kParseError;
+    const char* value_end = p;
+    while (value_end != value &&
+           (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+      --value_end;
+    }
+    p = skip_eol(p, end, incomplete);
+    if (incomplete) return kParseIncomplete;
+    if (!p) return kParseError;
+    head.headers.add(field_name,
+                     std::string_view(value, static_cast<std::size_t>(
+                                                 value_end - value)));
+  }
+  if (!derive_framing(head)) return kParseError;
+  return static_cast<int>(p - buf);
+}
+
+// Incremental decoder for `Transfer-Encoding: chunked` bodies. Chunk
+// extensions and trailer fields are validated and skipped.
+class ChunkedDecoder {
+ public:
+  enum class Result { need_more, done, error, body_limit };
+
+  void reset() noexcept {
+    state_ = State::size;
+    remaining_ = 0;
+    digits_ = 0;
+  }
+  bool done() const noexcept { return state_ == State::done; }
+
+  // Decode from [data, data + size), appending payload to `out`. `consumed`
+  // receives the bytes used; bytes after the final CRLF are left alone.
+  Result decode(const char* data, std::size_t size, std::string& out,
+                std::size_t& consumed, std::uint64_t body_limit) {
+    const char* p = data;
+    const char* const end = data + size;
+    Result result = Result::need_more;
+    while (p != end && result == Result::need_more) {
+      switch (state_) {
+        case State::size: {
+          const char c = *p;
+          int d = -1;
+          if (c >= '0' && c <= '9') d = c - '0';
+          else if (c >= 'a' && c <= 'f') d = c - 'a' + 10;
+          else if (c >= 'A' && c <= 'F') d = c - 'A' + 10;
+          if (d >= 0) {
+            if (++digits_ > 16) return finish(p, data, consumed, Result::error);
+            remaining_ = (remaining_ << 4) | static_cast<std::uint64_t>(d);
+            ++p;
+            break;
+          }
+          if (digits_ == 0) return finish(p, data, consumed, Result::error);
+          if (c == ';' || c == ' ' || c == '\t') {
+            state_ = State::ext;
+          } else if (c == '\r') {
+            state_ = State::size_lf;
+            ++p;
+          } else if (c == '\n') {
+            ++p;
+            end_of_size_line();
+          } else {
+            return finish(p, data, consumed, Result::error);
+          }
+          break;
+        }
+        case State::ext: {
+          p = detail::find_value_end(p, end);
+          if (p == end) break;
+          if (*p == '\r') {
+            state_ = State::size_lf;
+          } else if (*p == '\n') {
+            end_of_size_line();
+          } else {
+            return finish(p, data, consumed, Result::error);
+          }
+          ++p;
+          break;
+        }
+        case State::size_lf:
+          if (*p++ != '\n') return finish(p, data, consumed, Result::error);
+          end_of_size_line();
+          break;
+        case State::data: {
+          const auto take = static_cast<std::size_t>(std::min<std::uint64_t>(
+              remaining_, static_cast<std::uint64_t>(end - p)));
+          if (out.size() + take > body_limit) {
+            return finish(p, data, consumed, Result::body_limit);
+          }
+          out.append(p, take);
+          p += take;
+          remaining_ -= take;
+          if (remaining_ == 0) state_ = State::data_cr;
+          break;
+        }
+        case State::data_cr:
+          if (*p == '\r') {
+            state_ = State::data_lf;
+            ++p;
+          } else if (*p == '\n') {
+            state_ = State::size;
+            ++p;
+          } else {
+            return finish(p, data, consumed, Result::error);
+          }
+          break;
+        case State::data_lf:
+          if (*p++ != '\n') return finish(p, data, consumed, Result::error);
+          state_ = State::size;
+          break;
+        case State::trailer_start:
+          if (*p == '\r') {
+            state_ = State::final_lf;
+            ++p;
+          } else if (*p == '\n') {
+            ++p;
+            state_ = State::done;
+            result = Result::done;
+          } else {
+            state_ = State::trailer;
+          }
+          break;
+        case State::trailer: {
+          p = detail::find_value_end(p, end);
+          if (p == end) break;
+          if (*p == '\r') {
+            state_ = State::trailer_lf;
+          } else if (*p == '\n') {
+            state_ = State::trailer_start;
+          } else {
+            return finish(p, data, consumed, Result::error);
+          }
+          ++p;
+          break;
+        }
+        case State::trailer_lf:
+          if (*p++ != '\n') return finish(p, data, consumed, Result::error);
+          state_ = State::trailer_start;
+          break;
+        case State::final_lf:
+          if (*p++ != '\n') return finish(p, data, consumed, Result::error);
+          state_ = State::done;
+          result = Result::done;
+          break;
+        case State::done:
+          result = Result::done;
+          break;
+      }
+    }
+    return finish(p, data, consumed, result);
+  }
+
+ private:
+  enum class State {
+    size,
+    ext,
+    size_lf,
+    data,
+    data_cr,
+    data_lf,
+    trailer_start,
+    trailer,
+    trailer_lf,
+    final_lf,
+    done
+  };
+
+  void end_of_size_line() noexcept {
+    digits_ = 0;
+    state_ = remaining_ == 0 ? State::trailer_start : State::data;
+  }
+
+  static Result finish(const char* p, const char* data, std::size_t& consumed,
+                       Result r) noexcept {
+    consumed = static_cast<std::size_t>(p - data);
+    return r;
+  }
+
+  State state_ = State::size;
+  std::uint64_t remaining_ = 0;
+  int digits_ = 0;
+};
+
+// Header fields handed to a caller instead of a beast fields container; see
+// FastResponse::to_beast(FastResponseHead&). The views point into `arena`.
+struct FastResponseHead {
+  ResponseHead head;
+  std::string arena;
+
+  void clear() noexcept {
+    head.clear();
+    arena.clear();
+  }
+  bool empty() const noexcept { return head.status == 0; }
+};
+
+// A response read by async_read_fast_response(). The header views point
+// into `arena`, which owns a copy of the raw head bytes.
+struct FastResponse {
+  ResponseHead head;
+  std::string arena;
+  std::string body;
+
+  void clear() noexcept {
+    head.clear();
+    arena.clear();
+    body.clear();
+  }
+
+  // Materialize as a beast response; this is where per-field allocation
+  // happens, once, for callers that need http::response.
+  template <class Allocator = std::allocator<char>>
+  boost::beast::http::response<boost::beast::http::string_body,
+                               boost::beast::http::basic_fields<Allocator>>
+  to_beast() && {
+    namespace http = boost::beast::http;
+    using bsv = boost::beast::string_view;
+    http::response<http::string_body, http::basic_fields<Allocator>> res;
+    res.version(head.version);
+    res.result(head.status);
+    const bsv reason(head.reason.data(), head.reason.size());
+    if (!reason.empty() && reason != http::obsolete_reason(res.result())) {
+      res.reason(reason);
+    }
+    for (const auto& f : head.headers) {
+      res.insert(bsv(f.name.data(), f.name.size()),
+                 bsv(f.value.data(), f.value.size()));
+    }
+    res.body() = std::move(body);
+    return res;
+  }
+
+  // Like to_beast(), but the fields stay flat: they are swapped into
+  // `fields` and the beast response carries status and body only, so no
+  // field is copied or allocated. `fields`' old storage is reused by the
+  // next read into this FastResponse.
+  template <class Allocator = std::allocator<char>>
+  boost::beast::http::response<boost::beast::http::string_body,
+                               boost::beast::http::basic_fields<Allocator>>
+  to_beast(FastResponseHead& fields) && {
+    namespace http = boost::beast::http;
+    using bsv = boost::beast::string_view;
+    http::response<http::string_body, http::basic_fields<Allocator>> res;
+    res.version(head.version);
+    res.result(head.status);
+    const bsv reason(head.reason.data(), head.reason.size());
+    if (!reason.empty() && reason != http::obsolete_reason(res.result())) {
+      res.reason(reason);
+    }
+    res.body() = std::move(body);
+    // A short arena lives in the string itself and moves with the swap.
+    const char* from = arena.data();
+    std::swap(fields.head, head);
+    std::swap(fields.arena, arena);
+    fields.head.rebase(from, fields.arena.data());
+    return res;
+  }
+};
+
+struct FastReadOptions {
+  std::uint64_t body_limit = UINT64_MAX;
+  std::size_t header_limit = 8192;  // beast's response_parser default
+  // Responses to HEAD carry no body whatever their framing says.
+  bool head_request = false;
+};
+
+namespace detail {
+
+template <class Stream, class Handler>
+class fast_read_op
+    : public std::enable_shared_from_this<fast_read_op<Stream, Handler>> {
+ public:
+  fast_read_op(Stream& stream, boost::beast::flat_buffer& buffer,
+               FastResponse& res, FastReadOptions opts, BudgetLease* lease,
+               std::chrono::steady_clock::duration wait_timeout,
+               Handler handler)
+      : stream_(stream),
+        buffer_(buffer),
+        res_(res),
+        opts_(opts),
+        lease_(lease),
+        wait_timeout_(wait_timeout),
+        handler_(std::move(handler)) {}
+
+  void start() {
+    res_.clear();
+    parse_head();
+  }
+
+ private:
+  enum class Phase { head, length, chunked, eof };
+
+  // Parses the head once its empty line has arrived. Earlier reads only
+  // scan the new bytes for it, so a head split over many reads is not
+  // re-parsed from the start each time.
+  void parse_head() {
+    namespace http = boost::beast::http;
+    const auto data = buffer_.data();
+    const char* p = static_cast<const char*>(data.data());
+    const std::size_t n = data.size();
+    if (n > 0) {
+      if (!head_prefix_ok(p, n)) return done(http::error::bad_value);
+      if (!find_head_end(p, n)) {
+        if (n >= opts_.header_limit) return done(http::error::header_limit);
+        return read_more();
+      }
+      const int r = parse_response_head(p, n, res_.head);
+      if (r == kParseError) return done(http::error::bad_value);
+      if (r > 0) {
+        if (static_cast<std::size_t>(r) > opts_.header_limit) {
+          return done(http::error::header_limit);
+        }
+        head_scanned_ = 0;
+        const unsigned status = res_.head.status;
+        if (status / 100 == 1 && status != 101) {
+          // Interim responses (100 Continue, 103 Early Hints) are skipped.
+          buffer_.consume(static_cast<std::size_t>(r));
+          return parse_head();
+        }
+        res_.arena.assign(p, static_cast<std::size_t>(r));
+        res_.head.rebase(p, res_.arena.data());
+        buffer_.consume(static_cast<std::size_t>(r));
+        return start_body();
+      }
+      if (n >= opts_.header_limit) return done(http::error::header_limit);
+    }
+    read_more();
+  }
+
+  // Rejects a stream that does not start like a status line before waiting
+  // for a whole head.
+  static bool head_prefix_ok(const char* p, std::size_t n) noexcept {
+    static constexpr std::string_view kPrefix = "HTTP/1.";
+    const std::size_t have = std::min(n, kPrefix.size());
+    return std::string_view(p, have) == kPrefix.substr(0, have);
+  }
+
+  // True once [p, p + n) holds the empty line ending the head (LF LF or
+  // LF CR LF). Resumes where the previous call stopped.
+  bool find_head_end(const char* p, std::size_t n) noexcept {
+    // Back up over a terminator that may straddle the previous read.
+    std::size_t i = head_scanned_ > 2 ? head_scanned_ - 2 : 0;
+    for (;;) {
+      const void* lf = std::memchr(p + i, '\n', n - i);
+      if (!lf) break;
+      i = static_cast<std::size_t>(static_cast<const char*>(lf) - p) + 1;
+      if (i < n && p[i] == '\n') return true;
+      if (i + 1 < n && p[i] == '\r' && p[i + 1] == '\n') return true;
+      if (i + 1 >= n) break;
+    }
+    head_scanned_ = n;
+    return false;
+  }
+
+  void start_body() {
+    namespace http = boost::beast::http;
+    const unsigned status = res_.head.status;
+    if (opts_.head_request || status / 100 == 1 || status == 204 ||
+        status == 304) {
+      return done({});
+    }
+    if (res_.head.chunked) {
+      phase_ = Phase::chunked;
+      chunked_.reset();
+    } else if (res_.head.content_length) {
+      if (*res_.head.content_length > opts_.body_limit) {
+        return done(http::error::body_limit);
+      }
+      phase_ = Phase::length;
+      remaining_ = *res_.head.content_length;
+      if (remaining_ == 0) return done({});
+      res_.body.reserve(static_cast<std::size_t>(remaining_));
+    } else {
+      phase_ = Phase::eof;
+    }
+    drain();
+  }
+
+  // Move buffered bytes into the body, then read more if needed.
+  void drain() {
+    namespace http = boost::beast::http;
+    const auto data = buffer_.data();
+    const char* p = static_cast<const char*>(data.data());
+    const std::size_t n = data.size();
+    switch (phase_) {
+      case Phase::length: {
+        const auto take = static_cast<std::size_t>(
+            std::min<std::uint64_t>(remaining_, n));
+        res_.body.append(p, take);
+        buffer_.consume(take);
+        remaining_ -= take;
+        if (remaining_ == 0) return done({});
+        break;
+      }
+      case Phase::chunked: {
+        std::size_t used = 0;
+        const auto r =
+            chunked_.decode(p, n, res_.body, used, opts_.body_limit);
+        buffer_.consume(used);
+        if (r == ChunkedDecoder::Result::done) return done({});
+        if (r == ChunkedDecoder::Result::error) {
+          return done(http::error::bad_chunk);
+        }
+        if (r == ChunkedDecoder::Result::body_limit) {
+          return done(http::error::body_limit);
+        }
+        break;
+      }
+      case Phase::eof:
+        if (res_.body.size() + n > opts_.body_limit) {
+          return done(http::error::body_limit);
+        }
+        res_.body.append(p, n);
+        buffer_.consume(n);
+        break;
+      case Phase::head:
+        break;
+    }
+    reserve_then_read();
+  }
+
+  // Same admission policy as budget_read_target().
+  void reserve_then_read() {
+    if (!lease_) return read_more();
+    std::uint64_t want = 0;
+    if (phase_ == Phase::length) {
+      want = std::min(*res_.head.content_length, opts_.body_limit);
+    } else {
+      const std::uint64_t have = res_.body.size();
+      want = std::min<std::uint64_t>(have + kBudgetReadStep,
+                                     std::max(opts_.body_limit, have));
+    }
+    if (want <= lease_->bytes()) return read_more();
+    lease_->async_grow_to(stream_.get_executor(), want, wait_timeout_,
+                          [self = this->shared_from_this()](bool ok) {
+                            if (!ok) {
+                              return self->done(boost::beast::error_code(
+                                  boost::asio::error::no_buffer_space));
+                            }
+                            self->read_more();
+                          });
+  }
+
+  void read_more() {
+    std::size_t want = 16 * 1024;
+    if (phase_ == Phase::length) {
+      want = static_cast<std::size_t>(std::clamp<std::uint64_t>(
+          remaining_, 4096, kBudgetReadStep));
+    } else if (phase_ != Phase::head) {
+      want = static_cast<std::size_t>(kBudgetReadStep);
+    }
+    stream_.async_read_some(
+        buffer_.prepare(want),
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t n) {
+          self->buffer_.commit(n);
+          self->on_read(ec);
+        });
+  }
+
+  void on_read(boost::beast::error_code ec) {
+    namespace http = boost::beast::http;
+    if (ec == boost::asio::error::eof) {
+      if (phase_ == Phase::eof) {
+        drain_eof();
+        return;
+      }
+      if (phase_ == Phase::head && buffer_.size() == 0) {
+        return done(http::error::end_of_stream);
+      }
+      return done(http::error::partial_message);
+    }
+    if (ec) return done(ec);
+    if (phase_ == Phase::head) return parse_head();
+    drain();
+  }
+
+  void drain_eof() {
+    namespace http = boost::beast::http;
+    const auto data = buffer_.data();
+    if (res_.body.size() + data.size() > opts_.body_limit) {
+      return done(http::error::body_limit);
+    }
+    res_.body.append(static_cast<const char*>(data.data()), data.size());
+    buffer_.consume(data.size());
+    done({});
+  }
+
+  void done(boost::beast::error_code ec) { handler_(ec); }
+
+  Stream& stream_;
+  boost::beast::flat_buffer& buffer_;
+  FastResponse& res_;
+  FastReadOptions opts_;
+  BudgetLease* lease_;
+  std::chrono::steady_clock::duration wait_timeout_;
+  Handler handler_;
+  Phase phase_ = Phase::head;
+  // Bytes of the buffered head already searched for its end.
+  std::size_t head_scanned_ = 0;
+  std::uint64_t remaining_ = 0;
+  ChunkedDecoder chunked_;
+};
+
+}  // namespace detail
+
+// Read one response from `stream` into `res` with the fast parser. Bytes
+// past the end of the response stay in `buffer`. With a `lease`, the body
+// is admitted against the memory budget like async_read_budgeted() and the
+// read completes with asio::error::no_buffer_space if that takes longer
+// than `wait_timeout`. The stream's own timeout is left alone, so one
+// deadline set by the caller covers the whole response.
+// Handler: void(error_code).
+template <class Stream, class Handler>
+void async_read_fast_response(Stream& stream,
+                              boost::beast::flat_buffer& buffer,
+                              FastResponse& res, FastReadOptions opts,
+                              BudgetLease* lease,
+                              std::chrono::steady_clock::duration wait_timeout,
+                              Handler handler) {
+  using op_t = detail::fast_read_op<Stream, Handler>;
+  std::make_shared<op_t>(stream, buffer, res, opts, lease, wait_timeout,
+                         std::move(handler))
+      ->start();
+}
+
+template <class Stream, class Handler>
+void async_read_fast_response(Stream& stream,
+                              boost::beast::flat_buffer& buffer,
+                              FastResponse& res, FastReadOptions opts,
+                              Handler handler) {
+  async_read_fast_response(stream, buffer, res, opts, nullptr,
+                           std::chrono::steady_clock::duration::zero(),
+                           std::move(handler));
+}
+
+}  // namespace fast_http
+}  // namespace client_async
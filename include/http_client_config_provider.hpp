@@ -8,6 +8,7 @@
 #include <boost/log/trivial.hpp>
 #include <boost/json.hpp>
 #include <cctype>
+#include <chrono>
 #include <cstdint>
 #include <cstdlib>
 #include <optional>
@@ -145,6 +146,22 @@ class HttpclientConfig {
   int threads_num = 0;
   bool default_verify_path = true;
   bool insecure_skip_verify = false;
+  // Process-wide cap on buffered response bytes; 0 = unlimited. Read from
+  // the default profile only.
+  std::uint64_t response_memory_budget_bytes = 0;
+  // Cap on pooled connections in use; 0 = unlimited. Past it, requests
+  // queue by RequestPriority.
+  std::size_t pool_max_active = 0;
+  // On-disk TLS sessions, DNS answers and origin usage carried across
+  // process restarts; empty = off.
+  std::string warm_start_file;
+  // Origins pre-connected at startup from the warm-start file.
+  std::size_t warm_start_prewarm_origins = 4;
+  // How often the warm-start file is rewritten while running (0 = only on
+  // stop).
+  int warm_start_save_interval_seconds = 60;
+  // Origin ("http://host[:port]") -> Unix domain socket path.
+  std::unordered_map<std::string, std::string> unix_socket_overrides;
   std::vector<std::string> verify_paths;
   std::vector<HttpclientCertificate> certificates;
   std::vector<HttpclientCertificateFile> certificate_files;
@@ -182,6 +199,33 @@ class HttpclientConfig {
           config.insecure_skip_verify = jsonutil::bool_or_throw(
               *insecure_p, "httpclient_config.insecure_skip_verify");
         }
+        if (auto* budget_p = jo->if_contains("response_memory_budget_bytes")) {
+          config.response_memory_budget_bytes =
+              budget_p->to_number<std::uint64_t>();
+        }
+        if (auto* active_p = jo->if_contains("pool_max_active")) {
+          config.pool_max_active = active_p->to_number<std::size_t>();
+        }
+        if (auto* warm_p = jo->if_contains("warm_start_file")) {
+          config.warm_start_file = json::value_to<std::string>(*warm_p);
+        }
+        if (auto* warm_n_p = jo->if_contains("warm_start_prewarm_origins")) {
+          config.warm_start_prewarm_origins =
+              warm_n_p->to_number<std::size_t>();
+        }
+        if (auto* warm_s_p =
+                jo->if_contains("warm_start_save_interval_seconds")) {
+          config.warm_start_save_interval_seconds = warm_s_p->to_number<int>();
+          if (config.warm_start_save_interval_seconds < 0) {
+            throw std::invalid_argument(
+                "warm_start_save_interval_seconds must be non-negative");
+          }
+        }
+        if (auto* uds_p = jo->if_contains("unix_socket_overrides")) {
+          config.unix_socket_overrides =
+              json::value_to<std::unordered_map<std::string, std::string>>(
+                  *uds_p);
+        }
         if (auto* certificates_p = jo->if_contains("certificates")) {
           config.certificates =
               json::value_to<std::vector<HttpclientCertificate>>(
@@ -236,6 +280,21 @@ class HttpclientConfig {
   ssl::context::method get_ssl_method() const { return ssl_method; }
   bool get_default_verify_path() const { return default_verify_path; }
   bool get_insecure_skip_verify() const { return insecure_skip_verify; }
+  std::uint64_t get_response_memory_budget_bytes() const {
+    return response_memory_budget_bytes;
+  }
+  std::size_t get_pool_max_active() const { return pool_max_active; }
+  const std::string& get_warm_start_file() const { return warm_start_file; }
+  std::size_t get_warm_start_prewarm_origins() const {
+    return warm_start_prewarm_origins;
+  }
+  std::chrono::seconds get_warm_start_save_interval() const {
+    return std::chrono::seconds(warm_start_save_interval_seconds);
+  }
+  const std::unordered_map<std::string, std::string>&
+  get_unix_socket_overrides() const {
+    return unix_socket_overrides;
+  }
   const std::vector<std::string>& get_verify_paths() const {
     return verify_paths;
   }
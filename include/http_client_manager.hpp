@@ -2,68 +2,165 @@
 
 #include <boost/asio.hpp>
 #include <boost/system/result.hpp>
+#include <algorithm>
 #include <chrono>
 #include <memory>
 #include <optional>
 #include <string>
 #include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "batch_scheduler.hpp"
 #include "beast_connection_pool.hpp"
 #include "client_ssl_ctx.hpp"
+#include "cookie_jar.hpp"
+#include "explicit_instantiations.hpp"
 #include "http_client_config_provider.hpp"
+#include "http_client_runtime.hpp"
 #include "http_session.hpp"
 #include "http_session_pooled.hpp"
 #include "http_session_stream.hpp"
+#include "http_transport.hpp"
 #include "proxy_pool.hpp"
+#include "response_memory_budget.hpp"
+#include "traffic_record.hpp"
+#include "unix_socket_transport.hpp"
+#include "warm_start_state.hpp"
+#include "websocket_client.hpp"
 
 namespace asio = boost::asio;
 
 namespace client_async {
 
+// One entry of HttpClientManager::submit_batch.
+template <class RequestBody>
+struct BatchRequest {
+  urls::url url;
+  http::request<RequestBody, http::basic_fields<std::allocator<char>>> req;
+  // Batches want pooled keep-alive connections; redirects fall back to a
+  // fresh connection per hop.
+  HttpClientRequestParams params = [] {
+    HttpClientRequestParams p;
+    p.follow_redirect = false;
+    return p;
+  }();
+};
+
 class HttpClientManager {
  private:
-  std::unique_ptr<asio::io_context> ioc;
+  // What request handlers use once the call that started them has
+  // returned (redirect hops, batch jobs). They hold it by shared_ptr, so
+  // work still in flight when a manager on a shared runtime is destroyed
+  // finishes without touching the manager; the io_context, TLS context and
+  // pool it points to belong to the runtime.
+  struct Core {
+    asio::io_context* ioc{nullptr};
+    asio::ssl::context* ssl_ctx{nullptr};
+    beast_pool::ConnectionPool* pool{nullptr};
+    UnixSocketOverrides unix_socket_overrides;
+    std::shared_ptr<CookieJar> cookie_jar;
+    std::shared_ptr<TrafficRecorder> recorder;
+    std::shared_ptr<HttpTransport> transport;
+    ProxyOriginCache proxy_origins;
+
+    // Socket path for a request to `url`, if it should go over a Unix
+    // domain socket: an explicit `params.unix_socket_path` pinned to
+    // `pinned_origin` wins, then the per-origin config overrides.
+    std::optional<std::string> unix_socket_for(
+        const urls::url& url, const HttpClientRequestParams& params,
+        std::string_view pinned_origin) const {
+      if (params.unix_socket_path && !params.unix_socket_path->empty() &&
+          (pinned_origin.empty() || origin_key(url) == pinned_origin)) {
+        return params.unix_socket_path;
+      }
+      return unix_socket_overrides.find(url);
+    }
+  };
+
+  // A standalone manager owns its io_context, threads and pool; one built on
+  // an HttpClientRuntime borrows the runtime's and leaves these empty.
+  std::unique_ptr<asio::io_context> owned_ioc_;
+  std::unique_ptr<beast_pool::ConnectionPool> owned_pool_;
+  HttpClientRuntime* runtime_{nullptr};
+  asio::io_context* ioc;
   cjj365::ClientSSLContext& client_ssl_ctx;
   int threads_{0};
   std::vector<std::thread> thread_pool;
   std::unique_ptr<
       boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
       work_guard;
-  std::unique_ptr<beast_pool::ConnectionPool> pool_;
+  beast_pool::ConnectionPool* pool_;
   std::atomic<bool> stopped_{false};
   std::unique_ptr<ProxyPool> proxy_pool_;
   std::string profile_name_;
+  std::shared_ptr<Core> core_ = std::make_shared<Core>();
+  std::shared_ptr<beast_pool::WarmStartState> warm_start_;
+  std::string warm_start_file_;
+  std::chrono::seconds warm_start_save_interval_{0};
+  std::unique_ptr<asio::steady_timer> warm_start_timer_;
 
  public:
   HttpClientManager(cjj365::ClientSSLContext& ctx,
                     cjj365::IHttpclientConfigProvider& config_provider,
                     std::string_view profile = {})
       : client_ssl_ctx(ctx) {
-    profile_name_ = profile.empty()
-                        ? std::string(config_provider.default_name())
-                        : std::string(profile);
-    const auto& cfg = config_provider.get(profile_name_);
+    const auto& cfg = apply_profile(config_provider, profile);
+    apply_default_memory_budget(config_provider);
     threads_ = cfg.get_threads_num();
-    ioc = std::make_unique<asio::io_context>(threads_);
+    owned_ioc_ = std::make_unique<asio::io_context>(threads_);
+    ioc = owned_ioc_.get();
     work_guard = std::make_unique<boost::asio::executor_work_guard<
         boost::asio::io_context::executor_type>>(
         boost::asio::make_work_guard(*ioc));
     // Initialize a shared connection pool (defaults are fine; can be extended)
-    pool_ = std::make_unique<beast_pool::ConnectionPool>(
-        *ioc, beast_pool::PoolConfig{}, &client_ssl_ctx.context());
-    proxy_pool_ = std::make_unique<ProxyPool>(config_provider, profile_name_);
+    beast_pool::PoolConfig pool_cfg;
+    pool_cfg.max_active = cfg.get_pool_max_active();
+    owned_pool_ = std::make_unique<beast_pool::ConnectionPool>(
+        *ioc, pool_cfg, &client_ssl_ctx.context());
+    pool_ = owned_pool_.get();
+    core_->ioc = ioc;
+    core_->ssl_ctx = &client_ssl_ctx.context();
+    core_->pool = pool_;
+    if (!cfg.get_warm_start_file().empty()) {
+      start_warm(cfg.get_warm_start_file(),
+                 cfg.get_warm_start_prewarm_origins(),
+                 cfg.get_warm_start_save_interval());
+    }
     for (size_t i = 0; i < threads_; ++i) {
       thread_pool.emplace_back([this] { ioc->run(); });
     }
   }
 
+  // A profile on a shared runtime: no threads, io_context or pool of its
+  // own. The profile's threads_num, pool and warm-start settings are
+  // ignored in favour of the runtime's, as is its memory budget (the
+  // runtime sets it); its proxies and Unix socket overrides still apply.
+  HttpClientManager(HttpClientRuntime& runtime,
+                    cjj365::IHttpclientConfigProvider& config_provider,
+                    std::string_view profile = {})
+      : runtime_(&runtime),
+        ioc(&runtime.ioc()),
+        client_ssl_ctx(runtime.ssl_context()),
+        pool_(&runtime.pool()) {
+    core_->ioc = ioc;
+    core_->ssl_ctx = &client_ssl_ctx.context();
+    core_->pool = pool_;
+    apply_profile(config_provider, profile);
+  }
+
   ~HttpClientManager() { stop(); }
 
   asio::io_context& ioc_ref() { return *ioc; }
 
+  // Standalone managers stop their io_context and threads. On a shared
+  // runtime this only marks the manager stopped; the runtime's owner stops
+  // the network, and requests already started run to completion (their
+  // callbacks still fire) even if the manager is destroyed meanwhile.
   void stop() {
     if (stopped_.exchange(true)) return;  // already stopped
+    if (runtime_) return;
     work_guard->reset();
     ioc->stop();
     for (auto& t : thread_pool) {
@@ -71,6 +168,15 @@ class HttpClientManager {
         t.join();
       }
     }
+    save_warm_start();
+  }
+
+  // Write the warm-start file now (no-op when it is not configured or
+  // nothing changed). stop() does this too.
+  bool save_warm_start() {
+    if (runtime_) return runtime_->save_warm_start();
+    if (!warm_start_ || !warm_start_->dirty()) return true;
+    return warm_start_->save(warm_start_file_);
   }
 
   std::shared_ptr<const cjj365::ProxySetting> borrow_proxy() {
@@ -117,7 +223,110 @@ class HttpClientManager {
 
   std::string_view profile_name() const { return profile_name_; }
 
+  // The runtime's cache on a shared runtime; otherwise null unless
+  // `warm_start_file` is configured.
+  std::shared_ptr<beast_pool::WarmStartState> warm_start_state() const {
+    return runtime_ ? runtime_->cache() : warm_start_;
+  }
+
+  // Keep cookies from responses and send them back on later requests,
+  // redirect hops included. Null (the default) disables cookie handling.
+  // Managers may share one jar; set it before issuing requests.
+  void set_cookie_jar(std::shared_ptr<CookieJar> jar) {
+    core_->cookie_jar = std::move(jar);
+  }
+  const std::shared_ptr<CookieJar>& cookie_jar() const {
+    return core_->cookie_jar;
+  }
+
+  // Append every http_request / http_request_pooled exchange (each
+  // redirect hop separately) to `recorder`'s log for offline replay;
+  // streamed requests are not recorded. Null (the default) records
+  // nothing; set it before issuing requests.
+  void set_traffic_recorder(std::shared_ptr<TrafficRecorder> recorder) {
+    core_->recorder = std::move(recorder);
+  }
+  const std::shared_ptr<TrafficRecorder>& traffic_recorder() const {
+    return core_->recorder;
+  }
+
+  // Send http_request / http_request_pooled exchanges through `transport`
+  // instead of sockets (see InMemoryTransport); cookies, redirects and
+  // recording still apply. Null (the default) uses the network; set it
+  // before issuing requests.
+  void set_transport(std::shared_ptr<HttpTransport> transport) {
+    core_->transport = std::move(transport);
+  }
+  const std::shared_ptr<HttpTransport>& transport() const {
+    return core_->transport;
+  }
+
+  // Gauges for the process-wide in-flight response memory budget.
+  ResponseMemoryBudget::Stats response_memory_stats() const {
+    return ResponseMemoryBudget::global().stats();
+  }
+
  private:
+  // Per-profile policies, common to both constructors.
+  const cjj365::HttpclientConfig& apply_profile(
+      cjj365::IHttpclientConfigProvider& config_provider,
+      std::string_view profile) {
+    profile_name_ = profile.empty()
+                        ? std::string(config_provider.default_name())
+                        : std::string(profile);
+    const auto& cfg = config_provider.get(profile_name_);
+    proxy_pool_ = std::make_unique<ProxyPool>(config_provider, profile_name_);
+    core_->unix_socket_overrides =
+        UnixSocketOverrides(cfg.get_unix_socket_overrides());
+    return cfg;
+  }
+
+  // The budget is process-wide, so only the default profile sizes it;
+  // other profiles' response_memory_budget_bytes are ignored.
+  static void apply_default_memory_budget(
+      const cjj365::IHttpclientConfigProvider& config_provider) {
+    if (auto budget = config_provider.get().get_response_memory_budget_bytes();
+        budget > 0) {
+      ResponseMemoryBudget::global().set_capacity(budget);
+    }
+  }
+
+  // Load the warm-start file, pre-connect its busiest origins (resuming
+  // their TLS sessions) and rewrite it every `save_interval`.
+  void start_warm(const std::string& path, std::size_t prewarm_origins,
+                  std::chrono::seconds save_interval) {
+    warm_start_file_ = path;
+    warm_start_save_interval_ = save_interval;
+    warm_start_ = std::make_shared<beast_pool::WarmStartState>();
+    warm_start_->load(warm_start_file_);  // missing or stale: start empty
+    pool_->set_warm_start(warm_start_);
+    prewarm_top_origins(*pool_, *warm_start_, prewarm_origins);
+    if (save_interval.count() > 0) {
+      warm_start_timer_ = std::make_unique<asio::steady_timer>(*ioc);
+      arm_warm_start_save();
+    }
+  }
+
+  void arm_warm_start_save() {
+    warm_start_timer_->expires_after(warm_start_save_interval_);
+    warm_start_timer_->async_wait([this](boost::system::error_code ec) {
+      if (ec || stopped_) return;
+      save_warm_start();
+      arm_warm_start_save();
+    });
+  }
+
+  // Rewrites an `http+unix://` URL to http://localhost/... and records the
+  // socket in `params`. Other URLs are left alone.
+  static urls::url adopt_unix_socket_url(const urls::url_view& url_input,
+                                         HttpClientRequestParams& params) {
+    if (auto local = split_unix_socket_url(url_input)) {
+      params.unix_socket_path = std::move(local->socket_path);
+      return std::move(local->url);
+    }
+    return urls::url(url_input);
+  }
+
   static bool is_redirect_status(int status_code) {
     return status_code == 301 || status_code == 302 || status_code == 303 ||
            status_code == 307 || status_code == 308;
@@ -215,8 +424,11 @@ class HttpClientManager {
   }
 
  public:
+  // Returns a function that aborts the stream from any thread (the callback
+  // then reports error 8); it does nothing once the stream has finished.
+  // URLs that map to a Unix domain socket stream over it, never proxied.
   template <class RequestBody>
-  void http_request_stream(
+  std::function<void()> http_request_stream(
       const urls::url_view& url_input,
       http::request<RequestBody, http::basic_fields<std::allocator<char>>>&&
           req,
@@ -235,10 +447,20 @@ class HttpClientManager {
       // Streaming path intentionally does not follow redirects automatically.
       params.follow_redirect = false;
     }
-    urls::url url(url_input);
+    urls::url url = adopt_unix_socket_url(url_input, params);
     if (!params.no_modify_req) {
       update_request_target_for_url(req, url);
     }
+    if (auto socket_path = core_->unix_socket_for(url, params, {})) {
+      auto session = std::make_shared<
+          session_stream_unix<RequestBody, std::allocator<char>>>(
+          *(this->ioc), std::move(url),
+          HttpClientRequestParams{std::move(params)}, std::move(callback),
+          std::move(on_headers), std::move(on_chunk), std::move(*socket_path));
+      session->set_req(std::move(req));
+      session->run();
+      return cancel_stream(session);
+    }
     if (url.scheme() == "https") {
       auto session =
           std::make_shared<session_stream_ssl<RequestBody, std::allocator<char>>>(
@@ -247,7 +469,7 @@ class HttpClientManager {
               std::move(on_headers), std::move(on_chunk), proxy_setting);
       session->set_req(std::move(req));
       session->run();
-      return;
+      return cancel_stream(session);
     }
     auto session =
         std::make_shared<session_stream_plain<RequestBody, std::allocator<char>>>(
@@ -256,6 +478,16 @@ class HttpClientManager {
             std::move(on_headers), std::move(on_chunk), proxy_setting);
     session->set_req(std::move(req));
     session->run();
+    return cancel_stream(session);
+  }
+
+ private:
+  template <class Session>
+  static std::function<void()> cancel_stream(
+      const std::shared_ptr<Session>& session) {
+    return [weak = std::weak_ptr<Session>(session)] {
+      if (auto s = weak.lock()) s->cancel();
+    };
   }
 
  public:
@@ -270,13 +502,34 @@ class HttpClientManager {
                int)>&& callback,
       HttpClientRequestParams&& params = {},
       const cjj365::ProxySetting* proxy_setting = nullptr) {
+    start_request<RequestBody, ResponseBody>(
+        core_, url_input, std::move(req), std::move(callback),
+        std::move(params), proxy_setting);
+  }
+
+ private:
+  template <class RequestBody, class ResponseBody>
+  static void start_request(
+      std::shared_ptr<Core> core, const urls::url_view& url_input,
+      http::request<RequestBody, http::basic_fields<std::allocator<char>>>&&
+          req,
+      std::function<
+          void(std::optional<http::response<
+                   ResponseBody, http::basic_fields<std::allocator<char>>>>&&,
+               int)>&& callback,
+      HttpClientRequestParams&& params,
+      const cjj365::ProxySetting* proxy_setting) {
     struct RedirectState {
       urls::url url;
       http::request<RequestBody, http::basic_fields<std::allocator<char>>>
           req_template;
       HttpClientRequestParams params;
+      // Origin an explicit unix_socket_path belongs to; redirects elsewhere
+      // leave the socket.
+      std::string socket_origin;
       const cjj365::ProxySetting* proxy_setting{nullptr};
       int redirects_left{5};
+      std::shared_ptr<CookieJar> jar;
       std::shared_ptr<std::function<void()>> step;
       std::function<void(
           std::optional<http::response<
@@ -286,11 +539,17 @@ class HttpClientManager {
     };
 
     auto st = std::make_shared<RedirectState>();
-    st->url = urls::url(url_input);
+    st->url = adopt_unix_socket_url(url_input, params);
+    if (params.unix_socket_path) st->socket_origin = origin_key(st->url);
     st->req_template = std::move(req);
     st->params = std::move(params);
+    // Redirects, cookies and recording read the response's fields.
+    if (st->params.follow_redirect || core->cookie_jar || core->recorder) {
+      st->params.flat_headers.reset();
+    }
     st->proxy_setting = proxy_setting;
     st->redirects_left = 5;
+    st->jar = core->cookie_jar;
     st->step = nullptr;
     st->user_cb = std::move(callback);
 
@@ -298,19 +557,46 @@ class HttpClientManager {
     st->step = step;
     std::weak_ptr<RedirectState> st_weak = st;
 
-    *step = [this, st_weak]() {
+    *step = [core = std::move(core), st_weak]() {
       auto st = st_weak.lock();
       if (!st) return;
-      auto req_one = st->req_template;
+      using request_t = decltype(st->req_template);
+      auto req_one = [&]() -> request_t {
+        // Move-only bodies (file uploads) are sent once and never replayed.
+        if constexpr (std::is_copy_constructible_v<request_t>) {
+          return st->req_template;
+        } else {
+          return std::move(st->req_template);
+        }
+      }();
       if (!st->params.no_modify_req) {
         update_request_target_for_url(req_one, st->url);
       }
+      if (st->jar) {
+        st->jar->apply(req_one, st->url.host(), st->url.scheme() == "https");
+      }
+      const auto port = static_cast<std::uint16_t>(
+          st->url.has_port() ? st->url.port_number()
+                             : (st->url.scheme() == "https" ? 443 : 80));
+      std::optional<TrafficRecorder::Pending> recording;
+      if (core->recorder) {
+        recording = core->recorder->begin(st->url.scheme(), st->url.host(),
+                                          port, req_one);
+      }
 
       auto cb =
-          [st](std::optional<http::response<
-                   ResponseBody, http::basic_fields<std::allocator<char>>>>&&
-                   resp,
-               int ec) mutable {
+          [st, rec = core->recorder, recording = std::move(recording)](
+              std::optional<http::response<
+                  ResponseBody, http::basic_fields<std::allocator<char>>>>&&
+                  resp,
+              int ec) mutable {
+            if (rec) rec->finish(*recording, resp ? &*resp : nullptr, ec);
+            if (st->jar && resp.has_value()) {
+              const auto path = st->url.encoded_path();
+              st->jar->store(st->url.host(),
+                             std::string_view(path.data(), path.size()),
+                             resp->base());
+            }
             if (ec != 0 || !resp.has_value() || !st->params.follow_redirect ||
                 st->redirects_left <= 0) {
               st->user_cb(std::move(resp), ec);
@@ -319,8 +605,9 @@ class HttpClientManager {
 
             // Follow redirects only for GET/HEAD to avoid method/body
             // semantics.
-            if (st->req_template.method() != http::verb::get &&
-                st->req_template.method() != http::verb::head) {
+            if (!std::is_copy_constructible_v<decltype(st->req_template)> ||
+                (st->req_template.method() != http::verb::get &&
+                 st->req_template.method() != http::verb::head)) {
               st->user_cb(std::move(resp), ec);
               return;
             }
@@ -351,11 +638,28 @@ class HttpClientManager {
             }
           };
 
+      if (auto transport = core->transport) {
+        run_on_transport<ResponseBody>(
+            *transport,
+            transport_url(st->url.scheme(), st->url.host(), port,
+                          req_one.target()),
+            req_one, std::move(cb));
+        return;
+      }
       urls::url url_local = st->url;
-      if (url_local.scheme() == "https") {
+      if (auto socket_path = core->unix_socket_for(url_local, st->params,
+                                                   st->socket_origin)) {
+        auto session = std::make_shared<
+            session_unix<RequestBody, ResponseBody, std::allocator<char>>>(
+            *core->ioc, std::move(url_local),
+            HttpClientRequestParams{st->params}, std::move(cb),
+            std::move(*socket_path));
+        session->set_req(std::move(req_one));
+        session->run();
+      } else if (url_local.scheme() == "https") {
         auto session = std::make_shared<
             session_ssl<RequestBody, ResponseBody, std::allocator<char>>>(
-            *(this->ioc), this->client_ssl_ctx.context(), std::move(url_local),
+            *core->ioc, *core->ssl_ctx, std::move(url_local),
             HttpClientRequestParams{st->params}, std::move(cb),
             st->proxy_setting);
         session->set_req(std::move(req_one));
@@ -363,7 +667,7 @@ class HttpClientManager {
       } else {
         auto session = std::make_shared<
             session_plain<RequestBody, ResponseBody, std::allocator<char>>>(
-            *(this->ioc), std::move(url_local),
+            *core->ioc, std::move(url_local),
             HttpClientRequestParams{st->params}, std::move(cb),
             st->proxy_setting);
         session->set_req(std::move(req_one));
@@ -374,6 +678,7 @@ class HttpClientManager {
     (*step)();
   }
 
+ public:
   // New: pooled variant (keeps existing APIs intact)
   template <class RequestBody, class ResponseBody>
   void http_request_pooled(
@@ -399,8 +704,18 @@ class HttpClientManager {
       callback(std::nullopt, 9);
       return;
     }
-    // Build origin for pool acquisition
-    urls::url url(url_input);
+    const auto origin_id = pooled_origin_id(url_input, params);
+    run_pooled<RequestBody, ResponseBody>(*core_, origin_id, std::move(req),
+                                          std::move(callback), params,
+                                          proxy_setting);
+  }
+
+  // Pool origin for `url`, including any Unix socket override. Interning is
+  // done once per origin; callers sending many requests to the same origin
+  // should keep the id and use the OriginId overload below.
+  beast_pool::OriginId pooled_origin_id(const urls::url_view& url_input,
+                                        HttpClientRequestParams params = {}) {
+    urls::url url = adopt_unix_socket_url(url_input, params);
     beast_pool::Origin origin;
     origin.scheme = std::string(url.scheme());
     origin.host = std::string(url.host());
@@ -409,29 +724,271 @@ class HttpClientManager {
     } else {
       origin.port = (origin.scheme == "https") ? 443 : 80;
     }
+    if (auto socket_path = core_->unix_socket_for(url, params, {})) {
+      origin.socket_path = std::move(*socket_path);
+    }
+    return beast_pool::OriginTable::global().intern(origin);
+  }
+
+  // WebSocket client for a ws:// or wss:// URL. Its connection comes from
+  // this manager's pool (DNS cache, TLS context, warm-start sessions) and
+  // goes through `proxy_setting` with CONNECT when one is given. `params`
+  // supplies the handshake and idle (io_timeout) timeouts and any Unix
+  // socket override. Call connect() on the result.
+  std::shared_ptr<WebSocketClient> websocket(
+      const urls::url_view& url_input, WebSocketOptions options = {},
+      HttpClientRequestParams params = {},
+      const cjj365::ProxySetting* proxy_setting = nullptr) {
+    urls::url url(url_input);
+    if (url.scheme() == "ws") {
+      url.set_scheme("http");
+    } else if (url.scheme() == "wss") {
+      url.set_scheme("https");
+    }
+    options.handshake_timeout = params.handshake_timeout;
+    options.idle_timeout = params.io_timeout;
+    if (proxy_setting) {
+      options.proxy = WebSocketProxy{proxy_setting->host, proxy_setting->port,
+                                     proxy_setting->username,
+                                     proxy_setting->password};
+    }
+    http::request<http::empty_body> probe;
+    update_request_target_for_url(probe, url);
+    const auto origin_id = pooled_origin_id(url, std::move(params));
+    return WebSocketClient::create(*pool_, origin_id,
+                                   std::string(probe.target()),
+                                   std::move(options));
+  }
+
+  // Pooled request to an interned origin: no URL parsing, no Origin strings
+  // built or hashed per request. Redirects are not followed (code 9).
+  template <class RequestBody, class ResponseBody>
+  void http_request_pooled(
+      beast_pool::OriginId origin_id,
+      http::request<RequestBody, http::basic_fields<std::allocator<char>>>&&
+          req,
+      std::function<
+          void(std::optional<http::response<
+                   ResponseBody, http::basic_fields<std::allocator<char>>>>&&,
+               int)>&& callback,
+      HttpClientRequestParams&& params = {},
+      const cjj365::ProxySetting* proxy_setting = nullptr) {
+    if (params.follow_redirect) {
+      callback(std::nullopt, 9);
+      return;
+    }
+    run_pooled<RequestBody, ResponseBody>(*core_, origin_id, std::move(req),
+                                          std::move(callback), params,
+                                          proxy_setting);
+  }
+
+  // Sends many requests at once. Requests are grouped by origin; each origin
+  // gets one DNS lookup and warm connections before its first request is
+  // sent (unless a proxy is used or opts.prewarm is off). Requests run under
+  // a global and a per-origin cap, with origins taking turns.
+  //
+  // `on_result(i, response, ec)` fires as each request i finishes, on an
+  // io_context thread. `on_complete` fires once after the last result.
+  template <class RequestBody, class ResponseBody>
+  void submit_batch(
+      std::vector<BatchRequest<RequestBody>> batch,
+      std::function<void(
+          std::size_t,
+          std::optional<http::response<
+              ResponseBody, http::basic_fields<std::allocator<char>>>>&&,
+          int)>
+          on_result,
+      std::function<void()> on_complete, BatchOptions opts = {},
+      const cjj365::ProxySetting* proxy_setting = nullptr) {
+    struct State {
+      std::vector<BatchRequest<RequestBody>> items;
+      std::vector<beast_pool::OriginId> origin_ids;
+      decltype(on_result) on_result;
+    };
+    auto st = std::make_shared<State>();
+    st->items = std::move(batch);
+    st->on_result = std::move(on_result);
+    st->origin_ids.reserve(st->items.size());
+
+    // Resolve each URL to its pooled origin once, counting the requests that
+    // will reuse pooled connections.
+    std::unordered_map<beast_pool::OriginId, std::size_t> pooled_per_origin;
+    for (auto& item : st->items) {
+      item.url = adopt_unix_socket_url(item.url, item.params);
+      const auto id = pooled_origin_id(item.url, item.params);
+      st->origin_ids.push_back(id);
+      if (!item.params.follow_redirect) ++pooled_per_origin[id];
+    }
+
+    const bool prewarm = opts.prewarm && !proxy_setting;
+    auto start = [core = core_, st, proxy_setting](
+                     std::size_t i, std::function<void()> done) {
+      auto& item = st->items[i];
+      if (!item.params.no_modify_req) {
+        update_request_target_for_url(item.req, item.url);
+      }
+      auto cb = [st, i, done = std::move(done)](
+                    std::optional<http::response<
+                        ResponseBody,
+                        http::basic_fields<std::allocator<char>>>>&& resp,
+                    int ec) {
+        st->on_result(i, std::move(resp), ec);
+        done();
+      };
+      if (!item.params.follow_redirect) {
+        run_pooled<RequestBody, ResponseBody>(*core, st->origin_ids[i],
+                                              std::move(item.req),
+                                              std::move(cb), item.params,
+                                              proxy_setting);
+      } else if constexpr (std::is_copy_constructible_v<
+                               decltype(item.req)>) {
+        start_request<RequestBody, ResponseBody>(
+            core, item.url, std::move(item.req), std::move(cb),
+            std::move(item.params), proxy_setting);
+      } else {
+        cb(std::nullopt, 9);  // move-only bodies cannot follow redirects
+      }
+    };
+    auto scheduler =
+        BatchScheduler::create(st->origin_ids, opts, std::move(start),
+                               std::move(on_complete), /*start_open=*/!prewarm);
+    scheduler->run();
+    if (!prewarm) return;
+    for (auto const& [id, pooled] : pooled_per_origin) {
+      pool_->prewarm(id, std::min(pooled, opts.max_in_flight_per_origin),
+                     [scheduler, id = id](boost::system::error_code) {
+                       // Failures surface on the requests themselves.
+                       scheduler->open(id);
+                     });
+    }
+    // Origins reached only through redirects have nothing to warm.
+    for (auto id : st->origin_ids) {
+      if (pooled_per_origin.count(id) == 0) scheduler->open(id);
+    }
+  }
+
+ private:
+  template <class RequestBody, class ResponseBody>
+  static void run_pooled(
+      const Core& core, beast_pool::OriginId origin_id,
+      http::request<RequestBody, http::basic_fields<std::allocator<char>>>&&
+          req,
+      std::function<
+          void(std::optional<http::response<
+                   ResponseBody, http::basic_fields<std::allocator<char>>>>&&,
+               int)>&& callback,
+      const HttpClientRequestParams& params,
+      const cjj365::ProxySetting* proxy_setting) {
+    const auto& origin = beast_pool::OriginTable::global().get(origin_id);
+    if (beast_pool::is_unix(origin)) {
+      proxy_setting = nullptr;  // local sockets are never proxied
+      if (req.find(http::field::host) == req.end()) {
+        req.set(http::field::host, origin.host);
+      }
+    }
 
     std::optional<typename client_async::http_session_pooled<
         RequestBody, ResponseBody, std::allocator<char>>::ProxySetting>
         proxy;
     if (proxy_setting) {
       proxy = {proxy_setting->host, proxy_setting->port,
-               proxy_setting->username, proxy_setting->password};
+               proxy_setting->username, proxy_setting->password,
+               core.proxy_origins.get(*proxy_setting)};
+    }
+
+    if (auto jar = core.cookie_jar) {
+      const bool secure = beast_pool::is_https(origin);
+      jar->apply(req, origin.host, secure);
+      const std::string target(req.target());
+      callback = [jar, host = origin.host, target,
+                  cb = std::move(callback)](
+                     std::optional<http::response<
+                         ResponseBody,
+                         http::basic_fields<std::allocator<char>>>>&& resp,
+                     int ec) {
+        if (resp) jar->store(host, target, resp->base());
+        cb(std::move(resp), ec);
+      };
+    }
+
+    if (auto rec = core.recorder) {
+      callback = [rec, recording = rec->begin(origin.scheme, origin.host,
+                                              origin.port, req),
+                  cb = std::move(callback)](
+                     std::optional<http::response<
+                         ResponseBody,
+                         http::basic_fields<std::allocator<char>>>>&& resp,
+                     int ec) {
+        rec->finish(recording, resp ? &*resp : nullptr, ec);
+        cb(std::move(resp), ec);
+      };
+    }
+
+    if (auto transport = core.transport) {
+      run_on_transport<ResponseBody>(
+          *transport,
+          transport_url(origin.scheme, origin.host, origin.port, req.target()),
+          req, std::move(callback));
+      return;
     }
 
     using Pooled = client_async::http_session_pooled<RequestBody, ResponseBody,
                                                      std::allocator<char>>;
     auto session =
-        std::make_shared<Pooled>(*pool_, std::move(origin), std::move(proxy));
+        std::make_shared<Pooled>(*core.pool, origin_id, std::move(proxy));
     if (params.timeout.count() > 0) {
       session->set_io_timeout(params.timeout);
     }
+    session->set_body_policy(params.body_policy);
+    session->set_expect_continue(params.expect_continue);
+    session->set_fast_response_parser(params.fast_response_parser);
+    if (!core.cookie_jar && !core.recorder) {
+      session->set_flat_headers(params.flat_headers);
+    }
+    session->set_priority(params.priority);
     session->set_request(std::move(req));
     session->run(std::move(callback));
   }
+
+  // Hands `req` to `transport` and parses the returned bytes into
+  // ResponseBody; unparseable bytes fail like a read error (8). Only string
+  // request bodies are forwarded.
+  template <class ResponseBody, class Request, class Callback>
+  static void run_on_transport(HttpTransport& transport, std::string url,
+                               const Request& req, Callback&& cb) {
+    TransportRequest treq;
+    treq.method = req.method();
+    treq.url = std::move(url);
+    treq.headers = req.base();
+    using body_value = std::decay_t<decltype(req.body())>;
+    if constexpr (std::is_same_v<body_value, std::string>) {
+      treq.body = req.body();
+    }
+    transport.exchange(
+        std::move(treq),
+        [cb = std::forward<Callback>(cb)](int ec, std::string wire) mutable {
+          using response_t =
+              http::response<ResponseBody,
+                             http::basic_fields<std::allocator<char>>>;
+          if (ec != 0) {
+            cb(std::optional<response_t>{}, ec);
+            return;
+          }
+          boost::system::error_code perr;
+          auto res = parse_transport_response<ResponseBody>(wire, perr);
+          if (perr) {
+            cb(std::optional<response_t>{}, 8);
+            return;
+          }
+          cb(std::optional<response_t>{std::move(res)}, 0);
+        });
+  }
 };
 
-// EXTERN_CLIENTPOOL_HTTP_REQUEST(http::string_body, http::string_body)
-// EXTERN_CLIENTPOOL_HTTP_REQUEST(http::empty_body, http::string_body)
-// EXTERN_CLIENTPOOL_HTTP_REQUEST(http::file_body, http::empty_body)
+#ifdef HTTP_CLIENT_PREBUILT_SESSIONS
+EXTERN_CLIENTPOOL_HTTP_REQUEST(http::string_body, http::string_body)
+EXTERN_CLIENTPOOL_HTTP_REQUEST(http::empty_body, http::string_body)
+EXTERN_CLIENTPOOL_HTTP_REQUEST(http::file_body, http::empty_body)
+#endif
 
 }  // namespace client_async
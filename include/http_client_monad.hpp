@@ -20,8 +20,10 @@
 #include <vector>
 
 #include "common_macros.hpp"
+#include "cookie_jar.hpp"
 #include "http_client_manager.hpp"
 #include "io_monad.hpp"
+#include "io_monad_poll_conditional.hpp"
 #include "result_monad.hpp"
 
 namespace monad {
@@ -51,6 +53,33 @@ struct HttpExchange {
   std::optional<fs::path> response_file = std::nullopt;
   urls::url url;
   std::chrono::seconds timeout = std::chrono::seconds(30);
+  client_async::ResponseBodyPolicy body_policy{};
+  client_async::ExpectContinuePolicy expect_continue{};
+  // Talk to a local sidecar over this Unix domain socket instead of
+  // resolving url's host. `http+unix://` URLs need no extra setting.
+  std::optional<std::string> unix_socket_path = std::nullopt;
+  // Parse string_body responses with the fast_http reader.
+  bool fast_response_parser = false;
+  // Opt-in with fast_response_parser: the response's header fields land
+  // here as a flat table instead of in `response`, which then carries
+  // status and body only. Read them with response_header(). Requests that
+  // follow redirects, or a manager with a cookie jar or traffic recorder,
+  // still fill `response`'s fields and leave this empty.
+  std::shared_ptr<client_async::fast_http::FastResponseHead> flat_headers{};
+  // Send over HttpClientManager's keep-alive ConnectionPool. Redirect-
+  // following requests still take a fresh connection per hop.
+  bool use_pool = false;
+  // Queueing class when the pool is at capacity (pooled requests only).
+  client_async::RequestPriority priority =
+      client_async::RequestPriority::normal;
+  // Pool origin of `url` (and unix_socket_path), interned on the first
+  // pooled request; see pooled_origin_id().
+  struct PooledOrigin {
+    beast_pool::OriginId id;
+    std::string url_origin;  // url.encoded_origin() it was interned for
+    std::optional<std::string> unix_socket_path;
+  };
+  std::optional<PooledOrigin> pooled_origin = std::nullopt;
 
   static constexpr int JSON_ERR_MALFORMED = 9000;
   static constexpr int JSON_ERR_DECODE = 9001;
@@ -73,6 +102,32 @@ struct HttpExchange {
   HttpExchange(const urls::url_view& url_input, Req request)
       : url(url_input), request(std::move(request)) {}
 
+  // Contiguous view of the buffered response body. Works for string_body and
+  // spill_body responses; empty when no response is available.
+  std::string_view response_body_view() const {
+    if (!response.has_value()) return {};
+    if constexpr (std::is_same_v<typename Res::body_type,
+                                 client_async::spill_body>) {
+      return response->body().view();
+    } else {
+      return std::string_view(response->body());
+    }
+  }
+
+  // First value of response header `name` (case-insensitive), from
+  // flat_headers when the response was delivered that way.
+  std::optional<std::string_view> response_header(
+      std::string_view name) const {
+    if (flat_headers && !flat_headers->empty()) {
+      return flat_headers->head.headers.find(name);
+    }
+    if (!response.has_value()) return std::nullopt;
+    auto it =
+        response->find(boost::beast::string_view(name.data(), name.size()));
+    if (it == response->end()) return std::nullopt;
+    return std::string_view(it->value().data(), it->value().size());
+  }
+
   // Note: call this when the request target must preserve the exact encoded
   // path/query computed by boost::url (e.g. GitHub OAuth token exchange).
   // It bypasses the default behaviour in `http_request_io`, which rebuilds the
@@ -96,6 +151,23 @@ struct HttpExchange {
     request.set(http::field::host, std::move(host_header));
   }
 
+  // Pool origin for this exchange. Interned once and reused while url's
+  // scheme, host and port and unix_socket_path stay the same, so repeated
+  // pooled requests (retries, reused exchanges) skip building and hashing
+  // the origin.
+  beast_pool::OriginId pooled_origin_id(HttpClientManager& manager) {
+    const auto url_origin = url.encoded_origin();
+    if (!pooled_origin || pooled_origin->url_origin != url_origin ||
+        pooled_origin->unix_socket_path != unix_socket_path) {
+      HttpClientRequestParams params;
+      params.unix_socket_path = unix_socket_path;
+      pooled_origin = PooledOrigin{
+          manager.pooled_origin_id(url, std::move(params)),
+          std::string(url_origin), unix_socket_path};
+    }
+    return pooled_origin->id;
+  }
+
   void contentTypeJson() {
     request.set(http::field::content_type, "application/json");
   }
@@ -130,8 +202,10 @@ struct HttpExchange {
     if (status < 200 || status >= 300) {
       std::string body_preview;
       if constexpr (std::is_same_v<typename Res::body_type,
-                                   http::string_body>) {
-        const auto& body = response->body();
+                                   http::string_body> ||
+                    std::is_same_v<typename Res::body_type,
+                                   client_async::spill_body>) {
+        const auto body = response_body_view();
         if (!body.empty()) {
           body_preview = make_preview(body);
         }
@@ -188,30 +262,16 @@ struct HttpExchange {
     auto range = fields.equal_range(http::field::set_cookie);
 
     for (auto it = range.first; it != range.second; ++it) {
-      const std::string& cookie_header = it->value();
-
+      const auto header = it->value();
       // e.g., "access_token=abc; Path=/; HttpOnly"
-      std::istringstream stream(cookie_header);
-      std::string token;
-
-      // Split by ';'
-      while (std::getline(stream, token, ';')) {
-        // Trim leading spaces
-        token.erase(0, token.find_first_not_of(" \t"));
-
-        std::string prefix = cookie_name + "=";
-        if (token.size() >= prefix.size() &&
-            token.substr(0, prefix.size()) == prefix) {
-          std::string value = token.substr(cookie_name.length() + 1);
-
-          // Strip quotes if present
-          if (!value.empty() && value.front() == '"' && value.back() == '"') {
-            value = value.substr(1, value.length() - 2);
-          }
-
-          return value;
-        }
+      auto [name, value] = CookieJar::cookie_pair(
+          std::string_view(header.data(), header.size()));
+      if (name != cookie_name) continue;
+      // Strip quotes if present
+      if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+        value = value.substr(1, value.size() - 2);
       }
+      return std::string(value);
     }
 
     return std::nullopt;
@@ -219,15 +279,16 @@ struct HttpExchange {
 
   std::string createRequestCookie(
       std::initializer_list<std::pair<std::string, std::string>> cookies) {
+    std::size_t bytes = 0;
+    for (const auto& [key, value] : cookies) {
+      bytes += key.size() + value.size() + 3;
+    }
     std::string result;
-    bool first = true;
+    result.reserve(bytes);
     for (const auto& [key, value] : cookies) {
-      if (!first) {
-        result += "; ";
-      } else {
-        first = false;
-      }
-      result += fmt::format("{}={}", key, value);
+      if (!result.empty()) result.append("; ");
+      result.append(key).push_back('=');
+      result.append(value);
     }
     return result;
   }
@@ -246,8 +307,7 @@ struct HttpExchange {
 
     const int response_status =
         response.has_value() ? static_cast<int>(response->result_int()) : 0;
-    const std::string response_body =
-        response.has_value() ? response->body() : std::string{};
+    const std::string_view response_body = response_body_view();
     const std::string response_body_preview = make_preview(response_body);
 
     return getJsonResponse().and_then(
@@ -284,8 +344,7 @@ struct HttpExchange {
 
     const int response_status =
         response.has_value() ? static_cast<int>(response->result_int()) : 0;
-    const std::string response_body =
-        response.has_value() ? response->body() : std::string{};
+    const std::string_view response_body = response_body_view();
     const std::string response_body_preview = make_preview(response_body);
 
     return getJsonResponse().and_then(
@@ -345,8 +404,7 @@ struct HttpExchange {
 
     const int response_status =
         response.has_value() ? static_cast<int>(response->result_int()) : 0;
-    const std::string response_body =
-        response.has_value() ? response->body() : std::string{};
+    const std::string_view response_body = response_body_view();
     const std::string response_body_preview = make_preview(response_body);
 
     return getJsonResponse().and_then([response_status, response_body_preview](
@@ -372,12 +430,13 @@ struct HttpExchange {
   MyResult<json::value> getJsonResponse() {
     try {
       if (response.has_value()) {
-        const auto& response_string = response->body();
+        const auto response_string = response_body_view();
         if (response_string.empty()) {
           Error err{JSON_ERR_MALFORMED,
                     "Malformed JSON text: response body is empty"};
           err.response_status = static_cast<int>(response->result_int());
-          err.params["response_body_preview"] = make_preview(response->body());
+          err.params["response_body_preview"] =
+              make_preview(response_string);
           return MyResult<json::value>::Err(std::move(err));
         }
         return MyResult<json::value>::Ok(json::parse(response_string));
@@ -392,7 +451,7 @@ struct HttpExchange {
       BOOST_LOG_SEV(lg, trivial::error)
           << "Failed to get JSON response: " << e.what();
       if (response.has_value()) {
-        std::string preview = make_preview(response->body());
+        std::string preview = make_preview(response_body_view());
         BOOST_LOG_SEV(lg, trivial::error)
             << "Response body preview: " << preview;
         Error err{JSON_ERR_DECODE,
@@ -415,6 +474,14 @@ struct HttpExchange {
 template <typename Req, typename Res>
 using HttpExchangePtr = std::shared_ptr<HttpExchange<Req, Res>>;
 
+// Lets poll_conditional read an exchange's response headers.
+template <typename Req, typename Res>
+auto conditional_poll_header(const HttpExchangePtr<Req, Res>& ex)
+    -> decltype(&ex->response->base()) {
+  if (!ex || !ex->response) return nullptr;
+  return &ex->response->base();
+}
+
 // ----- Tag-Based Type Mapping -----
 
 template <typename Tag>
@@ -424,8 +491,10 @@ struct GetStringTag {};  // Example tag
 struct GetStatusTag {};  // New tag
 struct PostJsonTag {};   // Another example tag
 struct GetFileTag {};    // Downloads response to file_body
+struct GetSpillTag {};   // Buffers in memory, spills large bodies to disk
 struct GetHeaderTag {};
 struct DeleteTag {};
+struct PutFileTag {};    // Uploads a file range, zero-copy where possible
 
 template <>
 struct TagTraits<GetStringTag> {
@@ -439,6 +508,12 @@ struct TagTraits<GetFileTag> {
   using Response = http::response<http::file_body>;
 };
 
+template <>
+struct TagTraits<GetSpillTag> {
+  using Request = http::request<http::empty_body>;
+  using Response = http::response<client_async::spill_body>;
+};
+
 template <>
 struct TagTraits<GetStatusTag> {
   using Request = http::request<http::empty_body>;
@@ -463,6 +538,14 @@ struct TagTraits<DeleteTag> {
   using Response = http::response<http::empty_body>;
 };
 
+// Open the file with `ex->request.body().open(...)` (or reset() for a range)
+// and call `prepare_payload()` before sending.
+template <>
+struct TagTraits<PutFileTag> {
+  using Request = http::request<client_async::sendfile_body>;
+  using Response = http::response<http::string_body>;
+};
+
 // ----- Monadic Constructor -----
 
 template <typename Tag>
@@ -505,8 +588,12 @@ ExchangeIOFor<Tag>
       make_exchange({http::verb::get, DEFAULT_TARGET, 11});
     } else if constexpr (std::is_same_v<Tag, GetFileTag>) {
       make_exchange({http::verb::get, DEFAULT_TARGET, 11});
+    } else if constexpr (std::is_same_v<Tag, GetSpillTag>) {
+      make_exchange({http::verb::get, DEFAULT_TARGET, 11});
     } else if constexpr (std::is_same_v<Tag, DeleteTag>) {
       make_exchange({http::verb::delete_, DEFAULT_TARGET, 11});
+    } else if constexpr (std::is_same_v<Tag, PutFileTag>) {
+      make_exchange({http::verb::put, DEFAULT_TARGET, 11});
     } else if constexpr (std::is_same_v<Tag, PostJsonTag>) {
       Req req{http::verb::post, DEFAULT_TARGET, 11};
       req.set(http::field::content_type, "application/json");
@@ -640,8 +727,22 @@ auto http_request_io(HttpClientManager& pool, int verbose = 0) {
       request_params.connect_timeout = ex->timeout;
       request_params.handshake_timeout = ex->timeout;
       request_params.io_timeout = ex->timeout;
+      request_params.body_policy = ex->body_policy;
+      request_params.expect_continue = ex->expect_continue;
+      request_params.unix_socket_path = ex->unix_socket_path;
+      request_params.fast_response_parser = ex->fast_response_parser;
+      if (ex->flat_headers) {
+        ex->flat_headers->clear();
+        request_params.flat_headers = ex->flat_headers;
+      }
+      request_params.priority = ex->priority;
 
-      if (!ex->proxy && !ex->no_proxy_pool && pool.has_proxy_pool()) {
+      // Local sockets are never proxied.
+      const bool local_socket = ex->unix_socket_path.has_value() ||
+                                client_async::is_unix_socket_url(ex->url);
+      if (local_socket) {
+        ex->proxy.reset();
+      } else if (!ex->proxy && !ex->no_proxy_pool && pool.has_proxy_pool()) {
         ex->proxy = pool.borrow_proxy();
       }
 
@@ -651,7 +752,14 @@ auto http_request_io(HttpClientManager& pool, int verbose = 0) {
         ex->proxy.reset();
       }
 
-      auto req = ex->request;
+      auto req = [&]() -> Req {
+        // File uploads hold an open file and can only be sent once.
+        if constexpr (std::is_copy_constructible_v<Req>) {
+          return ex->request;
+        } else {
+          return std::move(ex->request);
+        }
+      }();
       if (!ex->no_modify_req) {
         req.set(http::field::user_agent, BOOST_BEAST_VERSION_STRING);
         std::string target = ex->url.encoded_path().empty()
@@ -668,26 +776,87 @@ auto http_request_io(HttpClientManager& pool, int verbose = 0) {
         std::cerr << "Before request headers: " << req.base() << std::endl;
       }
 
-      pool.http_request<typename Req::body_type, typename Res::body_type>(
-          ex->url, std::move(req),
-          [cb = std::move(cb), ex](std::optional<Res> resp, int err) mutable {
-            if (err == 0 && resp.has_value()) {
-              ex->response = std::move(resp);
-              cb(monad::Result<ExchangePtr, monad::Error>::Ok(std::move(ex)));
-              return;
-            }
+      auto on_response = [cb = std::move(cb), ex](std::optional<Res> resp,
+                                                  int err) mutable {
+        if (err == 0 && resp.has_value()) {
+          ex->response = std::move(resp);
+          cb(monad::Result<ExchangePtr, monad::Error>::Ok(std::move(ex)));
+          return;
+        }
 
-            const auto url_view = ex->url.buffer();
-            BOOST_LOG_SEV(ex->lg, trivial::error)
-                << "http_request_io failed with error num: " << err
-                << ", url:  " << url_view;
-            cb(monad::Result<ExchangePtr, monad::Error>::Err(monad::Error{
-                err,
-                fmt::format("http_request_io failed, url: {}", url_view)}));
-          },
-          HttpClientRequestParams{request_params}, ex->proxy.get());
+        const auto url_view = ex->url.buffer();
+        BOOST_LOG_SEV(ex->lg, trivial::error)
+            << "http_request_io failed with error num: " << err
+            << ", url:  " << url_view;
+        cb(monad::Result<ExchangePtr, monad::Error>::Err(monad::Error{
+            err, fmt::format("http_request_io failed, url: {}", url_view)}));
+      };
+      if (ex->use_pool && !ex->follow_redirect) {
+        pool.http_request_pooled<typename Req::body_type,
+                                 typename Res::body_type>(
+            ex->pooled_origin_id(pool), std::move(req), std::move(on_response),
+            HttpClientRequestParams{request_params}, ex->proxy.get());
+      } else if (ex->use_pool) {
+        // Redirect chains take a fresh connection per hop.
+        pool.http_request_pooled<typename Req::body_type,
+                                 typename Res::body_type>(
+            ex->url, std::move(req), std::move(on_response),
+            HttpClientRequestParams{request_params}, ex->proxy.get());
+      } else {
+        pool.http_request<typename Req::body_type, typename Res::body_type>(
+            ex->url, std::move(req), std::move(on_response),
+            HttpClientRequestParams{request_params}, ex->proxy.get());
+      }
     });
   };
 }
 
+// Poll `url` with conditional requests (see poll_conditional): once a 2xx
+// response carried an ETag or Last-Modified, later attempts send
+// If-None-Match / If-Modified-Since, and a 304 retries without calling
+// `decide` or touching a body.
+//
+//   prepare(attempt, S&, ExchangePtr&)  headers, use_pool, ... per attempt
+//   decide(attempt, S&, const ExchangePtr&) -> PollControl
+template <typename Tag, typename S, typename PrepareFn, typename DecideFn>
+ExchangeIOFor<Tag> poll_http_conditional(HttpClientManager& client,
+                                         const urls::url_view& url,
+                                         const ConditionalPollOptions& opts,
+                                         S initial_state, PrepareFn prepare,
+                                         DecideFn decide) {
+  using ExchangePtr = ExchangePtrFor<Tag>;
+  using PooledOrigin = typename ExchangePtr::element_type::PooledOrigin;
+  // Attempts share one interned pool origin.
+  auto send = [&client, url = urls::url(url), prepare = std::move(prepare),
+               origin = std::optional<PooledOrigin>{}](
+                  int attempt, S& st,
+                  const ConditionalValidators& validators) mutable {
+    return http_io<Tag>(url)
+        .map([&, attempt](ExchangePtr ex) {
+          prepare(attempt, st, ex);
+          validators.apply(ex->request);
+          if (ex->use_pool) {
+            ex->pooled_origin = origin;
+            ex->pooled_origin_id(client);
+            origin = ex->pooled_origin;
+          }
+          return ex;
+        })
+        .then(http_request_io<Tag>(client));
+  };
+  return poll_conditional<ExchangePtr>(
+      opts, client.ioc_ref().get_executor(), std::move(initial_state),
+      std::move(send), std::move(decide));
+}
+
+template <typename Tag, typename S, typename DecideFn>
+ExchangeIOFor<Tag> poll_http_conditional(HttpClientManager& client,
+                                         const urls::url_view& url,
+                                         const ConditionalPollOptions& opts,
+                                         S initial_state, DecideFn decide) {
+  return poll_http_conditional<Tag>(
+      client, url, opts, std::move(initial_state),
+      [](int, S&, ExchangePtrFor<Tag>&) {}, std::move(decide));
+}
+
 }  // namespace monad
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <boost/asio/io_context.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/system/error_code.hpp>
+#include <chrono>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include "beast_connection_pool.hpp"
+#include "client_ssl_ctx.hpp"
+#include "http_client_config_provider.hpp"
+#include "io_context_manager.hpp"
+#include "response_memory_budget.hpp"
+#include "warm_start_state.hpp"
+
+namespace client_async {
+
+// Pre-connect the `n` busiest origins recorded in `state`, one connection
+// each.
+inline void prewarm_top_origins(beast_pool::ConnectionPool& pool,
+                                const beast_pool::WarmStartState& state,
+                                std::size_t n) {
+  for (auto const& o : state.top_origins(n)) {
+    const auto id = beast_pool::OriginTable::global().intern(
+        beast_pool::Origin{o.scheme, o.host, o.port});
+    pool.prewarm(id, 1, [](boost::system::error_code) {});
+  }
+}
+
+// Network resources shared by every HttpClientManager built on top of it:
+// the io_context and its threads (owned by the IIoContextManager), one
+// ConnectionPool, and one cache of DNS answers and TLS sessions. Each
+// manager still applies its own profile's proxies, Unix socket overrides and
+// redirect policy.
+//
+// Pool settings, the warm-start file and the process-wide response memory
+// budget come from the default profile.
+// Pooled connections go to whichever profile asks next, so profiles sharing
+// a runtime share its TLS trust settings; a profile that verifies
+// differently needs its own runtime or a standalone manager.
+//
+// Stop the IIoContextManager before destroying the runtime.
+class HttpClientRuntime {
+ public:
+  HttpClientRuntime(cjj365::IIoContextManager& iocm,
+                    cjj365::ClientSSLContext& ssl_ctx,
+                    const cjj365::IHttpclientConfigProvider& config_provider)
+      : iocm_(iocm),
+        ssl_ctx_(ssl_ctx),
+        cache_(std::make_shared<beast_pool::WarmStartState>()) {
+    const auto& cfg = config_provider.get();
+    beast_pool::PoolConfig pool_cfg;
+    pool_cfg.max_active = cfg.get_pool_max_active();
+    pool_ = std::make_unique<beast_pool::ConnectionPool>(
+        iocm_.ioc(), pool_cfg, &ssl_ctx_.context());
+    pool_->set_warm_start(cache_);
+    if (auto budget = cfg.get_response_memory_budget_bytes(); budget > 0) {
+      ResponseMemoryBudget::global().set_capacity(budget);
+    }
+    warm_start_file_ = cfg.get_warm_start_file();
+    if (!warm_start_file_.empty()) {
+      cache_->load(warm_start_file_);  // missing or stale: start empty
+      prewarm_top_origins(*pool_, *cache_,
+                          cfg.get_warm_start_prewarm_origins());
+      save_interval_ = cfg.get_warm_start_save_interval();
+      if (save_interval_.count() > 0) {
+        save_timer_ = std::make_unique<asio::steady_timer>(iocm_.ioc());
+        arm_warm_start_save();
+      }
+    }
+  }
+
+  HttpClientRuntime(const HttpClientRuntime&) = delete;
+  HttpClientRuntime& operator=(const HttpClientRuntime&) = delete;
+
+  ~HttpClientRuntime() { save_warm_start(); }
+
+  asio::io_context& ioc() { return iocm_.ioc(); }
+  cjj365::ClientSSLContext& ssl_context() { return ssl_ctx_; }
+  beast_pool::ConnectionPool& pool() { return *pool_; }
+
+  // DNS answers, TLS sessions and origin usage seen by all profiles.
+  const std::shared_ptr<beast_pool::WarmStartState>& cache() const {
+    return cache_;
+  }
+
+  // Write the warm-start file, if the default profile names one and
+  // anything changed. Also done every warm_start_save_interval_seconds
+  // and on destruction.
+  bool save_warm_start() {
+    if (warm_start_file_.empty() || !cache_->dirty()) return true;
+    return cache_->save(warm_start_file_);
+  }
+
+ private:
+  void arm_warm_start_save() {
+    save_timer_->expires_after(save_interval_);
+    save_timer_->async_wait([this](boost::system::error_code ec) {
+      if (ec) return;
+      save_warm_start();
+      arm_warm_start_save();
+    });
+  }
+
+  cjj365::IIoContextManager& iocm_;
+  cjj365::ClientSSLContext& ssl_ctx_;
+  std::shared_ptr<beast_pool::WarmStartState> cache_;
+  std::unique_ptr<beast_pool::ConnectionPool> pool_;
+  std::string warm_start_file_;
+  std::chrono::seconds save_interval_{0};
+  std::unique_ptr<asio::steady_timer> save_timer_;
+};
+
+}  // namespace client_async
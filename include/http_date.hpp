@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string_view>
+
+namespace client_async {
+
+// Lenient HTTP-date parsing (RFC 6265 section 5.1.1 cookie-date), which
+// also accepts the IMF-fixdate, RFC 850 and asctime forms of RFC 9110.
+// Shared by Set-Cookie Expires and Retry-After.
+namespace http_date {
+
+namespace detail {
+
+inline bool is_delimiter(char ch) {
+  const auto u = static_cast<unsigned char>(ch);
+  return u == 0x09 || (u >= 0x20 && u <= 0x2F) || (u >= 0x3B && u <= 0x40) ||
+         (u >= 0x5B && u <= 0x60) || (u >= 0x7B && u <= 0x7E);
+}
+
+inline std::size_t leading_digits(std::string_view s) {
+  std::size_t n = 0;
+  while (n < s.size() && s[n] >= '0' && s[n] <= '9') ++n;
+  return n;
+}
+
+inline int to_int(std::string_view digits) {
+  int v = 0;
+  for (char ch : digits) v = v * 10 + (ch - '0');
+  return v;
+}
+
+inline bool month_equals(std::string_view token, std::string_view month) {
+  for (std::size_t i = 0; i < 3; ++i) {
+    char ch = token[i];
+    if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+    if (ch != month[i]) return false;
+  }
+  return true;
+}
+
+// hms-time = 1*2DIGIT ":" 1*2DIGIT ":" 1*2DIGIT
+inline bool parse_time(std::string_view token, int& h, int& m, int& s) {
+  int parts[3];
+  for (int k = 0; k < 3; ++k) {
+    const auto n = leading_digits(token);
+    if (n < 1 || n > 2) return false;
+    parts[k] = to_int(token.substr(0, n));
+    token.remove_prefix(n);
+    if (k < 2) {
+      if (token.empty() || token.front() != ':') return false;
+      token.remove_prefix(1);
+    }
+  }
+  h = parts[0];
+  m = parts[1];
+  s = parts[2];
+  return true;
+}
+
+// Days since 1970-01-01 (H. Hinnant's algorithm).
+inline long long days_from_civil(int y, int m, int d) {
+  y -= m <= 2;
+  const long long era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy =
+      (153 * static_cast<unsigned>(m + (m > 2 ? -3 : 9)) + 2) / 5 +
+      static_cast<unsigned>(d) - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<long long>(doe) - 719468;
+}
+
+}  // namespace detail
+
+// nullopt when `s` does not parse.
+inline std::optional<std::chrono::system_clock::time_point> parse(
+    std::string_view s) {
+  int hour = -1, minute = -1, second = -1, day = -1, month = -1, year = -1;
+  std::size_t i = 0;
+  while (i < s.size()) {
+    while (i < s.size() && detail::is_delimiter(s[i])) ++i;
+    const std::size_t start = i;
+    while (i < s.size() && !detail::is_delimiter(s[i])) ++i;
+    const auto token = s.substr(start, i - start);
+    if (token.empty()) continue;
+    if (hour < 0 && detail::parse_time(token, hour, minute, second)) continue;
+    const auto digits = detail::leading_digits(token);
+    if (day < 0 && (digits == 1 || digits == 2)) {
+      day = detail::to_int(token.substr(0, digits));
+      continue;
+    }
+    if (month < 0 && token.size() >= 3) {
+      static constexpr std::string_view kMonths[] = {
+          "jan", "feb", "mar", "apr", "may", "jun",
+          "jul", "aug", "sep", "oct", "nov", "dec"};
+      bool matched = false;
+      for (int m = 0; m < 12; ++m) {
+        if (detail::month_equals(token, kMonths[m])) {
+          month = m + 1;
+          matched = true;
+          break;
+        }
+      }
+      if (matched) continue;
+    }
+    if (year < 0 && digits >= 2 && digits <= 4) {
+      year = detail::to_int(token.substr(0, digits));
+    }
+  }
+  if (year >= 70 && year <= 99) year += 1900;
+  if (year >= 0 && year <= 69) year += 2000;
+  if (hour < 0 || day < 1 || day > 31 || month < 0 || year < 1601 ||
+      hour > 23 || minute > 59 || second > 59) {
+    return std::nullopt;
+  }
+  const auto days = detail::days_from_civil(year, month, day);
+  return std::chrono::system_clock::time_point{} +
+         std::chrono::hours(24) * days + std::chrono::hours(hour) +
+         std::chrono::minutes(minute) + std::chrono::seconds(second);
+}
+
+}  // namespace http_date
+
+}  // namespace client_async
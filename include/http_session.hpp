@@ -18,7 +18,14 @@
 #include <optional>
 
 #include "base64.h"
+#include "expect_continue.hpp"
+#include "explicit_instantiations.hpp"
+#include "fast_response_parser.hpp"
 #include "http_client_config_provider.hpp"
+#include "request_priority.hpp"
+#include "response_body_policy.hpp"
+#include "response_memory_budget.hpp"
+#include "sendfile_body.hpp"
 // #include "explicit_instantiations.hpp"
 
 namespace fs = std::filesystem;
@@ -45,6 +52,22 @@ struct HttpClientRequestParams {
   std::chrono::seconds connect_timeout = std::chrono::seconds(30);
   std::chrono::seconds handshake_timeout = std::chrono::seconds(30);
   std::chrono::seconds io_timeout = std::chrono::seconds(30);
+  // Response buffering limits; defaults keep the per-session historical caps.
+  ResponseBodyPolicy body_policy{};
+  // Opt-in `Expect: 100-continue` for large uploads (off by default).
+  ExpectContinuePolicy expect_continue{};
+  // Send plain HTTP over this Unix domain socket instead of resolving the
+  // URL host. Set by HttpClientManager for `http+unix://` URLs.
+  std::optional<std::string> unix_socket_path = std::nullopt;
+  // Read string_body responses with fast_http instead of beast's parser.
+  bool fast_response_parser = false;
+  // With fast_response_parser: string_body responses carry status and body
+  // only and their header fields are left here as a flat table, so no
+  // basic_fields container is filled. HttpClientManager drops it where it
+  // reads the fields itself (redirects, cookie jar, traffic recording).
+  std::shared_ptr<fast_http::FastResponseHead> flat_headers;
+  // Queueing class for pooled connections when the pool is at max_active.
+  RequestPriority priority = RequestPriority::normal;
 };
 
 // Performs an HTTP GET and prints the response
@@ -79,6 +102,10 @@ class session {
         handshake_to_(params.handshake_timeout),
         io_to_(params.io_timeout),
         accumulate_response_body_(params.accumulate_response_body),
+        body_policy_(std::move(params.body_policy)),
+        expect_continue_(params.expect_continue),
+        fast_response_parser_(params.fast_response_parser),
+        flat_headers_(std::move(params.flat_headers)),
         url_(std::move(url)),
         callback_(std::move(callback)) {}
 
@@ -90,6 +117,7 @@ class session {
   std::chrono::seconds connect_timeout() const { return connect_to_; }
   std::chrono::seconds handshake_timeout() const { return handshake_to_; }
   bool accumulate_response_body() const { return accumulate_response_body_; }
+  const ResponseBodyPolicy& body_policy() const { return body_policy_; }
   boost::beast::flat_buffer& read_buffer() { return buffer_; }
 
   void deliver(response_t&& r, int code) noexcept {
@@ -98,6 +126,27 @@ class session {
     } catch (...) {
       // prevent exceptions escaping Asio handlers
     }
+    // The body now belongs to the caller; stop counting it as in flight.
+    budget_lease_.reset();
+  }
+
+  // Streaming sessions parse with their own parser and opt out.
+  static constexpr bool supports_expect_continue = true;
+  // session_unix connects to a socket path; no lookup, no proxy.
+  static constexpr bool is_local_transport = false;
+
+  // Start accounting this response against the process-wide memory budget;
+  // null while the budget is unlimited.
+  BudgetLease* budget_lease() {
+    if (ResponseMemoryBudget::global().capacity() == 0) return nullptr;
+    if (!budget_lease_) {
+      std::string_view port = url_.port();
+      if (port.empty()) port = default_port_;
+      budget_lease_.emplace(
+          ResponseMemoryBudget::global(),
+          beast_pool::intern_origin(url_.scheme(), url_.host(), port));
+    }
+    return &*budget_lease_;
   }
 
  public:
@@ -126,7 +175,11 @@ class session {
       port = default_port_;
     }
     if (no_modify_req_) {
-      return do_resolve(this->url_.host(), port);
+      if constexpr (Derived::is_local_transport) {
+        return do_connect_local();
+      } else {
+        return do_resolve(this->url_.host(), port);
+      }
     }
     {
       auto host_hdr = bracket_ipv6(this->url_.host());
@@ -137,7 +190,9 @@ class session {
       }
     }
     // Look up the domain name
-    if (proxy_setting_) {
+    if constexpr (Derived::is_local_transport) {
+      do_connect_local();
+    } else if (proxy_setting_) {
       do_resolve_proxy();
     } else {
       do_resolve(this->url_.host(), port);
@@ -289,9 +344,13 @@ class session {
               return;
             } else {
               // std::cout << "connected to proxy server." << std::endl;
-              self->derived().replace_stream(
-                  std::move(self->proxy_stream_.value()));
-              self->after_connect();
+              if constexpr (!Derived::is_local_transport) {
+                self->derived().replace_stream(
+                    std::move(self->proxy_stream_.value()));
+                self->after_connect();
+              } else {
+                self->deliver(std::nullopt, 5);  // local sockets: no proxy
+              }
             }
           }
         });
@@ -333,23 +392,58 @@ class session {
 
  protected:
   void do_connect(asio::ip::tcp::resolver::results_type results) {
-    // Set a timeout on the operation
-    boost::beast::get_lowest_layer(derived().stream())
-        .expires_after(this->connect_timeout());
-    // Make the connection on the IP address we get from a lookup
-    boost::beast::get_lowest_layer(derived().stream())
-        .async_connect(
-            results, [self = derived().shared_from_this()](
-                         boost::beast::error_code ec,
-                         asio::ip::tcp::resolver::results_type::endpoint_type) {
-              if (ec) {
-                BOOST_LOG_SEV(self->lg, trivial::error)
-                    << "connect: " << ec.message();
-                self->deliver(std::nullopt, 5);
-              } else {
-                self->derived().after_connect();
-              }
-            });
+    if constexpr (!Derived::is_local_transport) {
+      // Set a timeout on the operation
+      boost::beast::get_lowest_layer(derived().stream())
+          .expires_after(this->connect_timeout());
+      // Make the connection on the IP address we get from a lookup
+      boost::beast::get_lowest_layer(derived().stream())
+          .async_connect(
+              results,
+              [self = derived().shared_from_this()](
+                  boost::beast::error_code ec,
+                  asio::ip::tcp::resolver::results_type::endpoint_type) {
+                if (ec) {
+                  BOOST_LOG_SEV(self->lg, trivial::error)
+                      << "connect: " << ec.message();
+                  self->deliver(std::nullopt, 5);
+                } else {
+                  self->derived().after_connect();
+                }
+              });
+    } else {
+      deliver(std::nullopt, 5);  // local transports connect by path
+    }
+  }
+
+  // Unix-socket transports only (Derived::socket_path()).
+  void do_connect_local() {
+    if constexpr (Derived::is_local_transport) {
+      asio::local::stream_protocol::endpoint ep;
+      try {
+        ep = asio::local::stream_protocol::endpoint(derived().socket_path());
+      } catch (const boost::system::system_error& e) {
+        // Path longer than sun_path.
+        BOOST_LOG_SEV(lg, trivial::error) << "connect: " << e.what();
+        return deliver(std::nullopt, 5);
+      }
+      boost::beast::get_lowest_layer(derived().stream())
+          .expires_after(this->connect_timeout());
+      boost::beast::get_lowest_layer(derived().stream())
+          .async_connect(ep, [self = derived().shared_from_this()](
+                                 boost::beast::error_code ec) {
+            if (ec) {
+              BOOST_LOG_SEV(self->lg, trivial::error)
+                  << "connect " << self->derived().socket_path() << ": "
+                  << ec.message();
+              self->deliver(std::nullopt, 5);
+            } else {
+              self->derived().after_connect();
+            }
+          });
+    } else {
+      deliver(std::nullopt, 5);  // TCP transports resolve and connect
+    }
   }
 
  public:
@@ -358,43 +452,155 @@ class session {
     // Apply per-operation timeout
     boost::beast::get_lowest_layer(derived().stream())
         .expires_after(this->op_timeout());
-    http::async_write(
-        derived().stream(), req_,
+    if constexpr (Derived::supports_expect_continue) {
+      if (wants_expect_continue(req_, expect_continue_)) {
+        return do_request_expect_continue();
+      }
+    }
+    auto cb = [self = derived().shared_from_this()](boost::beast::error_code ec,
+                                                    size_t bytes_transferred) {
+      if (ec) {
+        BOOST_LOG_SEV(self->lg, trivial::error) << "write: " << ec.message();
+        self->deliver(std::nullopt, 6);
+      } else {
+        self->do_read();
+      }
+    };
+    if constexpr (std::is_same_v<RequestBody, sendfile_body>) {
+      // Zero-copy upload on plain TCP / kTLS, buffered otherwise.
+      async_write_sendfile(derived().stream(), req_, this->op_timeout(), cb);
+    } else {
+      http::async_write(derived().stream(), req_, cb);
+    }
+  }
+
+  // Header first; the body follows only on `100 Continue` (or after the short
+  // wait). An early final status (401, 413, redirect...) is read as the
+  // response without uploading anything.
+  void do_request_expect_continue() {
+    async_send_expect_continue(
+        derived().stream(), buffer_, req_, interim_parser_,
+        expect_continue_.wait, this->op_timeout(),
         [self = derived().shared_from_this()](boost::beast::error_code ec,
-                                              size_t bytes_transferred) {
+                                              ExpectContinueOutcome outcome) {
           if (ec) {
             BOOST_LOG_SEV(self->lg, trivial::error)
-                << "write: " << ec.message();
-            self->deliver(std::nullopt, 6);
-          } else {
-            self->do_read();
+                << (outcome.read_failed ? "read: " : "write: ")
+                << ec.message();
+            self->deliver(std::nullopt, outcome.read_failed ? 8 : 6);
+            return;
+          }
+          if (!outcome.body_sent) {
+            BOOST_LOG_SEV(self->lg, trivial::debug)
+                << "upload skipped, server answered "
+                << self->interim_parser_->get().result_int();
           }
+          if (!self->interim_parser_) return self->do_read();
+          self->read_after_interim();
         });
   }
 
+  // Continue with a response whose header was read by the expect-continue
+  // exchange.
+  void read_after_interim() {
+    if constexpr (std::is_same_v<ResponseBody, http::empty_body>) {
+      auto res = interim_parser_->release();
+      interim_parser_.reset();
+      this->deliver(std::move(res), 0);
+    } else {
+      this->parser_.emplace(std::move(*interim_parser_));
+      interim_parser_.reset();
+      if (!prepare_parser()) return;
+      read_response();
+    }
+  }
+
   void do_read() {
+    if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
+      if (fast_response_parser_) return read_response_fast();
+    }
     this->parser_.emplace();
+    if (!prepare_parser()) return;
+    read_response();
+  }
+
+  // Opt-in fast path: flat header table, one field insertion per header at
+  // delivery (none with flat_headers). Same limits, budget, deadline and
+  // error codes as read_response().
+  // Guarded because explicit instantiations compile it for every body.
+  void read_response_fast() {
+    if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
+      fast_http::FastReadOptions opts;
+      opts.body_limit = effective_body_limit<ResponseBody>(this->body_policy_);
+      opts.head_request = req_.method() == http::verb::head;
+      boost::beast::get_lowest_layer(derived().stream())
+          .expires_after(this->op_timeout());
+      fast_http::async_read_fast_response(
+          derived().stream(), buffer_, fast_response_, opts, budget_lease(),
+          this->op_timeout(),
+          [self = derived().shared_from_this()](boost::beast::error_code ec) {
+            if (ec == asio::error::no_buffer_space) {
+              BOOST_LOG_SEV(self->lg, trivial::error)
+                  << "read: response memory budget not available in time";
+              return self->deliver(std::nullopt, 11);
+            }
+            if (ec) {
+              BOOST_LOG_SEV(self->lg, trivial::error)
+                  << "read: " << ec.message();
+              return self->deliver(std::nullopt, 8);
+            }
+            if (self->flat_headers_) {
+              return self->deliver(std::move(self->fast_response_)
+                                       .template to_beast<Allocator>(
+                                           *self->flat_headers_),
+                                   0);
+            }
+            self->deliver(std::move(self->fast_response_)
+                              .template to_beast<Allocator>(),
+                          0);
+          });
+    } else {
+      deliver(std::nullopt, 5);  // do_read() only takes it for strings
+    }
+  }
+
+  // Apply body limits and body-type setup to a freshly created parser_.
+  bool prepare_parser() {
     if constexpr (std::is_same_v<ResponseBody, http::empty_body>) {
       this->parser_->body_limit(0);
       this->parser_->skip(true);
     } else if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
-      this->parser_->body_limit(1024 * 1024 * 4);
+      this->parser_->body_limit(
+          effective_body_limit<ResponseBody>(this->body_policy_));
+    } else if constexpr (std::is_same_v<ResponseBody, spill_body>) {
+      parser_->get().body().set_spill_options(this->body_policy_);
+      this->parser_->body_limit(
+          effective_body_limit<ResponseBody>(this->body_policy_));
     } else if constexpr (std::is_same_v<ResponseBody, http::file_body>) {
       if (!this->body_file_.has_value() || this->body_file_->empty()) {
         BOOST_LOG_SEV(this->lg, trivial::error) << "body_file_ is not set.";
         this->deliver(std::nullopt, 7);
-        return;
+        return false;
       }
       http::file_body::value_type body;
       boost::beast::error_code ec;
       body.open(this->body_file_->c_str(), boost::beast::file_mode::write, ec);
       parser_->get().body() = std::move(body);
-      this->parser_->body_limit(static_cast<std::int64_t>(1024) * 1024 * 1024 *
-                                10);
+      this->parser_->body_limit(
+          effective_body_limit<ResponseBody>(this->body_policy_));
     }
+    return true;
+  }
 
+  void read_response() {
     auto cb = [self = derived().shared_from_this()](boost::beast::error_code ec,
                                                     size_t bytes_transferred) {
+      if (ec == asio::error::no_buffer_space) {
+        BOOST_LOG_SEV(self->lg, trivial::error)
+            << "read: response memory budget not available in time";
+        self->deliver(std::nullopt, 11);
+        return;
+      }
       if (ec) {
         if (ec == http::error::body_limit) {
           // Special handling for body limit errors
@@ -409,6 +615,9 @@ class session {
         }
         BOOST_LOG_SEV(self->lg, trivial::error) << "read: " << ec.message();
         self->deliver(self->parser_->release(), 8);
+      } else if (self->parser_->get().result() == http::status::continue_) {
+        // A `100 Continue` that arrived after the body was already sent.
+        self->do_read();
       } else {
         self->deliver(self->parser_->release(), 0);
       }
@@ -419,6 +628,12 @@ class session {
     if constexpr (std::is_same_v<ResponseBody, http::empty_body>) {
       http::async_read_header(derived().stream(), buffer_,
                               this->parser_.value(), cb);
+    } else if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
+      // In-memory bodies are admitted against the global memory budget.
+      async_read_budgeted(
+          derived().stream(), buffer_, this->parser_.value(), budget_lease(),
+          effective_body_limit<ResponseBody>(this->body_policy_),
+          this->op_timeout(), [cb](boost::beast::error_code ec) { cb(ec, 0); });
     } else {
       http::async_read(derived().stream(), buffer_, this->parser_.value(), cb);
     }
@@ -439,6 +654,7 @@ class session {
   std::string default_port_;
   std::optional<http::response_parser<ResponseBody>> parser_;
   std::optional<http::response_parser<http::empty_body>> proxy_response_parser_;
+  std::optional<http::response_parser<http::empty_body>> interim_parser_;
   bool no_modify_req_ = false;
   std::optional<boost::beast::tcp_stream> proxy_stream_;
   std::optional<http::request<http::empty_body>> proxy_req_;
@@ -450,6 +666,12 @@ class session {
   std::chrono::seconds handshake_to_{30};
   std::chrono::seconds io_to_{30};
   bool accumulate_response_body_{true};
+  ResponseBodyPolicy body_policy_{};
+  ExpectContinuePolicy expect_continue_{};
+  bool fast_response_parser_ = false;
+  std::shared_ptr<fast_http::FastResponseHead> flat_headers_;
+  fast_http::FastResponse fast_response_;
+  std::optional<BudgetLease> budget_lease_;
 
  protected:
   urls::url url_;
@@ -610,8 +832,59 @@ class session_plain
   }
 };
 
-// EXTERN_HTTP_SESSION(http::string_body, http::string_body)
-// EXTERN_HTTP_SESSION(http::empty_body, http::string_body)
-// EXTERN_HTTP_SESSION(http::file_body, http::empty_body)
+// Plain HTTP over a Unix domain socket (local sidecars). The URL still
+// supplies the Host header and the request target; the socket path replaces
+// DNS resolution and the TCP connect. Proxies never apply.
+template <class RequestBody, class ResponseBody, class Allocator>
+class session_unix
+    : public session<session_unix<RequestBody, ResponseBody, Allocator>,
+                     RequestBody, ResponseBody, Allocator>,
+      public std::enable_shared_from_this<
+          session_unix<RequestBody, ResponseBody, Allocator>> {
+  using stream_t = beast::basic_stream<asio::local::stream_protocol>;
+  std::unique_ptr<stream_t> stream_;
+  std::string socket_path_;
+
+ public:
+  static constexpr bool is_local_transport = true;
+
+  using response_t = std::optional<
+      http::response<ResponseBody, http::basic_fields<Allocator>>>;
+  using callback_t = std::function<void(response_t&&, int)>;
+  explicit session_unix(asio::io_context& ioc,             //
+                        urls::url&& url,                   //
+                        HttpClientRequestParams&& params,  //
+                        callback_t&& callback,             //
+                        std::string socket_path)
+      : session<session_unix<RequestBody, ResponseBody, Allocator>,
+                RequestBody, ResponseBody, Allocator>(
+            ioc, std::move(url), std::move(params), std::move(callback), "80"),
+        stream_(std::make_unique<stream_t>(ioc)),
+        socket_path_(std::move(socket_path)) {}
+
+  void do_eof() {
+    beast::error_code ec;
+    if (stream_->socket().shutdown(asio::socket_base::shutdown_both, ec)) {
+      BOOST_LOG_SEV(this->lg, trivial::error)
+          << "Socket shutdown failed: " << ec.message();
+    }
+  }
+
+  void after_connect() { this->do_request(); }
+  stream_t& stream() { return *stream_; }
+  const std::string& socket_path() const { return socket_path_; }
+
+  void on_shutdown(beast::error_code ec) {
+    if (ec) {
+      BOOST_LOG_SEV(this->lg, trivial::error) << "shutdown: " << ec.message();
+    }
+  }
+};
+
+#ifdef HTTP_CLIENT_PREBUILT_SESSIONS
+EXTERN_HTTP_SESSION(http::string_body, http::string_body)
+EXTERN_HTTP_SESSION(http::empty_body, http::string_body)
+EXTERN_HTTP_SESSION(http::file_body, http::empty_body)
+#endif
 
 }  // namespace client_async
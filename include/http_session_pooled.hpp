@@ -12,6 +12,12 @@
 
 #include "base64.h"
 #include "beast_connection_pool.hpp"
+#include "expect_continue.hpp"
+#include "explicit_instantiations.hpp"
+#include "fast_response_parser.hpp"
+#include "response_body_policy.hpp"
+#include "response_memory_budget.hpp"
+#include "sendfile_body.hpp"
 
 namespace client_async {
 
@@ -42,39 +48,72 @@ class http_session_pooled
     std::string port;
     std::string username;
     std::string password;
+    // Interned proxy hop; kNoOriginId interns host:port on each run().
+    beast_pool::OriginId origin_id = beast_pool::kNoOriginId;
   };
 
+  // `origin_id` comes from beast_pool::OriginTable::global().
   http_session_pooled(beast_pool::ConnectionPool& pool,
-                      beast_pool::Origin origin,
+                      beast_pool::OriginId origin_id,
                       std::optional<ProxySetting> proxy = std::nullopt)
-      : pool_(pool), origin_(std::move(origin)), proxy_(std::move(proxy)) {}
+      : pool_(pool),
+        origin_id_(origin_id),
+        origin_(beast_pool::OriginTable::global().get(origin_id)),
+        proxy_(std::move(proxy)) {}
+  http_session_pooled(beast_pool::ConnectionPool& pool,
+                      beast_pool::Origin const& origin,
+                      std::optional<ProxySetting> proxy = std::nullopt)
+      : http_session_pooled(pool,
+                            beast_pool::OriginTable::global().intern(origin),
+                            std::move(proxy)) {}
 
   void set_request(request_t req) { req_ = std::move(req); }
   void set_io_timeout(std::chrono::seconds timeout) {
     io_timeout_override_ = timeout;
   }
+  void set_body_policy(ResponseBodyPolicy policy) {
+    body_policy_ = std::move(policy);
+  }
+  void set_expect_continue(ExpectContinuePolicy policy) {
+    expect_continue_ = policy;
+  }
+  void set_fast_response_parser(bool enabled) {
+    fast_response_parser_ = enabled;
+  }
+  // See HttpClientRequestParams::flat_headers.
+  void set_flat_headers(std::shared_ptr<fast_http::FastResponseHead> sink) {
+    flat_headers_ = std::move(sink);
+  }
+  void set_priority(RequestPriority priority) { priority_ = priority; }
   void run(callback_t cb) {
     callback_ = std::move(cb);
     // Acquire a transport connection: use proxy endpoint if configured
     auto self = this->shared_from_this();
-    beast_pool::Origin acquire_origin = origin_;
+    beast_pool::OriginId acquire_origin = origin_id_;
     if (proxy_) {
-      acquire_origin.scheme = "http";  // proxy hop is plain TCP
-      acquire_origin.host = proxy_->host;
-      acquire_origin.port = static_cast<std::uint16_t>(std::stoi(proxy_->port));
-    }
-    pool_.acquire(acquire_origin, [self](boost::system::error_code ec,
-                                         beast_pool::Connection::Ptr c) {
-      if (ec || !c) return self->finish(std::nullopt, 1);
-      self->conn_ = std::move(c);
-      // If HTTP proxy specified and scheme is https, perform CONNECT then
-      // upgrade to TLS
-      if (self->proxy_ && beast_pool::is_https(self->origin_)) {
-        self->do_proxy_connect();
-      } else {
-        self->do_write();
+      // proxy hop is plain TCP
+      acquire_origin = proxy_->origin_id != beast_pool::kNoOriginId
+                           ? proxy_->origin_id
+                           : beast_pool::intern_proxy_origin(proxy_->host,
+                                                             proxy_->port);
+      if (acquire_origin == beast_pool::kNoOriginId) {
+        return finish(std::nullopt, 1);
       }
-    });
+    }
+    pool_.acquire(
+        acquire_origin,
+        [self](boost::system::error_code ec, beast_pool::Connection::Ptr c) {
+          if (ec || !c) return self->finish(std::nullopt, 1);
+          self->conn_ = std::move(c);
+          // If HTTP proxy specified and scheme is https, perform CONNECT then
+          // upgrade to TLS
+          if (self->proxy_ && beast_pool::is_https(self->origin_)) {
+            self->do_proxy_connect();
+          } else {
+            self->do_write();
+          }
+        },
+        priority_);
   }
 
  private:
@@ -83,14 +122,16 @@ class http_session_pooled
       // Diagnostic: surface non-zero internal finish codes to stderr so tests
       // can show why the pooled session failed (mapping: 1=acquire,2=write,
       // 3=read header,4=proxy response,5=ssl upgrade,6=handshake,7=write,
-      // 8=read)
+      // 8=read,9=memory budget wait timed out)
       std::cerr << "[debug] http_session_pooled::finish code=" << code << std::endl;
     }
-    // Release connection based on keep-alive and error
-    bool reusable = res.has_value() && res->keep_alive();
+    // Release connection based on keep-alive and error. A request whose
+    // body was never sent leaves the connection out of sync.
+    bool reusable = res.has_value() && res->keep_alive() && !body_skipped_;
     if (!reusable && conn_) conn_->close();
-    if (conn_) pool_.release(conn_, reusable);
+    if (conn_) pool_.release(conn_, reusable, endpoint_outcome(res, code));
     if (callback_) callback_(std::move(res), code);
+    budget_lease_.reset();
   }
 
   void do_proxy_connect() {
@@ -199,30 +240,145 @@ class http_session_pooled
               sp->do_write();
             }));
   }
+
+  // What this exchange says about the server for outlier detection. A
+  // memory budget timeout is local and says nothing.
+  std::optional<beast_pool::RequestOutcome> endpoint_outcome(
+      const std::optional<response_t>& res, int code) const {
+    if (code == 9) return std::nullopt;
+    beast_pool::RequestOutcome outcome;
+    outcome.failed = code != 0 || !res || res->result_int() >= 500;
+    if (!outcome.failed && sent_at_) {
+      outcome.latency = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::chrono::steady_clock::now() - *sent_at_);
+    }
+    return outcome;
+  }
+
   void do_write() {
     namespace http = boost::beast::http;
+    sent_at_ = std::chrono::steady_clock::now();
     pool_.set_op_timeout(*conn_, pool_io_timeout());
     auto sp = this->shared_from_this();
     // Keep request alive during async_write
     req_ptr_ = std::make_shared<request_t>(std::move(req_));
+    if (wants_expect_continue(*req_ptr_, expect_continue_)) {
+      return do_write_expect_continue();
+    }
     std::visit(
         [sp](auto& s) {
-          http::async_write(
-              s, *sp->req_ptr_,
-              boost::asio::bind_executor(
-                  sp->conn_->executor(),
-                  [sp](boost::system::error_code ec, std::size_t) {
-                    if (ec) return sp->finish(std::nullopt, 7);
-                    sp->do_read();
-                  }));
+          auto on_write = boost::asio::bind_executor(
+              sp->conn_->executor(),
+              [sp](boost::system::error_code ec, std::size_t) {
+                if (ec) return sp->finish(std::nullopt, 7);
+                sp->do_read();
+              });
+          if constexpr (std::is_same_v<RequestBody, sendfile_body>) {
+            async_write_sendfile(s, *sp->req_ptr_, sp->pool_io_timeout(),
+                                 std::move(on_write));
+          } else {
+            http::async_write(s, *sp->req_ptr_, std::move(on_write));
+          }
+        },
+        conn_->stream());
+  }
+
+  // Header first; the body follows on `100 Continue` or after the short
+  // wait. An early final status is read as the response and the upload is
+  // skipped.
+  void do_write_expect_continue() {
+    auto sp = this->shared_from_this();
+    std::visit(
+        [sp](auto& s) {
+          async_send_expect_continue(
+              s, sp->buffer_, *sp->req_ptr_, sp->interim_parser_,
+              sp->expect_continue_.wait, sp->pool_io_timeout(),
+              [sp](boost::system::error_code ec,
+                   ExpectContinueOutcome outcome) {
+                if (ec) {
+                  return sp->finish(std::nullopt,
+                                    outcome.read_failed ? 8 : 7);
+                }
+                sp->body_skipped_ = !outcome.body_sent;
+                if (sp->interim_parser_) {
+                  if constexpr (std::is_same_v<
+                                    ResponseBody,
+                                    boost::beast::http::empty_body>) {
+                    auto res = sp->interim_parser_->release();
+                    sp->interim_parser_.reset();
+                    return sp->finish(std::move(res), 0);
+                  } else {
+                    sp->parser_.emplace(std::move(*sp->interim_parser_));
+                    sp->interim_parser_.reset();
+                  }
+                }
+                // Bytes after the interim header are already buffered.
+                sp->read_response();
+              });
         },
         conn_->stream());
   }
 
   void do_read() {
+    buffer_.consume(buffer_.size());
+    if constexpr (std::is_same_v<ResponseBody,
+                                 boost::beast::http::string_body>) {
+      if (fast_response_parser_) return read_response_fast();
+    }
+    read_response();
+  }
+
+  // In-memory bodies are admitted against the global memory budget; null
+  // while it is unlimited.
+  BudgetLease* budget_lease() {
+    if (ResponseMemoryBudget::global().capacity() == 0) return nullptr;
+    if (!budget_lease_) {
+      budget_lease_.emplace(ResponseMemoryBudget::global(), origin_id_);
+    }
+    return &*budget_lease_;
+  }
+
+  // Opt-in fast_http path; same limits, budget and finish codes as
+  // read_response(). Explicit instantiations compile it for every
+  // ResponseBody, hence the guard; do_read() only calls it for strings.
+  void read_response_fast() {
+    if constexpr (std::is_same_v<ResponseBody,
+                                 boost::beast::http::string_body>) {
+      fast_http::FastReadOptions opts;
+      opts.body_limit = effective_body_limit<ResponseBody>(body_policy_);
+      opts.head_request =
+          req_ptr_->method() == boost::beast::http::verb::head;
+      pool_.set_op_timeout(*conn_, pool_io_timeout());
+      auto sp = this->shared_from_this();
+      std::visit(
+          [sp, opts](auto& s) {
+            fast_http::async_read_fast_response(
+                s, sp->buffer_, sp->fast_response_, opts, sp->budget_lease(),
+                sp->pool_io_timeout(),
+                [sp](boost::system::error_code ec) {
+                  if (ec == boost::asio::error::no_buffer_space)
+                    return sp->finish(std::nullopt, 9);
+                  if (ec) return sp->finish(std::nullopt, 8);
+                  if (sp->flat_headers_) {
+                    return sp->finish(std::move(sp->fast_response_)
+                                          .template to_beast<Allocator>(
+                                              *sp->flat_headers_),
+                                      0);
+                  }
+                  sp->finish(std::move(sp->fast_response_)
+                                 .template to_beast<Allocator>(),
+                             0);
+                });
+          },
+          conn_->stream());
+    } else {
+      finish(std::nullopt, 5);  // do_read() only takes it for strings
+    }
+  }
+
+  void read_response() {
     namespace http = boost::beast::http;
     pool_.set_op_timeout(*conn_, pool_io_timeout());
-    buffer_.consume(buffer_.size());
     if (!parser_) parser_.emplace();
     if constexpr (std::is_same_v<ResponseBody, http::empty_body>) {
       parser_->body_limit(0);
@@ -230,9 +386,32 @@ class http_session_pooled
     } else if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
       // Guard against unexpectedly large upstream responses that can trigger
       // `std::bad_alloc` (the default is effectively unbounded).
-      parser_->body_limit(1024 * 1024 * 4);
+      parser_->body_limit(effective_body_limit<ResponseBody>(body_policy_));
+    } else if constexpr (std::is_same_v<ResponseBody, spill_body>) {
+      parser_->get().body().set_spill_options(body_policy_);
+      parser_->body_limit(effective_body_limit<ResponseBody>(body_policy_));
     }
     auto sp = this->shared_from_this();
+    if constexpr (std::is_same_v<ResponseBody, http::string_body>) {
+      std::visit(
+          [sp](auto& s) {
+            async_read_budgeted(
+                s, sp->buffer_, *sp->parser_, sp->budget_lease(),
+                effective_body_limit<ResponseBody>(sp->body_policy_),
+                sp->pool_io_timeout(),
+                // Completions already run on the connection's executor.
+                [sp](boost::system::error_code ec) {
+                  if (ec == boost::asio::error::no_buffer_space)
+                    return sp->finish(std::nullopt, 9);
+                  if (ec) return sp->finish(std::nullopt, 8);
+                  if (sp->skip_late_continue()) return;
+                  auto res = sp->parser_->release();
+                  sp->finish(std::move(res), 0);
+                });
+          },
+          conn_->stream());
+      return;
+    }
     std::visit(
         [sp](auto& s) {
           http::async_read(s, sp->buffer_, *sp->parser_,
@@ -240,6 +419,7 @@ class http_session_pooled
                                sp->conn_->executor(),
                                [sp](boost::system::error_code ec, std::size_t) {
                                  if (ec) return sp->finish(std::nullopt, 8);
+                                 if (sp->skip_late_continue()) return;
                                  auto res = sp->parser_->release();
                                  sp->finish(std::move(res), 0);
                                }));
@@ -247,6 +427,16 @@ class http_session_pooled
         conn_->stream());
   }
 
+  // A `100 Continue` that arrived after the body was sent anyway is not the
+  // response; read the next one.
+  bool skip_late_continue() {
+    if (parser_->get().result() != boost::beast::http::status::continue_)
+      return false;
+    parser_.reset();
+    read_response();
+    return true;
+  }
+
   std::chrono::seconds pool_io_timeout() const {
     if (io_timeout_override_.has_value()) {
       return *io_timeout_override_;
@@ -259,7 +449,8 @@ class http_session_pooled
 
  private:
   beast_pool::ConnectionPool& pool_;
-  beast_pool::Origin origin_;
+  beast_pool::OriginId origin_id_;
+  beast_pool::Origin const& origin_;  // interned
   std::optional<ProxySetting> proxy_;
 
   boost::beast::flat_buffer buffer_;
@@ -268,6 +459,9 @@ class http_session_pooled
   std::optional<
       boost::beast::http::response_parser<boost::beast::http::empty_body>>
       proxy_parser_;
+  std::optional<boost::beast::http::response_parser<
+      boost::beast::http::empty_body, Allocator>>
+      interim_parser_;
 
   request_t req_{};
   std::shared_ptr<request_t> req_ptr_{};
@@ -277,6 +471,24 @@ class http_session_pooled
   beast_pool::Connection::Ptr conn_{};
   callback_t callback_{};
   std::optional<std::chrono::seconds> io_timeout_override_{};
+  ResponseBodyPolicy body_policy_{};
+  ExpectContinuePolicy expect_continue_{};
+  bool body_skipped_ = false;
+  bool fast_response_parser_ = false;
+  std::shared_ptr<fast_http::FastResponseHead> flat_headers_;
+  RequestPriority priority_ = RequestPriority::normal;
+  std::optional<std::chrono::steady_clock::time_point> sent_at_{};
+  fast_http::FastResponse fast_response_;
+  std::optional<BudgetLease> budget_lease_;
 };
 
+#ifdef HTTP_CLIENT_PREBUILT_SESSIONS
+EXTERN_HTTP_SESSION_POOLED(boost::beast::http::string_body,
+                           boost::beast::http::string_body)
+EXTERN_HTTP_SESSION_POOLED(boost::beast::http::empty_body,
+                           boost::beast::http::string_body)
+EXTERN_HTTP_SESSION_POOLED(boost::beast::http::file_body,
+                           boost::beast::http::empty_body)
+#endif
+
 }  // namespace client_async
@@ -4,12 +4,14 @@
 #include <boost/asio/ssl.hpp>  // IWYU pragma: keep
 #include <boost/beast.hpp>
 #include <boost/log/trivial.hpp>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <memory>
 #include <optional>
 #include <string>
 
+#include "explicit_instantiations.hpp"
 #include "http_session.hpp"
 
 namespace beast = boost::beast;
@@ -36,6 +38,8 @@ class session_stream_ssl
       http::response<http::empty_body, http::basic_fields<Allocator>>;
   using header_cb_t = std::function<void(header_t&&)>;
   using chunk_cb_t = std::function<void(std::string&&)>;
+  // Chunk callbacks are driven by this class's own parser.
+  static constexpr bool supports_expect_continue = false;
 
   explicit session_stream_ssl(
       asio::io_context& ioc, ssl::context& ctx, urls::url&& url,
@@ -46,7 +50,9 @@ class session_stream_ssl
             ioc, std::move(url), std::move(params), std::move(callback), "443",
             proxy_setting),
         ctx_(ctx),
-        stream_(std::make_unique<ssl::stream<beast::tcp_stream>>(ioc, ctx)),
+        // On the session's strand (see cancel()).
+        stream_(std::make_unique<ssl::stream<beast::tcp_stream>>(
+            this->executor(), ctx)),
         on_headers_(std::move(on_headers)),
         on_chunk_(std::move(on_chunk)) {}
 
@@ -92,24 +98,56 @@ class session_stream_ssl
         });
   }
 
+  // Abort the exchange from any thread; the callback reports error 8. Runs
+  // on the session's strand, where every handler touching stream_ runs,
+  // including the proxy path that swaps it.
+  void cancel() {
+    asio::post(this->executor(), [self = this->shared_from_this()] {
+      self->cancelled_ = true;
+      beast::get_lowest_layer(*self->stream_).cancel();
+    });
+  }
+
   void do_read() {
+    if (cancelled_) return this->deliver(std::nullopt, 8);
     parser_.emplace();
     parser_->body_limit(this->accumulate_response_body()
                             ? boost::optional<std::uint64_t>(
-                                  static_cast<std::uint64_t>(1024) * 1024 * 64)
+                                  this->body_policy().max_body_bytes.value_or(
+                                      static_cast<std::uint64_t>(1024) * 1024 *
+                                      64))
                             : boost::none);
     this->read_buffer().consume(this->read_buffer().size());
     read_some_loop();
   }
 
  private:
+  // Reserve memory budget for the next step before touching the socket. When
+  // chunks are not accumulated only about one step is ever held.
   void read_some_loop() {
+    const std::uint64_t limit =
+        this->accumulate_response_body()
+            ? this->body_policy().max_body_bytes.value_or(
+                  static_cast<std::uint64_t>(1024) * 1024 * 64)
+            : kBudgetReadStep * 2;
+    const std::uint64_t want =
+        budget_read_target(*parser_, this->read_buffer().size(), limit);
+    auto* lease = this->budget_lease();
+    if (!lease || want <= lease->bytes()) return read_some_step();
+    lease->async_grow_to(stream_->get_executor(), want, this->op_timeout(),
+                         [self = this->shared_from_this()](bool ok) {
+                           if (!ok) return self->deliver(std::nullopt, 11);
+                           self->read_some_step();
+                         });
+  }
+
+  void read_some_step() {
     beast::get_lowest_layer(*stream_).expires_after(this->op_timeout());
     http::async_read_some(
         *stream_, this->read_buffer(), *parser_,
         [self = this->shared_from_this()](beast::error_code ec,
                                           std::size_t /*bytes_transferred*/) {
-          if (ec) {
+          if (ec || self->cancelled_) {
             self->deliver(self->parser_->release(), 8);
             return;
           }
@@ -152,6 +190,7 @@ class session_stream_ssl
   std::optional<http::response_parser<http::string_body>> parser_;
   std::size_t last_body_size_{0};
   bool headers_delivered_{false};
+  std::atomic<bool> cancelled_{false};
   header_cb_t on_headers_;
   chunk_cb_t on_chunk_;
 };
@@ -170,6 +209,8 @@ class session_stream_plain
       http::response<http::empty_body, http::basic_fields<Allocator>>;
   using header_cb_t = std::function<void(header_t&&)>;
   using chunk_cb_t = std::function<void(std::string&&)>;
+  // Chunk callbacks are driven by this class's own parser.
+  static constexpr bool supports_expect_continue = false;
 
   explicit session_stream_plain(
       asio::io_context& ioc, urls::url&& url, HttpClientRequestParams&& params,
@@ -178,7 +219,8 @@ class session_stream_plain
       : session<session_stream_plain, RequestBody, http::string_body, Allocator>(
             ioc, std::move(url), std::move(params), std::move(callback), "80",
             proxy_setting),
-        stream_(std::make_unique<beast::tcp_stream>(ioc)),
+        // On the session's strand (see cancel()).
+        stream_(std::make_unique<beast::tcp_stream>(this->executor())),
         on_headers_(std::move(on_headers)),
         on_chunk_(std::move(on_chunk)) {}
 
@@ -190,24 +232,56 @@ class session_stream_plain
 
   void after_connect() { this->do_request(); }
 
+  // Abort the exchange from any thread; the callback reports error 8. Runs
+  // on the session's strand, where every handler touching stream_ runs,
+  // including the proxy path that swaps it.
+  void cancel() {
+    asio::post(this->executor(), [self = this->shared_from_this()] {
+      self->cancelled_ = true;
+      beast::get_lowest_layer(*self->stream_).cancel();
+    });
+  }
+
   void do_read() {
+    if (cancelled_) return this->deliver(std::nullopt, 8);
     parser_.emplace();
     parser_->body_limit(this->accumulate_response_body()
                             ? boost::optional<std::uint64_t>(
-                                  static_cast<std::uint64_t>(1024) * 1024 * 64)
+                                  this->body_policy().max_body_bytes.value_or(
+                                      static_cast<std::uint64_t>(1024) * 1024 *
+                                      64))
                             : boost::none);
     this->read_buffer().consume(this->read_buffer().size());
     read_some_loop();
   }
 
  private:
+  // Reserve memory budget for the next step before touching the socket. When
+  // chunks are not accumulated only about one step is ever held.
   void read_some_loop() {
+    const std::uint64_t limit =
+        this->accumulate_response_body()
+            ? this->body_policy().max_body_bytes.value_or(
+                  static_cast<std::uint64_t>(1024) * 1024 * 64)
+            : kBudgetReadStep * 2;
+    const std::uint64_t want =
+        budget_read_target(*parser_, this->read_buffer().size(), limit);
+    auto* lease = this->budget_lease();
+    if (!lease || want <= lease->bytes()) return read_some_step();
+    lease->async_grow_to(stream_->get_executor(), want, this->op_timeout(),
+                         [self = this->shared_from_this()](bool ok) {
+                           if (!ok) return self->deliver(std::nullopt, 11);
+                           self->read_some_step();
+                         });
+  }
+
+  void read_some_step() {
     beast::get_lowest_layer(*stream_).expires_after(this->op_timeout());
     http::async_read_some(
         *stream_, this->read_buffer(), *parser_,
         [self = this->shared_from_this()](beast::error_code ec,
                                           std::size_t /*bytes_transferred*/) {
-          if (ec) {
+          if (ec || self->cancelled_) {
             self->deliver(self->parser_->release(), 8);
             return;
           }
@@ -249,8 +323,149 @@ class session_stream_plain
   std::optional<http::response_parser<http::string_body>> parser_;
   std::size_t last_body_size_{0};
   bool headers_delivered_{false};
+  std::atomic<bool> cancelled_{false};
+  header_cb_t on_headers_;
+  chunk_cb_t on_chunk_;
+};
+
+// Streaming over a Unix domain socket (plain HTTP to local sidecars).
+template <class RequestBody, class Allocator = std::allocator<char>>
+class session_stream_unix
+    : public session<session_stream_unix<RequestBody, Allocator>, RequestBody,
+                     http::string_body, Allocator>,
+      public std::enable_shared_from_this<
+          session_stream_unix<RequestBody, Allocator>> {
+  using stream_t = beast::basic_stream<asio::local::stream_protocol>;
+
+ public:
+  using response_t = std::optional<
+      http::response<http::string_body, http::basic_fields<Allocator>>>;
+  using callback_t = std::function<void(response_t&&, int)>;
+  using header_t =
+      http::response<http::empty_body, http::basic_fields<Allocator>>;
+  using header_cb_t = std::function<void(header_t&&)>;
+  using chunk_cb_t = std::function<void(std::string&&)>;
+  // Chunk callbacks are driven by this class's own parser.
+  static constexpr bool supports_expect_continue = false;
+  // Connects to socket_path(); no lookup, no proxy.
+  static constexpr bool is_local_transport = true;
+
+  explicit session_stream_unix(
+      asio::io_context& ioc, urls::url&& url, HttpClientRequestParams&& params,
+      callback_t&& callback, header_cb_t on_headers, chunk_cb_t on_chunk,
+      std::string socket_path)
+      : session<session_stream_unix, RequestBody, http::string_body, Allocator>(
+            ioc, std::move(url), std::move(params), std::move(callback), "80"),
+        // On the session's strand (see cancel()).
+        stream_(std::make_unique<stream_t>(this->executor())),
+        socket_path_(std::move(socket_path)),
+        on_headers_(std::move(on_headers)),
+        on_chunk_(std::move(on_chunk)) {}
+
+  stream_t& stream() { return *stream_; }
+  const std::string& socket_path() const { return socket_path_; }
+
+  void after_connect() { this->do_request(); }
+
+  // Abort the exchange from any thread; the callback reports error 8. Runs
+  // on the session's strand, where every handler touching stream_ runs.
+  void cancel() {
+    asio::post(this->executor(), [self = this->shared_from_this()] {
+      self->cancelled_ = true;
+      beast::get_lowest_layer(*self->stream_).cancel();
+    });
+  }
+
+  void do_read() {
+    if (cancelled_) return this->deliver(std::nullopt, 8);
+    parser_.emplace();
+    parser_->body_limit(this->accumulate_response_body()
+                            ? boost::optional<std::uint64_t>(
+                                  this->body_policy().max_body_bytes.value_or(
+                                      static_cast<std::uint64_t>(1024) * 1024 *
+                                      64))
+                            : boost::none);
+    this->read_buffer().consume(this->read_buffer().size());
+    read_some_loop();
+  }
+
+ private:
+  // Reserve memory budget for the next step before touching the socket. When
+  // chunks are not accumulated only about one step is ever held.
+  void read_some_loop() {
+    const std::uint64_t limit =
+        this->accumulate_response_body()
+            ? this->body_policy().max_body_bytes.value_or(
+                  static_cast<std::uint64_t>(1024) * 1024 * 64)
+            : kBudgetReadStep * 2;
+    const std::uint64_t want =
+        budget_read_target(*parser_, this->read_buffer().size(), limit);
+    auto* lease = this->budget_lease();
+    if (!lease || want <= lease->bytes()) return read_some_step();
+    lease->async_grow_to(stream_->get_executor(), want, this->op_timeout(),
+                         [self = this->shared_from_this()](bool ok) {
+                           if (!ok) return self->deliver(std::nullopt, 11);
+                           self->read_some_step();
+                         });
+  }
+
+  void read_some_step() {
+    beast::get_lowest_layer(*stream_).expires_after(this->op_timeout());
+    http::async_read_some(
+        *stream_, this->read_buffer(), *parser_,
+        [self = this->shared_from_this()](beast::error_code ec,
+                                          std::size_t /*bytes_transferred*/) {
+          if (ec || self->cancelled_) {
+            self->deliver(self->parser_->release(), 8);
+            return;
+          }
+
+          if (!self->headers_delivered_ && self->parser_->is_header_done()) {
+            self->headers_delivered_ = true;
+            if (self->on_headers_) {
+              header_t header;
+              header.result(self->parser_->get().result());
+              header.reason(self->parser_->get().reason());
+              header.version(self->parser_->get().version());
+              for (const auto& field : self->parser_->get().base()) {
+                header.set(field.name_string(), field.value());
+              }
+              self->on_headers_(std::move(header));
+            }
+          }
+
+          const auto& body = self->parser_->get().body();
+          if (body.size() > self->last_body_size_ && self->on_chunk_) {
+            self->on_chunk_(body.substr(self->last_body_size_));
+            self->last_body_size_ = body.size();
+            if (!self->accumulate_response_body()) {
+              auto& parser_body = self->parser_->get().body();
+              typename http::string_body::value_type{}.swap(parser_body);
+              self->last_body_size_ = 0;
+            }
+          }
+
+          if (self->parser_->is_done()) {
+            self->deliver(self->parser_->release(), 0);
+            return;
+          }
+          self->read_some_loop();
+        });
+  }
+
+  std::unique_ptr<stream_t> stream_;
+  std::string socket_path_;
+  std::optional<http::response_parser<http::string_body>> parser_;
+  std::size_t last_body_size_{0};
+  bool headers_delivered_{false};
+  std::atomic<bool> cancelled_{false};
   header_cb_t on_headers_;
   chunk_cb_t on_chunk_;
 };
 
+#ifdef HTTP_CLIENT_PREBUILT_SESSIONS
+EXTERN_HTTP_SESSION_STREAM(http::string_body)
+EXTERN_HTTP_SESSION_STREAM(http::empty_body)
+#endif
+
 }  // namespace client_async
@@ -0,0 +1,213 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace client_async {
+
+// What a transport sees of one request.
+struct TransportRequest {
+  boost::beast::http::verb method = boost::beast::http::verb::get;
+  std::string url;  // absolute: scheme://host:port/path?query
+  boost::beast::http::fields headers;
+  std::string body;  // string bodies only; empty for other body types
+};
+
+// TransportRequest::url for a request sent to scheme://host:port with
+// request-target `target`. The port is always spelled out, so pooled and
+// per-request sends of the same URL reach the same canned entry.
+inline std::string transport_url(std::string_view scheme,
+                                 std::string_view host, std::uint16_t port,
+                                 std::string_view target) {
+  std::string url(scheme);
+  url.append("://").append(host).push_back(':');
+  url.append(std::to_string(port)).append(target);
+  return url;
+}
+
+// `url` in the form transport_url() produces: the default port (80, or 443
+// for https/wss) is spelled out, an empty path becomes "/" and a fragment is
+// dropped. Anything without "scheme://" is returned unchanged.
+inline std::string normalize_transport_url(std::string_view url) {
+  const auto scheme_end = url.find("://");
+  if (scheme_end == std::string_view::npos) return std::string(url);
+  const auto scheme = url.substr(0, scheme_end);
+  auto rest = url.substr(scheme_end + 3);
+  rest = rest.substr(0, rest.find('#'));
+  const auto authority_end = rest.find_first_of("/?");
+  const auto authority = rest.substr(0, authority_end);
+  const auto target = authority_end == std::string_view::npos
+                          ? std::string_view{}
+                          : rest.substr(authority_end);
+
+  // The port follows the last ':' outside an IPv6 literal's brackets.
+  const auto colon = authority.rfind(':');
+  const bool has_port = colon != std::string_view::npos &&
+                        authority.find(']', colon) == std::string_view::npos;
+  std::string out(scheme);
+  out.append("://").append(authority);
+  if (!has_port) {
+    out.append(scheme == "https" || scheme == "wss" ? ":443" : ":80");
+  }
+  if (target.empty() || target.front() == '?') out.push_back('/');
+  out.append(target);
+  return out;
+}
+
+// Stands in for sockets under HttpClientManager (see set_transport()), so
+// request pipelines can be benchmarked or simulated without the network.
+// The manager still parses the response bytes into the caller's body type,
+// so response parsing costs what it does on a real connection.
+class HttpTransport {
+ public:
+  // `ec` uses the session error codes (0 = ok, 1 = connect failed, ...);
+  // `wire` is the whole HTTP/1.1 response as it would arrive on a socket.
+  using Done = std::function<void(int ec, std::string wire)>;
+
+  virtual ~HttpTransport() = default;
+  virtual void exchange(TransportRequest req, Done done) = 0;
+};
+
+// Parses a transport's `wire` bytes the way a session reads a socket: the
+// whole message, no body limit. The message may end at end of input.
+template <class Body>
+boost::beast::http::response<Body> parse_transport_response(
+    std::string_view wire, boost::system::error_code& ec) {
+  namespace http = boost::beast::http;
+  http::response_parser<Body> parser;
+  parser.eager(true);
+  parser.body_limit(boost::none);
+  boost::asio::const_buffer buf(wire.data(), wire.size());
+  ec = {};
+  while (!parser.is_done()) {
+    const auto used = parser.put(buf, ec);
+    buf += used;
+    if (ec == http::error::need_more) ec = {};
+    if (ec) break;
+    if (used == 0) {  // all bytes in; the message ends here
+      parser.put_eof(ec);
+      break;
+    }
+  }
+  return parser.release();
+}
+
+// Canned responses keyed by method and absolute URL (query included). URLs
+// given to add() are normalised, so "http://api.test/items" matches a
+// request the manager sends as "http://api.test:80/items".
+// Responses are serialized once, when added; each exchange copies the bytes
+// and completes on `ex` after the response's delay. With
+// Timer = monad::VirtualTimer the delays run on the virtual clock, so a
+// large fan-out with realistic latencies finishes as fast as the CPU
+// allows (drive the context with monad::run_virtual).
+//
+// Configure the transport before requests start; exchanges do not lock.
+template <class Timer = boost::asio::steady_timer>
+class InMemoryTransport : public HttpTransport {
+ public:
+  struct Canned {
+    unsigned status = 200;
+    std::vector<std::pair<std::string, std::string>> headers;
+    std::string body;
+    std::chrono::milliseconds delay{0};
+  };
+
+  explicit InMemoryTransport(boost::asio::any_io_executor ex)
+      : ex_(std::move(ex)) {}
+
+  void add(std::string_view url, Canned c,
+           boost::beast::http::verb method = boost::beast::http::verb::get) {
+    routes_[key(method, normalize_transport_url(url))] =
+        Route{serialize(c), c.delay};
+  }
+
+  // Answers requests with no canned entry; returning nullopt fails them
+  // like a refused connection (code 1).
+  void set_fallback(
+      std::function<std::optional<Canned>(const TransportRequest&)> fn) {
+    fallback_ = std::move(fn);
+  }
+
+  std::size_t exchanges() const { return exchanges_.load(); }
+
+  void exchange(TransportRequest req, Done done) override {
+    ++exchanges_;
+    auto it = routes_.find(key(req.method, req.url));
+    if (it != routes_.end()) {
+      complete(it->second.wire, it->second.delay, std::move(done));
+      return;
+    }
+    std::optional<Canned> c;
+    if (fallback_) c = fallback_(req);
+    if (!c) {
+      boost::asio::post(ex_, [done = std::move(done)] { done(1, {}); });
+      return;
+    }
+    complete(serialize(*c), c->delay, std::move(done));
+  }
+
+  static std::string serialize(const Canned& c) {
+    const auto status = static_cast<boost::beast::http::status>(c.status);
+    const auto reason = boost::beast::http::obsolete_reason(status);
+    std::string out = "HTTP/1.1 " + std::to_string(c.status) + " ";
+    out.append(reason.data(), reason.size()).append("\r\n");
+    for (auto const& [name, value] : c.headers) {
+      out.append(name).append(": ").append(value).append("\r\n");
+    }
+    out.append("Content-Length: ").append(std::to_string(c.body.size()));
+    out.append("\r\n\r\n").append(c.body);
+    return out;
+  }
+
+ private:
+  struct Route {
+    std::string wire;
+    std::chrono::milliseconds delay{0};
+  };
+
+  static std::string key(boost::beast::http::verb method,
+                         std::string_view url) {
+    const auto m = boost::beast::http::to_string(method);
+    std::string k(m.data(), m.size());
+    k.push_back(' ');
+    k.append(url);
+    return k;
+  }
+
+  void complete(std::string wire, std::chrono::milliseconds delay,
+                Done done) {
+    if (delay.count() <= 0) {
+      boost::asio::post(ex_, [wire = std::move(wire),
+                              done = std::move(done)]() mutable {
+        done(0, std::move(wire));
+      });
+      return;
+    }
+    auto timer = std::make_shared<Timer>(ex_);
+    timer->expires_after(delay);
+    timer->async_wait([timer, wire = std::move(wire),
+                       done = std::move(done)](
+                          const boost::system::error_code& ec) mutable {
+      if (ec) return done(1, {});
+      done(0, std::move(wire));
+    });
+  }
+
+  boost::asio::any_io_executor ex_;
+  std::unordered_map<std::string, Route> routes_;
+  std::function<std::optional<Canned>(const TransportRequest&)> fallback_;
+  std::atomic<std::size_t> exchanges_{0};
+};
+
+}  // namespace client_async
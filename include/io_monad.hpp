@@ -37,11 +37,121 @@ template <typename X>
 inline constexpr bool is_io_v = is_io<X>::value;
 
 namespace detail {
-inline void cancel_timer(boost::asio::steady_timer& timer) { timer.cancel(); }
+template <class Timer>
+void cancel_timer(Timer& timer) {
+  timer.cancel();
+}
+
+inline Error timer_error(const boost::system::error_code& ec) {
+  return Error{1, std::string{"Timer error: "} + ec.message()};
+}
+
+// Per-call state of IO::timeout: the timer, the callback and the flags
+// share one allocation.
+template <class Timer, class R>
+struct TimeoutCall {
+  enum Arm { kIdle, kArmed, kFinished };
+
+  template <class Ctx>
+  TimeoutCall(Ctx& ctx, std::function<void(R)> done)
+      : timer(ctx), cb(std::move(done)) {}
+
+  Timer timer;
+  std::function<void(R)> cb;
+  std::atomic<bool> delivered{false};
+  std::atomic<int> arm{kIdle};
+};
+
+// Runs `io`, failing with code 2 if it has not completed after `duration`.
+// The timer is armed only once `io` has been started and has not completed
+// inline, so synchronous IOs never touch the timer queue. Whichever of the
+// two sides gets to `arm` second cancels the wait.
+template <class Timer, class R, class Ctx, class Io>
+void run_with_timeout(Ctx& ctx, std::chrono::milliseconds duration,
+                      const Io& io, std::function<void(R)> cb) {
+  using Call = TimeoutCall<Timer, R>;
+  auto st = std::make_shared<Call>(ctx, std::move(cb));
+  io.run([st](R r) {
+    if (st->delivered.exchange(true)) return;
+    if (st->arm.exchange(Call::kFinished) == Call::kArmed) {
+      cancel_timer(st->timer);
+    }
+    st->cb(std::move(r));
+  });
+  if (st->delivered.load()) return;
+  st->timer.expires_after(duration);
+  st->timer.async_wait([st](const boost::system::error_code& ec) {
+    if (ec || st->delivered.exchange(true)) return;
+    st->cb(R::Err(Error{2, "Operation timed out"}));
+  });
+  if (st->arm.exchange(Call::kArmed) == Call::kFinished) {
+    cancel_timer(st->timer);
+  }
+}
+
+// Per-call state of IO::delay: the timer, the callback, the flags and the
+// early result share one allocation.
+template <class Timer, class R>
+struct DelayCall {
+  template <class Ctx>
+  DelayCall(Ctx& ctx, std::function<void(R)> done)
+      : timer(ctx), cb(std::move(done)) {}
+
+  Timer timer;
+  std::function<void(R)> cb;
+  std::optional<R> result;
+  bool timer_fired = false;
+  bool delivered = false;
+};
+
+// Runs `io` and delivers its result no earlier than `duration` from now.
+template <class Timer, class R, class Ctx, class Io>
+void run_with_delay(Ctx& ctx, std::chrono::milliseconds duration,
+                    const Io& io, std::function<void(R)> cb) {
+  auto st = std::make_shared<DelayCall<Timer, R>>(ctx, std::move(cb));
+  st->timer.expires_after(duration);
+  st->timer.async_wait([st](const boost::system::error_code& ec) {
+    if (st->delivered) return;
+    if (ec) {
+      st->delivered = true;
+      st->cb(R::Err(timer_error(ec)));
+      return;
+    }
+    st->timer_fired = true;
+    if (st->result.has_value()) {
+      st->delivered = true;
+      st->cb(std::move(*st->result));
+    }
+  });
+  io.run([st](R r) {
+    if (st->delivered) return;
+    st->result = std::move(r);
+    if (st->timer_fired) {
+      st->delivered = true;
+      st->cb(std::move(*st->result));
+    }
+  });
+}
+
+// Attempt counter of a retry/poll loop plus the one timer every wait of the
+// loop reuses. The timer is created on the first retry and re-armed with
+// expires_after() afterwards; waits capture the loop to keep it alive.
+template <class Timer>
+struct RetryLoop {
+  int attempt = 0;
+  std::optional<Timer> timer;
+
+  template <class Ctx>
+  Timer& arm(Ctx& ctx, std::chrono::milliseconds delay) {
+    if (!timer) timer.emplace(ctx);
+    timer->expires_after(delay);
+    return *timer;
+  }
+};
 }  // namespace detail
 
 // Forward declarations for helpers
-template <typename T>
+template <typename T, class Timer>
 IO<T> delay_for(boost::asio::io_context& ioc,
                 std::chrono::milliseconds duration);
 template <typename T>
@@ -181,145 +291,67 @@ class IO {
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<T> timeout(boost::asio::io_context& ioc,
                 std::chrono::milliseconds duration) && {
-    return IO<T>(
-        [ioc_ptr = &ioc, duration, self = std::move(*this)](auto cb) mutable {
-          auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-          auto fired = std::make_shared<bool>(false);
-
-          timer->expires_after(duration);
-          timer->async_wait(
-              [cb, fired](const boost::system::error_code& ec) mutable {
-                if (*fired) return;
-                *fired = true;
-                if (!ec)
-                  cb(Result<T, Error>::Err(Error{2, "Operation timed out"}));
-              });
-
-          self.run([cb, timer, fired](IOResult r) mutable {
-            if (*fired) return;
-            *fired = true;
-            detail::cancel_timer(*timer);
-            cb(std::move(r));
-          });
-        });
+    return IO<T>([ioc_ptr = &ioc, duration,
+                  self = std::move(*this)](Callback cb) {
+      detail::run_with_timeout<Timer, IOResult>(*ioc_ptr, duration, self,
+                                                std::move(cb));
+    });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> timeout(boost::asio::io_context& ioc,
                 std::chrono::milliseconds duration) & {
-    return std::move(*this).timeout(ioc, duration);
+    return std::move(*this).template timeout<Timer>(ioc, duration);
   }
 
   // Executor-aware timeout
+  template <class Timer = boost::asio::steady_timer>
   IO<T> timeout(boost::asio::any_io_executor ex,
                 std::chrono::milliseconds duration) && {
-    return IO<T>([ex, duration, self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-      auto fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait(
-          [cb, fired](const boost::system::error_code& ec) mutable {
-            if (*fired) return;
-            *fired = true;
-            if (!ec) cb(Result<T, Error>::Err(Error{2, "Operation timed out"}));
-          });
-
-      self.run([cb, timer, fired](IOResult r) mutable {
-        if (*fired) return;
-        *fired = true;
-        detail::cancel_timer(*timer);
-        cb(std::move(r));
-      });
+    return IO<T>([ex, duration, self = std::move(*this)](Callback cb) {
+      detail::run_with_timeout<Timer, IOResult>(ex, duration, self,
+                                                std::move(cb));
     });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> timeout(boost::asio::any_io_executor ex,
                 std::chrono::milliseconds duration) & {
-    return std::move(*this).timeout(ex, duration);
+    return std::move(*this).template timeout<Timer>(ex, duration);
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<T> delay(boost::asio::io_context& ioc,
               std::chrono::milliseconds duration) && {
     return IO<T>([ioc_ptr = &ioc, duration,
-                  self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-      auto result = std::make_shared<std::optional<IOResult>>();
-      auto delivered = std::make_shared<bool>(false);
-      auto timer_fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait([cb, result, delivered, timer_fired,
-                         timer](const boost::system::error_code& ec) mutable {
-        if (*delivered) return;
-        if (ec) {
-          *delivered = true;
-          cb(Result<T, Error>::Err(
-              Error{1, std::string{"Timer error: "} + ec.message()}));
-          return;
-        }
-        *timer_fired = true;
-        if (result->has_value()) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
-
-      self.run([cb, result, delivered, timer_fired, timer](IOResult r) mutable {
-        if (*delivered) return;
-        *result = std::move(r);
-        if (*timer_fired) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
+                  self = std::move(*this)](Callback cb) {
+      detail::run_with_delay<Timer, IOResult>(*ioc_ptr, duration, self,
+                                              std::move(cb));
     });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> delay(boost::asio::io_context& ioc,
               std::chrono::milliseconds duration) & {
-    return std::move(*this).delay(ioc, duration);
+    return std::move(*this).template delay<Timer>(ioc, duration);
   }
 
   // Executor-aware delay
+  template <class Timer = boost::asio::steady_timer>
   IO<T> delay(boost::asio::any_io_executor ex,
               std::chrono::milliseconds duration) && {
-    return IO<T>([ex, duration, self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-      auto result = std::make_shared<std::optional<IOResult>>();
-      auto delivered = std::make_shared<bool>(false);
-      auto timer_fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait([cb, result, delivered, timer_fired,
-                         timer](const boost::system::error_code& ec) mutable {
-        if (*delivered) return;
-        if (ec) {
-          *delivered = true;
-          cb(Result<T, Error>::Err(
-              Error{1, std::string{"Timer error: "} + ec.message()}));
-          return;
-        }
-        *timer_fired = true;
-        if (result->has_value()) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
-
-      self.run([cb, result, delivered, timer_fired, timer](IOResult r) mutable {
-        if (*delivered) return;
-        *result = std::move(r);
-        if (*timer_fired) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
+    return IO<T>([ex, duration, self = std::move(*this)](Callback cb) {
+      detail::run_with_delay<Timer, IOResult>(ex, duration, self,
+                                              std::move(cb));
     });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> delay(boost::asio::any_io_executor ex,
               std::chrono::milliseconds duration) & {
-    return std::move(*this).delay(ex, duration);
+    return std::move(*this).template delay<Timer>(ex, duration);
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<T> retry_exponential_if(
       int max_attempts, std::chrono::milliseconds initial_delay,
       boost::asio::io_context& ioc,
@@ -329,7 +361,7 @@ class IO {
                   self_ptr = std::make_shared<IO<T>>(std::move(*this))](
                      auto cb) mutable {
       struct RetryState {
-        std::shared_ptr<int> attempt;
+        std::shared_ptr<detail::RetryLoop<Timer>> loop;
         std::shared_ptr<std::function<void(std::chrono::milliseconds)>> try_run;
         std::shared_ptr<IO<T>> self_ptr;
 
@@ -344,7 +376,7 @@ class IO {
       };
 
       auto state = std::make_shared<RetryState>();
-      state->attempt = std::make_shared<int>(0);
+      state->loop = std::make_shared<detail::RetryLoop<Timer>>();
       state->try_run =
           std::make_shared<std::function<void(std::chrono::milliseconds)>>();
       state->self_ptr = self_ptr;
@@ -355,20 +387,20 @@ class IO {
       // assign explicit capture lambda to avoid capturing `try_run` by value
       *state->try_run = [max_attempts, should_retry, state, weak_try, ioc_ptr,
                          cb](std::chrono::milliseconds current_delay) mutable {
-        (*state->attempt)++;
+        state->loop->attempt++;
         state->self_ptr->clone().run([max_attempts, state, should_retry,
                                       weak_try, cb, ioc_ptr,
                                       current_delay](IOResult r) mutable {
-          if (r.is_ok() || *state->attempt >= max_attempts ||
+          if (r.is_ok() || state->loop->attempt >= max_attempts ||
               !should_retry(r.error())) {
             // cleanup before delivering final result to break cycles
             state->cleanup();
             cb(std::move(r));
           } else {
-            auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-            timer->expires_after(current_delay);
-            timer->async_wait([weak_try, timer, cb, current_delay](
-                                  const boost::system::error_code& ec) mutable {
+            auto loop = state->loop;
+            auto& timer = loop->arm(*ioc_ptr, current_delay);
+            timer.async_wait([weak_try, loop, cb, current_delay](
+                                 const boost::system::error_code& ec) mutable {
               if (ec) {
                 // nothing to cleanup here as final will be delivered
                 cb(Result<T, Error>::Err(
@@ -387,29 +419,30 @@ class IO {
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<T> retry_exponential(int max_attempts,
                           std::chrono::milliseconds initial_delay,
                           boost::asio::io_context& ioc) && {
-    return std::move(*this).retry_exponential_if(
+    return std::move(*this).template retry_exponential_if<Timer>(
         max_attempts, initial_delay, ioc, [](const Error&) { return true; });
   }
 
   // Default-executor overloads using shared retry executor
+  template <class Timer = boost::asio::steady_timer>
   IO<T> retry_exponential_if(int max_attempts,
                              std::chrono::milliseconds initial_delay,
                              std::function<bool(const Error&)> should_retry) && {
-    return std::move(*this).retry_exponential_if(max_attempts, initial_delay,
-                                                 retry_io_context(),
-                                                 std::move(should_retry));
+    return std::move(*this).template retry_exponential_if<Timer>(
+        max_attempts, initial_delay, retry_io_context(),
+        std::move(should_retry));
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<T> retry_exponential(int max_attempts,
                           std::chrono::milliseconds initial_delay) && {
-    return std::move(*this).retry_exponential_if(max_attempts, initial_delay,
-                                                 retry_io_context(),
-                                                 [](const Error&) {
-                                                   return true;
-                                                 });
+    return std::move(*this).template retry_exponential_if<Timer>(
+        max_attempts, initial_delay, retry_io_context(),
+        [](const Error&) { return true; });
   }
 
   // Poll until condition on value is satisfied or attempts exhausted.
@@ -419,6 +452,7 @@ class IO {
   // - satisfied: predicate to decide if we can stop successfully
   // - retry_on_error: if returns true, keep retrying on error; otherwise fail
   // immediately
+  template <class Timer = boost::asio::steady_timer>
   IO<T> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::io_context& ioc, std::function<bool(const T&)> satisfied,
@@ -431,7 +465,7 @@ class IO {
                   self_ptr = std::make_shared<IO<T>>(std::move(*this))](
                      auto cb) mutable {
       struct PollState {
-        std::shared_ptr<int> attempt;
+        std::shared_ptr<detail::RetryLoop<Timer>> loop;
         std::shared_ptr<std::function<void()>> do_attempt;
         std::shared_ptr<std::shared_ptr<std::function<void()>>>
             keep_alive_holder;
@@ -444,7 +478,7 @@ class IO {
       };
 
       auto state = std::make_shared<PollState>();
-      state->attempt = std::make_shared<int>(0);
+      state->loop = std::make_shared<detail::RetryLoop<Timer>>();
       state->do_attempt = std::make_shared<std::function<void()>>();
       state->keep_alive_holder =
           std::make_shared<std::shared_ptr<std::function<void()>>>(
@@ -478,10 +512,9 @@ class IO {
                             release_keep_alive, cleanup](IOResult r) mutable {
         auto enqueue_retry = [&]() {
           auto keep_alive_copy = *state->keep_alive_holder;
-          auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-          timer->expires_after(interval);
-          timer->async_wait([weak_attempt, state, keep_alive_copy, timer, cb,
-                             release_keep_alive, cleanup](
+          auto& timer = state->loop->arm(*ioc_ptr, interval);
+          timer.async_wait([weak_attempt, state, keep_alive_copy, cb,
+                            release_keep_alive, cleanup](
                                 const boost::system::error_code& ec) mutable {
             if (ec) {
               // final failure from timer - schedule cleanup then deliver
@@ -506,7 +539,8 @@ class IO {
             enqueue_retry();
           }
         } else {
-          if (!retry_on_error(r.error()) || *state->attempt >= max_attempts) {
+          if (!retry_on_error(r.error()) ||
+              state->loop->attempt >= max_attempts) {
             cleanup();
             cb(std::move(r));
           } else {
@@ -517,30 +551,32 @@ class IO {
 
       *state->do_attempt = [state, max_attempts, cb, handle_result,
                             release_keep_alive, cleanup]() mutable {
-        if (*state->attempt >= max_attempts) {
+        if (state->loop->attempt >= max_attempts) {
           cleanup();
           cb(Result<T, Error>::Err(Error{3, "Polling attempts exhausted"}));
           return;
         }
-        (*state->attempt)++;
+        state->loop->attempt++;
         state->self_ptr->clone().run(handle_result);
       };
 
       (*state->do_attempt)();
     });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::io_context& ioc, std::function<bool(const T&)> satisfied,
       std::function<bool(const Error&)> retry_on_error = [](const Error&) {
         return true;
       }) & {
-    return std::move(*this).poll_if(max_attempts, interval, ioc,
-                                    std::move(satisfied),
-                                    std::move(retry_on_error));
+    return std::move(*this).template poll_if<Timer>(
+        max_attempts, interval, ioc, std::move(satisfied),
+        std::move(retry_on_error));
   }
 
   // Executor-aware poll_if for IO<T>
+  template <class Timer = boost::asio::steady_timer>
   IO<T> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::any_io_executor ex, std::function<bool(const T&)> satisfied,
@@ -551,7 +587,7 @@ class IO {
                   retry_on_error = std::move(retry_on_error),
                   self_ptr = std::make_shared<IO<T>>(std::move(*this))](
                      auto cb) mutable {
-      auto attempt = std::make_shared<int>(0);
+      auto loop = std::make_shared<detail::RetryLoop<Timer>>();
       auto do_attempt = std::make_shared<std::function<void()>>();
       auto keep_alive_holder =
           std::make_shared<std::shared_ptr<std::function<void()>>>(do_attempt);
@@ -563,17 +599,16 @@ class IO {
         }
       };
 
-      auto handle_result = [attempt, max_attempts, cb, self_ptr, interval, ex,
+      auto handle_result = [loop, max_attempts, cb, self_ptr, interval, ex,
                             satisfied, retry_on_error, weak_attempt,
                             keep_alive_holder,
                             release_keep_alive](IOResult r) mutable {
         auto enqueue_retry = [&]() {
           auto keep_alive_copy = *keep_alive_holder;
-          auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-          timer->expires_after(interval);
-          timer->async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
-                             timer, cb, release_keep_alive](
-                                const boost::system::error_code& ec) mutable {
+          auto& timer = loop->arm(ex, interval);
+          timer.async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
+                            loop, cb, release_keep_alive](
+                               const boost::system::error_code& ec) mutable {
             if (ec) {
               release_keep_alive();
               cb(Result<T, Error>::Err(
@@ -596,7 +631,7 @@ class IO {
             enqueue_retry();
           }
         } else {
-          if (!retry_on_error(r.error()) || *attempt >= max_attempts) {
+          if (!retry_on_error(r.error()) || loop->attempt >= max_attempts) {
             release_keep_alive();
             cb(std::move(r));
           } else {
@@ -605,29 +640,30 @@ class IO {
         }
       };
 
-      *do_attempt = [attempt, max_attempts, cb, self_ptr, handle_result,
+      *do_attempt = [loop, max_attempts, cb, self_ptr, handle_result,
                      release_keep_alive]() mutable {
-        if (*attempt >= max_attempts) {
+        if (loop->attempt >= max_attempts) {
           release_keep_alive();
           cb(Result<T, Error>::Err(Error{3, "Polling attempts exhausted"}));
           return;
         }
-        (*attempt)++;
+        loop->attempt++;
         self_ptr->clone().run(handle_result);
       };
 
       (*do_attempt)();
     });
   }
+  template <class Timer = boost::asio::steady_timer>
   IO<T> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::any_io_executor ex, std::function<bool(const T&)> satisfied,
       std::function<bool(const Error&)> retry_on_error = [](const Error&) {
         return true;
       }) & {
-    return std::move(*this).poll_if(max_attempts, interval, ex,
-                                    std::move(satisfied),
-                                    std::move(retry_on_error));
+    return std::move(*this).template poll_if<Timer>(
+        max_attempts, interval, ex, std::move(satisfied),
+        std::move(retry_on_error));
   }
 
   void run(Callback cb) const { thunk_(std::move(cb)); }
@@ -787,59 +823,33 @@ class IO<void> {
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> timeout(boost::asio::io_context& ioc,
                    std::chrono::milliseconds duration) && {
-    return IO<void>(
-        [ioc_ptr = &ioc, duration, self = std::move(*this)](auto cb) mutable {
-          auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-          auto fired = std::make_shared<bool>(false);
-
-          timer->expires_after(duration);
-          timer->async_wait(
-              [cb, fired](const boost::system::error_code& ec) mutable {
-                if (*fired) return;
-                *fired = true;
-                if (!ec) cb(IOResult::Err(Error{2, "Operation timed out"}));
-              });
-
-          self.run([cb, timer, fired](IOResult r) mutable {
-            if (*fired) return;
-            *fired = true;
-            detail::cancel_timer(*timer);
-            cb(std::move(r));
-          });
-        });
+    return IO<void>([ioc_ptr = &ioc, duration,
+                     self = std::move(*this)](Callback cb) {
+      detail::run_with_timeout<Timer, IOResult>(*ioc_ptr, duration, self,
+                                                std::move(cb));
+    });
   }
 
   // Executor-aware timeout
+  template <class Timer = boost::asio::steady_timer>
   IO<void> timeout(boost::asio::any_io_executor ex,
                    std::chrono::milliseconds duration) && {
-    return IO<void>([ex, duration, self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-      auto fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait(
-          [cb, fired](const boost::system::error_code& ec) mutable {
-            if (*fired) return;
-            *fired = true;
-            if (!ec) cb(IOResult::Err(Error{2, "Operation timed out"}));
-          });
-
-      self.run([cb, timer, fired](IOResult r) mutable {
-        if (*fired) return;
-        *fired = true;
-        detail::cancel_timer(*timer);
-        cb(std::move(r));
-      });
+    return IO<void>([ex, duration, self = std::move(*this)](Callback cb) {
+      detail::run_with_timeout<Timer, IOResult>(ex, duration, self,
+                                                std::move(cb));
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> timeout(boost::asio::any_io_executor ex,
                    std::chrono::milliseconds duration) & {
-    return std::move(*this).timeout(ex, duration);
+    return std::move(*this).template timeout<Timer>(ex, duration);
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> retry_exponential_if(
       int max_attempts, std::chrono::milliseconds initial_delay,
       boost::asio::io_context& ioc,
@@ -848,7 +858,7 @@ class IO<void> {
                      should_retry = std::move(should_retry),
                      self_ptr = std::make_shared<IO<void>>(std::move(*this))](
                         auto cb) mutable {
-      auto attempt = std::make_shared<int>(0);
+      auto loop = std::make_shared<detail::RetryLoop<Timer>>();
       auto try_run =
           std::make_shared<std::function<void(std::chrono::milliseconds)>>();
       std::weak_ptr<std::function<void(std::chrono::milliseconds)>> weak_try =
@@ -861,23 +871,22 @@ class IO<void> {
         self_ptr.reset();
       };
 
-      *try_run = [max_attempts, attempt, ioc_ptr, should_retry, self_ptr,
+      *try_run = [max_attempts, loop, ioc_ptr, should_retry, self_ptr,
                   weak_try, cb,
                   cleanup](std::chrono::milliseconds current_delay) mutable {
-        (*attempt)++;
-        self_ptr->clone().run([max_attempts, attempt, should_retry, weak_try,
+        loop->attempt++;
+        self_ptr->clone().run([max_attempts, loop, should_retry, weak_try,
                                cb, ioc_ptr, current_delay,
                                cleanup](IOResult r) mutable {
-          if (r.is_ok() || *attempt >= max_attempts ||
+          if (r.is_ok() || loop->attempt >= max_attempts ||
               !should_retry(r.error())) {
             // cleanup before delivering final result
             cleanup();
             cb(std::move(r));
           } else {
-            auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-            timer->expires_after(current_delay);
-            timer->async_wait([weak_try, timer, cb, current_delay, cleanup](
-                                  const boost::system::error_code& ec) mutable {
+            auto& timer = loop->arm(*ioc_ptr, current_delay);
+            timer.async_wait([weak_try, loop, cb, current_delay, cleanup](
+                                 const boost::system::error_code& ec) mutable {
               if (ec) {
                 // cleanup then deliver final failure
                 cleanup();
@@ -897,34 +906,36 @@ class IO<void> {
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> retry_exponential(int max_attempts,
                              std::chrono::milliseconds initial_delay,
                              boost::asio::io_context& ioc) && {
-    return std::move(*this).retry_exponential_if(
+    return std::move(*this).template retry_exponential_if<Timer>(
         max_attempts, initial_delay, ioc, [](const Error&) { return true; });
   }
 
   // Default-executor overloads using shared retry executor
+  template <class Timer = boost::asio::steady_timer>
   IO<void> retry_exponential_if(int max_attempts,
                                 std::chrono::milliseconds initial_delay,
                                 std::function<bool(const Error&)> should_retry) && {
-    return std::move(*this).retry_exponential_if(max_attempts, initial_delay,
-                                                 retry_io_context(),
-                                                 std::move(should_retry));
+    return std::move(*this).template retry_exponential_if<Timer>(
+        max_attempts, initial_delay, retry_io_context(),
+        std::move(should_retry));
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> retry_exponential(int max_attempts,
                              std::chrono::milliseconds initial_delay) && {
-    return std::move(*this).retry_exponential_if(max_attempts, initial_delay,
-                                                 retry_io_context(),
-                                                 [](const Error&) {
-                                                   return true;
-                                                 });
+    return std::move(*this).template retry_exponential_if<Timer>(
+        max_attempts, initial_delay, retry_io_context(),
+        [](const Error&) { return true; });
   }
 
   // Poll IO<void> until external condition is satisfied. After each run, call
   // satisfied(); if false, wait interval and retry. Errors are retried if
   // retry_on_error returns true and attempts remain.
+  template <class Timer = boost::asio::steady_timer>
   IO<void> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::io_context& ioc, std::function<bool()> satisfied,
@@ -936,7 +947,7 @@ class IO<void> {
                      retry_on_error = std::move(retry_on_error),
                      self_ptr = std::make_shared<IO<void>>(std::move(*this))](
                         auto cb) mutable {
-      auto attempt = std::make_shared<int>(0);
+      auto loop = std::make_shared<detail::RetryLoop<Timer>>();
       auto do_attempt = std::make_shared<std::function<void()>>();
       auto keep_alive_holder =
           std::make_shared<std::shared_ptr<std::function<void()>>>(do_attempt);
@@ -948,17 +959,16 @@ class IO<void> {
         }
       };
 
-      auto handle_result = [attempt, max_attempts, cb, self_ptr, interval,
+      auto handle_result = [loop, max_attempts, cb, self_ptr, interval,
                             ioc_ptr, satisfied, retry_on_error, weak_attempt,
                             keep_alive_holder,
                             release_keep_alive](IOResult r) mutable {
         auto enqueue_retry = [&]() {
           auto keep_alive_copy = *keep_alive_holder;
-          auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-          timer->expires_after(interval);
-          timer->async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
-                             timer, cb, release_keep_alive](
-                                const boost::system::error_code& ec) mutable {
+          auto& timer = loop->arm(*ioc_ptr, interval);
+          timer.async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
+                            loop, cb, release_keep_alive](
+                               const boost::system::error_code& ec) mutable {
             if (ec) {
               release_keep_alive();
               cb(Result<void, Error>::Err(
@@ -980,7 +990,7 @@ class IO<void> {
             enqueue_retry();
           }
         } else {
-          if (!retry_on_error(r.error()) || *attempt >= max_attempts) {
+          if (!retry_on_error(r.error()) || loop->attempt >= max_attempts) {
             release_keep_alive();
             cb(std::move(r));
           } else {
@@ -989,14 +999,14 @@ class IO<void> {
         }
       };
 
-      *do_attempt = [attempt, max_attempts, cb, self_ptr, handle_result,
+      *do_attempt = [loop, max_attempts, cb, self_ptr, handle_result,
                      release_keep_alive]() mutable {
-        if (*attempt >= max_attempts) {
+        if (loop->attempt >= max_attempts) {
           release_keep_alive();
           cb(Result<void, Error>::Err(Error{3, "Polling attempts exhausted"}));
           return;
         }
-        (*attempt)++;
+        loop->attempt++;
         self_ptr->clone().run(handle_result);
       };
 
@@ -1005,6 +1015,7 @@ class IO<void> {
   }
 
   // Executor-aware poll_if for IO<void>
+  template <class Timer = boost::asio::steady_timer>
   IO<void> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::any_io_executor ex, std::function<bool()> satisfied,
@@ -1016,7 +1027,7 @@ class IO<void> {
                      retry_on_error = std::move(retry_on_error),
                      self_ptr = std::make_shared<IO<void>>(std::move(*this))](
                         auto cb) mutable {
-      auto attempt = std::make_shared<int>(0);
+      auto loop = std::make_shared<detail::RetryLoop<Timer>>();
       auto do_attempt = std::make_shared<std::function<void()>>();
       auto keep_alive_holder =
           std::make_shared<std::shared_ptr<std::function<void()>>>(do_attempt);
@@ -1028,17 +1039,16 @@ class IO<void> {
         }
       };
 
-      auto handle_result = [attempt, max_attempts, cb, self_ptr, interval, ex,
+      auto handle_result = [loop, max_attempts, cb, self_ptr, interval, ex,
                             satisfied, retry_on_error, weak_attempt,
                             keep_alive_holder,
                             release_keep_alive](IOResult r) mutable {
         auto enqueue_retry = [&]() {
           auto keep_alive_copy = *keep_alive_holder;
-          auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-          timer->expires_after(interval);
-          timer->async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
-                             timer, cb, release_keep_alive](
-                                const boost::system::error_code& ec) mutable {
+          auto& timer = loop->arm(ex, interval);
+          timer.async_wait([weak_attempt, keep_alive_holder, keep_alive_copy,
+                            loop, cb, release_keep_alive](
+                               const boost::system::error_code& ec) mutable {
             if (ec) {
               release_keep_alive();
               cb(Result<void, Error>::Err(
@@ -1060,7 +1070,7 @@ class IO<void> {
             enqueue_retry();
           }
         } else {
-          if (!retry_on_error(r.error()) || *attempt >= max_attempts) {
+          if (!retry_on_error(r.error()) || loop->attempt >= max_attempts) {
             release_keep_alive();
             cb(std::move(r));
           } else {
@@ -1069,14 +1079,14 @@ class IO<void> {
         }
       };
 
-      *do_attempt = [attempt, max_attempts, cb, self_ptr, handle_result,
+      *do_attempt = [loop, max_attempts, cb, self_ptr, handle_result,
                      release_keep_alive]() mutable {
-        if (*attempt >= max_attempts) {
+        if (loop->attempt >= max_attempts) {
           release_keep_alive();
           cb(Result<void, Error>::Err(Error{3, "Polling attempts exhausted"}));
           return;
         }
-        (*attempt)++;
+        loop->attempt++;
         self_ptr->clone().run(handle_result);
       };
 
@@ -1084,94 +1094,42 @@ class IO<void> {
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> poll_if(
       int max_attempts, std::chrono::milliseconds interval,
       boost::asio::any_io_executor ex, std::function<bool()> satisfied,
       std::function<bool(const Error&)> retry_on_error = [](const Error&) {
         return true;
       }) & {
-    return std::move(*this).poll_if(max_attempts, interval, ex,
-                                    std::move(satisfied),
-                                    std::move(retry_on_error));
+    return std::move(*this).template poll_if<Timer>(
+        max_attempts, interval, ex, std::move(satisfied),
+        std::move(retry_on_error));
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> delay(boost::asio::io_context& ioc,
                  std::chrono::milliseconds duration) && {
     return IO<void>([ioc_ptr = &ioc, duration,
-                     self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(*ioc_ptr);
-      auto result = std::make_shared<std::optional<IOResult>>();
-      auto delivered = std::make_shared<bool>(false);
-      auto timer_fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait([cb, result, delivered, timer_fired,
-                         timer](const boost::system::error_code& ec) mutable {
-        if (*delivered) return;
-        if (ec) {
-          *delivered = true;
-          cb(Result<void, Error>::Err(
-              Error{1, std::string{"Timer error: "} + ec.message()}));
-          return;
-        }
-        *timer_fired = true;
-        if (result->has_value()) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
-
-      self.run([cb, result, delivered, timer_fired, timer](IOResult r) mutable {
-        if (*delivered) return;
-        *result = std::move(r);
-        if (*timer_fired) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
+                     self = std::move(*this)](Callback cb) {
+      detail::run_with_delay<Timer, IOResult>(*ioc_ptr, duration, self,
+                                              std::move(cb));
     });
   }
 
   // Executor-aware delay
+  template <class Timer = boost::asio::steady_timer>
   IO<void> delay(boost::asio::any_io_executor ex,
                  std::chrono::milliseconds duration) && {
-    return IO<void>([ex, duration, self = std::move(*this)](auto cb) mutable {
-      auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-      auto result = std::make_shared<std::optional<IOResult>>();
-      auto delivered = std::make_shared<bool>(false);
-      auto timer_fired = std::make_shared<bool>(false);
-
-      timer->expires_after(duration);
-      timer->async_wait([cb, result, delivered, timer_fired,
-                         timer](const boost::system::error_code& ec) mutable {
-        if (*delivered) return;
-        if (ec) {
-          *delivered = true;
-          cb(Result<void, Error>::Err(
-              Error{1, std::string{"Timer error: "} + ec.message()}));
-          return;
-        }
-        *timer_fired = true;
-        if (result->has_value()) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
-
-      self.run([cb, result, delivered, timer_fired, timer](IOResult r) mutable {
-        if (*delivered) return;
-        *result = std::move(r);
-        if (*timer_fired) {
-          *delivered = true;
-          cb(std::move(**result));
-        }
-      });
+    return IO<void>([ex, duration, self = std::move(*this)](Callback cb) {
+      detail::run_with_delay<Timer, IOResult>(ex, duration, self,
+                                              std::move(cb));
     });
   }
 
+  template <class Timer = boost::asio::steady_timer>
   IO<void> delay(boost::asio::any_io_executor ex,
                  std::chrono::milliseconds duration) & {
-    return std::move(*this).delay(ex, duration);
+    return std::move(*this).template delay<Timer>(ex, duration);
   }
 
   void run(Callback cb) const { thunk_(std::move(cb)); }
@@ -1553,12 +1511,13 @@ inline IO<void> all_ok_io(std::initializer_list<IO<void>> items) {
   return all_ok_io(std::vector<IO<void>>(items));
 }
 
-// delay helpers
-template <typename T = void>
+// delay helpers. `Timer` is any type with steady_timer's constructor,
+// async_wait and cancel, e.g. monad::VirtualTimer in tests.
+template <typename T = void, class Timer = boost::asio::steady_timer>
 IO<T> delay_for(boost::asio::io_context& ioc,
                 std::chrono::milliseconds duration) {
   return IO<T>([&ioc, duration](auto cb) {
-    auto timer = std::make_shared<boost::asio::steady_timer>(ioc, duration);
+    auto timer = std::make_shared<Timer>(ioc, duration);
     timer->async_wait([timer, cb](const boost::system::error_code& ec) mutable {
       if (ec) {
         cb(Result<T, Error>::Err(
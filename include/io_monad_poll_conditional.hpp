@@ -0,0 +1,218 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/beast/http/field.hpp>
+#include <boost/beast/http/message.hpp>
+#include <chrono>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "http_date.hpp"
+#include "io_monad.hpp"
+#include "io_monad_poll_with_state.hpp"
+
+namespace monad {
+
+struct ConditionalPollOptions {
+  int max_attempts = 30;
+  // Delay between attempts when neither the server nor `decide` names one.
+  std::chrono::milliseconds interval{1000};
+  // Bounds applied to server-supplied intervals.
+  std::chrono::milliseconds min_interval{0};
+  std::chrono::milliseconds max_interval{std::chrono::minutes(5)};
+  bool use_retry_after = true;
+  bool use_cache_control = true;  // max-age
+};
+
+// Validators of the last fresh response, replayed as If-None-Match /
+// If-Modified-Since so an unchanged resource costs a bodiless 304.
+struct ConditionalValidators {
+  std::string etag;
+  std::string last_modified;
+
+  bool empty() const { return etag.empty() && last_modified.empty(); }
+
+  template <class Fields>
+  void apply(Fields& request) const {
+    namespace http = boost::beast::http;
+    if (!etag.empty()) request.set(http::field::if_none_match, etag);
+    if (!last_modified.empty()) {
+      request.set(http::field::if_modified_since, last_modified);
+    }
+  }
+
+  // From a 2xx response: take its validators, dropping ones it no longer
+  // sends.
+  template <class Fields>
+  void replace(const Fields& response) {
+    namespace http = boost::beast::http;
+    etag = std::string(response[http::field::etag]);
+    last_modified = std::string(response[http::field::last_modified]);
+  }
+
+  // From a 304: it may carry a newer ETag but never removes one.
+  template <class Fields>
+  void refresh(const Fields& response) {
+    namespace http = boost::beast::http;
+    auto e = response[http::field::etag];
+    if (!e.empty()) etag = std::string(e);
+    auto lm = response[http::field::last_modified];
+    if (!lm.empty()) last_modified = std::string(lm);
+  }
+};
+
+// Poll state wrapping the caller's own state `S`.
+template <typename S>
+struct ConditionalPollState {
+  S user;
+  ConditionalValidators validators;
+  int not_modified = 0;  // 304s in a row
+};
+
+namespace detail {
+
+inline std::string_view poll_trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+    s.remove_prefix(1);
+  }
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) {
+    s.remove_suffix(1);
+  }
+  return s;
+}
+
+inline std::optional<long long> poll_delta_seconds(std::string_view s) {
+  s = poll_trim(s);
+  if (s.empty() || s.size() > 12) return std::nullopt;
+  long long v = 0;
+  for (char ch : s) {
+    if (ch < '0' || ch > '9') return std::nullopt;
+    v = v * 10 + (ch - '0');
+  }
+  return v;
+}
+
+// max-age from a Cache-Control value; s-maxage and friends are ignored.
+inline std::optional<long long> cache_control_max_age(std::string_view value) {
+  while (!value.empty()) {
+    const auto comma = std::min(value.find(','), value.size());
+    auto directive = poll_trim(value.substr(0, comma));
+    value.remove_prefix(std::min(comma + 1, value.size()));
+    const auto eq = directive.find('=');
+    if (eq == std::string_view::npos) continue;
+    auto name = poll_trim(directive.substr(0, eq));
+    if (name.size() != 7) continue;
+    bool match = true;
+    for (std::size_t i = 0; i < 7; ++i) {
+      char ch = name[i];
+      if (ch >= 'A' && ch <= 'Z') ch = static_cast<char>(ch - 'A' + 'a');
+      if (ch != "max-age"[i]) match = false;
+    }
+    if (!match) continue;
+    auto arg = directive.substr(eq + 1);
+    if (arg.size() >= 2 && arg.front() == '"' && arg.back() == '"') {
+      arg = arg.substr(1, arg.size() - 2);
+    }
+    return poll_delta_seconds(arg);
+  }
+  return std::nullopt;
+}
+
+}  // namespace detail
+
+// How long the server asked us to wait before polling again: Retry-After
+// (delta-seconds or HTTP-date) first, then Cache-Control max-age, clamped to
+// the options' bounds. nullopt when the response names no interval.
+template <class Fields>
+std::optional<std::chrono::milliseconds> server_poll_interval(
+    const Fields& response, const ConditionalPollOptions& opts,
+    std::chrono::system_clock::time_point now =
+        std::chrono::system_clock::now()) {
+  namespace http = boost::beast::http;
+  std::optional<std::chrono::milliseconds> hint;
+  if (opts.use_retry_after) {
+    auto ra = response[http::field::retry_after];
+    const std::string_view v(ra.data(), ra.size());
+    if (auto secs = detail::poll_delta_seconds(v)) {
+      hint = std::chrono::seconds(*secs);
+    } else if (auto at = client_async::http_date::parse(v)) {
+      hint = std::chrono::duration_cast<std::chrono::milliseconds>(
+          std::max(*at - now, std::chrono::system_clock::duration::zero()));
+    }
+  }
+  if (!hint && opts.use_cache_control) {
+    auto cc = response[http::field::cache_control];
+    if (auto secs = detail::cache_control_max_age(
+            std::string_view(cc.data(), cc.size()))) {
+      hint = std::chrono::seconds(*secs);
+    }
+  }
+  if (!hint) return std::nullopt;
+  return std::clamp(*hint, opts.min_interval, opts.max_interval);
+}
+
+// Response headers of what a conditional poll's `send` produced; found by
+// ADL, so other result types (HttpExchangePtr) add their own overload.
+template <class Body, class Fields>
+const boost::beast::http::header<false, Fields>* conditional_poll_header(
+    const boost::beast::http::response<Body, Fields>& response) {
+  return &response;
+}
+
+// poll_with_state for HTTP resources that answer conditional requests.
+//
+//   send(attempt, S&, const ConditionalValidators&) -> IO<R>
+//     issues one request; apply the validators to it.
+//   decide(attempt, S&, const R&) -> PollControl
+//     runs only for responses other than 304. A retry without its own delay
+//     waits as long as the server asked (Retry-After, max-age), else
+//     `opts.interval`.
+//
+// A 304 retries without calling `decide`; transport errors retry too, and
+// the last one is reported if attempts run out. Validators are taken from
+// 2xx responses only.
+template <typename R, typename S, typename SendFn, typename DecideFn>
+IO<R> poll_conditional(const ConditionalPollOptions& opts,
+                       boost::asio::any_io_executor ex, S initial_state,
+                       SendFn send, DecideFn decide) {
+  using State = ConditionalPollState<S>;
+  auto job = [send = std::move(send)](int attempt, State& st) mutable {
+    return send(attempt, st.user, st.validators);
+  };
+  auto on_result = [opts, decide = std::move(decide)](
+                       int attempt, State& st,
+                       const Result<R, Error>& r) mutable -> PollControl {
+    if (r.is_err()) return PollControl::retry();
+    const auto* header = conditional_poll_header(r.value());
+    if (!header) return PollControl::retry();
+    const auto hint = server_poll_interval(*header, opts);
+    const int status = static_cast<int>(header->result_int());
+    if (status == 304) {
+      ++st.not_modified;
+      st.validators.refresh(*header);
+      return PollControl::retry(hint);
+    }
+    st.not_modified = 0;
+    if (status >= 200 && status < 300) st.validators.replace(*header);
+    PollControl ctrl = decide(attempt, st.user, r.value());
+    if (ctrl.kind == PollControl::Kind::retry && !ctrl.retry_after) {
+      ctrl.retry_after = hint;
+    }
+    return ctrl;
+  };
+  auto on_exhausted = [](int attempts, State&,
+                         const Result<R, Error>& last) -> Error {
+    if (last.is_err()) return last.error();
+    return detail::default_exhausted_error<R>(attempts);
+  };
+  return poll_with_state<R>(opts.max_attempts, opts.interval, ex,
+                            State{std::move(initial_state), {}, 0},
+                            std::move(job), std::move(on_result),
+                            std::move(on_exhausted));
+}
+
+}  // namespace monad
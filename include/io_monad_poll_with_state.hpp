@@ -56,7 +56,8 @@ inline Error make_timer_error(const boost::system::error_code& ec) {
   return Error{1, std::string{"Timer error: "} + ec.message()};
 }
 
-template <typename T, typename S, typename JobFn, typename DecideFn,
+template <typename T, typename Timer = boost::asio::steady_timer,
+          typename S, typename JobFn, typename DecideFn,
           typename OnExhaustedFn>
 IO<T> poll_with_state_impl(int max_attempts,
                            std::chrono::milliseconds default_interval,
@@ -77,7 +78,7 @@ IO<T> poll_with_state_impl(int max_attempts,
                    typename IO<T>::Callback cb) mutable {
     using IOResult = Result<T, Error>;
 
-    auto attempt = std::make_shared<int>(0);
+    auto loop = std::make_shared<RetryLoop<Timer>>();
     auto do_attempt = std::make_shared<std::function<void()>>();
     auto keep_alive_holder =
         std::make_shared<std::shared_ptr<std::function<void()>>>(do_attempt);
@@ -93,14 +94,13 @@ IO<T> poll_with_state_impl(int max_attempts,
       }
     };
 
-    auto schedule_retry = [ex, weak_attempt, keep_alive_holder, cb, cleanup](
-                              std::chrono::milliseconds delay) mutable {
+    auto schedule_retry = [ex, loop, weak_attempt, keep_alive_holder, cb,
+                           cleanup](std::chrono::milliseconds delay) mutable {
       auto keep_alive_copy = (keep_alive_holder ? *keep_alive_holder
                                                 : std::shared_ptr<std::function<void()>>{});
-      auto timer = std::make_shared<boost::asio::steady_timer>(ex);
-      timer->expires_after(delay);
-      timer->async_wait([weak_attempt, keep_alive_holder, keep_alive_copy, timer,
-                         cb, cleanup](const boost::system::error_code& ec) mutable {
+      auto& timer = loop->arm(ex, delay);
+      timer.async_wait([weak_attempt, keep_alive_holder, keep_alive_copy, loop,
+                        cb, cleanup](const boost::system::error_code& ec) mutable {
         if (ec) {
           cleanup();
           cb(IOResult::Err(make_timer_error(ec)));
@@ -114,7 +114,7 @@ IO<T> poll_with_state_impl(int max_attempts,
     };
 
     auto handle_result =
-        [attempt, max_attempts, default_interval, cb, ex, state, job_ptr,
+        [max_attempts, default_interval, cb, ex, state, job_ptr,
          decide_ptr, on_exhausted_ptr, hooks_ptr, schedule_retry,
          cleanup](int attempt_no, IOResult r) mutable {
           PollControl ctrl;
@@ -187,15 +187,14 @@ IO<T> poll_with_state_impl(int max_attempts,
           schedule_retry(delay);
         };
 
-    *do_attempt = [attempt, max_attempts, cb, state, job_ptr, hooks_ptr,
+    *do_attempt = [loop, max_attempts, cb, state, job_ptr, hooks_ptr,
                    handle_result, cleanup]() mutable {
-      if (*attempt >= max_attempts) {
+      if (loop->attempt >= max_attempts) {
         cleanup();
         cb(IOResult::Err(default_exhausted_error<T>(max_attempts)));
         return;
       }
-      (*attempt)++;
-      const int attempt_no = *attempt;
+      const int attempt_no = ++loop->attempt;
 
       if (hooks_ptr->on_attempt_start) {
         hooks_ptr->on_attempt_start(attempt_no, *state);
@@ -220,20 +219,22 @@ IO<T> poll_with_state_impl(int max_attempts,
 }  // namespace detail
 
 // Full form: explicit executor + custom exhausted error.
-template <typename T, typename S, typename JobFn, typename DecideFn,
+template <typename T, typename Timer = boost::asio::steady_timer,
+          typename S, typename JobFn, typename DecideFn,
           typename OnExhaustedFn>
 IO<T> poll_with_state(int max_attempts, std::chrono::milliseconds default_interval,
                       boost::asio::any_io_executor ex, S initial_state,
                       JobFn job, DecideFn decide, OnExhaustedFn on_exhausted,
                       PollWithStateHooks<S> hooks = {}) {
-  return detail::poll_with_state_impl<T>(
+  return detail::poll_with_state_impl<T, Timer>(
       max_attempts, default_interval, ex, std::move(initial_state),
       std::move(job), std::move(decide), std::move(on_exhausted),
       std::move(hooks));
 }
 
 // Convenience: explicit executor, default exhausted error.
-template <typename T, typename S, typename JobFn, typename DecideFn>
+template <typename T, typename Timer = boost::asio::steady_timer,
+          typename S, typename JobFn, typename DecideFn>
 IO<T> poll_with_state(int max_attempts, std::chrono::milliseconds default_interval,
                       boost::asio::any_io_executor ex, S initial_state,
                       JobFn job, DecideFn decide,
@@ -241,14 +242,15 @@ IO<T> poll_with_state(int max_attempts, std::chrono::milliseconds default_interv
   auto on_exhausted = [max_attempts](int attempts, S&, const Result<T, Error>&) {
     return detail::default_exhausted_error<T>(max_attempts);
   };
-  return detail::poll_with_state_impl<T>(
+  return detail::poll_with_state_impl<T, Timer>(
       max_attempts, default_interval, ex, std::move(initial_state),
       std::move(job), std::move(decide), std::move(on_exhausted),
       std::move(hooks));
 }
 
 // Convenience: use internal retry executor (separate from job's executor).
-template <typename T, typename S, typename JobFn, typename DecideFn,
+template <typename T, typename Timer = boost::asio::steady_timer,
+          typename S, typename JobFn, typename DecideFn,
       typename OnExhaustedFn,
       typename std::enable_if_t<
         !std::is_convertible_v<std::decay_t<S>, boost::asio::any_io_executor>,
@@ -257,22 +259,24 @@ IO<T> poll_with_state(int max_attempts, std::chrono::milliseconds default_interv
                       S initial_state, JobFn job, DecideFn decide,
                       OnExhaustedFn on_exhausted,
                       PollWithStateHooks<S> hooks = {}) {
-  return poll_with_state<T>(max_attempts, default_interval, retry_executor(),
-                            std::move(initial_state), std::move(job),
-                            std::move(decide), std::move(on_exhausted),
-                            std::move(hooks));
+  return poll_with_state<T, Timer>(
+      max_attempts, default_interval, retry_executor(),
+      std::move(initial_state), std::move(job), std::move(decide),
+      std::move(on_exhausted), std::move(hooks));
 }
 
-template <typename T, typename S, typename JobFn, typename DecideFn,
+template <typename T, typename Timer = boost::asio::steady_timer,
+          typename S, typename JobFn, typename DecideFn,
       typename std::enable_if_t<
         !std::is_convertible_v<std::decay_t<S>, boost::asio::any_io_executor>,
         int> = 0>
 IO<T> poll_with_state(int max_attempts, std::chrono::milliseconds default_interval,
                       S initial_state, JobFn job, DecideFn decide,
                       PollWithStateHooks<S> hooks = {}) {
-  return poll_with_state<T>(max_attempts, default_interval, retry_executor(),
-                            std::move(initial_state), std::move(job),
-                            std::move(decide), std::move(hooks));
+  return poll_with_state<T, Timer>(
+      max_attempts, default_interval, retry_executor(),
+      std::move(initial_state), std::move(job), std::move(decide),
+      std::move(hooks));
 }
 
 }  // namespace monad
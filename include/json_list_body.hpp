@@ -0,0 +1,126 @@
+#pragma once
+
+#include <algorithm>
+#include <boost/asio/buffer.hpp>
+#include <boost/beast/core/error.hpp>
+#include <boost/beast/http/message.hpp>
+#include <boost/json/serializer.hpp>
+#include <boost/json/value.hpp>
+#include <boost/json/value_from.hpp>
+#include <boost/optional.hpp>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "resp_datastruct.hpp"
+
+namespace apihandler {
+
+// Beast body that writes {"data":[...],"meta":{...}} element by element.
+// Only one element's json::value exists at a time and output goes through
+// a fixed buffer, so a large list costs one copy (the vector itself) instead
+// of vector + DOM + string + body, and the first bytes leave before the
+// last element is serialized. The size is unknown up front: send it chunked.
+template <typename T, std::size_t BufferSize = 16 * 1024>
+struct json_list_body {
+  struct value_type {
+    std::vector<T> data;
+    std::optional<resp::DataMeta> meta;
+  };
+
+  class writer {
+   public:
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool isRequest, class Fields>
+    writer(const boost::beast::http::header<isRequest, Fields>&,
+           const value_type& body)
+        : body_(body) {}
+
+    void init(boost::beast::error_code& ec) { ec = {}; }
+
+    boost::optional<std::pair<const_buffers_type, bool>> get(
+        boost::beast::error_code& ec) {
+      ec = {};
+      std::size_t used = 0;
+      try {
+        while (used < BufferSize) {
+          if (!text_.empty()) {
+            const auto n = std::min(text_.size(), BufferSize - used);
+            std::copy_n(text_.data(), n, buf_ + used);
+            text_.remove_prefix(n);
+            used += n;
+          } else if (in_value_ && !sr_.done()) {
+            used += sr_.read(buf_ + used, BufferSize - used).size();
+          } else if (!advance()) {
+            break;
+          }
+        }
+      } catch (const std::exception&) {
+        ec = boost::system::errc::make_error_code(
+            boost::system::errc::invalid_argument);
+        return boost::none;
+      }
+      if (used == 0) return boost::none;
+      const bool more = stage_ != Stage::done || !text_.empty();
+      return {{const_buffers_type(buf_, used), more}};
+    }
+
+   private:
+    enum class Stage { open, elements, meta, close, done };
+
+    // Queues the next piece of output; false once everything is queued.
+    bool advance() {
+      in_value_ = false;
+      switch (stage_) {
+        case Stage::open:
+          text_ = R"({"data":[)";
+          stage_ = Stage::elements;
+          return true;
+        case Stage::elements:
+          if (next_ < body_.data.size()) {
+            if (next_ > 0) text_ = ",";
+            start_value(json::value_from(body_.data[next_++]));
+            return true;
+          }
+          text_ = "]";
+          stage_ = Stage::meta;
+          return true;
+        case Stage::meta:
+          stage_ = Stage::close;
+          if (body_.meta) {
+            text_ = R"(,"meta":)";
+            start_value(json::value_from(*body_.meta));
+          }
+          return true;
+        case Stage::close:
+          text_ = "}";
+          stage_ = Stage::done;
+          return true;
+        case Stage::done:
+          return false;
+      }
+      return false;
+    }
+
+    void start_value(json::value jv) {
+      current_ = std::move(jv);
+      sr_.reset(&current_);
+      in_value_ = true;
+    }
+
+    const value_type& body_;
+    Stage stage_ = Stage::open;
+    std::size_t next_ = 0;
+    std::string_view text_;  // literal punctuation, emitted before a value
+    json::value current_;
+    json::serializer sr_;
+    bool in_value_ = false;
+    char buf_[BufferSize];
+  };
+};
+
+}  // namespace apihandler
@@ -3,11 +3,16 @@
 #include <stdint.h>
 
 #include <any>
+#include <array>
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <filesystem>
 #include <fstream>
+#include <functional>
 #include <iostream>
+#include <limits>
 #include <map>
 #include <mutex>
 #include <regex>
@@ -18,6 +23,7 @@
 #include <unordered_map>
 #include <utility>
 #include <variant>
+#include <vector>
 
 #include "common_macros.hpp"  // ensure DEBUG_PRINT macro available
 
@@ -118,12 +124,25 @@ class RateLimiter {
   }
 };
 
-template <typename Key>
+// Remembers the keys of recently started tasks for `ttl`, so duplicates can
+// be rejected (is_running_or_mark) or attached to the running task's result
+// (join_or_mark + complete). Keys are spread over shards, each with its own
+// mutex, map and FIFO of mark times. Every mark lives for the same ttl, so
+// the FIFO is in expiry order and expiring is amortized O(1) per call.
+// Every call sweeps all shards, so a joiner hears about an expired mark on
+// the next call for any key; a shard with nothing due is skipped without
+// taking its lock.
+template <typename Key, typename Result = std::monostate,
+          typename Hash = std::hash<Key>,
+          typename ClockT = std::chrono::steady_clock>
 class TaskDeduplicator {
  public:
-  using Clock = std::chrono::steady_clock;
-  using TimePoint = Clock::time_point;
+  using Clock = ClockT;
+  using TimePoint = typename Clock::time_point;
   using Duration = std::chrono::seconds;
+  // Receives the owner's result, or null when the owner unmarked the key or
+  // the mark expired first.
+  using Waiter = std::function<void(const Result*)>;
   inline static auto DeduplicateDuration = [] {};
 
   TaskDeduplicator(Duration ttl) : _ttl(ttl) {}
@@ -131,37 +150,152 @@ class TaskDeduplicator {
   // Returns true if key is already running (not expired),
   // otherwise marks it as running and returns false.
   bool is_running_or_mark(const Key& key) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    auto now = Clock::now();
-
-    // Evacuate expired entries
-    for (auto it = _executed.begin(); it != _executed.end();) {
-      if (now - it->second > _ttl)
-        it = _executed.erase(it);
-      else
-        ++it;
-    }
+    return join_or_mark(key, nullptr);
+  }
 
-    // Check if the key is already running
-    auto it = _executed.find(key);
-    if (it != _executed.end()) {
-      return true;
+  // Like is_running_or_mark, but a duplicate caller's `on_result` is queued
+  // and called with the result the owner passes to complete(). Returns
+  // false when the caller became the owner; `on_result` is then unused.
+  bool join_or_mark(const Key& key, Waiter on_result) {
+    auto& shard = shard_for(key);
+    const auto now = Clock::now();
+    std::vector<Waiter> expired;
+    expire_others(&shard, now, expired);
+    bool running = false;
+    {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      expire(shard, now, expired);
+      auto [it, inserted] = shard.entries.try_emplace(key);
+      if (inserted) {
+        it->second.marked = now;
+        it->second.gen = ++shard.next_gen;
+        shard.fifo.push_back({now, key, it->second.gen});
+        if (shard.fifo.size() == 1) update_due(shard);
+      } else {
+        running = true;
+        if (on_result) it->second.waiters.push_back(std::move(on_result));
+      }
     }
+    notify(expired, nullptr);
+    return running;
+  }
 
-    // Mark as running
-    _executed[key] = now;
-    return false;
+  // Ends the owner's run: clears the mark and hands `result` to every
+  // caller that joined it.
+  void complete(const Key& key, const Result& result) {
+    notify(take(key), &result);
+    expire_all();
   }
 
   void unmark(const Key& key) {
-    std::lock_guard<std::mutex> lock(_mutex);
-    _executed.erase(key);
+    notify(take(key), nullptr);
+    expire_all();
+  }
+
+  std::size_t size() {
+    expire_all();
+    std::size_t n = 0;
+    for (auto& shard : _shards) {
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      n += shard.entries.size();
+    }
+    return n;
   }
 
  private:
-  std::unordered_map<Key, TimePoint> _executed;
+  static constexpr std::size_t kShards = 16;
+
+  struct Entry {
+    TimePoint marked;
+    uint64_t gen = 0;  // tells a re-mark apart from a stale FIFO slot
+    std::vector<Waiter> waiters;
+  };
+  struct Mark {
+    TimePoint at;
+    Key key;
+    uint64_t gen;
+  };
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<Key, Entry, Hash> entries;
+    std::deque<Mark> fifo;
+    uint64_t next_gen = 0;
+    // Expiry time of fifo.front() in clock ticks, or max when empty; read
+    // without the lock to skip shards with nothing due.
+    std::atomic<typename Clock::rep> due{
+        std::numeric_limits<typename Clock::rep>::max()};
+  };
+
+  Shard& shard_for(const Key& key) {
+    return _shards[Hash{}(key) % kShards];
+  }
+
+  // Drops marks older than ttl, collecting their waiters.
+  void expire(Shard& shard, TimePoint now, std::vector<Waiter>& out) {
+    bool popped = false;
+    while (!shard.fifo.empty() && now - shard.fifo.front().at > _ttl) {
+      const auto& front = shard.fifo.front();
+      auto it = shard.entries.find(front.key);
+      if (it != shard.entries.end() && it->second.gen == front.gen) {
+        for (auto& w : it->second.waiters) out.push_back(std::move(w));
+        shard.entries.erase(it);
+      }
+      shard.fifo.pop_front();
+      popped = true;
+    }
+    if (popped) update_due(shard);
+  }
+
+  // Runs expire() on every shard but `skip` that has a mark due.
+  void expire_others(const Shard* skip, TimePoint now,
+                     std::vector<Waiter>& out) {
+    const auto ticks = now.time_since_epoch().count();
+    for (auto& shard : _shards) {
+      if (&shard == skip ||
+          ticks <= shard.due.load(std::memory_order_relaxed)) {
+        continue;
+      }
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      expire(shard, now, out);
+    }
+  }
+  void expire_all() {
+    std::vector<Waiter> expired;
+    expire_others(nullptr, Clock::now(), expired);
+    notify(expired, nullptr);
+  }
+
+  void update_due(Shard& shard) {
+    shard.due.store(
+        shard.fifo.empty()
+            ? std::numeric_limits<typename Clock::rep>::max()
+            : std::chrono::time_point_cast<typename Clock::duration>(
+                  shard.fifo.front().at + _ttl)
+                  .time_since_epoch()
+                  .count(),
+        std::memory_order_relaxed);
+  }
+
+  std::vector<Waiter> take(const Key& key) {
+    auto& shard = shard_for(key);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto it = shard.entries.find(key);
+    if (it == shard.entries.end()) return {};
+    auto waiters = std::move(it->second.waiters);
+    shard.entries.erase(it);
+    return waiters;
+  }
+
+  // Called without a shard lock so waiters may use the deduplicator.
+  static void notify(std::vector<Waiter>& waiters, const Result* result) {
+    for (auto& w : waiters) w(result);
+  }
+  static void notify(std::vector<Waiter>&& waiters, const Result* result) {
+    notify(waiters, result);
+  }
+
   Duration _ttl;
-  std::mutex _mutex;
+  std::array<Shard, kShards> _shards;
 };
 
 class ThreadNotifier {
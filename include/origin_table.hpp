@@ -0,0 +1,122 @@
+#pragma once
+
+#include <charconv>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+// Origins and their process-wide interned ids, shared by the connection
+// pool, the response memory budget and anything that tags metrics per
+// origin.
+
+namespace beast_pool {
+
+// ------------------------------------
+// Origin key
+// ------------------------------------
+struct Origin {
+  std::string scheme;  // "http" or "https" (lowercase)
+  std::string host;    // authority host name (used for SNI)
+  std::uint16_t port;
+  // Non-empty: connect to this Unix domain socket instead of host:port
+  // (plain HTTP to local sidecars).
+  std::string socket_path{};
+
+  bool operator==(const Origin& o) const noexcept {
+    return scheme == o.scheme && host == o.host && port == o.port &&
+           socket_path == o.socket_path;
+  }
+};
+struct OriginHash {
+  std::size_t operator()(Origin const& o) const noexcept {
+    std::size_t h = std::hash<std::string>{}(o.scheme);
+    h ^= std::hash<std::string>{}(o.host) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    h ^= std::hash<std::uint16_t>{}(o.port) + 0x9e3779b9 + (h << 6) + (h >> 2);
+    if (!o.socket_path.empty()) {
+      h ^= std::hash<std::string>{}(o.socket_path) + 0x9e3779b9 + (h << 6) +
+           (h >> 2);
+    }
+    return h;
+  }
+};
+
+inline bool is_https(Origin const& o) noexcept { return o.scheme == "https"; }
+inline bool is_unix(Origin const& o) noexcept { return !o.socket_path.empty(); }
+
+// ------------------------------------
+// Origin interning
+// ------------------------------------
+// Dense process-wide id for an Origin (0, 1, 2, ...). Ids are never reused,
+// so callers can cache them and tag metrics with them. The table keeps one
+// Origin per distinct origin ever seen; per-pool state keyed by the id is
+// dropped once the origin goes unused (see ConnectionPool's reaper).
+using OriginId = std::uint32_t;
+inline constexpr OriginId kNoOriginId = static_cast<OriginId>(-1);
+
+class OriginTable {
+ public:
+  static OriginTable& global() {
+    static OriginTable table;
+    return table;
+  }
+
+  // Id for `o`; the first call for an origin assigns the next id. Callers on
+  // a hot path should intern once and keep the id.
+  OriginId intern(Origin const& o) {
+    {
+      std::shared_lock lk(mu_);
+      auto it = ids_.find(o);
+      if (it != ids_.end()) return it->second;
+    }
+    std::unique_lock lk(mu_);
+    auto [it, inserted] =
+        ids_.try_emplace(o, static_cast<OriginId>(origins_.size()));
+    if (inserted) origins_.push_back(&it->first);
+    return it->second;
+  }
+
+  // Entries are never erased, so the reference stays valid.
+  Origin const& get(OriginId id) const {
+    std::shared_lock lk(mu_);
+    return *origins_.at(id);
+  }
+
+  std::size_t size() const {
+    std::shared_lock lk(mu_);
+    return origins_.size();
+  }
+
+ private:
+  mutable std::shared_mutex mu_;
+  // Node-based: key addresses survive rehashing.
+  std::unordered_map<Origin, OriginId, OriginHash> ids_;
+  std::vector<Origin const*> origins_;
+};
+
+// Id of scheme://host:port, or kNoOriginId when `port` is not a port number.
+// Interns, so callers should keep the result.
+inline OriginId intern_origin(std::string_view scheme, std::string_view host,
+                              std::string_view port) {
+  std::uint16_t number = 0;
+  auto [end, ec] =
+      std::from_chars(port.data(), port.data() + port.size(), number);
+  if (ec != std::errc{} || end != port.data() + port.size()) {
+    return kNoOriginId;
+  }
+  return OriginTable::global().intern(
+      Origin{std::string(scheme), std::string(host), number});
+}
+
+// Id of an HTTP proxy hop (plain TCP to host:port).
+inline OriginId intern_proxy_origin(std::string_view host,
+                                    std::string_view port) {
+  return intern_origin("http", host, port);
+}
+
+}  // namespace beast_pool
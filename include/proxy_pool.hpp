@@ -12,12 +12,15 @@
 #include <chrono>
 #include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <string>
 #include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
 #include "http_client_config_provider.hpp"
+#include "origin_table.hpp"
 namespace logging = boost::log;
 namespace trivial = logging::trivial;
 namespace logsrc = logging::sources;
@@ -158,4 +161,58 @@ class ProxyPool {
     return cfg.get_proxy_pool();
   }
 };
+
+// Pool origin id of each proxy hop (host:port) seen so far, so pooled
+// requests through a proxy intern it once. Lookups do not allocate.
+class ProxyOriginCache {
+ public:
+  // kNoOriginId when the proxy's port is not a port number.
+  beast_pool::OriginId get(const cjj365::ProxySetting& proxy) const {
+    const View view{proxy.host, proxy.port};
+    {
+      std::shared_lock lk(mu_);
+      auto it = ids_.find(view);
+      if (it != ids_.end()) return it->second;
+    }
+    const auto id = beast_pool::intern_proxy_origin(proxy.host, proxy.port);
+    std::unique_lock lk(mu_);
+    ids_.try_emplace(Key{proxy.host, proxy.port}, id);
+    return id;
+  }
+
+ private:
+  struct Key {
+    std::string host;
+    std::string port;
+  };
+  struct View {
+    std::string_view host;
+    std::string_view port;
+  };
+  static View view_of(const Key& k) noexcept { return {k.host, k.port}; }
+  static View view_of(View v) noexcept { return v; }
+
+  struct Hash {
+    using is_transparent = void;
+    template <class K>
+    std::size_t operator()(const K& k) const noexcept {
+      const View v = view_of(k);
+      std::size_t h = std::hash<std::string_view>{}(v.host);
+      h ^= std::hash<std::string_view>{}(v.port) + 0x9e3779b9 + (h << 6) +
+           (h >> 2);
+      return h;
+    }
+  };
+  struct Eq {
+    using is_transparent = void;
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const noexcept {
+      const View x = view_of(a), y = view_of(b);
+      return x.host == y.host && x.port == y.port;
+    }
+  };
+
+  mutable std::shared_mutex mu_;
+  mutable std::unordered_map<Key, beast_pool::OriginId, Hash, Eq> ids_;
+};
 }  // namespace client_async
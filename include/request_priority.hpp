@@ -0,0 +1,123 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <utility>
+
+namespace client_async {
+
+// Scheduling class of a request when pooled connections are scarce.
+enum class RequestPriority : std::uint8_t {
+  interactive = 0,  // user-facing calls; lowest queueing latency
+  normal = 1,
+  bulk = 2,  // crawls and batch jobs; take whatever capacity is left
+};
+
+inline constexpr std::size_t kRequestPriorityCount = 3;
+
+using PriorityWeights = std::array<std::uint32_t, kRequestPriorityCount>;
+
+// Waiters served by weighted fair queueing across priority classes.
+//
+// Each class advances a virtual "pass" by 1/weight per item served, and the
+// non-empty class whose next item would finish first in virtual time goes
+// next (stride scheduling), so under sustained load classes are served in
+// proportion to their weights. A class that was idle re-enters at the
+// current virtual time instead of cashing in credit it banked while empty.
+//
+// Starvation guard: a waiter older than `max_wait` is served before anything
+// else, oldest first, whatever its weight.
+//
+// Not thread-safe; the owner serialises access (the pool uses its strand).
+template <class T>
+class WeightedFairQueue {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  explicit WeightedFairQueue(PriorityWeights weights = {16, 4, 1},
+                             std::chrono::milliseconds max_wait =
+                                 std::chrono::milliseconds(2000))
+      : max_wait_(max_wait) {
+    for (std::size_t i = 0; i < kRequestPriorityCount; ++i) {
+      // A zero weight would never be served by weight; treat it as 1.
+      stride_[i] = kStrideScale / (weights[i] == 0 ? 1 : weights[i]);
+    }
+  }
+
+  bool empty() const { return size_ == 0; }
+  std::size_t size() const { return size_; }
+  std::size_t size(RequestPriority p) const {
+    return queues_[index(p)].size();
+  }
+
+  void push(RequestPriority p, T item, clock::time_point now = clock::now()) {
+    const std::size_t i = index(p);
+    if (queues_[i].empty() && pass_[i] < vtime_) pass_[i] = vtime_;
+    queues_[i].push_back(Entry{std::move(item), now});
+    ++size_;
+  }
+
+  // Requires !empty().
+  T pop(clock::time_point now = clock::now()) {
+    const std::size_t i = pick(now);
+    auto& q = queues_[i];
+    T item = std::move(q.front().item);
+    q.pop_front();
+    --size_;
+    vtime_ = pass_[i];
+    pass_[i] += stride_[i];
+    return item;
+  }
+
+ private:
+  static constexpr std::uint64_t kStrideScale = 1u << 20;
+
+  struct Entry {
+    T item;
+    clock::time_point enqueued;
+  };
+
+  static std::size_t index(RequestPriority p) {
+    const auto i = static_cast<std::size_t>(p);
+    return i < kRequestPriorityCount ? i : kRequestPriorityCount - 1;
+  }
+
+  std::size_t pick(clock::time_point now) const {
+    std::size_t best = kRequestPriorityCount;
+    // Starving waiters first, oldest first.
+    for (std::size_t i = 0; i < kRequestPriorityCount; ++i) {
+      if (queues_[i].empty()) continue;
+      const auto t = queues_[i].front().enqueued;
+      if (now - t < max_wait_) continue;
+      if (best == kRequestPriorityCount ||
+          t < queues_[best].front().enqueued) {
+        best = i;
+      }
+    }
+    if (best != kRequestPriorityCount) return best;
+    // Smallest virtual finish time; ties go to the higher priority class.
+    std::uint64_t best_finish = std::numeric_limits<std::uint64_t>::max();
+    for (std::size_t i = 0; i < kRequestPriorityCount; ++i) {
+      if (queues_[i].empty()) continue;
+      const std::uint64_t finish = pass_[i] + stride_[i];
+      if (finish < best_finish) {
+        best = i;
+        best_finish = finish;
+      }
+    }
+    return best;
+  }
+
+  std::array<std::deque<Entry>, kRequestPriorityCount> queues_;
+  std::array<std::uint64_t, kRequestPriorityCount> stride_{};
+  std::array<std::uint64_t, kRequestPriorityCount> pass_{};
+  std::uint64_t vtime_ = 0;
+  std::size_t size_ = 0;
+  std::chrono::milliseconds max_wait_;
+};
+
+}  // namespace client_async
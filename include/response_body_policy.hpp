@@ -0,0 +1,265 @@
+#pragma once
+
+#include <atomic>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/optional.hpp>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <type_traits>
+#include <utility>
+
+namespace client_async {
+
+// Per-exchange limits for buffering a response body.
+// - max_body_bytes: hard cap enforced by the parser (`body_limit`). When unset
+//   each session keeps its historical default (see default_body_limit).
+// - spill_threshold / spill_dir: only used by `spill_body`; once the body
+//   grows beyond the threshold it is moved to a temp file under spill_dir.
+// string_body already reserves from Content-Length inside Beast, so the policy
+// only needs to bound how far that reservation may go.
+struct ResponseBodyPolicy {
+  std::optional<std::uint64_t> max_body_bytes = std::nullopt;
+  std::uint64_t spill_threshold = static_cast<std::uint64_t>(1024) * 1024;
+  std::filesystem::path spill_dir{};
+};
+
+// Buffers the response in memory up to a threshold, then switches to a temp
+// file. `view()` always returns one contiguous view; a spilled body is memory
+// mapped lazily on first access. The temp file is removed on destruction
+// unless `release_file()` took ownership of it.
+struct spill_body {
+  class value_type {
+   public:
+    value_type() = default;
+    value_type(const value_type&) = delete;
+    value_type& operator=(const value_type&) = delete;
+
+    value_type(value_type&& other) noexcept { move_from(std::move(other)); }
+    value_type& operator=(value_type&& other) noexcept {
+      if (this != &other) {
+        discard();
+        move_from(std::move(other));
+      }
+      return *this;
+    }
+
+    ~value_type() { discard(); }
+
+    void set_spill_options(std::uint64_t threshold,
+                           std::filesystem::path dir = {}) {
+      threshold_ = threshold;
+      dir_ = std::move(dir);
+    }
+    void set_spill_options(const ResponseBodyPolicy& policy) {
+      set_spill_options(policy.spill_threshold, policy.spill_dir);
+    }
+
+    std::uint64_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    bool spilled() const noexcept { return !path_.empty(); }
+    const std::filesystem::path& path() const noexcept { return path_; }
+
+    // Contiguous view of the whole body. For spilled bodies the file is
+    // mapped read-only; the view stays valid while this object lives.
+    std::string_view view() const {
+      if (!spilled()) return std::string_view(mem_);
+      if (size_ == 0) return {};
+      if (!mapping_) {
+        auto m = std::make_unique<Mapping>();
+        m->file = boost::interprocess::file_mapping(
+            path_.string().c_str(), boost::interprocess::read_only);
+        m->region = boost::interprocess::mapped_region(
+            m->file, boost::interprocess::read_only, 0,
+            static_cast<std::size_t>(size_));
+        mapping_ = std::move(m);
+      }
+      return std::string_view(
+          static_cast<const char*>(mapping_->region.get_address()),
+          static_cast<std::size_t>(size_));
+    }
+
+    std::string str() const { return std::string(view()); }
+
+    // Hand the spilled file over to the caller (e.g. to rename it into
+    // place). Returns an empty path when the body is still in memory.
+    std::filesystem::path release_file() {
+      if (!spilled()) return {};
+      mapping_.reset();
+      auto out = std::move(path_);
+      path_.clear();
+      mem_.clear();
+      size_ = 0;
+      return out;
+    }
+
+   private:
+    friend struct spill_body;
+
+    struct Mapping {
+      boost::interprocess::file_mapping file;
+      boost::interprocess::mapped_region region;
+    };
+
+    void move_from(value_type&& other) noexcept {
+      mem_ = std::move(other.mem_);
+      file_ = std::move(other.file_);
+      path_ = std::move(other.path_);
+      dir_ = std::move(other.dir_);
+      mapping_ = std::move(other.mapping_);
+      size_ = other.size_;
+      threshold_ = other.threshold_;
+      other.path_.clear();
+      other.size_ = 0;
+    }
+
+    void discard() noexcept {
+      mapping_.reset();
+      boost::beast::error_code ec;
+      if (file_.is_open()) file_.close(ec);
+      if (!path_.empty()) {
+        std::error_code fec;
+        std::filesystem::remove(path_, fec);
+        path_.clear();
+      }
+      mem_.clear();
+      size_ = 0;
+    }
+
+    std::filesystem::path make_spill_path(std::error_code& fec) const {
+      static std::atomic<std::uint64_t> counter{0};
+      std::filesystem::path dir =
+          dir_.empty() ? std::filesystem::temp_directory_path(fec) : dir_;
+      if (fec) return {};
+      auto stamp = std::chrono::steady_clock::now().time_since_epoch().count();
+      return dir / ("httpclient-spill-" + std::to_string(stamp) + "-" +
+                    std::to_string(counter.fetch_add(1)) + ".body");
+    }
+
+    // Move the in-memory bytes to a fresh temp file.
+    void spill(boost::beast::error_code& ec) {
+      std::error_code fec;
+      auto p = make_spill_path(fec);
+      if (fec) {
+        ec = boost::beast::error_code(fec.value(), boost::system::generic_category());
+        return;
+      }
+      file_.open(p.string().c_str(), boost::beast::file_mode::write_new, ec);
+      if (ec) return;
+      path_ = std::move(p);
+      if (!mem_.empty()) {
+        file_.write(mem_.data(), mem_.size(), ec);
+        if (ec) return;
+      }
+      std::string{}.swap(mem_);
+    }
+
+    std::string mem_;
+    boost::beast::file file_;
+    std::filesystem::path path_;
+    std::filesystem::path dir_;
+    mutable std::unique_ptr<Mapping> mapping_;
+    std::uint64_t size_ = 0;
+    std::uint64_t threshold_ = static_cast<std::uint64_t>(1024) * 1024;
+  };
+
+  static std::uint64_t size(const value_type& body) { return body.size(); }
+
+  class reader {
+    value_type& body_;
+
+   public:
+    template <bool isRequest, class Fields>
+    explicit reader(boost::beast::http::header<isRequest, Fields>&,
+                    value_type& b)
+        : body_(b) {}
+
+    void init(const boost::optional<std::uint64_t>& length,
+              boost::beast::error_code& ec) {
+      ec = {};
+      if (!length) return;
+      // Known size: go straight to disk when it can never fit the threshold,
+      // otherwise reserve once instead of growing the buffer repeatedly.
+      if (*length > body_.threshold_) {
+        body_.spill(ec);
+      } else {
+        body_.mem_.reserve(static_cast<std::size_t>(*length));
+      }
+    }
+
+    template <class ConstBufferSequence>
+    std::size_t put(const ConstBufferSequence& buffers,
+                    boost::beast::error_code& ec) {
+      ec = {};
+      auto const extra = boost::beast::buffer_bytes(buffers);
+      if (!body_.spilled() && body_.size_ + extra > body_.threshold_) {
+        body_.spill(ec);
+        if (ec) return 0;
+      }
+      for (auto b : boost::beast::buffers_range_ref(buffers)) {
+        if (body_.spilled()) {
+          body_.file_.write(b.data(), b.size(), ec);
+          if (ec) return 0;
+        } else {
+          body_.mem_.append(static_cast<const char*>(b.data()), b.size());
+        }
+      }
+      body_.size_ += extra;
+      return extra;
+    }
+
+    void finish(boost::beast::error_code& ec) {
+      ec = {};
+      if (body_.file_.is_open()) body_.file_.close(ec);
+    }
+  };
+
+  class writer {
+    const value_type& body_;
+
+   public:
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool isRequest, class Fields>
+    explicit writer(const boost::beast::http::header<isRequest, Fields>&,
+                    const value_type& b)
+        : body_(b) {}
+
+    void init(boost::beast::error_code& ec) { ec = {}; }
+
+    boost::optional<std::pair<const_buffers_type, bool>> get(
+        boost::beast::error_code& ec) {
+      ec = {};
+      auto v = body_.view();
+      return {{const_buffers_type{v.data(), v.size()}, false}};
+    }
+  };
+};
+
+// Historical per-body defaults used when the policy leaves the cap unset.
+template <class Body>
+std::uint64_t default_body_limit() {
+  namespace http = boost::beast::http;
+  if constexpr (std::is_same_v<Body, http::file_body>) {
+    return static_cast<std::uint64_t>(1024) * 1024 * 1024 * 10;
+  } else if constexpr (std::is_same_v<Body, spill_body>) {
+    return static_cast<std::uint64_t>(1024) * 1024 * 1024;
+  } else {
+    return static_cast<std::uint64_t>(1024) * 1024 * 4;
+  }
+}
+
+template <class Body>
+std::uint64_t effective_body_limit(const ResponseBodyPolicy& policy) {
+  return policy.max_body_bytes.value_or(default_body_limit<Body>());
+}
+
+}  // namespace client_async
@@ -0,0 +1,440 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/error.hpp>
+#include <boost/asio/post.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "origin_table.hpp"
+
+namespace client_async {
+
+// Process-wide byte budget for response bodies buffered in memory.
+//
+// Sessions reserve budget ahead of each body read and give it back once the
+// response is handed to the caller. When the budget is exhausted the read is
+// parked (the socket is simply not read, so TCP applies backpressure) until
+// another response releases bytes. Parked readers are woken round-robin per
+// origin (an interned beast_pool::OriginId) so a single busy host cannot
+// starve the others.
+//
+// capacity() == 0 (the default) means unlimited: reservations always succeed.
+// Sessions then skip the budget altogether (no lease, no lock), so the gauges
+// only count responses read while a capacity is set.
+class ResponseMemoryBudget {
+ public:
+  struct Stats {
+    std::uint64_t capacity = 0;
+    std::uint64_t reserved_bytes = 0;
+    std::uint64_t peak_reserved_bytes = 0;
+    std::size_t waiting = 0;
+    std::uint64_t waits_total = 0;
+    std::uint64_t wait_timeouts_total = 0;
+  };
+
+  using grant_fn = std::function<void(bool granted)>;
+
+  ResponseMemoryBudget() = default;
+  explicit ResponseMemoryBudget(std::uint64_t capacity)
+      : capacity_(capacity) {}
+  ResponseMemoryBudget(const ResponseMemoryBudget&) = delete;
+  ResponseMemoryBudget& operator=(const ResponseMemoryBudget&) = delete;
+
+  static ResponseMemoryBudget& global() {
+    static ResponseMemoryBudget instance;
+    return instance;
+  }
+
+  void set_capacity(std::uint64_t bytes) {
+    std::vector<Waiter> ready;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      capacity_ = bytes;
+      drain_locked(ready);
+    }
+    dispatch(ready);
+  }
+
+  // Lock-free, so readers can check for an unlimited budget on every
+  // request.
+  std::uint64_t capacity() const {
+    return capacity_.load(std::memory_order_relaxed);
+  }
+
+  // Reserve immediately or fail. Fails while other readers are parked so a
+  // newcomer cannot overtake them.
+  bool try_reserve(beast_pool::OriginId origin, std::uint64_t bytes) {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (!ring_.empty() || !fits_locked(bytes)) return false;
+    grant_locked(origin, bytes);
+    return true;
+  }
+
+  // Reserve `bytes` for `origin`; `fn(true)` is posted to `ex` once granted.
+  // `held` is what the caller already owns while it waits; it lets the budget
+  // notice when every reserved byte belongs to parked readers and nobody is
+  // left to release anything. Returns a waiter id usable with cancel(), or 0
+  // if granted immediately.
+  template <class Executor>
+  std::uint64_t async_reserve(const Executor& ex, beast_pool::OriginId origin,
+                              std::uint64_t bytes, grant_fn fn,
+                              std::uint64_t held = 0) {
+    std::vector<Waiter> ready;
+    std::uint64_t id = 0;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (ring_.empty() && fits_locked(bytes)) {
+        grant_locked(origin, bytes);
+      } else {
+        auto& entry = origins_[origin];
+        if (entry.waiters.empty()) ring_.push_back(origin);
+        id = ++next_waiter_id_;
+        entry.waiters.push_back(Waiter{id, origin, bytes, held,
+                                       boost::asio::any_io_executor(ex),
+                                       std::move(fn)});
+        parked_held_ += held;
+        ++waiting_;
+        ++waits_total_;
+        drain_locked(ready);
+      }
+    }
+    if (id == 0) {
+      boost::asio::post(ex, [fn = std::move(fn)]() { fn(true); });
+    }
+    dispatch(ready);
+    return id;
+  }
+
+  // Withdraw a parked request; its handler is posted with `false`.
+  // Returns false if the waiter was already granted.
+  bool cancel(std::uint64_t waiter_id, bool timed_out = true) {
+    Waiter w;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (!take_waiter_locked(waiter_id, w)) return false;
+      if (timed_out) ++wait_timeouts_total_;
+    }
+    boost::asio::post(w.ex, [fn = std::move(w.fn)]() { fn(false); });
+    return true;
+  }
+
+  void release(beast_pool::OriginId origin, std::uint64_t bytes) {
+    if (bytes == 0) return;
+    std::vector<Waiter> ready;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      reserved_ -= std::min(bytes, reserved_);
+      auto it = origins_.find(origin);
+      if (it != origins_.end()) {
+        it->second.reserved -= std::min(bytes, it->second.reserved);
+        if (it->second.reserved == 0 && it->second.waiters.empty()) {
+          origins_.erase(it);
+        }
+      }
+      drain_locked(ready);
+    }
+    dispatch(ready);
+  }
+
+  // ----- gauges -----
+  std::uint64_t reserved_bytes() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return reserved_;
+  }
+  std::uint64_t origin_reserved_bytes(beast_pool::OriginId origin) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = origins_.find(origin);
+    return it == origins_.end() ? 0 : it->second.reserved;
+  }
+  Stats stats() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return Stats{capacity_.load(), reserved_,    peak_,
+                 waiting_,         waits_total_, wait_timeouts_total_};
+  }
+  void reset_peak() {
+    std::lock_guard<std::mutex> lk(mu_);
+    peak_ = reserved_;
+  }
+
+ private:
+  struct Waiter {
+    std::uint64_t id = 0;
+    beast_pool::OriginId origin = beast_pool::kNoOriginId;
+    std::uint64_t bytes = 0;
+    std::uint64_t held = 0;
+    boost::asio::any_io_executor ex;
+    grant_fn fn;
+  };
+  struct OriginEntry {
+    std::uint64_t reserved = 0;
+    std::deque<Waiter> waiters;
+  };
+
+  // A request larger than the whole budget is admitted alone rather than
+  // never; the parser body_limit still bounds it.
+  bool fits_locked(std::uint64_t bytes) const {
+    const auto capacity = capacity_.load(std::memory_order_relaxed);
+    return capacity == 0 || reserved_ == 0 || reserved_ + bytes <= capacity;
+  }
+
+  void grant_locked(beast_pool::OriginId origin, std::uint64_t bytes) {
+    reserved_ += bytes;
+    peak_ = std::max(peak_, reserved_);
+    origins_[origin].reserved += bytes;
+  }
+
+  // Grant parked waiters in origin round-robin order while they fit. Stops
+  // at the first waiter that does not fit so large requests are not starved.
+  void drain_locked(std::vector<Waiter>& ready) {
+    while (!ring_.empty()) {
+      auto it = origins_.find(ring_.front());
+      if (it == origins_.end() || it->second.waiters.empty()) {
+        ring_.pop_front();
+        continue;
+      }
+      auto& w = it->second.waiters.front();
+      if (!fits_locked(w.bytes)) {
+        // When only parked readers hold budget nothing will ever be
+        // released. Overcommit for the reader holding the most so it can
+        // finish and free its share, instead of deadlocking.
+        if (reserved_ > parked_held_) break;
+        Waiter top;
+        take_waiter_locked(largest_holder_locked(), top);
+        grant_locked(top.origin, top.bytes);
+        ready.push_back(std::move(top));
+        continue;
+      }
+      grant_locked(w.origin, w.bytes);
+      parked_held_ -= w.held;
+      ready.push_back(std::move(w));
+      it->second.waiters.pop_front();
+      --waiting_;
+      const auto origin = ring_.front();
+      ring_.pop_front();
+      if (!it->second.waiters.empty()) ring_.push_back(origin);
+    }
+  }
+
+  std::uint64_t largest_holder_locked() const {
+    std::uint64_t id = 0;
+    std::uint64_t most = 0;
+    for (const auto& [origin, entry] : origins_) {
+      for (const auto& w : entry.waiters) {
+        if (id == 0 || w.held > most) {
+          id = w.id;
+          most = w.held;
+        }
+      }
+    }
+    return id;
+  }
+
+  bool take_waiter_locked(std::uint64_t id, Waiter& out) {
+    for (auto& [origin, entry] : origins_) {
+      auto& q = entry.waiters;
+      for (auto it = q.begin(); it != q.end(); ++it) {
+        if (it->id != id) continue;
+        out = std::move(*it);
+        q.erase(it);
+        parked_held_ -= out.held;
+        --waiting_;
+        if (q.empty()) {
+          ring_.erase(std::remove(ring_.begin(), ring_.end(), origin),
+                      ring_.end());
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  static void dispatch(std::vector<Waiter>& ready) {
+    for (auto& w : ready) {
+      boost::asio::post(w.ex, [fn = std::move(w.fn)]() { fn(true); });
+    }
+  }
+
+  mutable std::mutex mu_;
+  std::atomic<std::uint64_t> capacity_{0};  // written under mu_
+  std::uint64_t reserved_ = 0;
+  std::uint64_t peak_ = 0;
+  std::uint64_t parked_held_ = 0;
+  std::size_t waiting_ = 0;
+  std::uint64_t waits_total_ = 0;
+  std::uint64_t wait_timeouts_total_ = 0;
+  std::uint64_t next_waiter_id_ = 0;
+  std::unordered_map<beast_pool::OriginId, OriginEntry> origins_;
+  std::deque<beast_pool::OriginId> ring_;
+};
+
+// Bytes held by one response. Grows as the body arrives and gives everything
+// back on reset() or destruction.
+class BudgetLease {
+ public:
+  BudgetLease() = default;
+  BudgetLease(ResponseMemoryBudget& budget, beast_pool::OriginId origin)
+      : budget_(&budget), origin_(origin) {}
+  BudgetLease(const BudgetLease&) = delete;
+  BudgetLease& operator=(const BudgetLease&) = delete;
+  ~BudgetLease() { reset(); }
+
+  bool active() const { return budget_ != nullptr; }
+  // False when there is no budget to hold or it is unlimited.
+  bool limited() const { return budget_ && budget_->capacity() != 0; }
+  std::uint64_t bytes() const { return bytes_; }
+
+  void reset() {
+    if (budget_ && bytes_ > 0) budget_->release(origin_, bytes_);
+    bytes_ = 0;
+  }
+
+  // Make sure at least `target` bytes are held, waiting up to `wait_timeout`
+  // for budget to free up. `fn(true)` runs on `ex` once the lease covers the
+  // target, `fn(false)` on timeout.
+  template <class Executor>
+  void async_grow_to(const Executor& ex, std::uint64_t target,
+                     std::chrono::steady_clock::duration wait_timeout,
+                     std::function<void(bool)> fn) {
+    if (!budget_ || target <= bytes_) {
+      return boost::asio::post(ex, [fn = std::move(fn)]() { fn(true); });
+    }
+    const std::uint64_t delta = target - bytes_;
+    if (budget_->try_reserve(origin_, delta)) {
+      bytes_ = target;
+      return boost::asio::post(ex, [fn = std::move(fn)]() { fn(true); });
+    }
+    // Arm the wait timer before parking so a grant from another thread can
+    // always cancel it.
+    auto timer = std::make_shared<boost::asio::steady_timer>(ex);
+    auto waiter_id = std::make_shared<std::atomic<std::uint64_t>>(0);
+    timer->expires_after(wait_timeout);
+    timer->async_wait(
+        [budget = budget_, waiter_id](const boost::system::error_code& ec) {
+          if (!ec && waiter_id->load() != 0) budget->cancel(waiter_id->load());
+        });
+    waiter_id->store(budget_->async_reserve(
+        ex, origin_, delta,
+        [this, target, delta, timer, fn = std::move(fn)](bool granted) {
+          timer->cancel();
+          if (granted) bytes_ += delta;
+          fn(granted && bytes_ >= target);
+        },
+        bytes_));
+  }
+
+ private:
+  ResponseMemoryBudget* budget_ = nullptr;
+  beast_pool::OriginId origin_ = beast_pool::kNoOriginId;
+  std::uint64_t bytes_ = 0;
+};
+
+// Read size used by http::async_read_some for a single step.
+inline constexpr std::uint64_t kBudgetReadStep = 65536;
+
+// Bytes the lease should hold before the next read_some on `parser`. The
+// header is read unbudgeted (the parser's header limit bounds it). With a
+// known Content-Length the whole body is then admitted at once, bounded by
+// the body limit; otherwise budget is taken one read step at a time.
+template <class Parser>
+std::uint64_t budget_read_target(const Parser& parser,
+                                 std::uint64_t buffered,
+                                 std::uint64_t body_limit) {
+  if (!parser.is_header_done()) return 0;
+  if (auto len = parser.content_length()) {
+    return std::min<std::uint64_t>(*len, body_limit);
+  }
+  const std::uint64_t have = parser.get().body().size();
+  return std::min<std::uint64_t>(have + buffered + kBudgetReadStep,
+                                 std::max(body_limit, have));
+}
+
+// Read a full message like http::async_read, but reserve budget on `lease`
+// before every read step. Completes with asio::error::no_buffer_space when
+// budget did not become available within `wait_timeout`. The stream's
+// timeout is left alone, so a deadline set before the call covers the whole
+// response, budget waits included.
+template <class Stream, class DynamicBuffer, class Parser, class Handler>
+class budgeted_read_op
+    : public std::enable_shared_from_this<
+          budgeted_read_op<Stream, DynamicBuffer, Parser, Handler>> {
+ public:
+  budgeted_read_op(Stream& stream, DynamicBuffer& buffer, Parser& parser,
+                   BudgetLease& lease, std::uint64_t body_limit,
+                   std::chrono::steady_clock::duration wait_timeout,
+                   Handler handler)
+      : stream_(stream),
+        buffer_(buffer),
+        parser_(parser),
+        lease_(lease),
+        body_limit_(body_limit),
+        wait_timeout_(wait_timeout),
+        handler_(std::move(handler)) {}
+
+  void step() {
+    if (parser_.is_done()) return handler_(boost::beast::error_code{});
+    const std::uint64_t want =
+        budget_read_target(parser_, buffer_.size(), body_limit_);
+    if (want <= lease_.bytes()) return read();
+    lease_.async_grow_to(
+        stream_.get_executor(), want, wait_timeout_,
+        [self = this->shared_from_this()](bool ok) {
+          if (!ok) {
+            return self->handler_(boost::beast::error_code(
+                boost::asio::error::no_buffer_space));
+          }
+          self->read();
+        });
+  }
+
+ private:
+  void read() {
+    boost::beast::http::async_read_some(
+        stream_, buffer_, parser_,
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t) {
+          if (ec) return self->handler_(ec);
+          self->step();
+        });
+  }
+
+  Stream& stream_;
+  DynamicBuffer& buffer_;
+  Parser& parser_;
+  BudgetLease& lease_;
+  std::uint64_t body_limit_;
+  std::chrono::steady_clock::duration wait_timeout_;
+  Handler handler_;
+};
+
+// Without a limited budget (`lease` null or unlimited) this is a plain
+// http::async_read: no lease, no lock taken per step.
+template <class Stream, class DynamicBuffer, class Parser, class Handler>
+void async_read_budgeted(Stream& stream, DynamicBuffer& buffer, Parser& parser,
+                         BudgetLease* lease, std::uint64_t body_limit,
+                         std::chrono::steady_clock::duration wait_timeout,
+                         Handler handler) {
+  if (!lease || !lease->limited()) {
+    return boost::beast::http::async_read(
+        stream, buffer, parser,
+        [handler = std::move(handler)](boost::beast::error_code ec,
+                                       std::size_t) mutable { handler(ec); });
+  }
+  using op_t = budgeted_read_op<Stream, DynamicBuffer, Parser, Handler>;
+  std::make_shared<op_t>(stream, buffer, parser, *lease, body_limit,
+                         wait_timeout, std::move(handler))
+      ->step();
+}
+
+}  // namespace client_async
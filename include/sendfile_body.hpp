@@ -0,0 +1,352 @@
+#pragma once
+
+#include <openssl/bio.h>
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/opensslv.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl/stream.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+
+#if defined(__linux__)
+#include <cerrno>
+#include <sys/sendfile.h>
+#endif
+
+// Zero-copy uploads are only attempted where the kernel can move file pages
+// straight to the socket: Linux sendfile(2) for plain TCP, and SSL_sendfile
+// for TLS sockets that have kernel TLS enabled on the send side.
+#if defined(__linux__)
+#define HTTPCLIENT_HAS_SENDFILE 1
+#else
+#define HTTPCLIENT_HAS_SENDFILE 0
+#endif
+#if HTTPCLIENT_HAS_SENDFILE && OPENSSL_VERSION_NUMBER >= 0x30000000L && \
+    !defined(OPENSSL_NO_KTLS)
+#define HTTPCLIENT_HAS_KTLS_SENDFILE 1
+#else
+#define HTTPCLIENT_HAS_KTLS_SENDFILE 0
+#endif
+
+namespace client_async {
+
+// Process-wide counters so callers can see which path uploads actually took.
+struct SendfileCounters {
+  std::atomic<std::uint64_t> zero_copy_bytes{0};
+  std::atomic<std::uint64_t> fallback_bytes{0};
+};
+
+inline SendfileCounters& sendfile_counters() {
+  static SendfileCounters counters;
+  return counters;
+}
+
+// Request body that uploads a byte range of a file. With plain
+// http::async_write it behaves like http::file_body (buffered reads); use
+// async_write_sendfile() to let the kernel send the range without copying it
+// through userspace when the transport allows it.
+struct sendfile_body {
+  class value_type {
+   public:
+    value_type() = default;
+
+    // Upload the whole file.
+    void open(const char* path, boost::beast::error_code& ec) {
+      file_.open(path, boost::beast::file_mode::scan, ec);
+      if (ec) return;
+      const auto size = file_.size(ec);
+      if (ec) return;
+      offset_ = 0;
+      length_ = size;
+    }
+
+    // Upload `length` bytes starting at `offset` of an already open file.
+    void reset(boost::beast::file&& file, std::uint64_t offset,
+               std::uint64_t length, boost::beast::error_code& ec) {
+      file_ = std::move(file);
+      const auto size = file_.size(ec);
+      if (ec) return;
+      if (offset > size || length > size - offset) {
+        ec = boost::beast::http::error::buffer_overflow;
+        return;
+      }
+      offset_ = offset;
+      length_ = length;
+    }
+
+    bool is_open() const { return file_.is_open(); }
+    std::uint64_t offset() const noexcept { return offset_; }
+    std::uint64_t size() const noexcept { return length_; }
+    boost::beast::file& file() noexcept { return file_; }
+
+   private:
+    boost::beast::file file_;
+    std::uint64_t offset_ = 0;
+    std::uint64_t length_ = 0;
+  };
+
+  static std::uint64_t size(const value_type& body) { return body.size(); }
+
+  // Fallback path: read the range into a small buffer, one chunk at a time.
+  class writer {
+    value_type& body_;
+    std::uint64_t remain_ = 0;
+    char buf_[16 * 1024];
+
+   public:
+    using const_buffers_type = boost::asio::const_buffer;
+
+    template <bool isRequest, class Fields>
+    writer(boost::beast::http::header<isRequest, Fields>&, value_type& b)
+        : body_(b) {}
+
+    void init(boost::beast::error_code& ec) {
+      remain_ = body_.size();
+      body_.file().seek(body_.offset(), ec);
+    }
+
+    boost::optional<std::pair<const_buffers_type, bool>> get(
+        boost::beast::error_code& ec) {
+      const auto want = static_cast<std::size_t>(
+          std::min<std::uint64_t>(sizeof(buf_), remain_));
+      if (want == 0) {
+        ec = {};
+        return boost::none;
+      }
+      const auto n = body_.file().read(buf_, want, ec);
+      if (ec) return boost::none;
+      if (n == 0) {
+        ec = boost::beast::http::error::short_read;
+        return boost::none;
+      }
+      remain_ -= n;
+      sendfile_counters().fallback_bytes.fetch_add(n,
+                                                   std::memory_order_relaxed);
+      return {{const_buffers_type{buf_, n}, remain_ > 0}};
+    }
+  };
+};
+
+namespace sendfile_detail {
+
+// Transport hooks: which socket (and TLS handle) a stream exposes for the
+// zero-copy path. Anything not listed here uses the buffered writer.
+inline boost::asio::ip::tcp::socket* tcp_socket(boost::beast::tcp_stream& s) {
+  return &s.socket();
+}
+inline boost::asio::ip::tcp::socket* tcp_socket(
+    boost::asio::ip::tcp::socket& s) {
+  return &s;
+}
+template <class Stream>
+boost::asio::ip::tcp::socket* tcp_socket(Stream&) {
+  return nullptr;
+}
+
+template <class Stream>
+SSL* ktls_handle(Stream&) {
+  return nullptr;
+}
+template <class Next>
+SSL* ktls_handle(boost::asio::ssl::stream<Next>& s) {
+#if HTTPCLIENT_HAS_KTLS_SENDFILE
+  SSL* ssl = s.native_handle();
+  if (ssl && BIO_get_ktls_send(SSL_get_wbio(ssl))) return ssl;
+#else
+  (void)s;
+#endif
+  return nullptr;
+}
+template <class Next>
+boost::asio::ip::tcp::socket* tcp_socket(boost::asio::ssl::stream<Next>& s) {
+  if (!ktls_handle(s)) return nullptr;
+  return tcp_socket(s.next_layer());
+}
+
+template <class Stream, class Fields, class Handler>
+class write_op
+    : public std::enable_shared_from_this<write_op<Stream, Fields, Handler>> {
+  using request_t = boost::beast::http::request<sendfile_body, Fields>;
+  using serializer_t =
+      boost::beast::http::request_serializer<sendfile_body, Fields>;
+
+ public:
+  write_op(Stream& stream, request_t& req,
+           std::chrono::steady_clock::duration timeout, Handler handler)
+      : stream_(stream),
+        req_(req),
+        owned_sr_(std::in_place, req),
+        sr_(*owned_sr_),
+        timer_(stream.get_executor()),
+        timeout_(timeout),
+        handler_(std::move(handler)) {}
+
+  // Continue with a caller-owned serializer, e.g. after the header was sent
+  // separately for `Expect: 100-continue`.
+  write_op(Stream& stream, serializer_t& sr,
+           std::chrono::steady_clock::duration timeout, Handler handler)
+      : stream_(stream),
+        req_(sr.get()),
+        sr_(sr),
+        timer_(stream.get_executor()),
+        timeout_(timeout),
+        handler_(std::move(handler)) {}
+
+  void start() {
+    auto* sock = tcp_socket(stream_);
+    // sendfile needs a known length; chunked uploads take the buffered path.
+    if (!HTTPCLIENT_HAS_SENDFILE || !sock || req_.chunked() ||
+        !req_.body().is_open()) {
+      return boost::beast::http::async_write(
+          stream_, sr_,
+          [self = this->shared_from_this()](boost::beast::error_code ec,
+                                            std::size_t n) {
+            self->handler_(ec, n);
+          });
+    }
+    if (sr_.is_header_done()) return start_body();
+    boost::beast::http::async_write_header(
+        stream_, sr_,
+        [self = this->shared_from_this()](boost::beast::error_code ec,
+                                          std::size_t n) {
+          self->header_bytes_ = n;
+          if (ec) return self->handler_(ec, n);
+          self->start_body();
+        });
+  }
+
+ private:
+  void start_body() {
+    offset_ = req_.body().offset();
+    remain_ = req_.body().size();
+    arm_timer();
+    send_some();
+  }
+
+ private:
+  void arm_timer() {
+    timer_.expires_after(timeout_);
+    timer_.async_wait([self = this->shared_from_this()](
+                          const boost::system::error_code& ec) {
+      if (ec) return;
+      self->timed_out_ = true;
+      boost::system::error_code ignored;
+      if (auto* sock = tcp_socket(self->stream_)) sock->cancel(ignored);
+    });
+  }
+
+  void complete(boost::beast::error_code ec) {
+    timer_.cancel();
+    if (timed_out_) ec = boost::beast::error::timeout;
+    handler_(ec, header_bytes_ + sent_);
+  }
+
+  void send_some() {
+#if HTTPCLIENT_HAS_SENDFILE
+    auto* sock = tcp_socket(stream_);
+    boost::system::error_code ec;
+    sock->native_non_blocking(true, ec);
+    if (ec) return complete(ec);
+    const int in_fd = req_.body().file().native_handle();
+    while (remain_ > 0) {
+      const auto chunk = static_cast<std::size_t>(
+          std::min<std::uint64_t>(remain_, std::uint64_t{1} << 30));
+      ssize_t n = -1;
+      int err = 0;
+#if HTTPCLIENT_HAS_KTLS_SENDFILE
+      if (SSL* ssl = ktls_handle(stream_)) {
+        n = SSL_sendfile(ssl, in_fd, static_cast<off_t>(offset_), chunk, 0);
+        if (n < 0) {
+          const int ssl_err = SSL_get_error(ssl, static_cast<int>(n));
+          err = ssl_err == SSL_ERROR_WANT_WRITE ? EAGAIN : EIO;
+          ERR_clear_error();
+        }
+      } else
+#endif
+      {
+        off_t off = static_cast<off_t>(offset_);
+        n = ::sendfile(sock->native_handle(), in_fd, &off, chunk);
+        if (n < 0) err = errno;
+      }
+      if (n < 0) {
+        if (err == EINTR) continue;
+        if (err == EAGAIN || err == EWOULDBLOCK) {
+          return sock->async_wait(
+              boost::asio::socket_base::wait_write,
+              [self = this->shared_from_this()](
+                  const boost::system::error_code& ec) {
+                if (ec) return self->complete(ec);
+                self->send_some();
+              });
+        }
+        return complete(
+            boost::system::error_code(err, boost::system::system_category()));
+      }
+      if (n == 0) {
+        // File shrank underneath us.
+        return complete(boost::beast::http::error::short_read);
+      }
+      offset_ += static_cast<std::uint64_t>(n);
+      remain_ -= static_cast<std::uint64_t>(n);
+      sent_ += static_cast<std::uint64_t>(n);
+      sendfile_counters().zero_copy_bytes.fetch_add(
+          static_cast<std::uint64_t>(n), std::memory_order_relaxed);
+    }
+#endif
+    complete({});
+  }
+
+  Stream& stream_;
+  request_t& req_;
+  std::optional<serializer_t> owned_sr_;
+  serializer_t& sr_;
+  boost::asio::steady_timer timer_;
+  std::chrono::steady_clock::duration timeout_;
+  Handler handler_;
+  std::size_t header_bytes_ = 0;
+  std::uint64_t offset_ = 0;
+  std::uint64_t remain_ = 0;
+  std::uint64_t sent_ = 0;
+  bool timed_out_ = false;
+};
+
+}  // namespace sendfile_detail
+
+// Write `req` to `stream`, sending the file range with sendfile(2) (or
+// SSL_sendfile under kTLS) when the stream is a plain TCP socket or a kTLS
+// socket, and through the buffered writer otherwise. `timeout` bounds the
+// zero-copy phase; the buffered path relies on the stream's own timeout.
+// The handler receives (error_code, bytes_written).
+template <class Stream, class Fields, class Handler>
+void async_write_sendfile(
+    Stream& stream, boost::beast::http::request<sendfile_body, Fields>& req,
+    std::chrono::steady_clock::duration timeout, Handler&& handler) {
+  using op_t =
+      sendfile_detail::write_op<Stream, Fields, std::decay_t<Handler>>;
+  std::make_shared<op_t>(stream, req, timeout, std::forward<Handler>(handler))
+      ->start();
+}
+
+// Same, for a request whose header already went out through `sr`.
+template <class Stream, class Fields, class Handler>
+void async_write_sendfile(
+    Stream& stream,
+    boost::beast::http::request_serializer<sendfile_body, Fields>& sr,
+    std::chrono::steady_clock::duration timeout, Handler&& handler) {
+  using op_t =
+      sendfile_detail::write_op<Stream, Fields, std::decay_t<Handler>>;
+  std::make_shared<op_t>(stream, sr, timeout, std::forward<Handler>(handler))
+      ->start();
+}
+
+}  // namespace client_async
@@ -0,0 +1,276 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/url.hpp>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "http_client_manager.hpp"
+#include "sse_parser.hpp"
+
+namespace client_async {
+
+struct SseOptions {
+  // Reconnection delay until the server sends `retry:`.
+  std::chrono::milliseconds reconnect_delay{3000};
+  // Consecutive failed connections double the delay up to this cap.
+  std::chrono::milliseconds max_reconnect_delay{60000};
+  // Reconnections before giving up; -1 retries forever.
+  int max_reconnects = -1;
+  // A stream silent for this long is dropped and reconnected. Servers
+  // usually send comment lines as heartbeats well within it.
+  std::chrono::seconds idle_timeout{300};
+  std::size_t max_event_bytes = 1024 * 1024;
+  // Resume after this event ID on the first connection.
+  std::string last_event_id;
+  std::vector<std::pair<std::string, std::string>> headers;
+  // Must outlive the client.
+  const cjj365::ProxySetting* proxy = nullptr;
+};
+
+// Server-Sent Events subscription over HttpClientManager's streaming
+// sessions. Events are parsed incrementally as chunks arrive (see
+// SseParser) and handed to callbacks. When the stream ends or fails the
+// client reconnects after the server's `retry:` interval, sending
+// Last-Event-ID so the server can replay what was missed.
+//
+// A response that is not `200 text/event-stream` stops the client, except
+// 429 and 5xx, which are retried. 204 stops it without an error, as the
+// spec asks.
+//
+// Set the callbacks before start(). They run on the client's strand (over
+// the manager's io threads), so they never overlap.
+class SseClient : public std::enable_shared_from_this<SseClient> {
+ public:
+  using EventHandler = std::function<void(const SseEvent&)>;
+  // `code`: the session's transport error code, the HTTP status of a
+  // rejected response (415 for a 200 that is not an event stream, 413 for
+  // an oversized event), or 0 after a 204.
+  using ErrorHandler = std::function<void(int code, bool will_retry)>;
+
+  static std::shared_ptr<SseClient> create(HttpClientManager& client,
+                                           const urls::url_view& url,
+                                           SseOptions options = {}) {
+    return std::shared_ptr<SseClient>(
+        new SseClient(client, url, std::move(options)));
+  }
+
+  // Every event, whatever its type.
+  void on_event(EventHandler handler) { on_event_ = std::move(handler); }
+  // Events whose `event:` field is `type` ("message" when absent).
+  void on(std::string type, EventHandler handler) {
+    typed_.insert_or_assign(std::move(type), std::move(handler));
+  }
+  // Each time a connection is accepted.
+  void on_open(std::function<void()> handler) {
+    on_open_ = std::move(handler);
+  }
+  // Each time a connection ends; once with `will_retry == false` at the end.
+  void on_error(ErrorHandler handler) { on_error_ = std::move(handler); }
+
+  void start() {
+    running_ = true;
+    asio::post(strand_, [self = shared_from_this()] { self->connect(); });
+  }
+
+  // Close the stream and stop reconnecting. Safe from any thread.
+  void stop() {
+    if (!running_.exchange(false)) return;
+    std::function<void()> cancel;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      cancel = std::move(cancel_);
+    }
+    if (cancel) cancel();
+    asio::post(strand_, [self = shared_from_this()] { self->timer_.cancel(); });
+  }
+
+  bool running() const { return running_; }
+
+  std::string last_event_id() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return last_event_id_;
+  }
+
+  int reconnects() const { return reconnects_; }
+
+ private:
+  SseClient(HttpClientManager& client, const urls::url_view& url,
+            SseOptions options)
+      : client_(client),
+        url_(url),
+        options_(std::move(options)),
+        parser_(options_.max_event_bytes),
+        strand_(asio::make_strand(client.ioc_ref())),
+        timer_(strand_) {
+    parser_.set_last_event_id(options_.last_event_id);
+    last_event_id_ = options_.last_event_id;
+  }
+
+  // Runs on strand_, like every handler below.
+  void connect() {
+    if (!running_) return;
+    http::request<http::empty_body> req{http::verb::get, "/", 11};
+    req.set(http::field::accept, "text/event-stream");
+    req.set(http::field::cache_control, "no-cache");
+    for (auto const& [name, value] : options_.headers) req.set(name, value);
+    parser_.reset();
+    if (!parser_.last_event_id().empty()) {
+      req.set("Last-Event-ID", parser_.last_event_id());
+    }
+    opened_ = false;
+    got_event_ = false;
+    retryable_ = false;
+    stop_code_.reset();
+
+    HttpClientRequestParams params;
+    params.follow_redirect = false;
+    params.accumulate_response_body = false;
+    params.io_timeout = options_.idle_timeout;
+
+    // The session calls back on its own strand; hop onto ours, in order,
+    // so handle_end's timer never races stop().
+    auto self = shared_from_this();
+    auto cancel = client_.http_request_stream<http::empty_body>(
+        url_, std::move(req),
+        [self](http::response<http::empty_body>&& header) {
+          asio::post(self->strand_, [self, header = std::move(header)] {
+            self->handle_headers(header);
+          });
+        },
+        [self](std::string&& chunk) {
+          asio::post(self->strand_, [self, chunk = std::move(chunk)] {
+            self->handle_chunk(chunk);
+          });
+        },
+        [self](std::optional<http::response<http::string_body>>&&, int ec) {
+          asio::post(self->strand_, [self, ec] { self->handle_end(ec); });
+        },
+        std::move(params), options_.proxy);
+    std::lock_guard<std::mutex> lk(mu_);
+    cancel_ = std::move(cancel);
+    if (!running_) cancel_();  // stop() raced with connect()
+  }
+
+  void handle_headers(const http::response<http::empty_body>& header) {
+    const int status = header.result_int();
+    const auto type = header[http::field::content_type];
+    const bool event_stream = type.starts_with("text/event-stream");
+    if (status == 200 && event_stream) {
+      opened_ = true;
+      if (on_open_) on_open_();
+      return;
+    }
+    // Retry overloaded or failing servers; anything else is final.
+    retryable_ = status == 429 || status >= 500;
+    stop_code_ = status == 204 ? 0 : (status == 200 ? 415 : status);
+    cancel_current();
+  }
+
+  void handle_chunk(const std::string& chunk) {
+    if (!opened_) return;
+    const bool ok = parser_.feed(chunk, [this](const SseEvent& ev) {
+      got_event_ = true;
+      dispatch(ev);
+    });
+    if (got_event_) {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (last_event_id_ != parser_.last_event_id()) {
+        last_event_id_ = parser_.last_event_id();
+      }
+    }
+    if (!ok) {
+      stop_code_ = 413;  // one event outgrew max_event_bytes
+      retryable_ = true;
+      cancel_current();
+    }
+  }
+
+  void dispatch(const SseEvent& ev) {
+    if (on_event_) on_event_(ev);
+    if (typed_.empty()) return;
+    auto it = typed_.find(ev.type);
+    if (it != typed_.end()) it->second(ev);
+  }
+
+  void handle_end(int ec) {
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      cancel_ = nullptr;
+    }
+    if (!running_) return;
+    const int code = stop_code_.value_or(ec);
+    const bool retry = (!stop_code_ || retryable_) &&
+                       (options_.max_reconnects < 0 ||
+                        reconnects_ < options_.max_reconnects);
+    if (stop_code_ == 0) {
+      running_ = false;  // 204: the server wants no more connections
+      if (on_error_) on_error_(0, false);
+      return;
+    }
+    if (on_error_) on_error_(code, retry);
+    if (!retry) {
+      running_ = false;
+      return;
+    }
+    failures_ = got_event_ ? 0 : failures_ + 1;
+    ++reconnects_;
+    timer_.expires_after(next_delay());
+    timer_.async_wait([self = shared_from_this()](boost::system::error_code e) {
+      if (!e) self->connect();
+    });
+  }
+
+  // The server's interval, doubled per consecutive failed connection.
+  std::chrono::milliseconds next_delay() const {
+    auto delay = parser_.retry().value_or(options_.reconnect_delay);
+    for (int i = 1; i < failures_ && delay < options_.max_reconnect_delay;
+         ++i) {
+      delay *= 2;
+    }
+    return std::min(delay, std::max(options_.max_reconnect_delay,
+                                    options_.reconnect_delay));
+  }
+
+  void cancel_current() {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (cancel_) cancel_();
+  }
+
+  HttpClientManager& client_;
+  urls::url url_;
+  SseOptions options_;
+  // The parser belongs to the current connection's handlers; mu_ guards
+  // what other threads read or call.
+  SseParser parser_;
+  mutable std::mutex mu_;
+  std::function<void()> cancel_;
+  std::string last_event_id_;
+  asio::strand<asio::io_context::executor_type> strand_;
+  asio::steady_timer timer_;
+  std::atomic<bool> running_{false};
+  EventHandler on_event_;
+  std::map<std::string, EventHandler, std::less<>> typed_;
+  std::function<void()> on_open_;
+  ErrorHandler on_error_;
+  // Per connection; touched only on strand_.
+  bool opened_ = false;
+  bool got_event_ = false;
+  bool retryable_ = false;
+  std::optional<int> stop_code_;
+  int failures_ = 0;
+  std::atomic<int> reconnects_{0};
+};
+
+}  // namespace client_async
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace client_async {
+
+// One dispatched Server-Sent Event. The views are only valid during the
+// callback that receives the event; copy what must outlive it.
+struct SseEvent {
+  std::string_view type;  // "message" unless the event named one
+  std::string_view data;  // data lines joined with '\n'
+  std::string_view id;    // the stream's last event ID after this event
+};
+
+// Incremental text/event-stream parser (WHATWG HTML, "Server-sent events").
+// Events that arrive whole inside one chunk are reported as views into that
+// chunk; only an event split across chunks is copied, once, into an
+// internal buffer. Multi-line data is the other case that needs a copy.
+class SseParser {
+ public:
+  // A single event larger than `max_event_bytes` makes feed() fail.
+  explicit SseParser(std::size_t max_event_bytes = 1024 * 1024)
+      : max_event_bytes_(max_event_bytes) {}
+
+  // Parse `chunk`, calling `on_event(const SseEvent&)` for each complete
+  // event. Returns false (and drops the partial event) when an event
+  // outgrows the limit. Do not feed or reset the parser from `on_event`.
+  template <class F>
+  bool feed(std::string_view chunk, F&& on_event) {
+    if (skip_lf_ && !chunk.empty()) {
+      skip_lf_ = false;
+      if (chunk.front() == '\n') chunk.remove_prefix(1);
+    }
+    if (chunk.empty()) return true;
+    if (pending_.empty()) {
+      const auto consumed = parse(chunk, on_event);
+      pending_.assign(chunk.substr(consumed));
+    } else {
+      pending_.append(chunk);
+      const auto consumed = parse(pending_, on_event);
+      pending_.erase(0, consumed);
+    }
+    if (pending_.size() > max_event_bytes_) {
+      pending_.clear();
+      return false;
+    }
+    return true;
+  }
+
+  // Start of a new connection: drop any partial event. The last event ID
+  // and the retry interval carry over.
+  void reset() {
+    pending_.clear();
+    id_buffer_ = last_event_id_;
+    skip_lf_ = false;
+    at_stream_start_ = true;
+  }
+
+  // Value for the Last-Event-ID header when reconnecting.
+  const std::string& last_event_id() const { return last_event_id_; }
+  void set_last_event_id(std::string id) {
+    last_event_id_ = std::move(id);
+    id_buffer_ = last_event_id_;
+  }
+
+  // Reconnection delay most recently sent in a `retry:` field.
+  std::optional<std::chrono::milliseconds> retry() const { return retry_; }
+
+  // Bytes held for an event that has not completed yet.
+  std::size_t buffered() const { return pending_.size(); }
+
+ private:
+  // Handles every complete line of `text`; returns the offset just past the
+  // last dispatched event. Lines after it are parsed again once the rest of
+  // their event arrives.
+  template <class F>
+  std::size_t parse(std::string_view text, F& on_event) {
+    std::size_t pos = 0;
+    std::size_t consumed = 0;
+    if (at_stream_start_) {
+      // A UTF-8 BOM may open the stream, possibly split across chunks.
+      constexpr std::string_view bom = "\xEF\xBB\xBF";
+      const auto n = std::min(text.size(), bom.size());
+      if (text.substr(0, n) != bom.substr(0, n)) {
+        at_stream_start_ = false;
+      } else if (n < bom.size()) {
+        return 0;
+      } else {
+        pos = bom.size();
+      }
+    }
+    begin_event();
+    while (pos < text.size()) {
+      const auto eol = text.find_first_of("\r\n", pos);
+      if (eol == std::string_view::npos) break;  // partial line
+      const auto line = text.substr(pos, eol - pos);
+      std::size_t next = eol + 1;
+      bool cr_at_end = false;
+      if (text[eol] == '\r') {
+        if (next == text.size()) {
+          cr_at_end = true;
+        } else if (text[next] == '\n') {
+          ++next;
+        }
+      }
+      pos = next;
+      if (!line.empty()) {
+        process_line(line);
+        continue;
+      }
+      dispatch(on_event);
+      consumed = pos;
+      at_stream_start_ = false;
+      skip_lf_ = cr_at_end;  // a CRLF may be split across chunks
+      begin_event();
+    }
+    return consumed;
+  }
+
+  void begin_event() {
+    type_ = {};
+    data_ = {};
+    data_lines_ = 0;
+  }
+
+  void process_line(std::string_view line) {
+    if (line.front() == ':') return;  // comment / keep-alive
+    const auto colon = line.find(':');
+    const auto name = line.substr(0, colon);
+    std::string_view value;
+    if (colon != std::string_view::npos) {
+      value = line.substr(colon + 1);
+      if (!value.empty() && value.front() == ' ') value.remove_prefix(1);
+    }
+    if (name == "data") {
+      if (data_lines_ == 0) {
+        data_ = value;
+      } else {
+        if (data_lines_ == 1) data_buf_.assign(data_);
+        data_buf_.push_back('\n');
+        data_buf_.append(value);
+        data_ = data_buf_;
+      }
+      ++data_lines_;
+    } else if (name == "event") {
+      type_ = value;
+    } else if (name == "id") {
+      if (value.find('\0') == std::string_view::npos) {
+        id_buffer_.assign(value);
+      }
+    } else if (name == "retry") {
+      if (!value.empty() && value.size() <= 9 &&
+          value.find_first_not_of("0123456789") == std::string_view::npos) {
+        long ms = 0;
+        for (char ch : value) ms = ms * 10 + (ch - '0');
+        retry_ = std::chrono::milliseconds(ms);
+      }
+    }
+  }
+
+  template <class F>
+  void dispatch(F& on_event) {
+    last_event_id_ = id_buffer_;
+    if (data_lines_ == 0) return;
+    on_event(SseEvent{type_.empty() ? std::string_view("message") : type_,
+                      data_, last_event_id_});
+  }
+
+  std::size_t max_event_bytes_;
+  std::string pending_;
+  std::string data_buf_;
+  std::string id_buffer_;
+  std::string last_event_id_;
+  std::string_view type_;
+  std::string_view data_;
+  std::size_t data_lines_ = 0;
+  std::optional<std::chrono::milliseconds> retry_;
+  bool skip_lf_ = false;
+  bool at_stream_start_ = true;
+};
+
+}  // namespace client_async
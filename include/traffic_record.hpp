@@ -0,0 +1,342 @@
+#pragma once
+
+#include <boost/beast/http/message.hpp>
+#include <boost/interprocess/exceptions.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace client_async {
+
+// One recorded exchange. The views point into the mapped log and stay
+// valid while the TrafficLog that produced them is alive.
+struct TrafficEntry {
+  std::chrono::microseconds start;     // since the recorder was opened
+  std::chrono::microseconds duration;  // request handed over to callback
+  std::int32_t error = 0;              // client error code, 0 on success
+  std::uint16_t status = 0;            // 0 when no response arrived
+  std::uint16_t port = 0;
+  std::string_view method;
+  std::string_view scheme;
+  std::string_view host;
+  std::string_view target;
+  std::string_view request_headers;  // "Name: value\r\n" lines
+  std::string_view request_body;
+  std::string_view response_headers;
+  std::string_view response_body;
+};
+
+// Appends request/response pairs to a compact binary log for offline
+// replay (see TrafficLog). Only string-valued bodies are captured; file,
+// spill and empty bodies are logged as empty. Credentials (Authorization,
+// Proxy-Authorization and Cookie values) are replaced with "[redacted]"
+// unless the recorder is opened with `redact_credentials` off.
+// Thread-safe.
+//
+// Like the warm-start file, the log is in host byte order: "HCTR", a
+// version, then length-prefixed records. A record cut short by a crash is
+// ignored on read and cut off when the log is reopened for appending.
+class TrafficRecorder {
+ public:
+  using clock = std::chrono::steady_clock;
+
+  static constexpr std::uint32_t kVersion = 1;
+  static constexpr std::string_view kMagic{"HCTR"};
+  static constexpr std::string_view kRedacted{"[redacted]"};
+
+  // The request half of a record, captured before the request is sent.
+  struct Pending {
+    clock::time_point started;
+    std::string request;  // serialized method ... request body
+  };
+
+  // Opens `path` for appending, writing the file header if it is new and
+  // dropping a partial last record if it is not. Returns null if the file
+  // cannot be opened or is not a traffic log.
+  static std::shared_ptr<TrafficRecorder> open(
+      const std::filesystem::path& path, bool redact_credentials = true) {
+    std::error_code ec;
+    const bool fresh = !std::filesystem::exists(path, ec) ||
+                       std::filesystem::file_size(path, ec) == 0;
+    if (!fresh && !truncate_partial_tail(path)) return nullptr;
+    std::shared_ptr<TrafficRecorder> rec(new TrafficRecorder());
+    rec->redact_credentials_ = redact_credentials;
+    rec->out_.open(path, std::ios::binary | std::ios::app);
+    if (!rec->out_) return nullptr;
+    if (fresh) {
+      std::string header(kMagic);
+      put(header, kVersion);
+      rec->out_.write(header.data(),
+                      static_cast<std::streamsize>(header.size()));
+    }
+    return rec;
+  }
+
+  ~TrafficRecorder() { flush(); }
+
+  template <class Body, class Fields>
+  Pending begin(std::string_view scheme, std::string_view host,
+                std::uint16_t port,
+                const boost::beast::http::request<Body, Fields>& req,
+                clock::time_point now = clock::now()) const {
+    Pending p;
+    p.started = now;
+    std::string& out = p.request;
+    put_str(out, view(req.method_string()));
+    put_str(out, scheme);
+    put_str(out, host);
+    put(out, port);
+    put_str(out, view(req.target()));
+    put_str(out, header_block(req, redact_credentials_));
+    put_str(out, body_view(req));
+    return p;
+  }
+
+  // Completes and appends the record; `res` is null when the request
+  // failed before a response arrived.
+  template <class Body, class Fields>
+  void finish(const Pending& p,
+              const boost::beast::http::response<Body, Fields>* res, int error,
+              clock::time_point now = clock::now()) {
+    using std::chrono::duration_cast;
+    using std::chrono::microseconds;
+    std::string rec;
+    put(rec, static_cast<std::uint64_t>(
+                 duration_cast<microseconds>(p.started - opened_).count()));
+    put(rec, static_cast<std::uint64_t>(
+                 duration_cast<microseconds>(now - p.started).count()));
+    put(rec, static_cast<std::int32_t>(error));
+    put(rec, static_cast<std::uint16_t>(res ? res->result_int() : 0));
+    rec += p.request;
+    put_str(rec, res ? header_block(*res, redact_credentials_)
+                     : std::string());
+    put_str(rec, res ? body_view(*res) : std::string_view());
+
+    std::string framed;
+    framed.reserve(sizeof(std::uint32_t) + rec.size());
+    put(framed, static_cast<std::uint32_t>(rec.size()));
+    framed += rec;
+    std::lock_guard<std::mutex> lk(mu_);
+    out_.write(framed.data(), static_cast<std::streamsize>(framed.size()));
+    ++records_;
+  }
+
+  void flush() {
+    std::lock_guard<std::mutex> lk(mu_);
+    out_.flush();
+  }
+
+  std::size_t records() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return records_;
+  }
+
+ private:
+  TrafficRecorder() = default;
+
+  // Checks the file header and cuts the file back to the end of its last
+  // complete record, so appends do not land after a partial one.
+  static bool truncate_partial_tail(const std::filesystem::path& path) {
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec) return false;
+    std::uintmax_t end = 0;
+    {
+      std::ifstream in(path, std::ios::binary);
+      std::string magic(kMagic.size(), '\0');
+      std::uint32_t version = 0;
+      in.read(magic.data(), static_cast<std::streamsize>(magic.size()));
+      in.read(reinterpret_cast<char*>(&version), sizeof(version));
+      if (!in || magic != kMagic || version != kVersion) return false;
+      end = kMagic.size() + sizeof(version);
+      std::uint32_t len = 0;
+      while (size - end >= sizeof(len)) {
+        in.seekg(static_cast<std::streamoff>(end));
+        if (!in.read(reinterpret_cast<char*>(&len), sizeof(len))) break;
+        if (size - end - sizeof(len) < len) break;  // cut short by a crash
+        end += sizeof(len) + len;
+      }
+    }
+    if (end < size) std::filesystem::resize_file(path, end, ec);
+    return !ec;
+  }
+
+  // Beast's string_view type differs between Boost versions.
+  template <class S>
+  static std::string_view view(const S& s) {
+    return std::string_view(s.data(), s.size());
+  }
+
+  template <class T>
+  static void put(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+  }
+  static void put_str(std::string& out, std::string_view s) {
+    put(out, static_cast<std::uint32_t>(s.size()));
+    out.append(s);
+  }
+
+  static bool is_credential(boost::beast::http::field name) {
+    using boost::beast::http::field;
+    return name == field::authorization ||
+           name == field::proxy_authorization || name == field::cookie;
+  }
+
+  template <class Message>
+  static std::string header_block(const Message& m, bool redact) {
+    std::string out;
+    for (auto const& f : m) {
+      out.append(view(f.name_string())).append(": ");
+      if (redact && is_credential(f.name())) {
+        out.append(kRedacted);
+      } else {
+        out.append(view(f.value()));
+      }
+      out.append("\r\n");
+    }
+    return out;
+  }
+
+  template <class Message>
+  static std::string_view body_view(const Message& m) {
+    using value_type = std::decay_t<decltype(m.body())>;
+    if constexpr (std::is_same_v<value_type, std::string>) {
+      return m.body();
+    } else {
+      return {};
+    }
+  }
+
+  const clock::time_point opened_ = clock::now();
+  bool redact_credentials_ = true;
+  mutable std::mutex mu_;
+  std::ofstream out_;
+  std::size_t records_ = 0;
+};
+
+// Read side of a TrafficRecorder log. The file is memory-mapped, so the
+// entries are views into it and loading is a single pass over the index.
+class TrafficLog {
+ public:
+  TrafficLog() = default;
+  TrafficLog(const TrafficLog&) = delete;
+  TrafficLog& operator=(const TrafficLog&) = delete;
+
+  // Returns false (leaving the log empty) if the file is missing, from
+  // another version or malformed. A truncated final record is dropped.
+  bool open(const std::filesystem::path& path) {
+    unmap();
+    std::error_code ec;
+    const auto size = std::filesystem::file_size(path, ec);
+    if (ec || size == 0) return false;
+    try {
+      file_ = boost::interprocess::file_mapping(
+          path.string().c_str(), boost::interprocess::read_only);
+      region_ = boost::interprocess::mapped_region(
+          file_, boost::interprocess::read_only, 0,
+          static_cast<std::size_t>(size));
+    } catch (const boost::interprocess::interprocess_exception&) {
+      unmap();
+      return false;
+    }
+    data_ = static_cast<const char*>(region_.get_address());
+    size_ = static_cast<std::size_t>(size);
+    if (!index()) {
+      unmap();
+      return false;
+    }
+    return true;
+  }
+
+  const std::vector<TrafficEntry>& entries() const { return entries_; }
+  std::size_t size() const { return entries_.size(); }
+
+ private:
+  // Bounds-checked cursor over one region of the mapping.
+  struct Reader {
+    std::string_view data;
+    std::size_t pos = 0;
+
+    std::string_view bytes(std::size_t n) {
+      if (data.size() - pos < n) {
+        pos = data.size() + 1;
+        return {};
+      }
+      std::string_view v(data.data() + pos, n);
+      pos += n;
+      return v;
+    }
+    template <class T>
+    bool get(T& out) {
+      auto b = bytes(sizeof(T));
+      if (b.size() != sizeof(T)) return false;
+      std::memcpy(&out, b.data(), sizeof(T));
+      return true;
+    }
+    bool str(std::string_view& out) {
+      std::uint32_t n = 0;
+      if (!get(n)) return false;
+      out = bytes(n);
+      return out.size() == n;
+    }
+    bool done() const { return pos == data.size(); }
+  };
+
+  bool index() {
+    Reader file{std::string_view(data_, size_)};
+    std::uint32_t version = 0;
+    if (file.bytes(TrafficRecorder::kMagic.size()) !=
+            TrafficRecorder::kMagic ||
+        !file.get(version) || version != TrafficRecorder::kVersion) {
+      return false;
+    }
+    while (!file.done()) {
+      std::uint32_t len = 0;
+      if (!file.get(len)) break;
+      auto body = file.bytes(len);
+      if (body.size() != len) break;  // cut short by a crash
+      Reader r{body};
+      TrafficEntry e;
+      std::uint64_t start = 0;
+      std::uint64_t duration = 0;
+      if (!r.get(start) || !r.get(duration) || !r.get(e.error) ||
+          !r.get(e.status) || !r.str(e.method) || !r.str(e.scheme) ||
+          !r.str(e.host) || !r.get(e.port) || !r.str(e.target) ||
+          !r.str(e.request_headers) || !r.str(e.request_body) ||
+          !r.str(e.response_headers) || !r.str(e.response_body) ||
+          !r.done()) {
+        return false;
+      }
+      e.start = std::chrono::microseconds(start);
+      e.duration = std::chrono::microseconds(duration);
+      entries_.push_back(e);
+    }
+    return true;
+  }
+
+  void unmap() {
+    region_ = boost::interprocess::mapped_region();
+    file_ = boost::interprocess::file_mapping();
+    data_ = nullptr;
+    size_ = 0;
+    entries_.clear();
+  }
+
+  boost::interprocess::file_mapping file_;
+  boost::interprocess::mapped_region region_;
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  std::vector<TrafficEntry> entries_;
+};
+
+}  // namespace client_async
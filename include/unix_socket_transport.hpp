@@ -0,0 +1,91 @@
+#pragma once
+
+#include <boost/system/result.hpp>
+#include <boost/url.hpp>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+
+namespace client_async {
+
+// Plain HTTP over Unix domain sockets, for local sidecars (proxies, metadata
+// agents). Two ways to route a request to a socket:
+// - `http+unix://<percent-encoded socket path>/<target>`, e.g.
+//   `http+unix://%2Frun%2Fagent.sock/v1/health`;
+// - a per-origin override in config (`unix_socket_overrides`), mapping an
+//   origin such as `http://metadata.local` to a socket path. The URL keeps
+//   its host, which still goes out in the Host header.
+inline constexpr std::string_view kUnixSocketScheme = "http+unix";
+
+inline bool is_unix_socket_url(const boost::urls::url_view& url) {
+  return url.scheme() == kUnixSocketScheme;
+}
+
+// "scheme://host:port" with the default port filled in; the key used for
+// socket overrides.
+inline std::string origin_key(const boost::urls::url_view& url) {
+  std::string key(url.scheme());
+  key.append("://");
+  key.append(url.host());
+  key.push_back(':');
+  if (url.has_port()) {
+    key.append(url.port());
+  } else {
+    key.append(url.scheme() == "https" ? "443" : "80");
+  }
+  return key;
+}
+
+struct UnixSocketTarget {
+  std::string socket_path;
+  // http://localhost/<target>: what the sessions and redirects work with.
+  boost::urls::url url;
+};
+
+// Split an `http+unix://` URL into its socket path and an ordinary http URL
+// carrying the same path and query. Returns nullopt for other schemes or an
+// empty socket path.
+inline std::optional<UnixSocketTarget> split_unix_socket_url(
+    const boost::urls::url_view& url) {
+  if (!is_unix_socket_url(url)) return std::nullopt;
+  std::string path = url.host();  // percent-decoded
+  if (path.empty()) return std::nullopt;
+  UnixSocketTarget out{std::move(path), boost::urls::url(url)};
+  out.url.set_scheme("http");
+  out.url.set_host("localhost");
+  out.url.remove_port();
+  return out;
+}
+
+// Per-origin socket overrides from config, keyed by origin_key(). Keys that
+// do not parse as absolute http URLs are ignored.
+class UnixSocketOverrides {
+ public:
+  UnixSocketOverrides() = default;
+  explicit UnixSocketOverrides(
+      const std::unordered_map<std::string, std::string>& raw) {
+    for (const auto& [origin, path] : raw) {
+      if (path.empty()) continue;
+      boost::system::result<boost::urls::url_view> parsed =
+          boost::urls::parse_uri(origin);
+      if (!parsed || parsed->scheme() != "http") continue;
+      by_origin_.emplace(origin_key(*parsed), path);
+    }
+  }
+
+  bool empty() const { return by_origin_.empty(); }
+
+  std::optional<std::string> find(const boost::urls::url_view& url) const {
+    if (by_origin_.empty() || url.scheme() != "http") return std::nullopt;
+    auto it = by_origin_.find(origin_key(url));
+    if (it == by_origin_.end()) return std::nullopt;
+    return it->second;
+  }
+
+ private:
+  std::unordered_map<std::string, std::string> by_origin_;
+};
+
+}  // namespace client_async
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace monad {
+
+// Simulated clock for deterministic timer tests. One clock lives in each
+// execution context (as an asio service); it starts at the epoch and only
+// moves when run_virtual() finds the context idle, jumping straight to the
+// next deadline. A retry loop with minutes of backoff therefore finishes in
+// microseconds of wall time, in the same order it would in real time.
+class VirtualClock : public boost::asio::execution_context::service {
+ public:
+  using duration = std::chrono::steady_clock::duration;
+  using time_point = std::chrono::steady_clock::time_point;
+
+  static inline boost::asio::execution_context::id id;
+
+  explicit VirtualClock(boost::asio::execution_context& ctx)
+      : boost::asio::execution_context::service(ctx) {}
+
+  static VirtualClock& of(boost::asio::execution_context& ctx) {
+    return boost::asio::use_service<VirtualClock>(ctx);
+  }
+
+  time_point now() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return now_;
+  }
+  duration elapsed() const { return now() - time_point{}; }
+
+  // Number of waits that have not fired or been cancelled.
+  std::size_t pending() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return waits_.size();
+  }
+
+  // Moves the clock to the earliest deadline and posts every wait due at
+  // that instant. Returns false when nothing is waiting.
+  bool advance() {
+    std::vector<Wait> due;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      if (waits_.empty()) return false;
+      const auto deadline = waits_.begin()->first.first;
+      if (deadline > now_) now_ = deadline;
+      while (!waits_.empty() && waits_.begin()->first.first <= now_) {
+        due.push_back(std::move(waits_.begin()->second));
+        waits_.erase(waits_.begin());
+      }
+    }
+    for (auto& w : due) complete(std::move(w), {});
+    return true;
+  }
+
+ private:
+  friend class VirtualTimer;
+  using Handler = std::function<void(boost::system::error_code)>;
+  using Key = std::pair<time_point, std::uint64_t>;
+  struct Wait {
+    std::uint64_t timer;
+    boost::asio::any_io_executor ex;
+    Handler handler;
+  };
+
+  void shutdown() override {
+    // Destroyed outside the lock: a handler may own the timer it waits on,
+    // and ~VirtualTimer takes the lock.
+    std::map<Key, Wait> waits;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      waits.swap(waits_);
+    }
+  }
+
+  std::uint64_t new_timer_id() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return ++next_timer_;
+  }
+
+  void add(time_point deadline, Wait w) {
+    std::lock_guard<std::mutex> lk(mu_);
+    waits_.emplace(Key{deadline, ++next_seq_}, std::move(w));
+  }
+
+  // Completes the timer's outstanding waits with operation_aborted.
+  std::size_t cancel(std::uint64_t timer) {
+    std::vector<Wait> aborted;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      for (auto it = waits_.begin(); it != waits_.end();) {
+        if (it->second.timer == timer) {
+          aborted.push_back(std::move(it->second));
+          it = waits_.erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    for (auto& w : aborted) {
+      complete(std::move(w), boost::asio::error::operation_aborted);
+    }
+    return aborted.size();
+  }
+
+  static void complete(Wait w, boost::system::error_code ec) {
+    boost::asio::post(w.ex, [h = std::move(w.handler), ec]() { h(ec); });
+  }
+
+  mutable std::mutex mu_;
+  time_point now_{};
+  std::uint64_t next_seq_ = 0;
+  std::uint64_t next_timer_ = 0;
+  std::map<Key, Wait> waits_;
+};
+
+// Drop-in for boost::asio::steady_timer in the IO timer helpers (timeout,
+// delay, retry_exponential_if, poll_if, delay_for, poll_with_state), e.g.
+//   io.retry_exponential_if<VirtualTimer>(8, 30s, ioc, should_retry)
+// Only the subset of the steady_timer interface those helpers use.
+class VirtualTimer {
+ public:
+  using clock_type = std::chrono::steady_clock;
+  using duration = VirtualClock::duration;
+  using time_point = VirtualClock::time_point;
+
+  explicit VirtualTimer(boost::asio::io_context& ioc)
+      : VirtualTimer(boost::asio::any_io_executor(ioc.get_executor())) {}
+  explicit VirtualTimer(const boost::asio::any_io_executor& ex)
+      : ex_(ex),
+        clock_(VirtualClock::of(
+            boost::asio::query(ex, boost::asio::execution::context))),
+        id_(clock_.new_timer_id()),
+        expiry_(clock_.now()) {}
+  VirtualTimer(boost::asio::io_context& ioc, duration d) : VirtualTimer(ioc) {
+    expires_after(d);
+  }
+  VirtualTimer(const boost::asio::any_io_executor& ex, duration d)
+      : VirtualTimer(ex) {
+    expires_after(d);
+  }
+
+  VirtualTimer(const VirtualTimer&) = delete;
+  VirtualTimer& operator=(const VirtualTimer&) = delete;
+  ~VirtualTimer() { clock_.cancel(id_); }
+
+  boost::asio::any_io_executor get_executor() const { return ex_; }
+  time_point expiry() const { return expiry_; }
+
+  std::size_t expires_at(time_point t) {
+    const auto n = cancel();
+    expiry_ = t;
+    return n;
+  }
+  std::size_t expires_after(duration d) {
+    return expires_at(clock_.now() + d);
+  }
+  std::size_t cancel() { return clock_.cancel(id_); }
+
+  template <class WaitHandler>
+  void async_wait(WaitHandler&& handler) {
+    // std::function needs a copyable target; asio handlers may be move-only.
+    auto h = std::make_shared<std::decay_t<WaitHandler>>(
+        std::forward<WaitHandler>(handler));
+    clock_.add(expiry_, VirtualClock::Wait{
+                            id_, ex_, [h](boost::system::error_code ec) {
+                              (*h)(ec);
+                            }});
+  }
+
+ private:
+  boost::asio::any_io_executor ex_;
+  VirtualClock& clock_;
+  std::uint64_t id_;
+  time_point expiry_;
+};
+
+// Runs `ioc` like io_context::run(), except that whenever no handler is
+// ready the virtual clock jumps to the next VirtualTimer deadline instead of
+// sleeping. Returns the number of handlers executed.
+inline std::size_t run_virtual(boost::asio::io_context& ioc) {
+  auto& clock = VirtualClock::of(ioc);
+  std::size_t handlers = 0;
+  for (;;) {
+    ioc.restart();
+    handlers += ioc.poll();
+    if (clock.advance()) continue;
+    // No virtual waits left: block for real work (sockets, other threads).
+    ioc.restart();
+    const auto n = ioc.run_one();
+    if (n == 0) break;
+    handlers += n;
+  }
+  return handlers;
+}
+
+}  // namespace monad
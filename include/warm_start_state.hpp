@@ -0,0 +1,372 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <boost/asio/ip/address.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace beast_pool {
+
+// Names an origin without owning it; cheap to build from an Origin.
+struct WarmOriginRef {
+  std::string_view scheme;
+  std::string_view host;
+  std::uint16_t port = 0;
+};
+
+// What one origin taught us in earlier runs.
+struct WarmOrigin {
+  std::string scheme;
+  std::string host;
+  std::uint16_t port = 0;
+  std::uint64_t uses = 0;
+  std::int64_t last_used = 0;  // unix seconds
+  std::vector<boost::asio::ip::tcp::endpoint> addresses;
+  std::int64_t dns_expires = 0;  // unix seconds
+  std::string tls_session;       // DER-encoded SSL_SESSION
+  std::int64_t tls_expires = 0;  // unix seconds
+};
+
+// State that lets a fresh process skip cold-start work: TLS sessions to
+// resume, DNS answers still within their TTL, and which origins are hot
+// enough to pre-connect. Kept in memory, loaded from and saved to a small
+// versioned file. Thread-safe.
+//
+// The file is a per-machine cache in host byte order; a file from another
+// version, or one that fails to parse, is ignored rather than repaired. It
+// holds TLS session secrets, so it is written readable by its owner only.
+class WarmStartState {
+ public:
+  using clock = std::chrono::system_clock;
+  using tcp = boost::asio::ip::tcp;
+
+  static constexpr std::uint32_t kVersion = 1;
+
+  // `max_origins` bounds the saved file; the least used origins go first.
+  // In memory up to twice as many are kept before the least used are
+  // dropped.
+  explicit WarmStartState(std::size_t max_origins = 256)
+      : max_origins_(max_origins) {}
+
+  // Replace the in-memory state with the file's. Returns false (and leaves
+  // the state empty) if the file is missing, from another version, or
+  // malformed.
+  bool load(const std::filesystem::path& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return clear_and_fail();
+    const std::string data((std::istreambuf_iterator<char>(in)),
+                           std::istreambuf_iterator<char>());
+    Reader r{data};
+    std::unordered_map<std::string, WarmOrigin> loaded;
+    std::uint32_t version = 0;
+    std::uint32_t count = 0;
+    if (r.bytes(kMagic.size()) != kMagic || !r.get(version) ||
+        version != kVersion || !r.get(count)) {
+      return clear_and_fail();
+    }
+    for (std::uint32_t i = 0; i < count; ++i) {
+      WarmOrigin o;
+      std::uint32_t naddr = 0;
+      if (!r.str(o.scheme) || !r.str(o.host) || !r.get(o.port) ||
+          !r.get(o.uses) || !r.get(o.last_used) || !r.get(naddr)) {
+        return clear_and_fail();
+      }
+      for (std::uint32_t k = 0; k < naddr; ++k) {
+        std::string ip;
+        std::uint16_t port = 0;
+        if (!r.str(ip) || !r.get(port)) return clear_and_fail();
+        boost::system::error_code ec;
+        auto addr = boost::asio::ip::make_address(ip, ec);
+        if (!ec) o.addresses.emplace_back(addr, port);
+      }
+      if (!r.get(o.dns_expires) || !r.str(o.tls_session) ||
+          !r.get(o.tls_expires)) {
+        return clear_and_fail();
+      }
+      auto k = key(WarmOriginRef{o.scheme, o.host, o.port});
+      loaded.emplace(std::move(k), std::move(o));
+    }
+    if (!r.done()) return clear_and_fail();
+    std::lock_guard<std::mutex> lk(mu_);
+    origins_ = std::move(loaded);
+    dirty_ = false;
+    return true;
+  }
+
+  // Write the state to `path` atomically (temp file + rename), creating
+  // parent directories. The file gets mode 0600. Returns false on I/O
+  // errors.
+  bool save(const std::filesystem::path& path) {
+    std::string data;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      data = serialize_locked();
+      dirty_ = false;
+    }
+    std::error_code ec;
+    if (path.has_parent_path()) {
+      std::filesystem::create_directories(path.parent_path(), ec);
+    }
+    auto tmp = path;
+    tmp += ".tmp";
+    std::filesystem::remove(tmp, ec);
+    // Created with its final mode: a chmod after creation would leave a
+    // window in which another user could open the file.
+    const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+                          0600);
+    if (fd < 0) return false;
+    std::size_t written = 0;
+    while (written < data.size()) {
+      const auto n = ::write(fd, data.data() + written, data.size() - written);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        break;
+      }
+      written += static_cast<std::size_t>(n);
+    }
+    if (::close(fd) != 0 || written != data.size()) {
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+    std::filesystem::rename(tmp, path, ec);
+    return !ec;
+  }
+
+  // True if anything changed since the last load() or save().
+  bool dirty() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return dirty_;
+  }
+
+  std::size_t size() const {
+    std::lock_guard<std::mutex> lk(mu_);
+    return origins_.size();
+  }
+
+  void note_use(WarmOriginRef o, clock::time_point now = clock::now()) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& entry = entry_locked(o);
+    ++entry.uses;
+    entry.last_used = unix_seconds(now);
+    dirty_ = true;
+  }
+
+  // The resolver reports no TTLs, so the caller picks one.
+  template <class Endpoints>
+  void set_addresses(WarmOriginRef o, const Endpoints& endpoints,
+                     std::chrono::seconds ttl,
+                     clock::time_point now = clock::now()) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& entry = entry_locked(o);
+    entry.addresses.clear();
+    for (auto const& e : endpoints) entry.addresses.emplace_back(e);
+    entry.dns_expires = unix_seconds(now + ttl);
+    dirty_ = true;
+  }
+
+  // Drop the cached addresses, e.g. after connecting to them failed, so the
+  // next request resolves again.
+  void forget_addresses(WarmOriginRef o) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = origins_.find(key(o));
+    if (it == origins_.end() || it->second.addresses.empty()) return;
+    it->second.addresses.clear();
+    it->second.dns_expires = 0;
+    dirty_ = true;
+  }
+
+  // Cached addresses, or none once they have expired.
+  std::vector<tcp::endpoint> addresses(
+      WarmOriginRef o, clock::time_point now = clock::now()) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = origins_.find(key(o));
+    if (it == origins_.end() || it->second.dns_expires <= unix_seconds(now)) {
+      return {};
+    }
+    return it->second.addresses;
+  }
+
+  void set_tls_session(WarmOriginRef o, std::string der,
+                       std::int64_t expires_unix) {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto& entry = entry_locked(o);
+    entry.tls_session = std::move(der);
+    entry.tls_expires = expires_unix;
+    dirty_ = true;
+  }
+
+  // DER-encoded session to resume, or empty once it has expired.
+  std::string tls_session(WarmOriginRef o,
+                          clock::time_point now = clock::now()) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = origins_.find(key(o));
+    if (it == origins_.end() || it->second.tls_expires <= unix_seconds(now)) {
+      return {};
+    }
+    return it->second.tls_session;
+  }
+
+  // Up to `n` origins, most used first (ties: most recently used).
+  std::vector<WarmOrigin> top_origins(std::size_t n) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto ranked = ranked_locked();
+    if (ranked.size() > n) ranked.resize(n);
+    std::vector<WarmOrigin> out;
+    out.reserve(ranked.size());
+    for (auto const* o : ranked) out.push_back(*o);
+    return out;
+  }
+
+  static std::string key(WarmOriginRef o) {
+    std::string k;
+    k.reserve(o.scheme.size() + o.host.size() + 9);
+    k.append(o.scheme).append("://").append(o.host);
+    k.push_back(':');
+    k.append(std::to_string(o.port));
+    return k;
+  }
+
+  static std::int64_t unix_seconds(clock::time_point t) {
+    return std::chrono::duration_cast<std::chrono::seconds>(
+               t.time_since_epoch())
+        .count();
+  }
+
+ private:
+  static constexpr std::string_view kMagic{"HCWS"};
+
+  // Bounds-checked cursor over the file contents.
+  struct Reader {
+    const std::string& data;
+    std::size_t pos = 0;
+
+    std::string_view bytes(std::size_t n) {
+      if (data.size() - pos < n) {
+        pos = data.size() + 1;  // poisons done()
+        return {};
+      }
+      std::string_view v(data.data() + pos, n);
+      pos += n;
+      return v;
+    }
+    template <class T>
+    bool get(T& out) {
+      auto b = bytes(sizeof(T));
+      if (b.size() != sizeof(T)) return false;
+      std::memcpy(&out, b.data(), sizeof(T));
+      return true;
+    }
+    bool str(std::string& out) {
+      std::uint32_t n = 0;
+      if (!get(n)) return false;
+      auto b = bytes(n);
+      if (b.size() != n) return false;
+      out.assign(b);
+      return true;
+    }
+    bool done() const { return pos == data.size(); }
+  };
+
+  template <class T>
+  static void put(std::string& out, const T& v) {
+    out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+  }
+  static void put_str(std::string& out, std::string_view s) {
+    put(out, static_cast<std::uint32_t>(s.size()));
+    out.append(s);
+  }
+
+  bool clear_and_fail() {
+    std::lock_guard<std::mutex> lk(mu_);
+    origins_.clear();
+    dirty_ = false;
+    return false;
+  }
+
+  WarmOrigin& entry_locked(WarmOriginRef o) {
+    auto k = key(o);
+    auto it = origins_.find(k);
+    if (it == origins_.end()) {
+      if (origins_.size() >= 2 * max_origins_) trim_locked(max_origins_);
+      WarmOrigin entry;
+      entry.scheme = std::string(o.scheme);
+      entry.host = std::string(o.host);
+      entry.port = o.port;
+      it = origins_.emplace(std::move(k), std::move(entry)).first;
+    }
+    return it->second;
+  }
+
+  // Keep the `n` best-ranked origins. Run once the map doubles, so the sort
+  // is amortised over the insertions in between.
+  void trim_locked(std::size_t n) {
+    auto ranked = ranked_locked();
+    if (ranked.size() <= n) return;
+    std::vector<std::string> drop;
+    drop.reserve(ranked.size() - n);
+    for (std::size_t i = n; i < ranked.size(); ++i) {
+      const auto* o = ranked[i];
+      drop.push_back(key({o->scheme, o->host, o->port}));
+    }
+    for (auto const& k : drop) origins_.erase(k);
+    dirty_ = true;
+  }
+
+  std::vector<const WarmOrigin*> ranked_locked() const {
+    std::vector<const WarmOrigin*> ranked;
+    ranked.reserve(origins_.size());
+    for (auto const& [k, o] : origins_) ranked.push_back(&o);
+    std::sort(ranked.begin(), ranked.end(),
+              [](const WarmOrigin* a, const WarmOrigin* b) {
+                if (a->uses != b->uses) return a->uses > b->uses;
+                return a->last_used > b->last_used;
+              });
+    return ranked;
+  }
+
+  std::string serialize_locked() const {
+    auto ranked = ranked_locked();
+    if (ranked.size() > max_origins_) ranked.resize(max_origins_);
+    std::string out;
+    out.append(kMagic);
+    put(out, kVersion);
+    put(out, static_cast<std::uint32_t>(ranked.size()));
+    for (auto const* o : ranked) {
+      put_str(out, o->scheme);
+      put_str(out, o->host);
+      put(out, o->port);
+      put(out, o->uses);
+      put(out, o->last_used);
+      put(out, static_cast<std::uint32_t>(o->addresses.size()));
+      for (auto const& ep : o->addresses) {
+        put_str(out, ep.address().to_string());
+        put(out, ep.port());
+      }
+      put(out, o->dns_expires);
+      put_str(out, o->tls_session);
+      put(out, o->tls_expires);
+    }
+    return out;
+  }
+
+  mutable std::mutex mu_;
+  std::unordered_map<std::string, WarmOrigin> origins_;
+  std::size_t max_origins_;
+  bool dirty_ = false;
+};
+
+}  // namespace beast_pool
@@ -0,0 +1,676 @@
+#pragma once
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/beast/version.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/websocket/ssl.hpp>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#include "base64.h"
+#include "beast_connection_pool.hpp"
+
+namespace client_async {
+
+// Stream layer under beast::websocket::stream that can hold writes back.
+// While corked, writes complete at once into a buffer; async_flush() then
+// sends everything buffered with one write to the next layer. Otherwise
+// writes pass straight through.
+template <class NextLayer>
+class coalescing_stream {
+ public:
+  using executor_type = typename NextLayer::executor_type;
+  using next_layer_type = NextLayer;
+
+  explicit coalescing_stream(NextLayer&& next) : next_(std::move(next)) {}
+
+  executor_type get_executor() noexcept { return next_.get_executor(); }
+  NextLayer& next_layer() noexcept { return next_; }
+  NextLayer const& next_layer() const noexcept { return next_; }
+
+  // Writes issued to the next layer are added to `*counter`.
+  void count_writes(std::atomic<std::size_t>* counter) { writes_ = counter; }
+
+  void cork() { corked_ = true; }
+
+  // Uncork and send what was buffered. Writes made before `handler(ec)`
+  // runs are sent as part of the flush.
+  void async_flush(std::function<void(boost::system::error_code)> handler) {
+    corked_ = false;
+    flush_handler_ = std::move(handler);
+    flush_some();
+  }
+
+  template <class MutableBufferSequence, class ReadToken>
+  auto async_read_some(MutableBufferSequence const& buffers,
+                       ReadToken&& token) {
+    return next_.async_read_some(buffers, std::forward<ReadToken>(token));
+  }
+
+  template <class ConstBufferSequence, class WriteToken>
+  auto async_write_some(ConstBufferSequence const& buffers,
+                        WriteToken&& token) {
+    return boost::asio::async_initiate<
+        WriteToken, void(boost::system::error_code, std::size_t)>(
+        [this](auto handler, ConstBufferSequence const& b) {
+          if (!corked_ && !flushing_) {
+            if (writes_) ++*writes_;
+            next_.async_write_some(b, std::move(handler));
+            return;
+          }
+          const auto n = boost::asio::buffer_size(b);
+          const auto at = pending_.size();
+          pending_.resize(at + n);
+          boost::asio::buffer_copy(boost::asio::buffer(&pending_[at], n), b);
+          boost::asio::post(
+              next_.get_executor(),
+              boost::beast::bind_front_handler(
+                  std::move(handler), boost::system::error_code{}, n));
+        },
+        token, buffers);
+  }
+
+ private:
+  void flush_some() {
+    if (pending_.empty()) {
+      flushing_ = false;
+      auto handler = std::move(flush_handler_);
+      return handler({});
+    }
+    flushing_ = true;
+    out_.swap(pending_);
+    pending_.clear();
+    if (writes_) ++*writes_;
+    boost::asio::async_write(
+        next_, boost::asio::buffer(out_),
+        [this](boost::system::error_code ec, std::size_t) {
+          out_.clear();
+          if (ec) {
+            flushing_ = false;
+            pending_.clear();
+            auto handler = std::move(flush_handler_);
+            return handler(ec);
+          }
+          flush_some();
+        });
+  }
+
+  NextLayer next_;
+  std::string pending_;  // written while corked or flushing
+  std::string out_;      // being flushed
+  bool corked_ = false;
+  bool flushing_ = false;
+  std::atomic<std::size_t>* writes_ = nullptr;
+  std::function<void(boost::system::error_code)> flush_handler_;
+};
+
+// Closing the websocket tears down the layer below.
+template <class NextLayer>
+void teardown(boost::beast::role_type role, coalescing_stream<NextLayer>& s,
+              boost::system::error_code& ec) {
+  using boost::beast::websocket::teardown;
+  teardown(role, s.next_layer(), ec);
+}
+
+template <class NextLayer, class TeardownHandler>
+void async_teardown(boost::beast::role_type role,
+                    coalescing_stream<NextLayer>& s,
+                    TeardownHandler&& handler) {
+  using boost::beast::websocket::async_teardown;
+  async_teardown(role, s.next_layer(),
+                 std::forward<TeardownHandler>(handler));
+}
+
+struct WebSocketMessage {
+  std::string data;
+  bool binary = false;
+};
+
+// HTTP proxy reached with CONNECT, for ws:// and wss:// alike.
+struct WebSocketProxy {
+  std::string host;
+  std::string port;
+  std::string username;
+  std::string password;
+};
+
+struct WebSocketOptions {
+  // Offer permessage-deflate (RFC 7692); used only if the server agrees.
+  // Messages shorter than deflate_threshold bytes are sent uncompressed.
+  bool permessage_deflate = true;
+  std::size_t deflate_threshold = 256;
+  // Ping once the connection has been quiet for half of idle_timeout, and
+  // drop it when the other half passes without a reply. Without pings,
+  // idle_timeout of silence drops it.
+  bool keep_alive_pings = true;
+  // HttpClientManager::websocket() takes both from HttpClientRequestParams
+  // (io_timeout and handshake_timeout). The handshake timeout also bounds
+  // the TLS handshake behind a proxy and the closing handshake.
+  std::chrono::seconds idle_timeout{30};
+  std::chrono::seconds handshake_timeout{30};
+  std::size_t max_message_bytes = 16 * 1024 * 1024;
+  // Messages queued while a write is in flight go to the socket together,
+  // up to about this many bytes per write. 0 writes each one on its own.
+  std::size_t coalesce_bytes = 64 * 1024;
+  std::vector<std::pair<std::string, std::string>> headers;
+  std::optional<WebSocketProxy> proxy;
+};
+
+// WebSocket client on a ConnectionPool connection. The connection is
+// acquired like any pooled request, so it reuses the pool's DNS answers,
+// TLS context and resumed sessions, then leaves the pool for good once the
+// upgrade starts (see ConnectionPool::detach).
+//
+// Everything runs on the pool strand; the public functions may be called
+// from any thread. Sends are queued and written in order. Incoming messages
+// go to the on_message handler, or, without one, wait for receive().
+//
+// The client keeps itself alive while connected; call close() to end it.
+class WebSocketClient : public std::enable_shared_from_this<WebSocketClient> {
+ public:
+  using error_code = boost::system::error_code;
+  using close_reason = boost::beast::websocket::close_reason;
+  using close_code = boost::beast::websocket::close_code;
+  using Handler = std::function<void(error_code)>;
+  using MessageHandler = std::function<void(WebSocketMessage&&)>;
+  using ReceiveHandler = std::function<void(error_code, WebSocketMessage&&)>;
+  // `ec` is empty after a clean closing handshake.
+  using CloseHandler = std::function<void(error_code, const close_reason&)>;
+
+  struct Stats {
+    std::size_t messages_sent = 0;
+    std::size_t messages_received = 0;
+    // Writes issued to the transport, pings and control frames included.
+    std::size_t transport_writes = 0;
+  };
+
+  // `origin_id` is the server (http, https or a Unix socket origin) and
+  // `target` the request path and query.
+  static std::shared_ptr<WebSocketClient> create(
+      beast_pool::ConnectionPool& pool, beast_pool::OriginId origin_id,
+      std::string target, WebSocketOptions options = {}) {
+    return std::shared_ptr<WebSocketClient>(new WebSocketClient(
+        pool, origin_id, std::move(target), std::move(options)));
+  }
+
+  // Set before connect().
+  void on_message(MessageHandler handler) {
+    on_message_ = std::move(handler);
+  }
+  // Once, when an open connection ends.
+  void on_close(CloseHandler handler) { on_close_ = std::move(handler); }
+
+  // `on_open(ec)` runs once the handshake finished or failed.
+  void connect(Handler on_open) {
+    boost::asio::post(strand_, [self = shared_from_this(),
+                                on_open = std::move(on_open)]() mutable {
+      if (self->state_ != State::idle) {
+        return on_open(boost::asio::error::already_started);
+      }
+      self->state_ = State::connecting;
+      self->on_open_ = std::move(on_open);
+      self->acquire();
+    });
+  }
+
+  // Queue a message. `done(ec)` runs once it was written, or failed.
+  // Messages sent before the connection opens wait for it.
+  void send(std::string data, bool binary = false, Handler done = {}) {
+    boost::asio::post(strand_, [self = shared_from_this(),
+                                m = Outgoing{std::move(data), binary,
+                                             std::move(done)}]() mutable {
+      if (self->state_ == State::closed || self->close_requested_) {
+        if (m.done) m.done(boost::beast::websocket::error::closed);
+        return;
+      }
+      self->queue_.push_back(std::move(m));
+      self->drain();
+    });
+  }
+
+  // Next incoming message, for clients without an on_message handler.
+  void receive(ReceiveHandler handler) {
+    boost::asio::post(strand_, [self = shared_from_this(),
+                                handler = std::move(handler)]() mutable {
+      if (!self->inbox_.empty()) {
+        auto m = std::move(self->inbox_.front());
+        self->inbox_.pop_front();
+        return handler({}, std::move(m));
+      }
+      if (self->state_ == State::closed) {
+        return handler(self->end_error(), {});
+      }
+      self->receivers_.push_back(std::move(handler));
+    });
+  }
+
+  // Send what is queued, then the close frame. `done(ec)` runs when the
+  // connection has ended.
+  void close(close_code code = close_code::normal, Handler done = {}) {
+    boost::asio::post(strand_, [self = shared_from_this(), code,
+                                done = std::move(done)]() mutable {
+      if (self->state_ == State::closed || self->state_ == State::idle) {
+        self->state_ = State::closed;
+        if (done) done({});
+        return;
+      }
+      if (done) self->close_waiters_.push_back(std::move(done));
+      if (self->close_requested_) return;
+      self->close_requested_ = true;
+      self->close_code_ = code;
+      if (self->state_ == State::open && !self->writing_ &&
+          self->queue_.empty()) {
+        self->start_close();
+      }
+    });
+  }
+
+  bool is_open() const { return open_; }
+
+  Stats stats() const {
+    return Stats{sent_, received_, transport_writes_};
+  }
+
+  // IO wrappers over the calls above.
+  monad::IO<void> connect_io() {
+    return monad::IO<void>([self = shared_from_this()](auto cb) {
+      self->connect([cb = std::move(cb)](error_code ec) { cb(to_result(ec)); });
+    });
+  }
+
+  monad::IO<void> send_io(std::string data, bool binary = false) {
+    return monad::IO<void>([self = shared_from_this(), data = std::move(data),
+                            binary](auto cb) {
+      self->send(data, binary,
+                 [cb = std::move(cb)](error_code ec) { cb(to_result(ec)); });
+    });
+  }
+
+  monad::IO<WebSocketMessage> receive_io() {
+    return monad::IO<WebSocketMessage>([self = shared_from_this()](auto cb) {
+      self->receive([cb = std::move(cb)](error_code ec, WebSocketMessage&& m) {
+        using R = monad::Result<WebSocketMessage, monad::Error>;
+        if (ec) return cb(R::Err(monad::Error{ec.value(), ec.message()}));
+        cb(R::Ok(std::move(m)));
+      });
+    });
+  }
+
+  monad::IO<void> close_io(close_code code = close_code::normal) {
+    return monad::IO<void>([self = shared_from_this(), code](auto cb) {
+      self->close(code,
+                  [cb = std::move(cb)](error_code ec) { cb(to_result(ec)); });
+    });
+  }
+
+ private:
+  using Connection = beast_pool::Connection;
+  template <class S>
+  using Ws = boost::beast::websocket::stream<coalescing_stream<S>>;
+  using WsVariant =
+      std::variant<std::monostate, Ws<Connection::TcpStream>,
+                   Ws<Connection::SslStream>, Ws<Connection::UnixStream>>;
+
+  enum class State { idle, connecting, open, closed };
+
+  struct Outgoing {
+    std::string data;
+    bool binary = false;
+    Handler done;
+  };
+
+  WebSocketClient(beast_pool::ConnectionPool& pool,
+                  beast_pool::OriginId origin_id, std::string target,
+                  WebSocketOptions options)
+      : pool_(pool),
+        strand_(pool.executor()),
+        origin_id_(origin_id),
+        origin_(beast_pool::OriginTable::global().get(origin_id)),
+        target_(target.empty() ? "/" : std::move(target)),
+        options_(std::move(options)) {
+    if (beast_pool::is_unix(origin_)) options_.proxy.reset();
+  }
+
+  static monad::Result<void, monad::Error> to_result(error_code ec) {
+    if (ec) {
+      return monad::Result<void, monad::Error>::Err(
+          monad::Error{ec.value(), ec.message()});
+    }
+    return monad::Result<void, monad::Error>::Ok();
+  }
+
+  static bool is_ip_literal(std::string_view host) {
+    if (host.find(':') != std::string_view::npos) return true;  // IPv6
+    return host.find('.') != std::string_view::npos &&
+           host.find_first_not_of("0123456789.") == std::string_view::npos;
+  }
+
+  // host[:port] as the Host header and CONNECT target want it.
+  std::string authority(bool always_port) const {
+    std::string out;
+    if (origin_.host.find(':') != std::string::npos &&
+        origin_.host.front() != '[') {
+      out = "[" + origin_.host + "]";
+    } else {
+      out = origin_.host;
+    }
+    const std::uint16_t default_port = beast_pool::is_https(origin_) ? 443 : 80;
+    if (always_port || origin_.port != default_port) {
+      out += ":" + std::to_string(origin_.port);
+    }
+    return out;
+  }
+
+  template <class F>
+  void visit_ws(F&& f) {
+    std::visit(
+        [&](auto& ws) {
+          if constexpr (!std::is_same_v<std::decay_t<decltype(ws)>,
+                                        std::monostate>) {
+            f(ws);
+          }
+        },
+        ws_);
+  }
+
+  void acquire() {
+    beast_pool::OriginId id = origin_id_;
+    if (options_.proxy) {
+      id = beast_pool::OriginTable::global().intern(
+          {"http", options_.proxy->host,
+           static_cast<std::uint16_t>(std::stoi(options_.proxy->port))});
+    }
+    pool_.acquire(id, [self = shared_from_this()](error_code ec,
+                                                  Connection::Ptr c) {
+      if (ec || !c) {
+        return self->finish(ec ? ec : boost::asio::error::not_connected);
+      }
+      self->conn_ = std::move(c);
+      if (self->options_.proxy) return self->proxy_connect();
+      self->upgrade();
+    });
+  }
+
+  void proxy_connect() {
+    namespace http = boost::beast::http;
+    connect_req_.method(http::verb::connect);
+    connect_req_.target(authority(/*always_port=*/true));
+    connect_req_.version(11);
+    connect_req_.set(http::field::host, connect_req_.target());
+    auto const& proxy = *options_.proxy;
+    if (!proxy.username.empty() && !proxy.password.empty()) {
+      connect_req_.set(
+          http::field::proxy_authorization,
+          "Basic " + base64_encode(proxy.username + ":" + proxy.password));
+    }
+    pool_.set_op_timeout(*conn_, options_.handshake_timeout);
+    std::visit(
+        [self = shared_from_this()](auto& s) {
+          http::async_write(
+              s, self->connect_req_,
+              [self](error_code ec, std::size_t) {
+                if (ec) return self->finish(ec);
+                self->proxy_read_response();
+              });
+        },
+        conn_->stream());
+  }
+
+  void proxy_read_response() {
+    namespace http = boost::beast::http;
+    proxy_parser_.emplace();
+    std::visit(
+        [self = shared_from_this()](auto& s) {
+          http::async_read_header(
+              s, self->proxy_buffer_, *self->proxy_parser_,
+              [self](error_code ec, std::size_t) {
+                if (ec) return self->finish(ec);
+                if (self->proxy_parser_->get().result_int() != 200) {
+                  return self->finish(boost::asio::error::connection_refused);
+                }
+                if (!beast_pool::is_https(self->origin_)) {
+                  return self->upgrade();
+                }
+                self->tls_handshake();
+              });
+        },
+        conn_->stream());
+  }
+
+  // TLS to the origin, inside the proxy tunnel.
+  void tls_handshake() {
+    auto* tls = conn_->upgrade_to_ssl();
+    if (!tls) return finish(boost::asio::error::no_protocol_option);
+    if (!is_ip_literal(origin_.host)) {
+      SSL_set_tlsext_host_name(tls->native_handle(), origin_.host.c_str());
+    }
+    pool_.set_op_timeout(*conn_, options_.handshake_timeout);
+    tls->async_handshake(boost::asio::ssl::stream_base::client,
+                         [self = shared_from_this()](error_code ec) {
+                           if (ec) return self->finish(ec);
+                           self->upgrade();
+                         });
+  }
+
+  void upgrade() {
+    namespace websocket = boost::beast::websocket;
+    auto stream = pool_.detach(std::move(conn_));
+    std::visit(
+        [this](auto& s) {
+          using S = std::decay_t<decltype(s)>;
+          ws_.template emplace<Ws<S>>(std::move(s));
+        },
+        stream);
+    visit_ws([this](auto& ws) {
+      ws.next_layer().count_writes(&transport_writes_);
+      // The websocket stream runs its own timers.
+      boost::beast::get_lowest_layer(ws).expires_never();
+      ws.set_option(websocket::stream_base::timeout{
+          options_.handshake_timeout, options_.idle_timeout,
+          options_.keep_alive_pings});
+      if (options_.permessage_deflate) {
+        websocket::permessage_deflate pmd;
+        pmd.client_enable = true;
+        pmd.msg_size_threshold = options_.deflate_threshold;
+        ws.set_option(pmd);
+      }
+      ws.read_message_max(options_.max_message_bytes);
+      ws.set_option(websocket::stream_base::decorator(
+          [headers = options_.headers](websocket::request_type& req) {
+            req.set(boost::beast::http::field::user_agent,
+                    BOOST_BEAST_VERSION_STRING);
+            for (auto const& [name, value] : headers) req.set(name, value);
+          }));
+      ws.async_handshake(authority(/*always_port=*/false), target_,
+                         [self = shared_from_this()](error_code ec) {
+                           if (ec) return self->finish(ec);
+                           self->opened();
+                         });
+    });
+  }
+
+  void opened() {
+    state_ = State::open;
+    open_ = true;
+    if (auto on_open = std::move(on_open_)) on_open({});
+    read();
+    if (close_requested_ && queue_.empty()) return start_close();
+    drain();
+  }
+
+  void read() {
+    visit_ws([self = shared_from_this()](auto& ws) {
+      ws.async_read(self->read_buffer_, [self, &ws](error_code ec,
+                                                    std::size_t) {
+        if (ec == boost::asio::error::operation_aborted &&
+            self->close_requested_) {
+          return;  // our close finished the connection; it reports
+        }
+        if (ec) return self->finish(ec);
+        WebSocketMessage m{
+            boost::beast::buffers_to_string(self->read_buffer_.data()),
+            ws.got_binary()};
+        self->read_buffer_.consume(self->read_buffer_.size());
+        ++self->received_;
+        self->deliver(std::move(m));
+        self->read();
+      });
+    });
+  }
+
+  void deliver(WebSocketMessage&& m) {
+    if (on_message_) return on_message_(std::move(m));
+    if (!receivers_.empty()) {
+      auto handler = std::move(receivers_.front());
+      receivers_.pop_front();
+      return handler({}, std::move(m));
+    }
+    inbox_.push_back(std::move(m));
+  }
+
+  // Writes the next batch: queued messages up to coalesce_bytes, corked so
+  // their frames leave in one transport write.
+  void drain() {
+    if (state_ != State::open || writing_ || queue_.empty()) return;
+    writing_ = true;
+    std::size_t bytes = queue_.front().data.size();
+    batch_ = 1;
+    while (batch_ < queue_.size() &&
+           bytes + queue_[batch_].data.size() <= options_.coalesce_bytes) {
+      bytes += queue_[batch_++].data.size();
+    }
+    if (batch_ > 1) visit_ws([](auto& ws) { ws.next_layer().cork(); });
+    write(0);
+  }
+
+  void write(std::size_t i) {
+    visit_ws([this, i](auto& ws) {
+      ws.binary(queue_[i].binary);
+      ws.async_write(boost::asio::buffer(queue_[i].data),
+                     [self = shared_from_this(), i](error_code ec,
+                                                    std::size_t) {
+                       self->written(ec, i);
+                     });
+    });
+  }
+
+  void written(error_code ec, std::size_t i) {
+    if (!ec && i + 1 < batch_) return write(i + 1);
+    if (ec || batch_ == 1) return batch_done(ec);
+    visit_ws([this](auto& ws) {
+      ws.next_layer().async_flush(
+          [self = shared_from_this()](error_code ec) { self->batch_done(ec); });
+    });
+  }
+
+  void batch_done(error_code ec) {
+    writing_ = false;
+    for (std::size_t i = 0; i < batch_ && !queue_.empty(); ++i) {
+      auto m = std::move(queue_.front());
+      queue_.pop_front();
+      if (!ec) ++sent_;
+      if (m.done) m.done(ec);
+    }
+    batch_ = 0;
+    if (ec) return;  // the pending read reports the failure
+    if (close_requested_ && queue_.empty()) return start_close();
+    drain();
+  }
+
+  void start_close() {
+    visit_ws([this](auto& ws) {
+      ws.async_close(close_code_, [self = shared_from_this()](error_code ec) {
+        self->finish(ec);
+      });
+    });
+  }
+
+  error_code end_error() const {
+    return end_ec_ ? end_ec_
+                   : error_code(boost::beast::websocket::error::closed);
+  }
+
+  // Ends the connection, or the attempt, with `ec`.
+  void finish(error_code ec) {
+    if (state_ == State::closed) return;
+    const bool was_open = state_ == State::open;
+    state_ = State::closed;
+    open_ = false;
+    if (ec == boost::beast::websocket::error::closed) ec = {};
+    end_ec_ = ec;
+    if (conn_) {
+      conn_->close();
+      pool_.release(std::move(conn_), false,
+                    beast_pool::RequestOutcome{true, {}});
+    }
+    close_reason reason;
+    visit_ws([&](auto& ws) {
+      reason = ws.reason();
+      if (ec) boost::beast::get_lowest_layer(ws).close();
+    });
+    if (auto on_open = std::move(on_open_)) on_open(end_error());
+    auto queue = std::move(queue_);
+    queue_.clear();
+    for (auto& m : queue) {
+      if (m.done) m.done(end_error());
+    }
+    auto receivers = std::move(receivers_);
+    receivers_.clear();
+    for (auto& r : receivers) r(end_error(), {});
+    auto waiters = std::move(close_waiters_);
+    close_waiters_.clear();
+    for (auto& w : waiters) w(ec);
+    if (was_open && on_close_) on_close_(ec, reason);
+  }
+
+  beast_pool::ConnectionPool& pool_;
+  boost::asio::strand<boost::asio::io_context::executor_type> strand_;
+  beast_pool::OriginId origin_id_;
+  beast_pool::Origin const& origin_;
+  std::string target_;
+  WebSocketOptions options_;
+
+  // Strand only.
+  State state_ = State::idle;
+  Connection::Ptr conn_;  // until the upgrade
+  boost::beast::http::request<boost::beast::http::empty_body> connect_req_;
+  std::optional<boost::beast::http::response_parser<
+      boost::beast::http::empty_body>>
+      proxy_parser_;
+  boost::beast::flat_buffer proxy_buffer_;
+  WsVariant ws_;
+  boost::beast::flat_buffer read_buffer_;
+  std::deque<Outgoing> queue_;
+  std::size_t batch_ = 0;
+  bool writing_ = false;
+  bool close_requested_ = false;
+  close_code close_code_ = close_code::normal;
+  error_code end_ec_;
+  Handler on_open_;
+  MessageHandler on_message_;
+  CloseHandler on_close_;
+  std::deque<WebSocketMessage> inbox_;
+  std::deque<ReceiveHandler> receivers_;
+  std::vector<Handler> close_waiters_;
+
+  std::atomic<bool> open_{false};
+  std::atomic<std::size_t> sent_{0};
+  std::atomic<std::size_t> received_{0};
+  std::atomic<std::size_t> transport_writes_{0};
+};
+
+}  // namespace client_async
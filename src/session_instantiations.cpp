@@ -0,0 +1,21 @@
+#include "explicit_instantiations.hpp"
+#include "http_client_manager.hpp"
+
+namespace client_async {
+
+INSTANTIATE_HTTP_SESSION(http::string_body, http::string_body)
+INSTANTIATE_HTTP_SESSION(http::empty_body, http::string_body)
+INSTANTIATE_HTTP_SESSION(http::file_body, http::empty_body)
+
+INSTANTIATE_HTTP_SESSION_POOLED(http::string_body, http::string_body)
+INSTANTIATE_HTTP_SESSION_POOLED(http::empty_body, http::string_body)
+INSTANTIATE_HTTP_SESSION_POOLED(http::file_body, http::empty_body)
+
+INSTANTIATE_HTTP_SESSION_STREAM(http::string_body)
+INSTANTIATE_HTTP_SESSION_STREAM(http::empty_body)
+
+INSTANTIATE_CLIENTPOOL_HTTP_REQUEST(http::string_body, http::string_body)
+INSTANTIATE_CLIENTPOOL_HTTP_REQUEST(http::empty_body, http::string_body)
+INSTANTIATE_CLIENTPOOL_HTTP_REQUEST(http::file_body, http::empty_body)
+
+}  // namespace client_async
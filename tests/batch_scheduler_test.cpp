@@ -0,0 +1,169 @@
+#include "batch_scheduler.hpp"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using client_async::BatchOptions;
+using client_async::BatchScheduler;
+
+namespace {
+
+// Records starts; jobs finish only when the test calls complete().
+struct ManualJobs {
+  std::mutex mu;
+  std::vector<std::size_t> started;
+  std::vector<std::function<void()>> pending;
+
+  BatchScheduler::start_fn starter() {
+    return [this](std::size_t i, std::function<void()> done) {
+      std::lock_guard<std::mutex> lk(mu);
+      started.push_back(i);
+      pending.push_back(std::move(done));
+    };
+  }
+
+  // Finish the oldest running job.
+  void complete_one() {
+    std::function<void()> done;
+    {
+      std::lock_guard<std::mutex> lk(mu);
+      ASSERT_FALSE(pending.empty());
+      done = std::move(pending.front());
+      pending.erase(pending.begin());
+    }
+    done();
+  }
+};
+
+}  // namespace
+
+TEST(BatchSchedulerTest, EmptyBatchCompletesImmediately) {
+  bool finished = false;
+  auto sched = BatchScheduler::create(
+      {}, {}, [](std::size_t, std::function<void()>) { FAIL(); },
+      [&] { finished = true; });
+  sched->run();
+  EXPECT_TRUE(finished);
+}
+
+TEST(BatchSchedulerTest, RespectsGlobalAndPerOriginCaps) {
+  ManualJobs jobs;
+  BatchOptions opts;
+  opts.max_in_flight = 3;
+  opts.max_in_flight_per_origin = 2;
+  // Origin 7 has four jobs, origin 9 has one.
+  std::vector<BatchScheduler::Key> keys{7, 7, 7, 7, 9};
+  bool finished = false;
+  auto sched = BatchScheduler::create(keys, opts, jobs.starter(),
+                                      [&] { finished = true; });
+  sched->run();
+  // Two from origin 7 (its cap) plus the one from origin 9.
+  ASSERT_EQ(jobs.started.size(), 3u);
+  EXPECT_EQ(std::count(jobs.started.begin(), jobs.started.end(), 4u), 1);
+  EXPECT_EQ(sched->in_flight(), 3u);
+
+  while (!jobs.pending.empty()) {
+    EXPECT_LE(sched->in_flight(), 3u);
+    jobs.complete_one();
+  }
+  EXPECT_TRUE(finished);
+  EXPECT_EQ(jobs.started.size(), keys.size());
+  EXPECT_EQ(sched->completed(), keys.size());
+}
+
+TEST(BatchSchedulerTest, OriginsTakeTurns) {
+  ManualJobs jobs;
+  BatchOptions opts;
+  opts.max_in_flight = 1;
+  opts.max_in_flight_per_origin = 1;
+  std::vector<BatchScheduler::Key> keys{1, 1, 1, 2, 2, 2};
+  auto sched = BatchScheduler::create(keys, opts, jobs.starter(), [] {});
+  sched->run();
+  while (!jobs.pending.empty()) jobs.complete_one();
+  // Jobs 0-2 belong to origin 1, jobs 3-5 to origin 2.
+  EXPECT_EQ(jobs.started, (std::vector<std::size_t>{0, 3, 1, 4, 2, 5}));
+}
+
+TEST(BatchSchedulerTest, ClosedOriginWaitsForOpen) {
+  ManualJobs jobs;
+  std::vector<BatchScheduler::Key> keys{1, 2};
+  auto sched = BatchScheduler::create(keys, {}, jobs.starter(), [] {},
+                                      /*start_open=*/false);
+  sched->run();
+  EXPECT_TRUE(jobs.started.empty());
+  sched->open(2);
+  EXPECT_EQ(jobs.started, (std::vector<std::size_t>{1}));
+  sched->open(2);  // no-op
+  sched->open(1);
+  EXPECT_EQ(jobs.started, (std::vector<std::size_t>{1, 0}));
+}
+
+TEST(BatchSchedulerTest, SynchronousCompletionDoesNotRecurse) {
+  constexpr std::size_t kJobs = 100000;
+  std::vector<BatchScheduler::Key> keys(kJobs, 1);
+  BatchOptions opts;
+  opts.max_in_flight_per_origin = 1;
+  std::size_t ran = 0;
+  bool finished = false;
+  auto sched = BatchScheduler::create(
+      keys, opts,
+      [&](std::size_t, std::function<void()> done) {
+        ++ran;
+        done();
+      },
+      [&] { finished = true; });
+  sched->run();
+  EXPECT_EQ(ran, kJobs);
+  EXPECT_TRUE(finished);
+}
+
+TEST(BatchSchedulerTest, CompletionsFromManyThreads) {
+  constexpr std::size_t kJobs = 2000;
+  std::vector<BatchScheduler::Key> keys;
+  for (std::size_t i = 0; i < kJobs; ++i) keys.push_back(i % 13);
+  BatchOptions opts;
+  opts.max_in_flight = 16;
+  opts.max_in_flight_per_origin = 2;
+  std::atomic<std::size_t> running{0};
+  std::atomic<std::size_t> peak{0};
+  std::atomic<bool> finished{false};
+  std::vector<std::thread> threads;
+  std::mutex threads_mu;
+  auto sched = BatchScheduler::create(
+      keys, opts,
+      [&](std::size_t, std::function<void()> done) {
+        const auto now = ++running;
+        auto prev = peak.load();
+        while (now > prev && !peak.compare_exchange_weak(prev, now)) {
+        }
+        std::lock_guard<std::mutex> lk(threads_mu);
+        threads.emplace_back([&running, done = std::move(done)] {
+          --running;
+          done();
+        });
+      },
+      [&] { finished = true; });
+  sched->run();
+  // Threads keep spawning until the batch drains.
+  for (std::size_t joined = 0;;) {
+    std::thread t;
+    {
+      std::lock_guard<std::mutex> lk(threads_mu);
+      if (joined == threads.size()) {
+        if (finished) break;
+        continue;
+      }
+      t = std::move(threads[joined++]);
+    }
+    t.join();
+  }
+  EXPECT_TRUE(finished);
+  EXPECT_LE(peak.load(), 16u);
+  EXPECT_EQ(sched->completed(), kJobs);
+}
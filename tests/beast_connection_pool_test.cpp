@@ -2,10 +2,17 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
 #include <boost/asio/io_context.hpp>
 #include <boost/asio/ssl/context.hpp>
+#include <filesystem>
+#include <functional>
+#include <memory>
 #include <stdexcept>
 #include <thread>
+#include <vector>
+
+#include "server_certificate.hpp"
 
 using namespace beast_pool;
 
@@ -41,6 +48,26 @@ TEST(BeastConnectionPoolTest, AcquireAndRelease) {
   EXPECT_TRUE(called);
 }
 
+TEST(BeastConnectionPoolTest, OriginTableInternsOnce) {
+  auto& table = OriginTable::global();
+  const OriginId a = table.intern(Origin{"https", "intern.example", 443});
+  const OriginId b = table.intern(Origin{"http", "intern.example", 443});
+  const OriginId c = table.intern(
+      Origin{"https", "intern.example", 443, "/run/sidecar.sock"});
+  EXPECT_NE(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ(table.intern(Origin{"https", "intern.example", 443}), a);
+  EXPECT_EQ(table.get(a).host, "intern.example");
+  EXPECT_EQ(table.get(c).socket_path, "/run/sidecar.sock");
+  // Interning more origins keeps earlier references valid.
+  const Origin* first = &table.get(a);
+  for (int i = 0; i < 1000; ++i) {
+    table.intern(Origin{"http", "bulk" + std::to_string(i) + ".example", 80});
+  }
+  EXPECT_EQ(&table.get(a), first);
+  EXPECT_GE(table.size(), 1003u);
+}
+
 // External network tests can be flaky and may crash in some environments.
 // Disable it in CI; prefer the LocalLoopback test below.
 TEST(BeastConnectionPoolTest, DISABLED_VisitExampleCom) {
@@ -217,3 +244,335 @@ TEST(BeastConnectionPoolTest, DISABLED_LocalLoopback) {
   EXPECT_EQ(status, 200);
   EXPECT_EQ(body, "hello-from-loopback");
 }
+
+// Several keep-alive listeners standing in for the addresses of one host.
+// Each answers every request with its own status and counts hits.
+namespace {
+
+struct MultiListener {
+  struct Listener {
+    explicit Listener(boost::asio::io_context& ioc) : acceptor(ioc) {}
+    tcp::acceptor acceptor;
+    unsigned status = 200;
+    std::atomic<int> hits{0};
+  };
+
+  boost::asio::io_context ioc;
+  std::vector<std::unique_ptr<Listener>> listeners;
+  std::thread thr;
+
+  explicit MultiListener(const std::vector<unsigned>& statuses) {
+    for (auto status : statuses) {
+      auto l = std::make_unique<Listener>(ioc);
+      l->status = status;
+      tcp::endpoint ep{boost::asio::ip::make_address("127.0.0.1"), 0};
+      l->acceptor.open(ep.protocol());
+      l->acceptor.bind(ep);
+      l->acceptor.listen();
+      do_accept(*l);
+      listeners.push_back(std::move(l));
+    }
+    thr = std::thread([this] { ioc.run(); });
+  }
+
+  ~MultiListener() {
+    ioc.stop();
+    if (thr.joinable()) thr.join();
+  }
+
+  std::vector<tcp::endpoint> endpoints() const {
+    std::vector<tcp::endpoint> out;
+    for (auto const& l : listeners) out.push_back(l->acceptor.local_endpoint());
+    return out;
+  }
+
+ private:
+  struct Session : public std::enable_shared_from_this<Session> {
+    Session(tcp::socket s, Listener& l) : stream(std::move(s)), listener(l) {}
+    boost::beast::tcp_stream stream;
+    Listener& listener;
+    boost::beast::flat_buffer buffer;
+    boost::beast::http::request<boost::beast::http::string_body> req;
+    boost::beast::http::response<boost::beast::http::string_body> res;
+
+    void do_read() {
+      req = {};
+      boost::beast::http::async_read(
+          stream, buffer, req,
+          [self = shared_from_this()](boost::system::error_code ec,
+                                      std::size_t) {
+            if (!ec) self->do_write();
+          });
+    }
+
+    void do_write() {
+      namespace http = boost::beast::http;
+      ++listener.hits;
+      res = {};
+      res.result(listener.status);
+      res.version(req.version());
+      res.keep_alive(req.keep_alive());
+      res.prepare_payload();
+      http::async_write(stream, res,
+                        [self = shared_from_this()](
+                            boost::system::error_code ec, std::size_t) {
+                          if (!ec) self->do_read();
+                        });
+    }
+  };
+
+  void do_accept(Listener& l) {
+    l.acceptor.async_accept(
+        [this, &l](boost::system::error_code ec, tcp::socket sock) {
+          if (ec) return;
+          std::make_shared<Session>(std::move(sock), l)->do_read();
+          do_accept(l);
+        });
+  }
+};
+
+// Sends `n` requests one after another through `pool` and runs `ioc` until
+// they are all done.
+void send_sequential(boost::asio::io_context& ioc, ConnectionPool& pool,
+                     Origin const& origin, int n) {
+  namespace http = boost::beast::http;
+  std::function<void(int)> next = [&](int left) {
+    if (left == 0) return;
+    http::request<http::string_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, origin.host);
+    pool.async_request(origin, std::move(req),
+                       [&, left](boost::system::error_code,
+                                 http::request<http::string_body>,
+                                 http::response<http::string_body>) {
+                         next(left - 1);
+                       });
+  };
+  next(n);
+  ioc.run();
+  ioc.restart();
+}
+
+PoolConfig outlier_config(double max_fraction) {
+  PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  cfg.io_timeout = std::chrono::seconds(5);
+  cfg.endpoint_policy = EndpointPolicy::least_outstanding;
+  cfg.outlier_detection.consecutive_failures = 2;
+  cfg.outlier_detection.base_ejection = std::chrono::minutes(5);
+  cfg.outlier_detection.max_ejected_fraction = max_fraction;
+  return cfg;
+}
+
+}  // namespace
+
+TEST(BeastConnectionPoolTest, EjectsFailingListener) {
+  MultiListener server({200, 503, 200});
+  boost::asio::io_context ioc;
+  ConnectionPool pool(ioc, outlier_config(0.5), nullptr);
+  Origin origin{"http", "outlier.test", 80};
+  pool.set_endpoints(origin, server.endpoints());
+
+  send_sequential(ioc, pool, origin, 12);
+  const int bad_hits = server.listeners[1]->hits;
+  EXPECT_EQ(bad_hits, 2);  // ejected after consecutive_failures
+  send_sequential(ioc, pool, origin, 20);
+  EXPECT_EQ(server.listeners[1]->hits, bad_hits);
+  EXPECT_EQ(server.listeners[0]->hits + server.listeners[2]->hits, 30);
+}
+
+TEST(BeastConnectionPoolTest, EjectionRespectsMaxFraction) {
+  MultiListener server({503, 503, 200});
+  boost::asio::io_context ioc;
+  ConnectionPool pool(ioc, outlier_config(0.34), nullptr);
+  Origin origin{"http", "outlier-fraction.test", 80};
+  pool.set_endpoints(origin, server.endpoints());
+
+  send_sequential(ioc, pool, origin, 30);
+  // Only one of the two failing listeners may be out at a time, so the
+  // other keeps getting its share.
+  const int first = server.listeners[0]->hits;
+  const int second = server.listeners[1]->hits;
+  EXPECT_EQ(std::min(first, second), 2);
+  EXPECT_GT(std::max(first, second), 2);
+  EXPECT_GT(server.listeners[2]->hits.load(), 0);
+}
+
+TEST(BeastConnectionPoolTest, WarmStartAddressesSkipLookup) {
+  MultiListener server({200});
+  auto state = std::make_shared<WarmStartState>();
+  // The host does not resolve; only the cached address gets us there.
+  Origin origin{"http", "warm-start.invalid", 80};
+  state->set_addresses(WarmOriginRef{origin.scheme, origin.host, origin.port},
+                       server.endpoints(), std::chrono::seconds(60));
+
+  boost::asio::io_context ioc;
+  PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  ConnectionPool pool(ioc, cfg, nullptr);
+  pool.set_warm_start(state);
+  send_sequential(ioc, pool, origin, 2);
+  EXPECT_EQ(server.listeners[0]->hits, 2);
+  auto top = state->top_origins(1);
+  ASSERT_EQ(top.size(), 1u);
+  EXPECT_EQ(top[0].uses, 2u);
+}
+
+TEST(BeastConnectionPoolTest, StaleWarmStartAddressFallsBackToDns) {
+  MultiListener server({200});
+  const auto live = server.endpoints().front();
+  // A port nothing listens on stands in for the server's old address.
+  tcp::endpoint stale;
+  {
+    boost::asio::io_context tmp;
+    tcp::acceptor a(tmp, tcp::endpoint{live.address(), 0});
+    stale = a.local_endpoint();
+  }
+  Origin origin{"http", "127.0.0.1", live.port()};
+  const WarmOriginRef ref{origin.scheme, origin.host, origin.port};
+  for (auto policy : {EndpointPolicy::first, EndpointPolicy::least_outstanding}) {
+    auto state = std::make_shared<WarmStartState>();
+    state->set_addresses(ref, std::vector<tcp::endpoint>{stale},
+                         std::chrono::seconds(300));
+
+    boost::asio::io_context ioc;
+    PoolConfig cfg;
+    cfg.idle_reap_interval = std::chrono::seconds(0);
+    cfg.endpoint_policy = policy;
+    ConnectionPool pool(ioc, cfg, nullptr);
+    pool.set_warm_start(state);
+    const int before = server.listeners[0]->hits;
+    send_sequential(ioc, pool, origin, 2);
+    EXPECT_EQ(server.listeners[0]->hits - before, 2);
+    // The lookup replaced the stale entry.
+    EXPECT_EQ(state->addresses(ref),
+              (std::vector<tcp::endpoint>{live}));
+  }
+}
+
+// HTTPS listener that records whether each handshake resumed a session.
+namespace {
+
+struct TlsListener {
+  boost::asio::io_context ioc;
+  boost::asio::ssl::context ctx{boost::asio::ssl::context::tls_server};
+  tcp::acceptor acceptor{ioc};
+  std::thread thr;
+  std::atomic<int> handshakes{0};
+  std::atomic<int> resumed{0};
+
+  TlsListener() {
+    cjj365::testcert::load_server_certificate(ctx);
+    tcp::endpoint ep{boost::asio::ip::make_address("127.0.0.1"), 0};
+    acceptor.open(ep.protocol());
+    acceptor.bind(ep);
+    acceptor.listen();
+    do_accept();
+    thr = std::thread([this] { ioc.run(); });
+  }
+
+  ~TlsListener() {
+    ioc.stop();
+    if (thr.joinable()) thr.join();
+  }
+
+  using Stream = boost::asio::ssl::stream<boost::beast::tcp_stream>;
+
+  struct Session : public std::enable_shared_from_this<Session> {
+    Session(tcp::socket s, TlsListener& l)
+        : stream(boost::beast::tcp_stream(std::move(s)), l.ctx), listener(l) {}
+    Stream stream;
+    TlsListener& listener;
+    boost::beast::flat_buffer buffer;
+    boost::beast::http::request<boost::beast::http::string_body> req;
+    boost::beast::http::response<boost::beast::http::string_body> res;
+
+    void run() {
+      stream.async_handshake(
+          boost::asio::ssl::stream_base::server,
+          [self = shared_from_this()](boost::system::error_code ec) {
+            if (ec) return;
+            ++self->listener.handshakes;
+            if (SSL_session_reused(self->stream.native_handle())) {
+              ++self->listener.resumed;
+            }
+            self->do_read();
+          });
+    }
+
+    void do_read() {
+      req = {};
+      boost::beast::http::async_read(
+          stream, buffer, req,
+          [self = shared_from_this()](boost::system::error_code ec,
+                                      std::size_t) {
+            if (!ec) self->do_write();
+          });
+    }
+
+    void do_write() {
+      res = {};
+      res.result(200);
+      res.version(req.version());
+      res.keep_alive(req.keep_alive());
+      res.prepare_payload();
+      boost::beast::http::async_write(
+          stream, res,
+          [self = shared_from_this()](boost::system::error_code ec,
+                                      std::size_t) {
+            if (!ec) self->do_read();
+          });
+    }
+  };
+
+  void do_accept() {
+    acceptor.async_accept([this](boost::system::error_code ec,
+                                 tcp::socket sock) {
+      if (ec) return;
+      std::make_shared<Session>(std::move(sock), *this)->run();
+      do_accept();
+    });
+  }
+};
+
+}  // namespace
+
+TEST(BeastConnectionPoolTest, WarmStartResumesTlsSession) {
+  TlsListener server;
+  Origin origin{"https", "warm-tls.invalid", 443};
+  const WarmOriginRef ref{origin.scheme, origin.host, origin.port};
+  const auto path = std::filesystem::temp_directory_path() /
+                    "beast_connection_pool_test_warm_start.bin";
+
+  // Each round stands in for a separate process: its own TLS context and
+  // pool, with the state handed over through the file.
+  auto run_once = [&](bool load) {
+    auto state = std::make_shared<WarmStartState>();
+    if (load) {
+      EXPECT_TRUE(state->load(path));
+    } else {
+      state->set_addresses(
+          ref,
+          std::vector<tcp::endpoint>{server.acceptor.local_endpoint()},
+          std::chrono::seconds(60));
+    }
+    boost::asio::io_context ioc;
+    boost::asio::ssl::context tls(boost::asio::ssl::context::tls_client);
+    tls.set_verify_mode(boost::asio::ssl::verify_none);
+    PoolConfig cfg;
+    cfg.idle_reap_interval = std::chrono::seconds(0);
+    ConnectionPool pool(ioc, cfg, &tls);
+    pool.set_warm_start(state);
+    send_sequential(ioc, pool, origin, 1);
+    EXPECT_FALSE(state->tls_session(ref).empty());
+    EXPECT_TRUE(state->save(path));
+  };
+
+  run_once(false);
+  EXPECT_EQ(server.handshakes, 1);
+  EXPECT_EQ(server.resumed, 0);
+  run_once(true);
+  EXPECT_EQ(server.handshakes, 2);
+  EXPECT_EQ(server.resumed, 1);
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+}
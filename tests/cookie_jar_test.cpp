@@ -0,0 +1,184 @@
+#include "cookie_jar.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <string>
+
+#include "http_date.hpp"
+
+using client_async::CookieJar;
+namespace http_date = client_async::http_date;
+namespace http = boost::beast::http;
+using namespace std::chrono_literals;
+
+namespace {
+
+http::fields set_cookies(std::initializer_list<const char*> headers) {
+  http::fields f;
+  for (auto const* h : headers) f.insert(http::field::set_cookie, h);
+  return f;
+}
+
+}  // namespace
+
+TEST(CookieJarTest, ParsesAttributesOnce) {
+  const auto now = CookieJar::clock::now();
+  auto c = CookieJar::parse_set_cookie(
+      " sid = abc123 ; Path=/app; Domain=.Example.com; Secure; HttpOnly; "
+      "Max-Age=60; Expires=Wed, 21 Oct 2015 07:28:00 GMT",
+      "www.example.com", "/login", now);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(c->name, "sid");
+  EXPECT_EQ(c->value, "abc123");
+  EXPECT_EQ(c->domain, "example.com");
+  EXPECT_FALSE(c->host_only);
+  EXPECT_EQ(c->path, "/app");
+  EXPECT_TRUE(c->secure);
+  EXPECT_TRUE(c->http_only);
+  ASSERT_TRUE(c->expires);
+  EXPECT_EQ(*c->expires, now + 60s);  // Max-Age beats Expires
+
+  // No Path: the directory of the request path.
+  c = CookieJar::parse_set_cookie("a=1", "example.com", "/docs/page", now);
+  ASSERT_TRUE(c);
+  EXPECT_EQ(c->path, "/docs");
+  EXPECT_TRUE(c->host_only);
+  EXPECT_FALSE(c->expires);
+
+  EXPECT_FALSE(CookieJar::parse_set_cookie("novalue", "example.com", "/", now));
+  EXPECT_FALSE(CookieJar::parse_set_cookie("a=1; Domain=other.com",
+                                           "example.com", "/", now));
+  EXPECT_FALSE(
+      CookieJar::parse_set_cookie("a=1; Domain=com", "example.com", "/", now));
+}
+
+TEST(HttpDateTest, ParsesCookieDates) {
+  auto t = http_date::parse("Wed, 21 Oct 2015 07:28:00 GMT");
+  ASSERT_TRUE(t);
+  EXPECT_EQ(std::chrono::duration_cast<std::chrono::seconds>(
+                t->time_since_epoch())
+                .count(),
+            1445412480);
+  // Old two-digit RFC 850 years.
+  t = http_date::parse("Sunday, 06-Nov-94 08:49:37 GMT");
+  ASSERT_TRUE(t);
+  EXPECT_EQ(std::chrono::duration_cast<std::chrono::seconds>(
+                t->time_since_epoch())
+                .count(),
+            784111777);
+  EXPECT_FALSE(http_date::parse("not a date"));
+  EXPECT_FALSE(http_date::parse("Wed, 32 Oct 2015 07:28:00 GMT"));
+}
+
+TEST(CookieJarTest, ReverseDomain) {
+  EXPECT_EQ(CookieJar::reverse_domain("api.example.com"), "com.example.api");
+  EXPECT_EQ(CookieJar::reverse_domain("localhost"), "localhost");
+  EXPECT_EQ(CookieJar::reverse_domain(""), "");
+}
+
+TEST(CookieJarTest, MatchesDomainAndPath) {
+  CookieJar jar;
+  jar.store("www.example.com", "/app/login?next=1",
+            set_cookies({"host=1", "dom=2; Domain=example.com; Path=/",
+                         "deep=3; Path=/app/admin"}));
+  EXPECT_EQ(jar.size(), 3u);
+
+  EXPECT_EQ(jar.cookie_header("www.example.com", "/app/x", false),
+            "host=1; dom=2");
+  // Domain cookies reach subdomains; host-only ones do not.
+  EXPECT_EQ(jar.cookie_header("api.example.com", "/app/x", false), "dom=2");
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false), "dom=2");
+  EXPECT_EQ(jar.cookie_header("badexample.com", "/", false), "");
+  // Longest path first; "/app/administrator" is not under "/app/admin".
+  EXPECT_EQ(jar.cookie_header("WWW.example.com", "/app/admin/users", false),
+            "deep=3; host=1; dom=2");
+  EXPECT_EQ(jar.cookie_header("www.example.com", "/app/administrator", false),
+            "host=1; dom=2");
+  EXPECT_EQ(jar.get("dom", "api.example.com"), "2");
+  EXPECT_FALSE(jar.get("host", "api.example.com"));
+}
+
+TEST(CookieJarTest, SecureCookiesNeedHttps) {
+  CookieJar jar;
+  jar.store("example.com", "/", set_cookies({"s=1; Secure", "p=2"}));
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false), "p=2");
+  EXPECT_EQ(jar.cookie_header("example.com", "/", true), "s=1; p=2");
+}
+
+TEST(CookieJarTest, ReplacesAndDeletes) {
+  const auto now = CookieJar::clock::now();
+  CookieJar jar;
+  jar.store("example.com", "/", set_cookies({"a=1", "b=2"}), now);
+  jar.store("example.com", "/", set_cookies({"a=3"}), now + 1s);
+  // Replacing keeps the original creation order.
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 1s),
+            "a=3; b=2");
+  jar.store("example.com", "/", set_cookies({"b=; Max-Age=0"}), now + 2s);
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 2s), "a=3");
+  EXPECT_EQ(jar.size(), 1u);
+}
+
+TEST(CookieJarTest, ExpiresThroughHeap) {
+  const auto now = CookieJar::clock::now();
+  CookieJar jar;
+  jar.store("example.com", "/",
+            set_cookies({"short=1; Max-Age=10", "long=2; Max-Age=100",
+                         "session=3"}),
+            now);
+  // Refreshing `short` leaves its first heap entry stale.
+  jar.store("example.com", "/", set_cookies({"short=4; Max-Age=50"}),
+            now + 5s);
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 20s),
+            "short=4; long=2; session=3");
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 60s),
+            "long=2; session=3");
+  jar.purge_expired(now + 200s);
+  EXPECT_EQ(jar.size(), 1u);
+}
+
+TEST(CookieJarTest, SlidingExpiryKeepsHeapBounded) {
+  const auto now = CookieJar::clock::now();
+  CookieJar jar;
+  // A year-long session cookie refreshed on every response.
+  for (int i = 0; i < 10000; ++i) {
+    jar.store("example.com", "/", set_cookies({"sid=1; Max-Age=31536000"}),
+              now + std::chrono::seconds(i));
+  }
+  EXPECT_EQ(jar.size(), 1u);
+  EXPECT_LE(jar.pending_expiries(), 2 * jar.size() + 64);
+  // The live deadline survives compaction.
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 31536000s),
+            "sid=1");
+  jar.purge_expired(now + 31546000s);
+  EXPECT_EQ(jar.size(), 0u);
+}
+
+TEST(CookieJarTest, CapsCookiesPerDomain) {
+  const auto now = CookieJar::clock::now();
+  CookieJar jar(/*max_per_domain=*/2);
+  jar.store("example.com", "/", set_cookies({"a=1"}), now);
+  jar.store("example.com", "/", set_cookies({"b=2"}), now + 1s);
+  jar.store("example.com", "/", set_cookies({"c=3"}), now + 2s);
+  EXPECT_EQ(jar.cookie_header("example.com", "/", false, now + 2s),
+            "b=2; c=3");
+}
+
+TEST(CookieJarTest, AppliesToRequests) {
+  CookieJar jar;
+  jar.store("example.com", "/", set_cookies({"sid=abc"}));
+  http::request<http::empty_body> req{http::verb::get, "/items?page=2", 11};
+  jar.apply(req, "example.com", false);
+  EXPECT_EQ(req[http::field::cookie], "sid=abc");
+
+  // Caller-set cookies come first.
+  http::request<http::empty_body> own{http::verb::get, "/", 11};
+  own.set(http::field::cookie, "pref=dark");
+  jar.apply(own, "example.com", false);
+  EXPECT_EQ(own[http::field::cookie], "pref=dark; sid=abc");
+
+  http::request<http::empty_body> other{http::verb::get, "/", 11};
+  jar.apply(other, "other.com", false);
+  EXPECT_EQ(other.find(http::field::cookie), other.end());
+}
@@ -0,0 +1,208 @@
+#include "endpoint_set.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/ip/address.hpp>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using beast_pool::EndpointPolicy;
+using beast_pool::EndpointSet;
+using beast_pool::OutlierDetection;
+using beast_pool::RequestOutcome;
+using tcp = boost::asio::ip::tcp;
+using namespace std::chrono_literals;
+
+namespace {
+
+tcp::endpoint ep(const std::string& ip, unsigned short port = 443) {
+  return {boost::asio::ip::make_address(ip), port};
+}
+
+EndpointSet make_set(const std::vector<tcp::endpoint>& eps) {
+  EndpointSet set;
+  set.update(eps, EndpointSet::clock::now());
+  return set;
+}
+
+}  // namespace
+
+TEST(EndpointSetTest, FirstPolicyAlwaysPicksFirst) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(set.pick(EndpointPolicy::first), 0u);
+  }
+}
+
+TEST(EndpointSetTest, LeastOutstandingRotatesOnTies) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2"), ep("10.0.0.3")});
+  std::vector<std::size_t> picks;
+  for (int i = 0; i < 6; ++i) {
+    picks.push_back(set.pick(EndpointPolicy::least_outstanding));
+  }
+  EXPECT_EQ(picks, (std::vector<std::size_t>{0, 1, 2, 0, 1, 2}));
+}
+
+TEST(EndpointSetTest, LeastOutstandingAvoidsBusyAddress) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  set.find(ep("10.0.0.1"))->active = 5;
+  for (int i = 0; i < 4; ++i) {
+    const auto idx = set.pick(EndpointPolicy::least_outstanding);
+    EXPECT_EQ(idx, 1u);
+    ++set.find(set.loads()[idx].endpoint)->active;
+  }
+  // Now 5 vs 4: still the second one, then they even out.
+  EXPECT_EQ(set.pick(EndpointPolicy::least_outstanding), 1u);
+}
+
+TEST(EndpointSetTest, PowerOfTwoPrefersLighterAddress) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  set.find(ep("10.0.0.2"))->active = 3;
+  // With two addresses both are always sampled.
+  for (int i = 0; i < 20; ++i) {
+    EXPECT_EQ(set.pick(EndpointPolicy::power_of_two), 0u);
+  }
+}
+
+TEST(EndpointSetTest, PowerOfTwoSpreadsEqualLoad) {
+  auto set = make_set(
+      {ep("10.0.0.1"), ep("10.0.0.2"), ep("10.0.0.3"), ep("10.0.0.4")});
+  std::map<std::size_t, int> hits;
+  for (int i = 0; i < 4000; ++i) {
+    const auto idx = set.pick(EndpointPolicy::power_of_two);
+    ++hits[idx];
+    ++set.find(set.loads()[idx].endpoint)->active;
+  }
+  for (auto const& [idx, n] : hits) {
+    EXPECT_NEAR(n, 1000, 10) << "endpoint " << idx;
+  }
+}
+
+TEST(EndpointSetTest, UpdateKeepsLoadsOfSurvivingAddresses) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  set.find(ep("10.0.0.1"))->active = 2;
+  set.find(ep("10.0.0.2"))->active = 7;
+  // DNS now returns .2 and a new .3; duplicates are collapsed.
+  set.update(std::vector<tcp::endpoint>{ep("10.0.0.2"), ep("10.0.0.3"),
+                                        ep("10.0.0.3")},
+             EndpointSet::clock::now());
+  ASSERT_EQ(set.size(), 2u);
+  EXPECT_EQ(set.find(ep("10.0.0.1")), nullptr);
+  EXPECT_EQ(set.find(ep("10.0.0.2"))->active, 7u);
+  EXPECT_EQ(set.find(ep("10.0.0.3"))->active, 0u);
+}
+
+TEST(EndpointSetTest, StaleAfterRefreshInterval) {
+  EndpointSet set;
+  const auto t0 = EndpointSet::clock::now();
+  set.update(std::vector<tcp::endpoint>{ep("10.0.0.1")}, t0);
+  EXPECT_FALSE(set.stale(30s, t0 + 10s));
+  EXPECT_TRUE(set.stale(30s, t0 + 30s));
+  EXPECT_FALSE(set.stale(0s, t0 + 1h));  // refresh disabled
+  set.touch(t0 + 30s);
+  EXPECT_FALSE(set.stale(30s, t0 + 40s));
+}
+
+namespace {
+
+OutlierDetection detection(std::size_t failures) {
+  OutlierDetection od;
+  od.consecutive_failures = failures;
+  od.base_ejection = 10s;
+  od.max_ejection = 35s;
+  od.max_ejected_fraction = 0.5;
+  return od;
+}
+
+const RequestOutcome kFailed{true, {}};
+const RequestOutcome kOk{false, {}};
+
+}  // namespace
+
+TEST(EndpointSetTest, EjectsAfterConsecutiveFailures) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  const auto od = detection(3);
+  const auto t0 = EndpointSet::clock::now();
+  const auto bad = ep("10.0.0.2");
+  EXPECT_FALSE(set.report(bad, kFailed, od, t0));
+  EXPECT_FALSE(set.report(bad, kOk, od, t0));  // resets the streak
+  EXPECT_FALSE(set.report(bad, kFailed, od, t0));
+  EXPECT_FALSE(set.report(bad, kFailed, od, t0));
+  EXPECT_TRUE(set.report(bad, kFailed, od, t0));
+  EXPECT_EQ(set.ejected_count(t0), 1u);
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(set.pick(EndpointPolicy::least_outstanding, t0), 0u);
+  }
+  // Back in rotation once the ejection expires.
+  EXPECT_EQ(set.ejected_count(t0 + 10s), 0u);
+}
+
+TEST(EndpointSetTest, EjectionTimeBacksOffAndRecovers) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  const auto od = detection(1);
+  auto now = EndpointSet::clock::now();
+  const auto bad = ep("10.0.0.2");
+  const auto eject = [&] {
+    EXPECT_TRUE(set.report(bad, kFailed, od, now));
+    const auto until = set.find(bad)->ejected_until - now;
+    now = set.find(bad)->ejected_until;
+    return until;
+  };
+  EXPECT_EQ(eject(), 10s);
+  EXPECT_EQ(eject(), 20s);
+  EXPECT_EQ(eject(), 35s);  // capped at max_ejection
+  // Healthy requests earn the backoff back one step at a time.
+  EXPECT_FALSE(set.report(bad, kOk, od, now));
+  EXPECT_FALSE(set.report(bad, kOk, od, now));
+  EXPECT_EQ(eject(), 20s);
+}
+
+TEST(EndpointSetTest, EjectedFractionIsCapped) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2"), ep("10.0.0.3")});
+  auto od = detection(1);
+  od.max_ejected_fraction = 0.34;
+  const auto t0 = EndpointSet::clock::now();
+  EXPECT_TRUE(set.report(ep("10.0.0.1"), kFailed, od, t0));
+  EXPECT_FALSE(set.report(ep("10.0.0.2"), kFailed, od, t0));
+  EXPECT_EQ(set.ejected_count(t0), 1u);
+
+  // A lone address is never ejected.
+  auto single = make_set({ep("10.0.0.9")});
+  EXPECT_FALSE(single.report(ep("10.0.0.9"), kFailed, od, t0));
+}
+
+TEST(EndpointSetTest, DisabledDetectionNeverEjects) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2")});
+  const auto t0 = EndpointSet::clock::now();
+  for (int i = 0; i < 10; ++i) {
+    EXPECT_FALSE(set.report(ep("10.0.0.1"), kFailed, OutlierDetection{}, t0));
+  }
+  EXPECT_EQ(set.ejected_count(t0), 0u);
+}
+
+TEST(EndpointSetTest, SlowAddressIsEjectedAsLatencyOutlier) {
+  auto set = make_set({ep("10.0.0.1"), ep("10.0.0.2"), ep("10.0.0.3")});
+  auto od = detection(2);
+  od.latency_factor = 3;
+  od.latency_min_samples = 5;
+  const auto t0 = EndpointSet::clock::now();
+  bool ejected = false;
+  for (int i = 0; i < 10 && !ejected; ++i) {
+    set.report(ep("10.0.0.1"), RequestOutcome{false, 10ms}, od, t0);
+    set.report(ep("10.0.0.2"), RequestOutcome{false, 12ms}, od, t0);
+    ejected = set.report(ep("10.0.0.3"), RequestOutcome{false, 200ms}, od, t0);
+  }
+  EXPECT_TRUE(ejected);
+  EXPECT_GT(set.find(ep("10.0.0.3"))->ejected_until, t0);
+  EXPECT_EQ(set.ejected_count(t0), 1u);
+}
+
+TEST(EndpointSetTest, PinnedSetIsNeverStale) {
+  EndpointSet set;
+  const auto t0 = EndpointSet::clock::now();
+  set.pin(std::vector<tcp::endpoint>{ep("10.0.0.1")}, t0);
+  EXPECT_TRUE(set.pinned());
+  EXPECT_FALSE(set.stale(30s, t0 + 1h));
+}
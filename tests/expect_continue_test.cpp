@@ -0,0 +1,177 @@
+#include "expect_continue.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+using client_async::ExpectContinueOutcome;
+using client_async::ExpectContinuePolicy;
+
+namespace {
+
+enum class Mode { accept, reject, silent };
+
+// Single-connection server that reacts to `Expect: 100-continue` per `mode`
+// and records how many body bytes actually reached it.
+struct ContinueServer {
+  net::io_context ioc{1};
+  tcp::acceptor acceptor;
+  std::thread thr;
+  unsigned short port{};
+  std::atomic<std::size_t> body_bytes{0};
+  std::atomic<bool> saw_expect{false};
+
+  explicit ContinueServer(Mode mode)
+      : acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0),
+                 true) {
+    port = acceptor.local_endpoint().port();
+    thr = std::thread([this, mode] {
+      boost::system::error_code ec;
+      tcp::socket sock(ioc);
+      acceptor.accept(sock, ec);
+      if (ec) return;
+      boost::beast::flat_buffer buf;
+      http::request_parser<http::string_body> parser;
+      parser.body_limit(std::uint64_t{64} << 20);
+      http::read_header(sock, buf, parser, ec);
+      if (ec) return;
+      saw_expect = parser.get()[http::field::expect] == "100-continue";
+      if (mode == Mode::reject) {
+        http::response<http::string_body> res{
+            http::status::payload_too_large, 11};
+        res.body() = "too large";
+        res.prepare_payload();
+        http::write(sock, res, ec);
+        // Give a misbehaving client time to push the body anyway.
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        body_bytes = buf.size() + sock.available(ec);
+        return;
+      }
+      if (mode == Mode::accept) {
+        http::response<http::empty_body> cont{http::status::continue_, 11};
+        http::write(sock, cont, ec);
+      }
+      http::read(sock, buf, parser, ec);
+      if (ec) return;
+      body_bytes = parser.get().body().size();
+      http::response<http::string_body> res{http::status::ok, 11};
+      res.body() = std::to_string(body_bytes.load());
+      res.prepare_payload();
+      http::write(sock, res, ec);
+    });
+  }
+
+  ~ContinueServer() {
+    if (thr.joinable()) thr.join();
+  }
+};
+
+struct Result {
+  ExpectContinueOutcome outcome;
+  boost::beast::error_code ec;
+  unsigned status = 0;
+  std::string body;
+};
+
+Result exchange(unsigned short port, std::size_t body_size,
+                std::chrono::milliseconds wait) {
+  net::io_context ioc;
+  boost::beast::tcp_stream stream(ioc);
+  boost::beast::flat_buffer buffer;
+  http::request<http::string_body> req{http::verb::put, "/upload", 11};
+  req.body().assign(body_size, 'x');
+  req.prepare_payload();
+  std::optional<http::response_parser<http::empty_body>> interim;
+  std::optional<http::response_parser<http::string_body>> parser;
+  Result r;
+
+  auto read_rest = [&] {
+    if (interim) {
+      parser.emplace(std::move(*interim));
+      interim.reset();
+    } else {
+      parser.emplace();
+    }
+    http::async_read(stream, buffer, *parser,
+                     [&](boost::beast::error_code ec, std::size_t) {
+                       r.ec = ec;
+                       r.status = parser->get().result_int();
+                       r.body = parser->get().body();
+                     });
+  };
+
+  stream.async_connect(
+      tcp::endpoint(net::ip::make_address("127.0.0.1"), port),
+      [&](boost::system::error_code ec) {
+        ASSERT_FALSE(ec);
+        stream.expires_after(std::chrono::seconds(5));
+        client_async::async_send_expect_continue(
+            stream, buffer, req, interim, wait, std::chrono::seconds(5),
+            [&](boost::beast::error_code ec, ExpectContinueOutcome o) {
+              r.outcome = o;
+              r.ec = ec;
+              if (!ec) read_rest();
+            });
+      });
+  ioc.run();
+  return r;
+}
+
+}  // namespace
+
+TEST(ExpectContinueTest, PolicyThreshold) {
+  ExpectContinuePolicy policy;
+  http::request<http::string_body> req{http::verb::post, "/", 11};
+  req.body() = std::string(100, 'a');
+  req.prepare_payload();
+  EXPECT_FALSE(client_async::wants_expect_continue(req, policy));
+  policy.threshold = 101;
+  EXPECT_FALSE(client_async::wants_expect_continue(req, policy));
+  policy.threshold = 100;
+  EXPECT_TRUE(client_async::wants_expect_continue(req, policy));
+  http::request<http::empty_body> get{http::verb::get, "/", 11};
+  EXPECT_FALSE(client_async::wants_expect_continue(get, policy));
+}
+
+TEST(ExpectContinueTest, BodySentAfterContinue) {
+  ContinueServer server(Mode::accept);
+  auto r = exchange(server.port, 256 * 1024, std::chrono::seconds(5));
+  EXPECT_FALSE(r.ec) << r.ec.message();
+  EXPECT_TRUE(r.outcome.body_sent);
+  EXPECT_EQ(r.status, 200u);
+  EXPECT_EQ(r.body, std::to_string(256 * 1024));
+  EXPECT_TRUE(server.saw_expect);
+}
+
+TEST(ExpectContinueTest, EarlyRejectionSkipsBody) {
+  ContinueServer server(Mode::reject);
+  auto r = exchange(server.port, 4 * 1024 * 1024, std::chrono::seconds(5));
+  EXPECT_FALSE(r.ec) << r.ec.message();
+  EXPECT_FALSE(r.outcome.body_sent);
+  EXPECT_EQ(r.status, 413u);
+  EXPECT_EQ(r.body, "too large");
+  server.thr.join();
+  EXPECT_EQ(server.body_bytes.load(), 0u);
+}
+
+TEST(ExpectContinueTest, SilentServerGetsBodyAfterWait) {
+  ContinueServer server(Mode::silent);
+  auto start = std::chrono::steady_clock::now();
+  auto r = exchange(server.port, 64 * 1024, std::chrono::milliseconds(100));
+  EXPECT_GE(std::chrono::steady_clock::now() - start,
+            std::chrono::milliseconds(100));
+  EXPECT_FALSE(r.ec) << r.ec.message();
+  EXPECT_TRUE(r.outcome.body_sent);
+  EXPECT_EQ(r.status, 200u);
+  EXPECT_EQ(r.body, std::to_string(64 * 1024));
+}
@@ -0,0 +1,266 @@
+#include "fast_response_parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <string>
+#include <thread>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+using namespace client_async::fast_http;
+
+namespace {
+
+constexpr std::string_view kSmall =
+    "HTTP/1.1 200 OK\r\n"
+    "Server: nginx\r\n"
+    "Date: Sat, 17 Oct 2026 10:00:00 GMT\r\n"
+    "Content-Type: application/json; charset=utf-8\r\n"
+    "Content-Length: 17\r\n"
+    "Connection: keep-alive\r\n"
+    "ETag:   \"abc\"  \r\n"
+    "X-Request-Id: 1f2e\r\n"
+    "\r\n"
+    "{\"ok\":true,\"n\":1}";
+
+// Writes `raw` on the first accepted connection, then closes it.
+struct RawServer {
+  net::io_context ioc{1};
+  tcp::acceptor acceptor{ioc, {net::ip::make_address("127.0.0.1"), 0}};
+  std::thread thr;
+
+  explicit RawServer(std::string raw) {
+    thr = std::thread([this, raw = std::move(raw)] {
+      boost::system::error_code ec;
+      tcp::socket s(ioc);
+      acceptor.accept(s, ec);
+      if (ec) return;
+      // Dribble the bytes to exercise incremental parsing.
+      for (std::size_t i = 0; i < raw.size(); i += 7) {
+        net::write(s, net::buffer(raw.data() + i, std::min<std::size_t>(
+                                                      7, raw.size() - i)),
+                   ec);
+      }
+      s.shutdown(tcp::socket::shutdown_send, ec);
+      char sink[64];
+      s.read_some(net::buffer(sink), ec);
+    });
+  }
+  ~RawServer() { thr.join(); }
+  unsigned short port() const { return acceptor.local_endpoint().port(); }
+};
+
+struct ReadResult {
+  boost::beast::error_code ec;
+  FastResponse res;
+  std::string leftover;
+};
+
+ReadResult read_from(std::string raw, FastReadOptions opts = {}) {
+  RawServer server(std::move(raw));
+  net::io_context ioc;
+  boost::beast::tcp_stream stream(ioc);
+  boost::beast::flat_buffer buffer;
+  ReadResult out;
+  stream.connect({net::ip::make_address("127.0.0.1"), server.port()});
+  async_read_fast_response(stream, buffer, out.res, opts,
+                           [&](boost::beast::error_code ec) { out.ec = ec; });
+  ioc.run();
+  out.leftover = boost::beast::buffers_to_string(buffer.data());
+  return out;
+}
+
+}  // namespace
+
+TEST(FastResponseParserTest, ParsesHeadAndFraming) {
+  ResponseHead head;
+  const int n = parse_response_head(kSmall.data(), kSmall.size(), head);
+  ASSERT_GT(n, 0);
+  EXPECT_EQ(kSmall.substr(static_cast<std::size_t>(n)), "{\"ok\":true,\"n\":1}");
+  EXPECT_EQ(head.version, 11u);
+  EXPECT_EQ(head.status, 200u);
+  EXPECT_EQ(head.reason, "OK");
+  EXPECT_EQ(head.headers.size(), 7u);
+  EXPECT_EQ(head.content_length, 17u);
+  EXPECT_FALSE(head.chunked);
+  EXPECT_TRUE(head.keep_alive);
+  EXPECT_EQ(head.headers.find(KnownField::etag), "\"abc\"");
+  EXPECT_EQ(head.headers.find("CONTENT-TYPE"),
+            "application/json; charset=utf-8");
+  EXPECT_EQ(head.headers.find("x-request-id"), "1f2e");
+  EXPECT_FALSE(head.headers.find("set-cookie").has_value());
+}
+
+TEST(FastResponseParserTest, IncompleteAtEveryPrefix) {
+  const auto head_len = kSmall.find("\r\n\r\n") + 4;
+  for (std::size_t len = 0; len < head_len; ++len) {
+    ResponseHead head;
+    EXPECT_EQ(parse_response_head(kSmall.data(), len, head), kParseIncomplete)
+        << "len=" << len;
+  }
+}
+
+TEST(FastResponseParserTest, RejectsMalformedHeads) {
+  for (std::string_view bad : {
+           std::string_view("HTTP/2 200 OK\r\n\r\n"),
+           std::string_view("HTTX/1.1 200 OK\r\n\r\n"),
+           std::string_view("HTTP/1.1 2x0 OK\r\n\r\n"),
+           std::string_view("HTTP/1.1 200 OK\r\nBad Name: v\r\n\r\n"),
+           std::string_view("HTTP/1.1 200 OK\r\n: v\r\n\r\n"),
+           std::string_view("HTTP/1.1 200 OK\r\nA: b\x01\r\n\r\n"),
+           std::string_view("HTTP/1.1 200 OK\r\nA: b\r\n folded\r\n\r\n"),
+           std::string_view("HTTP/1.1 200 OK\r\nContent-Length: 1x\r\n\r\n"),
+           std::string_view(
+               "HTTP/1.1 200 OK\r\nContent-Length: 1\r\nContent-Length: 2\r\n"
+               "\r\n"),
+       }) {
+    ResponseHead head;
+    EXPECT_EQ(parse_response_head(bad.data(), bad.size(), head), kParseError)
+        << bad;
+  }
+}
+
+TEST(FastResponseParserTest, KeepAliveAndChunkedRules) {
+  ResponseHead head;
+  std::string_view h10 = "HTTP/1.0 200 OK\nContent-Length: 0\n\n";
+  ASSERT_GT(parse_response_head(h10.data(), h10.size(), head), 0);
+  EXPECT_FALSE(head.keep_alive);
+  std::string_view chunked =
+      "HTTP/1.1 200 OK\r\nTransfer-Encoding: gzip, Chunked\r\n"
+      "Content-Length: 10\r\nConnection: close\r\n\r\n";
+  ASSERT_GT(parse_response_head(chunked.data(), chunked.size(), head), 0);
+  EXPECT_TRUE(head.chunked);
+  EXPECT_FALSE(head.content_length.has_value());
+  EXPECT_FALSE(head.keep_alive);
+}
+
+TEST(FastResponseParserTest, ChunkedDecoderAcrossSplits) {
+  const std::string wire =
+      "5;name=val\r\nhello\r\n"
+      "7\r\n, world\r\n"
+      "0\r\nTrailer: x\r\n\r\n"
+      "NEXT";
+  for (std::size_t split = 1; split < wire.size(); ++split) {
+    ChunkedDecoder dec;
+    std::string out;
+    std::size_t used1 = 0, used2 = 0;
+    auto r = dec.decode(wire.data(), split, out, used1, UINT64_MAX);
+    ASSERT_NE(r, ChunkedDecoder::Result::error) << split;
+    if (r != ChunkedDecoder::Result::done) {
+      ASSERT_EQ(used1, split);
+      r = dec.decode(wire.data() + split, wire.size() - split, out, used2,
+                     UINT64_MAX);
+    }
+    ASSERT_EQ(r, ChunkedDecoder::Result::done) << split;
+    EXPECT_EQ(out, "hello, world");
+    EXPECT_EQ(wire.substr(used1 + used2), "NEXT");
+  }
+}
+
+TEST(FastResponseParserTest, ChunkedDecoderErrorsAndLimit) {
+  for (std::string bad : {"x\r\n", "5\r\nhelloXX", "11111111111111111\r\n"}) {
+    ChunkedDecoder dec;
+    std::string out;
+    std::size_t used = 0;
+    EXPECT_EQ(dec.decode(bad.data(), bad.size(), out, used, UINT64_MAX),
+              ChunkedDecoder::Result::error)
+        << bad;
+  }
+  ChunkedDecoder dec;
+  std::string out;
+  std::size_t used = 0;
+  std::string wire = "a\r\n0123456789\r\n0\r\n\r\n";
+  EXPECT_EQ(dec.decode(wire.data(), wire.size(), out, used, 4),
+            ChunkedDecoder::Result::body_limit);
+}
+
+TEST(FastResponseParserTest, AsyncReadContentLengthLeavesPipelinedBytes) {
+  auto r = read_from(std::string(kSmall) + "HTTP/1.1 204 No Content\r\n\r\n");
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  EXPECT_EQ(r.res.body, "{\"ok\":true,\"n\":1}");
+  EXPECT_EQ(r.res.head.headers.find(KnownField::content_type),
+            "application/json; charset=utf-8");
+  EXPECT_EQ(r.leftover, "HTTP/1.1 204 No Content\r\n\r\n");
+  auto beast_res = std::move(r.res).to_beast();
+  EXPECT_EQ(beast_res.result_int(), 200);
+  EXPECT_EQ(beast_res[http::field::etag], "\"abc\"");
+  EXPECT_EQ(beast_res.body(), "{\"ok\":true,\"n\":1}");
+  EXPECT_TRUE(beast_res.keep_alive());
+}
+
+TEST(FastResponseParserTest, AsyncReadSkipsContinueAndDecodesChunked) {
+  auto r = read_from(
+      "HTTP/1.1 100 Continue\r\n\r\n"
+      "HTTP/1.1 201 Created\r\nTransfer-Encoding: chunked\r\n\r\n"
+      "3\r\nabc\r\n4\r\ndefg\r\n0\r\n\r\n");
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  EXPECT_EQ(r.res.head.status, 201u);
+  EXPECT_EQ(r.res.body, "abcdefg");
+}
+
+TEST(FastResponseParserTest, AsyncReadUntilEofAndLimits) {
+  auto r = read_from("HTTP/1.0 200 OK\r\n\r\nstream until close");
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  EXPECT_EQ(r.res.body, "stream until close");
+
+  FastReadOptions small;
+  small.body_limit = 4;
+  r = read_from(std::string(kSmall), small);
+  EXPECT_EQ(r.ec, http::error::body_limit);
+
+  r = read_from("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nshort");
+  EXPECT_EQ(r.ec, http::error::partial_message);
+
+  FastReadOptions head_req;
+  head_req.head_request = true;
+  r = read_from("HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\n", head_req);
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  EXPECT_TRUE(r.res.body.empty());
+}
+
+TEST(FastResponseParserTest, AsyncReadHeadLimitsAndBareLineFeeds) {
+  // Bare-LF terminator split across the 7-byte writes.
+  auto r = read_from("HTTP/1.1 200 OK\nX-A: 1\nContent-Length: 2\n\nok");
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  EXPECT_EQ(r.res.head.headers.find("x-a"), "1");
+  EXPECT_EQ(r.res.body, "ok");
+
+  r = read_from("SMTP ready\r\n\r\n");
+  EXPECT_EQ(r.ec, http::error::bad_value);
+
+  FastReadOptions tiny;
+  tiny.header_limit = 32;
+  r = read_from("HTTP/1.1 200 OK\r\nX-Long: " + std::string(64, 'v') +
+                    "\r\n\r\n",
+                tiny);
+  EXPECT_EQ(r.ec, http::error::header_limit);
+}
+
+TEST(FastResponseParserTest, FlatHeadersBypassBeastFields) {
+  auto r = read_from(std::string(kSmall));
+  ASSERT_FALSE(r.ec) << r.ec.message();
+  FastResponseHead fields;
+  auto beast_res = std::move(r.res).to_beast(fields);
+  EXPECT_EQ(beast_res.result_int(), 200);
+  EXPECT_EQ(beast_res.body(), "{\"ok\":true,\"n\":1}");
+  EXPECT_EQ(beast_res.begin(), beast_res.end());
+  EXPECT_EQ(fields.head.headers.find(KnownField::etag), "\"abc\"");
+  EXPECT_EQ(fields.head.headers.find("x-request-id"), "1f2e");
+
+  // A head short enough to live inside the arena string itself.
+  FastResponse small;
+  small.arena = "HTTP/1.0 204\n\n";
+  ASSERT_GT(parse_response_head(small.arena.data(), small.arena.size(),
+                                small.head),
+            0);
+  const std::string_view arena(small.arena);
+  small.head.headers.add(arena.substr(0, 4), arena.substr(5, 3));
+  std::move(small).to_beast(fields);
+  EXPECT_EQ(fields.head.status, 204u);
+  EXPECT_EQ(fields.head.headers.find("http"), "1.0");
+  EXPECT_EQ(fields.head.headers[0].name.data(), fields.arena.data());
+}
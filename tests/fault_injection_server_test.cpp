@@ -0,0 +1,218 @@
+#include "fault_injection_server.hpp"
+
+#include <gtest/gtest.h>
+#include <zlib.h>
+
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <string>
+
+#include "beast_connection_pool.hpp"
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+using namespace cjj365::testsrv;
+using namespace std::chrono_literals;
+
+namespace {
+
+struct Fetched {
+  boost::system::error_code ec;
+  http::response<http::string_body> res;
+};
+
+// One blocking GET on an already connected stream.
+template <class Stream>
+Fetched get(Stream& stream, boost::beast::flat_buffer& buf,
+            const std::string& target) {
+  Fetched out;
+  http::request<http::empty_body> req{http::verb::get, target, 11};
+  req.set(http::field::host, "127.0.0.1");
+  http::write(stream, req, out.ec);
+  if (!out.ec) http::read(stream, buf, out.res, out.ec);
+  return out;
+}
+
+Fetched get(const FaultServer& server, const std::string& target) {
+  net::io_context ioc;
+  tcp::socket sock(ioc);
+  sock.connect({net::ip::make_address("127.0.0.1"), server.port()});
+  boost::beast::flat_buffer buf;
+  return get(sock, buf, target);
+}
+
+std::string gunzip(const std::string& in) {
+  z_stream zs{};
+  EXPECT_EQ(inflateInit2(&zs, 15 + 16), Z_OK);
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  std::string out;
+  char chunk[1024];
+  int rc = Z_OK;
+  while (rc == Z_OK) {
+    zs.next_out = reinterpret_cast<Bytef*>(chunk);
+    zs.avail_out = sizeof(chunk);
+    rc = inflate(&zs, Z_NO_FLUSH);
+    out.append(chunk, sizeof(chunk) - zs.avail_out);
+  }
+  inflateEnd(&zs);
+  EXPECT_EQ(rc, Z_STREAM_END);
+  return out;
+}
+
+}  // namespace
+
+TEST(FaultInjectionServerTest, ScriptAdvancesPerRoute) {
+  FaultServer server;
+  server.route("/limited", {too_many_requests(2s), ok("done")});
+
+  auto first = get(server, "/limited");
+  ASSERT_FALSE(first.ec) << first.ec.message();
+  EXPECT_EQ(first.res.result_int(), 429u);
+  EXPECT_EQ(first.res[http::field::retry_after], "2");
+  for (int i = 0; i < 2; ++i) {  // the last entry repeats
+    auto next = get(server, "/limited?attempt=" + std::to_string(i));
+    ASSERT_FALSE(next.ec) << next.ec.message();
+    EXPECT_EQ(next.res.result_int(), 200u);
+    EXPECT_EQ(next.res.body(), "done");
+  }
+  EXPECT_EQ(get(server, "/missing").res.result_int(), 404u);
+  EXPECT_EQ(server.hits("/limited"), 3u);
+  EXPECT_EQ(server.requests(), 4);
+}
+
+TEST(FaultInjectionServerTest, ClosesKeepAliveAfterNRequests) {
+  FaultServerOptions opts;
+  opts.close_after_requests = 2;
+  FaultServer server(opts);
+  server.route("/", ok("x"));
+
+  net::io_context ioc;
+  tcp::socket sock(ioc);
+  sock.connect({net::ip::make_address("127.0.0.1"), server.port()});
+  boost::beast::flat_buffer buf;
+  auto a = get(sock, buf, "/");
+  ASSERT_FALSE(a.ec) << a.ec.message();
+  EXPECT_TRUE(a.res.keep_alive());
+  auto b = get(sock, buf, "/");
+  ASSERT_FALSE(b.ec) << b.ec.message();
+  EXPECT_FALSE(b.res.keep_alive());
+  EXPECT_TRUE(get(sock, buf, "/").ec);
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST(FaultInjectionServerTest, ResetsMidBody) {
+  FaultServer server;
+  Reply r = ok(std::string(1000, 'b'));
+  r.reset_after = 100;
+  server.route("/reset", r);
+  auto got = get(server, "/reset");
+  EXPECT_TRUE(got.ec);
+}
+
+TEST(FaultInjectionServerTest, DelaysAndDripsTheBody) {
+  FaultServer server;
+  Reply r = ok(std::string(50, 'd'));
+  r.latency = fixed_latency(50ms);
+  r.drip_bytes = 20;
+  r.drip_interval = 20ms;
+  server.route("/slow", r);
+
+  const auto start = std::chrono::steady_clock::now();
+  auto got = get(server, "/slow");
+  const auto took = std::chrono::steady_clock::now() - start;
+  ASSERT_FALSE(got.ec) << got.ec.message();
+  EXPECT_EQ(got.res.body(), std::string(50, 'd'));
+  // The head plus 50 bytes is well over 3 drips.
+  EXPECT_GE(took, 50ms + 3 * 20ms);
+}
+
+TEST(FaultInjectionServerTest, ChunkedGzipBody) {
+  FaultServer server;
+  std::string text;
+  for (int i = 0; i < 200; ++i) text += "line " + std::to_string(i) + "\n";
+  Reply r = ok(text);
+  r.chunked = true;
+  r.chunk_size = 64;
+  r.gzip = true;
+  server.route("/gz", r);
+
+  auto got = get(server, "/gz");
+  ASSERT_FALSE(got.ec) << got.ec.message();
+  EXPECT_TRUE(got.res.chunked());
+  EXPECT_EQ(got.res[http::field::content_encoding], "gzip");
+  EXPECT_EQ(gunzip(got.res.body()), text);
+}
+
+TEST(FaultInjectionServerTest, LatencyDistributionsAreSeeded) {
+  std::mt19937 a(7), b(7);
+  auto uniform = uniform_latency(10ms, 20ms);
+  auto tail = exponential_latency(100ms);
+  for (int i = 0; i < 100; ++i) {
+    const auto d = uniform(a);
+    EXPECT_GE(d, 10ms);
+    EXPECT_LE(d, 20ms);
+    EXPECT_EQ(d, uniform(b));
+    EXPECT_EQ(tail(a), tail(b));
+  }
+}
+
+TEST(FaultInjectionServerTest, SlowTlsHandshake) {
+  FaultServerOptions opts;
+  opts.tls = true;
+  opts.tls_handshake_delay = 100ms;
+  FaultServer server(opts);
+  server.route("/", ok("secure"));
+
+  net::io_context ioc;
+  net::ssl::context ctx(net::ssl::context::tls_client);
+  ctx.set_verify_mode(net::ssl::verify_none);
+  net::ssl::stream<tcp::socket> stream(ioc, ctx);
+  stream.next_layer().connect(
+      {net::ip::make_address("127.0.0.1"), server.port()});
+  const auto start = std::chrono::steady_clock::now();
+  stream.handshake(net::ssl::stream_base::client);
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 100ms);
+  boost::beast::flat_buffer buf;
+  auto got = get(stream, buf, "/");
+  ASSERT_FALSE(got.ec) << got.ec.message();
+  EXPECT_EQ(got.res.body(), "secure");
+}
+
+// The pool must not reuse a connection the server announced it will close.
+TEST(FaultInjectionServerTest, PoolReconnectsAfterConnectionClose) {
+  FaultServerOptions opts;
+  opts.close_after_requests = 1;
+  FaultServer server(opts);
+  server.route("/", ok("pooled"));
+
+  net::io_context ioc;
+  beast_pool::PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  cfg.io_timeout = std::chrono::seconds(5);
+  beast_pool::ConnectionPool pool(ioc, cfg, nullptr);
+  const beast_pool::Origin origin{"http", "127.0.0.1", server.port()};
+
+  int ok_responses = 0;
+  std::function<void(int)> next = [&](int left) {
+    if (left == 0) return;
+    http::request<http::string_body> req{http::verb::get, "/", 11};
+    req.set(http::field::host, "127.0.0.1");
+    pool.async_request(origin, req,
+                       [&, left](boost::system::error_code ec,
+                                 http::request<http::string_body>,
+                                 http::response<http::string_body> res) {
+                         EXPECT_FALSE(ec) << ec.message();
+                         if (!ec && res.body() == "pooled") ++ok_responses;
+                         next(left - 1);
+                       });
+  };
+  next(3);
+  ioc.run();
+  EXPECT_EQ(ok_responses, 3);
+  EXPECT_EQ(server.connections(), 3);
+}
@@ -0,0 +1,301 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client_ssl_ctx.hpp"
+#include "http_client_config_provider.hpp"
+#include "http_client_manager.hpp"
+#include "http_client_runtime.hpp"
+#include "io_context_manager.hpp"
+#include "misc_util.hpp"
+
+namespace fs = std::filesystem;
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+namespace urls = boost::urls;
+using tcp = net::ip::tcp;
+using namespace std::chrono_literals;
+
+static cjj365::ConfigSources& config_sources() {
+  static const fs::path config_dir =
+      fs::path(__FILE__).parent_path() / "config_dir";
+  static cjj365::ConfigSources instance({config_dir}, {});
+  return instance;
+}
+
+namespace {
+
+// Stand-in for the application's IoContextManager: one io thread.
+class TestIoContext : public cjj365::IIoContextManager {
+ public:
+  TestIoContext() : guard_(net::make_work_guard(ioc_)) {
+    thr_ = std::thread([this] { ioc_.run(); });
+  }
+  ~TestIoContext() override { stop(); }
+
+  net::io_context& ioc() override { return ioc_; }
+  void stop() override {
+    guard_.reset();
+    ioc_.stop();
+    if (thr_.joinable()) thr_.join();
+  }
+
+ private:
+  net::io_context ioc_;
+  net::executor_work_guard<net::io_context::executor_type> guard_;
+  std::thread thr_;
+};
+
+// Keep-alive server counting accepted connections and requests.
+struct CountingServer {
+  net::io_context ioc{1};
+  tcp::acceptor acceptor{ioc,
+                         tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)};
+  std::thread thr;
+  std::atomic<int> connections{0};
+  std::atomic<int> requests{0};
+
+  CountingServer() {
+    do_accept();
+    thr = std::thread([this] { ioc.run(); });
+  }
+  ~CountingServer() {
+    ioc.stop();
+    if (thr.joinable()) thr.join();
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" +
+           std::to_string(acceptor.local_endpoint().port()) + "/ping";
+  }
+
+  struct Session : public std::enable_shared_from_this<Session> {
+    Session(tcp::socket s, CountingServer& srv)
+        : sock(std::move(s)), server(srv) {}
+    tcp::socket sock;
+    CountingServer& server;
+    boost::beast::flat_buffer buffer;
+    http::request<http::string_body> req;
+    http::response<http::string_body> res;
+
+    void do_read() {
+      req = {};
+      http::async_read(sock, buffer, req,
+                       [self = shared_from_this()](boost::system::error_code ec,
+                                                   std::size_t) {
+                         if (!ec) self->do_write();
+                       });
+    }
+
+    void do_write() {
+      ++server.requests;
+      res = http::response<http::string_body>(http::status::ok,
+                                              req.version());
+      res.keep_alive(req.keep_alive());
+      res.body() = "pong";
+      res.prepare_payload();
+      http::async_write(sock, res,
+                        [self = shared_from_this()](
+                            boost::system::error_code ec, std::size_t) {
+                          if (!ec) self->do_read();
+                        });
+    }
+  };
+
+  void do_accept() {
+    acceptor.async_accept([this](boost::system::error_code ec,
+                                 tcp::socket sock) {
+      if (ec) return;
+      ++connections;
+      std::make_shared<Session>(std::move(sock), *this)->do_read();
+      do_accept();
+    });
+  }
+};
+
+// One pooled GET through `client`; returns the status (0 on failure).
+int pooled_get(client_async::HttpClientManager& client,
+               const std::string& url) {
+  misc::ThreadNotifier notifier{5000};
+  int status = 0;
+  http::request<http::empty_body> req{
+      http::verb::get, std::string(urls::url_view(url).encoded_target()), 11};
+  client_async::HttpClientRequestParams params;
+  params.follow_redirect = false;
+  client.http_request_pooled<http::empty_body, http::string_body>(
+      urls::url_view(url), std::move(req),
+      [&](std::optional<http::response<http::string_body>>&& resp, int ec) {
+        if (ec == 0 && resp) status = resp->result_int();
+        notifier.notify();
+      },
+      std::move(params));
+  notifier.waitForNotification();
+  return status;
+}
+
+// One GET through the per-request (redirect-following) path; returns the
+// status (0 on failure).
+int direct_get(client_async::HttpClientManager& client,
+               const std::string& url) {
+  misc::ThreadNotifier notifier{5000};
+  int status = 0;
+  http::request<http::empty_body> req{http::verb::get, "/", 11};
+  client.http_request<http::empty_body, http::string_body>(
+      urls::url_view(url), std::move(req),
+      [&](std::optional<http::response<http::string_body>>&& resp, int ec) {
+        if (ec == 0 && resp) status = resp->result_int();
+        notifier.notify();
+      });
+  notifier.waitForNotification();
+  return status;
+}
+
+}  // namespace
+
+TEST(HttpClientRuntimeTest, ProfilesShareConnections) {
+  CountingServer server;
+  cjj365::AppProperties app_properties{config_sources()};
+  cjj365::HttpclientConfigProviderFile config_provider(app_properties,
+                                                       config_sources());
+  cjj365::ClientSSLContext ssl_ctx(config_provider);
+  TestIoContext iocm;
+  client_async::HttpClientRuntime runtime(iocm, ssl_ctx, config_provider);
+
+  auto first = std::make_unique<client_async::HttpClientManager>(
+      runtime, config_provider);
+  auto second = std::make_unique<client_async::HttpClientManager>(
+      runtime, config_provider);
+  EXPECT_EQ(&first->ioc_ref(), &iocm.ioc());
+  EXPECT_EQ(&second->ioc_ref(), &iocm.ioc());
+
+  EXPECT_EQ(pooled_get(*first, server.url()), 200);
+  EXPECT_EQ(pooled_get(*second, server.url()), 200);
+  // The second profile reused the first one's keep-alive connection.
+  EXPECT_EQ(server.requests, 2);
+  EXPECT_EQ(server.connections, 1);
+
+  // Stopping one profile leaves the shared network running.
+  first->stop();
+  first.reset();
+  EXPECT_EQ(pooled_get(*second, server.url()), 200);
+  EXPECT_EQ(server.connections, 1);
+  EXPECT_EQ(runtime.cache()->top_origins(1).at(0).uses, 3u);
+
+  second.reset();
+  iocm.stop();
+}
+
+TEST(HttpClientRuntimeTest, InMemoryTransportReplacesTheNetwork) {
+  cjj365::AppProperties app_properties{config_sources()};
+  cjj365::HttpclientConfigProviderFile config_provider(app_properties,
+                                                       config_sources());
+  cjj365::ClientSSLContext ssl_ctx(config_provider);
+  TestIoContext iocm;
+  client_async::HttpClientRuntime runtime(iocm, ssl_ctx, config_provider);
+  client_async::HttpClientManager client(runtime, config_provider);
+
+  auto transport = std::make_shared<client_async::InMemoryTransport<>>(
+      iocm.ioc().get_executor());
+  transport->add("http://10.255.0.1:8080/", {204, {}, "", {}});
+  client.set_transport(transport);
+
+  // Nothing listens on either address; only the canned route answers.
+  EXPECT_EQ(pooled_get(client, "http://10.255.0.1:8080/"), 204);
+  EXPECT_EQ(pooled_get(client, "http://10.255.0.2:8080/"), 0);
+  EXPECT_EQ(transport->exchanges(), 2u);
+
+  client.stop();
+  iocm.stop();
+}
+
+// Both request paths key the transport on scheme://host:port/target, so a
+// URL without a port and a redirect hop reach the same canned entry.
+TEST(HttpClientRuntimeTest, InMemoryTransportServesNonPooledRequests) {
+  cjj365::AppProperties app_properties{config_sources()};
+  cjj365::HttpclientConfigProviderFile config_provider(app_properties,
+                                                       config_sources());
+  cjj365::ClientSSLContext ssl_ctx(config_provider);
+  TestIoContext iocm;
+  client_async::HttpClientRuntime runtime(iocm, ssl_ctx, config_provider);
+  client_async::HttpClientManager client(runtime, config_provider);
+
+  auto transport = std::make_shared<client_async::InMemoryTransport<>>(
+      iocm.ioc().get_executor());
+  transport->add("http://api.test/items", {200, {}, "[]", {}});
+  transport->add("http://api.test/old",
+                 {301, {{"Location", "/items"}}, "", {}});
+  client.set_transport(transport);
+
+  EXPECT_EQ(direct_get(client, "http://api.test/items"), 200);
+  EXPECT_EQ(direct_get(client, "http://api.test:80/items"), 200);
+  EXPECT_EQ(pooled_get(client, "http://api.test/items"), 200);
+  EXPECT_EQ(direct_get(client, "http://api.test/old"), 200);
+  EXPECT_EQ(transport->exchanges(), 5u);
+
+  client.stop();
+  iocm.stop();
+}
+
+// A profile destroyed while its requests are in flight: the redirect hop
+// and the queued batch jobs still run on the shared runtime, and their
+// callbacks fire.
+TEST(HttpClientRuntimeTest, DestroyingAProfileMidRequestIsSafe) {
+  cjj365::AppProperties app_properties{config_sources()};
+  cjj365::HttpclientConfigProviderFile config_provider(app_properties,
+                                                       config_sources());
+  cjj365::ClientSSLContext ssl_ctx(config_provider);
+  TestIoContext iocm;
+  client_async::HttpClientRuntime runtime(iocm, ssl_ctx, config_provider);
+  auto client =
+      std::make_unique<client_async::HttpClientManager>(runtime,
+                                                        config_provider);
+
+  auto transport = std::make_shared<client_async::InMemoryTransport<>>(
+      iocm.ioc().get_executor());
+  transport->add("http://api.test/old",
+                 {302, {{"Location", "/items"}}, "", 50ms});
+  transport->add("http://api.test/items", {200, {}, "[]", 50ms});
+  client->set_transport(transport);
+
+  misc::ThreadNotifier redirected{5000};
+  int redirect_status = 0;
+  client->http_request<http::empty_body, http::string_body>(
+      urls::url_view("http://api.test/old"),
+      http::request<http::empty_body>{http::verb::get, "/", 11},
+      [&](std::optional<http::response<http::string_body>>&& resp, int ec) {
+        if (ec == 0 && resp) redirect_status = resp->result_int();
+        redirected.notify();
+      });
+
+  misc::ThreadNotifier batch_done{5000};
+  std::atomic<int> batch_ok{0};
+  std::vector<client_async::BatchRequest<http::empty_body>> batch(4);
+  for (auto& item : batch) item.url = urls::url("http://api.test/items");
+  client_async::BatchOptions opts;
+  opts.max_in_flight = 1;  // later jobs start after the manager is gone
+  opts.prewarm = false;
+  client->submit_batch<http::empty_body, http::string_body>(
+      std::move(batch),
+      [&](std::size_t, std::optional<http::response<http::string_body>>&& resp,
+          int ec) {
+        if (ec == 0 && resp && resp->result_int() == 200) ++batch_ok;
+      },
+      [&] { batch_done.notify(); }, opts);
+
+  client.reset();
+  redirected.waitForNotification();
+  batch_done.waitForNotification();
+  EXPECT_EQ(redirect_status, 200);
+  EXPECT_EQ(batch_ok, 4);
+  iocm.stop();
+}
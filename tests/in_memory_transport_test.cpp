@@ -0,0 +1,146 @@
+#include "http_transport.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "virtual_time.hpp"
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using client_async::InMemoryTransport;
+using client_async::TransportRequest;
+using monad::VirtualClock;
+using monad::VirtualTimer;
+using namespace std::chrono_literals;
+
+namespace {
+
+TransportRequest get(std::string url) {
+  TransportRequest req;
+  req.url = std::move(url);
+  return req;
+}
+
+}  // namespace
+
+TEST(InMemoryTransportTest, ServesCannedResponsesByMethodAndUrl) {
+  net::io_context ioc;
+  InMemoryTransport<> transport(ioc.get_executor());
+  transport.add("http://api.test:80/items?page=1",
+                {200, {{"Content-Type", "application/json"}}, "[1,2]", {}});
+  transport.add("http://api.test:80/items", {201, {}, "made", {}},
+                http::verb::post);
+
+  std::vector<std::pair<int, std::string>> got;
+  auto record = [&](int ec, std::string wire) {
+    got.emplace_back(ec, std::move(wire));
+  };
+  transport.exchange(get("http://api.test:80/items?page=1"), record);
+  auto post = get("http://api.test:80/items");
+  post.method = http::verb::post;
+  transport.exchange(post, record);
+  transport.exchange(get("http://api.test:80/items"), record);  // not a GET
+  EXPECT_TRUE(got.empty());  // completions are posted, never inline
+  ioc.run();
+
+  ASSERT_EQ(got.size(), 3u);
+  EXPECT_EQ(got[0].first, 0);
+  boost::system::error_code ec;
+  auto res = client_async::parse_transport_response<http::string_body>(
+      got[0].second, ec);
+  ASSERT_FALSE(ec) << ec.message();
+  EXPECT_EQ(res.result_int(), 200u);
+  EXPECT_EQ(res[http::field::content_type], "application/json");
+  EXPECT_EQ(res.body(), "[1,2]");
+  EXPECT_EQ(got[1].first, 0);
+  EXPECT_EQ(got[1].second.rfind("HTTP/1.1 201 Created\r\n", 0), 0u);
+  EXPECT_EQ(got[2].first, 1);
+  EXPECT_EQ(transport.exchanges(), 3u);
+
+  // A response cut short is an error, not a shorter body.
+  client_async::parse_transport_response<http::string_body>(
+      got[0].second.substr(0, got[0].second.size() - 1), ec);
+  EXPECT_TRUE(ec);
+}
+
+TEST(InMemoryTransportTest, FallbackAnswersUnknownUrls) {
+  net::io_context ioc;
+  InMemoryTransport<> transport(ioc.get_executor());
+  transport.set_fallback([](const TransportRequest& req)
+                             -> std::optional<InMemoryTransport<>::Canned> {
+    if (req.url.find("/echo") == std::string::npos) return std::nullopt;
+    return InMemoryTransport<>::Canned{200, {}, req.body, {}};
+  });
+  auto echo = get("http://h:1/echo");
+  echo.body = "hello";
+  std::string wire;
+  int missing_ec = 0;
+  transport.exchange(echo, [&](int, std::string w) { wire = std::move(w); });
+  transport.exchange(get("http://h:1/other"),
+                     [&](int ec, std::string) { missing_ec = ec; });
+  ioc.run();
+  EXPECT_NE(wire.find("Content-Length: 5\r\n\r\nhello"), std::string::npos);
+  EXPECT_EQ(missing_ec, 1);
+}
+
+// A fan-out with one-second latencies completes in one virtual second, in
+// deadline order, without sleeping.
+TEST(InMemoryTransportTest, DelaysRunOnTheVirtualClock) {
+  net::io_context ioc;
+  InMemoryTransport<VirtualTimer> transport(ioc.get_executor());
+  transport.add("http://slow/", {200, {}, "slow", 1s});
+  transport.add("http://fast/", {200, {}, "fast", 10ms});
+
+  constexpr int kFanOut = 2000;
+  std::vector<std::string> order;
+  VirtualClock::duration last_done{};
+  for (int i = 0; i < kFanOut; ++i) {
+    transport.exchange(get(i % 2 ? "http://fast:80/" : "http://slow:80/"),
+                       [&](int ec, std::string wire) {
+                         ASSERT_EQ(ec, 0);
+                         order.push_back(wire.substr(wire.size() - 4));
+                         last_done = VirtualClock::of(ioc).elapsed();
+                       });
+  }
+  monad::run_virtual(ioc);
+
+  ASSERT_EQ(order.size(), static_cast<std::size_t>(kFanOut));
+  EXPECT_EQ(order.front(), "fast");
+  EXPECT_EQ(order[kFanOut / 2 - 1], "fast");
+  EXPECT_EQ(order[kFanOut / 2], "slow");
+  EXPECT_EQ(last_done, 1s);
+}
+
+TEST(InMemoryTransportTest, AddedUrlsAreNormalised) {
+  net::io_context ioc;
+  InMemoryTransport<> transport(ioc.get_executor());
+  transport.add("http://api.test/items", {200, {}, "plain", {}});
+  transport.add("https://api.test?q=1#frag", {200, {}, "tls", {}});
+  transport.add("http://[::1]:8080/v6", {200, {}, "v6", {}});
+
+  std::vector<int> codes;
+  for (const char* url : {"http://api.test:80/items",
+                          "https://api.test:443/?q=1", "http://[::1]:8080/v6",
+                          "http://api.test:8080/items"}) {
+    transport.exchange(get(url),
+                       [&](int ec, std::string) { codes.push_back(ec); });
+  }
+  ioc.run();
+  EXPECT_EQ(codes, (std::vector<int>{0, 0, 0, 1}));
+
+  EXPECT_EQ(client_async::normalize_transport_url("http://[::1]/"),
+            "http://[::1]:80/");
+  EXPECT_EQ(client_async::normalize_transport_url("not a url"), "not a url");
+}
+
+TEST(InMemoryTransportTest, TransportUrlSpellsOutThePort) {
+  EXPECT_EQ(client_async::transport_url("http", "api.test", 80, "/items"),
+            "http://api.test:80/items");
+  EXPECT_EQ(client_async::transport_url("https", "h", 8443, "/a?b=1"),
+            "https://h:8443/a?b=1");
+}
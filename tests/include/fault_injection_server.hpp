@@ -0,0 +1,387 @@
+#pragma once
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "server_certificate.hpp"
+
+// In-process HTTP/1.1 server whose routes replay scripted pathologies:
+// latency, slow-drip bodies, resets mid-body, keep-alive closes, slow TLS
+// handshakes, 429 + Retry-After and chunked/gzip encodings. Shared by the
+// tests and the benchmarks in bm/.
+
+namespace cjj365 {
+namespace testsrv {
+
+using Millis = std::chrono::milliseconds;
+
+// Draws a delay; called on the server thread with the server's seeded
+// generator, so a given seed replays the same sequence.
+using LatencyFn = std::function<Millis(std::mt19937&)>;
+
+inline LatencyFn fixed_latency(Millis d) {
+  return [d](std::mt19937&) { return d; };
+}
+
+inline LatencyFn uniform_latency(Millis lo, Millis hi) {
+  return [lo, hi](std::mt19937& rng) {
+    std::uniform_int_distribution<Millis::rep> dist(lo.count(), hi.count());
+    return Millis(dist(rng));
+  };
+}
+
+// Mostly short with a long tail, like a busy upstream.
+inline LatencyFn exponential_latency(Millis mean) {
+  return [mean](std::mt19937& rng) {
+    std::exponential_distribution<double> dist(1.0 / mean.count());
+    return Millis(static_cast<Millis::rep>(dist(rng)));
+  };
+}
+
+// One scripted response. Faults compose: a reply can be delayed, dripped,
+// gzipped, chunked and cut off all at once.
+struct Reply {
+  unsigned status = 200;
+  std::string body;
+  std::vector<std::pair<std::string, std::string>> headers;
+
+  LatencyFn latency;  // wait before the status line is written
+
+  // Write the response `drip_bytes` at a time with a pause in between
+  // (0 writes it in one go).
+  std::size_t drip_bytes = 0;
+  Millis drip_interval{0};
+
+  // Reset the connection (RST) after this many body bytes on the wire.
+  std::optional<std::size_t> reset_after;
+  bool drop = false;  // reset without sending anything
+
+  bool close = false;  // send Connection: close and shut down afterwards
+  bool chunked = false;
+  std::size_t chunk_size = 4096;
+  bool gzip = false;  // Content-Encoding: gzip
+};
+
+inline Reply ok(std::string body) {
+  Reply r;
+  r.body = std::move(body);
+  return r;
+}
+
+inline Reply too_many_requests(std::chrono::seconds retry_after) {
+  Reply r;
+  r.status = 429;
+  r.headers.emplace_back("Retry-After", std::to_string(retry_after.count()));
+  return r;
+}
+
+struct FaultServerOptions {
+  bool tls = false;  // uses the certificate from server_certificate.hpp
+  Millis tls_handshake_delay{0};
+  // Close a keep-alive connection after it has served this many requests.
+  std::optional<int> close_after_requests;
+  std::uint32_t seed = 1;
+};
+
+inline std::string gzip_compress(std::string_view in) {
+  z_stream zs{};
+  if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                   Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("deflateInit2 failed");
+  }
+  std::string out(deflateBound(&zs, static_cast<uLong>(in.size())), '\0');
+  zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  zs.avail_in = static_cast<uInt>(in.size());
+  zs.next_out = reinterpret_cast<Bytef*>(out.data());
+  zs.avail_out = static_cast<uInt>(out.size());
+  const int rc = deflate(&zs, Z_FINISH);
+  out.resize(zs.total_out);
+  deflateEnd(&zs);
+  if (rc != Z_STREAM_END) throw std::runtime_error("deflate failed");
+  return out;
+}
+
+// Routes match on the request path (query ignored); unknown paths get 404.
+// The n-th request to a route is answered with script[n], and the last
+// entry repeats once the script runs out.
+class FaultServer {
+ public:
+  explicit FaultServer(FaultServerOptions opts = {})
+      : opts_(std::move(opts)),
+        acceptor_(ioc_, boost::asio::ip::tcp::endpoint(
+                            boost::asio::ip::make_address("127.0.0.1"), 0)),
+        rng_(opts_.seed) {
+    if (opts_.tls) testcert::load_server_certificate(ssl_ctx_);
+    thread_ = std::thread([this] {
+      accept();
+      ioc_.run();
+    });
+  }
+
+  ~FaultServer() {
+    boost::asio::post(ioc_, [this] {
+      boost::system::error_code ec;
+      acceptor_.close(ec);
+    });
+    ioc_.stop();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  FaultServer(const FaultServer&) = delete;
+  FaultServer& operator=(const FaultServer&) = delete;
+
+  void route(std::string path, std::vector<Reply> script) {
+    if (script.empty()) throw std::invalid_argument("empty route script");
+    std::lock_guard<std::mutex> lk(mu_);
+    routes_[std::move(path)] = Route{std::move(script), 0};
+  }
+  void route(std::string path, Reply reply) {
+    route(std::move(path), std::vector<Reply>{std::move(reply)});
+  }
+
+  std::uint16_t port() const { return acceptor_.local_endpoint().port(); }
+  std::string url(std::string_view path = "/") const {
+    return std::string(opts_.tls ? "https" : "http") + "://127.0.0.1:" +
+           std::to_string(port()) + std::string(path);
+  }
+
+  int connections() const { return connections_.load(); }
+  int requests() const { return requests_.load(); }
+  std::size_t hits(const std::string& path) const {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = routes_.find(path);
+    return it == routes_.end() ? 0 : it->second.hits;
+  }
+
+ private:
+  using tcp = boost::asio::ip::tcp;
+
+  struct Route {
+    std::vector<Reply> script;
+    std::size_t hits = 0;
+  };
+
+  // A response serialized up front, so faults can cut it at any byte.
+  struct Wire {
+    std::string bytes;
+    std::size_t limit = 0;  // bytes to send before stopping
+    bool reset = false;     // RST once `limit` is reached
+    bool close = false;
+    std::size_t drip_bytes = 0;
+    Millis drip_interval{0};
+    Millis latency{0};
+  };
+
+  template <class Stream>
+  struct Conn : std::enable_shared_from_this<Conn<Stream>> {
+    template <class... Args>
+    Conn(FaultServer& s, Args&&... args)
+        : server(s),
+          stream(std::forward<Args>(args)...),
+          timer(s.ioc_) {}
+
+    FaultServer& server;
+    Stream stream;
+    boost::asio::steady_timer timer;
+    boost::beast::flat_buffer buf;
+    boost::beast::http::request<boost::beast::http::string_body> req;
+    Wire wire;
+    int served = 0;
+
+    tcp::socket& socket() {
+      if constexpr (std::is_same_v<Stream, tcp::socket>) {
+        return stream;
+      } else {
+        return stream.next_layer();
+      }
+    }
+
+    void start() {
+      if constexpr (std::is_same_v<Stream, tcp::socket>) {
+        read();
+      } else {
+        timer.expires_after(server.opts_.tls_handshake_delay);
+        timer.async_wait([self = this->shared_from_this()](
+                             boost::system::error_code ec) {
+          if (ec) return;
+          self->stream.async_handshake(
+              boost::asio::ssl::stream_base::server,
+              [self](boost::system::error_code ec) {
+                if (!ec) self->read();
+              });
+        });
+      }
+    }
+
+    void read() {
+      req = {};
+      boost::beast::http::async_read(
+          stream, buf, req,
+          [self = this->shared_from_this()](boost::system::error_code ec,
+                                            std::size_t) {
+            if (ec) return;
+            ++self->served;
+            self->wire = self->server.respond(self->req, self->served);
+            self->timer.expires_after(self->wire.latency);
+            self->timer.async_wait([self](boost::system::error_code ec) {
+              if (!ec) self->send(0);
+            });
+          });
+    }
+
+    void send(std::size_t offset) {
+      if (offset == wire.limit) {
+        boost::system::error_code ec;
+        if (wire.reset) {
+          socket().set_option(tcp::socket::linger(true, 0), ec);
+          socket().close(ec);
+        } else if (wire.close) {
+          socket().shutdown(tcp::socket::shutdown_send, ec);
+        } else {
+          read();
+        }
+        return;
+      }
+      std::size_t n = wire.limit - offset;
+      if (wire.drip_bytes > 0) n = std::min(n, wire.drip_bytes);
+      boost::asio::async_write(
+          stream, boost::asio::buffer(wire.bytes.data() + offset, n),
+          [self = this->shared_from_this(), next = offset + n](
+              boost::system::error_code ec, std::size_t) {
+            if (ec) return;
+            if (self->wire.drip_bytes == 0 || next == self->wire.limit) {
+              self->send(next);
+              return;
+            }
+            self->timer.expires_after(self->wire.drip_interval);
+            self->timer.async_wait(
+                [self, next](boost::system::error_code ec) {
+                  if (!ec) self->send(next);
+                });
+          });
+    }
+  };
+
+  void accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec,
+                                  tcp::socket sock) {
+      if (ec) return;
+      ++connections_;
+      if (opts_.tls) {
+        using TlsStream = boost::asio::ssl::stream<tcp::socket>;
+        std::make_shared<Conn<TlsStream>>(*this, std::move(sock), ssl_ctx_)
+            ->start();
+      } else {
+        std::make_shared<Conn<tcp::socket>>(*this, std::move(sock))->start();
+      }
+      accept();
+    });
+  }
+
+  // Picks the scripted reply for `req` and serializes it.
+  Wire respond(
+      const boost::beast::http::request<boost::beast::http::string_body>& req,
+      int served_on_connection) {
+    ++requests_;
+    std::string_view target(req.target().data(), req.target().size());
+    const std::string path(target.substr(0, target.find('?')));
+    Reply reply;
+    {
+      std::lock_guard<std::mutex> lk(mu_);
+      auto it = routes_.find(path);
+      if (it == routes_.end()) {
+        reply.status = 404;
+        reply.body = "no route";
+      } else {
+        auto& r = it->second;
+        reply = r.script[std::min(r.hits, r.script.size() - 1)];
+        ++r.hits;
+      }
+    }
+
+    Wire w;
+    w.close = reply.close || !req.keep_alive() ||
+              (opts_.close_after_requests &&
+               served_on_connection >= *opts_.close_after_requests);
+    w.drip_bytes = reply.drip_bytes;
+    w.drip_interval = reply.drip_interval;
+    if (reply.latency) w.latency = reply.latency(rng_);
+
+    std::string payload =
+        reply.gzip ? gzip_compress(reply.body) : std::move(reply.body);
+    const auto status = static_cast<boost::beast::http::status>(reply.status);
+    std::string& out = w.bytes;
+    out = "HTTP/1.1 " + std::to_string(reply.status) + " " +
+          std::string(boost::beast::http::obsolete_reason(status)) + "\r\n";
+    for (auto const& [name, value] : reply.headers) {
+      out += name + ": " + value + "\r\n";
+    }
+    if (reply.gzip) out += "Content-Encoding: gzip\r\n";
+    if (w.close) out += "Connection: close\r\n";
+    if (reply.chunked) {
+      out += "Transfer-Encoding: chunked\r\n\r\n";
+    } else {
+      out += "Content-Length: " + std::to_string(payload.size()) + "\r\n\r\n";
+    }
+    const std::size_t head = out.size();
+    if (reply.chunked) {
+      const std::size_t step = std::max<std::size_t>(reply.chunk_size, 1);
+      char size_line[32];
+      for (std::size_t pos = 0; pos < payload.size(); pos += step) {
+        const auto n = std::min(step, payload.size() - pos);
+        std::snprintf(size_line, sizeof(size_line), "%zx\r\n", n);
+        out += size_line;
+        out.append(payload, pos, n);
+        out += "\r\n";
+      }
+      out += "0\r\n\r\n";
+    } else {
+      out += payload;
+    }
+    w.limit = out.size();
+    if (reply.reset_after) {
+      w.reset = true;
+      w.limit = std::min(out.size(), head + *reply.reset_after);
+    }
+    if (reply.drop) {
+      w.reset = true;
+      w.limit = 0;
+    }
+    return w;
+  }
+
+  FaultServerOptions opts_;
+  boost::asio::ssl::context ssl_ctx_{boost::asio::ssl::context::tls_server};
+  boost::asio::io_context ioc_;
+  tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::mt19937 rng_;  // server thread only
+  std::atomic<int> connections_{0};
+  std::atomic<int> requests_{0};
+  mutable std::mutex mu_;
+  std::map<std::string, Route> routes_;
+};
+
+}  // namespace testsrv
+}  // namespace cjj365
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cctype>
+#include <chrono>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "fault_injection_server.hpp"
+#include "traffic_record.hpp"
+
+namespace cjj365 {
+namespace testsrv {
+
+// Serves a TrafficRecorder log from loopback. Each recorded response is
+// the next reply on its path, in recorded order, sent after the recorded
+// round-trip time (scaled by `time_scale`). Exchanges that failed without
+// a response are replayed as connection resets.
+class ReplayServer {
+ public:
+  explicit ReplayServer(const client_async::TrafficLog& log,
+                        double time_scale = 1.0)
+      : server_(FaultServerOptions{}) {
+    std::map<std::string, std::vector<Reply>> scripts;
+    for (auto const& e : log.entries()) {
+      const auto path = e.target.substr(0, e.target.find('?'));
+      scripts[std::string(path)].push_back(to_reply(e, time_scale));
+    }
+    for (auto& [path, script] : scripts) {
+      server_.route(path, std::move(script));
+    }
+  }
+
+  std::uint16_t port() const { return server_.port(); }
+  std::string url(std::string_view path = "/") const {
+    return server_.url(path);
+  }
+  int requests() const { return server_.requests(); }
+
+ private:
+  static Reply to_reply(const client_async::TrafficEntry& e,
+                        double time_scale) {
+    Reply r;
+    r.latency = fixed_latency(std::chrono::duration_cast<Millis>(
+        e.duration * time_scale));
+    if (e.status == 0) {
+      r.drop = true;
+      return r;
+    }
+    r.status = e.status;
+    r.body = std::string(e.response_body);
+    // Framing is the server's job: it re-sends the decoded body.
+    std::string_view rest = e.response_headers;
+    while (!rest.empty()) {
+      const auto eol = rest.find("\r\n");
+      const auto line = rest.substr(0, eol);
+      rest = eol == std::string_view::npos ? std::string_view{}
+                                           : rest.substr(eol + 2);
+      const auto colon = line.find(": ");
+      if (colon == std::string_view::npos) continue;
+      const std::string name(line.substr(0, colon));
+      if (is_framing(name)) continue;
+      r.headers.emplace_back(name, std::string(line.substr(colon + 2)));
+    }
+    return r;
+  }
+
+  static bool is_framing(std::string name) {
+    for (auto& ch : name) ch = static_cast<char>(std::tolower(ch));
+    return name == "content-length" || name == "transfer-encoding" ||
+           name == "connection" || name == "keep-alive";
+  }
+
+  FaultServer server_;
+};
+
+}  // namespace testsrv
+}  // namespace cjj365
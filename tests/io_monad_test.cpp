@@ -1,5 +1,6 @@
 #include "io_monad.hpp"
 
+#include "io_monad_poll_conditional.hpp"
 #include "io_monad_poll_with_state.hpp"
 
 #include <gtest/gtest.h>  // Add this line
@@ -20,6 +21,9 @@
 #include <cstdlib>
 #include <filesystem>
 #include <i_output.hpp>
+#include <memory>
+#include <optional>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <tuple>
@@ -327,6 +331,90 @@ TEST(PollWithStateTest, ExhaustedUsesCustomError) {
   EXPECT_NE(result_r->error().what.find("last_attempt=3"), std::string::npos);
 }
 
+TEST(PollConditionalTest, SkipsDecideOnNotModified) {
+  namespace http = boost::beast::http;
+  using Response = http::response<http::string_body>;
+  boost::asio::io_context ioc;
+
+  // poll_conditional owns the state; keep what was sent where we can see it.
+  auto sent_if_none_match = std::make_shared<std::vector<std::string>>();
+  struct State {
+    std::shared_ptr<std::vector<std::string>> sent_if_none_match;
+    std::vector<std::string> bodies;
+  };
+
+  // 200 (v1), 304, 304, 200 (v2).
+  auto send = [](int attempt, State& st,
+                 const ConditionalValidators& v) -> IO<Response> {
+    http::request<http::empty_body> req{http::verb::get, "/status", 11};
+    v.apply(req);
+    st.sent_if_none_match->emplace_back(req[http::field::if_none_match]);
+    Response res{attempt == 1 || attempt == 4 ? http::status::ok
+                                              : http::status::not_modified,
+                 11};
+    if (attempt == 1) {
+      res.set(http::field::etag, "\"v1\"");
+      res.body() = "pending";
+    } else if (attempt == 4) {
+      res.set(http::field::etag, "\"v2\"");
+      res.body() = "ready";
+    }
+    res.set(http::field::cache_control, "private, max-age=0");
+    return IO<Response>::pure(std::move(res));
+  };
+
+  int decided = 0;
+  auto decide = [&decided](int /*attempt*/, State& st,
+                           const Response& res) -> PollControl {
+    ++decided;
+    st.bodies.push_back(res.body());
+    return res.body() == "ready" ? PollControl::done() : PollControl::retry();
+  };
+
+  ConditionalPollOptions opts;
+  opts.max_attempts = 5;
+  opts.interval = std::chrono::seconds(10);  // max-age=0 must win
+  std::optional<Result<Response, Error>> result_r;
+  poll_conditional<Response>(opts, ioc.get_executor(),
+                             State{sent_if_none_match, {}}, send, decide)
+      .run([&](auto r) { result_r = std::move(r); });
+
+  const auto started = std::chrono::steady_clock::now();
+  ioc.run();
+  EXPECT_LT(std::chrono::steady_clock::now() - started,
+            std::chrono::seconds(5));
+  ASSERT_TRUE(result_r.has_value());
+  ASSERT_TRUE(result_r->is_ok()) << result_r->error();
+  EXPECT_EQ(result_r->value().body(), "ready");
+  EXPECT_EQ(decided, 2);
+  // The first ETag is replayed until the server sends a new one.
+  EXPECT_EQ(*sent_if_none_match,
+            (std::vector<std::string>{"", "\"v1\"", "\"v1\"", "\"v1\""}));
+}
+
+TEST(PollConditionalTest, ServerIntervalHints) {
+  namespace http = boost::beast::http;
+  ConditionalPollOptions opts;
+  opts.min_interval = std::chrono::seconds(1);
+  opts.max_interval = std::chrono::seconds(60);
+
+  http::fields f;
+  EXPECT_FALSE(server_poll_interval(f, opts));
+  f.set(http::field::cache_control, "no-cache, Max-Age=\"30\"");
+  EXPECT_EQ(server_poll_interval(f, opts), std::chrono::seconds(30));
+  f.set(http::field::retry_after, "5");  // wins over max-age
+  EXPECT_EQ(server_poll_interval(f, opts), std::chrono::seconds(5));
+  f.set(http::field::retry_after, "3600");
+  EXPECT_EQ(server_poll_interval(f, opts), std::chrono::seconds(60));
+  f.set(http::field::retry_after, "Wed, 21 Oct 2015 07:28:00 GMT");
+  const auto now = std::chrono::system_clock::time_point{} +
+                   std::chrono::seconds(1445412470);
+  EXPECT_EQ(server_poll_interval(f, opts, now), std::chrono::seconds(10));
+  f.erase(http::field::retry_after);
+  f.set(http::field::cache_control, "s-maxage=100");
+  EXPECT_FALSE(server_poll_interval(f, opts));
+}
+
 TEST(CollectIOParallelTest, PropagatesFirstError) {
   boost::asio::io_context ioc;
 
@@ -1134,6 +1222,47 @@ TEST(ApiHandlerTest, Download) {
       });
 }
 
+// The streamed list body must produce the same JSON as the DOM path, also
+// when elements straddle the output buffer.
+TEST(ApiHandlerTest, StreamedListMatchesDomSerialization) {
+  std::vector<int> items(5000);
+  for (int i = 0; i < 5000; ++i) items[i] = i * 7;
+  const std::string expected = json::serialize(json::value_from(
+      apihandler::ApiDataResponse<int>(std::vector<int>(items))));
+
+  auto dechunk = [](const auto& res) {
+    std::ostringstream wire;
+    wire << res;
+    const std::string bytes = wire.str();
+    http::response_parser<http::string_body> parser;
+    parser.eager(true);
+    boost::system::error_code ec;
+    parser.put(boost::asio::buffer(bytes), ec);
+    EXPECT_FALSE(ec) << ec.message();
+    EXPECT_TRUE(parser.is_done());
+    return parser.get().body();
+  };
+
+  std::optional<std::string> streamed;
+  monad::IO<apihandler::ApiListStream<int>>::pure(
+      apihandler::ApiListStream<int>(std::vector<int>(items)))
+      .then(apihandler::http_response_gen_fn)
+      .run([&](auto r) {
+        ASSERT_TRUE(r.is_ok());
+        EXPECT_TRUE(r.value().chunked());
+        EXPECT_EQ(r.value()[http::field::content_type], "application/json");
+        streamed = dechunk(r.value());
+      });
+  ASSERT_TRUE(streamed.has_value());
+  EXPECT_EQ(*streamed, expected);
+
+  http::response<apihandler::json_list_body<int, 5>> tiny{http::status::ok,
+                                                          11};
+  tiny.body().data = {1, 22, 333};
+  tiny.chunked(true);
+  EXPECT_EQ(dechunk(tiny), R"({"data":[1,22,333]})");
+}
+
 TEST(IOMonadTest, NonCopyableCapture) {
   NonCopyable nc(10);
   std::shared_ptr<NonCopyable> nc_ptr =
@@ -0,0 +1,83 @@
+#include "request_priority.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <map>
+#include <vector>
+
+using client_async::RequestPriority;
+using client_async::WeightedFairQueue;
+using namespace std::chrono_literals;
+
+namespace {
+using Clock = WeightedFairQueue<int>::clock;
+}  // namespace
+
+TEST(RequestPriorityTest, ServesClassesInProportionToWeights) {
+  WeightedFairQueue<RequestPriority> q({4, 2, 1}, 1h);
+  const auto now = Clock::now();
+  for (int i = 0; i < 700; ++i) {
+    q.push(RequestPriority::interactive, RequestPriority::interactive, now);
+    q.push(RequestPriority::normal, RequestPriority::normal, now);
+    q.push(RequestPriority::bulk, RequestPriority::bulk, now);
+  }
+  std::map<RequestPriority, int> served;
+  for (int i = 0; i < 700; ++i) ++served[q.pop(now)];
+  EXPECT_EQ(served[RequestPriority::interactive], 400);
+  EXPECT_EQ(served[RequestPriority::normal], 200);
+  EXPECT_EQ(served[RequestPriority::bulk], 100);
+}
+
+TEST(RequestPriorityTest, LoneClassGetsEverything) {
+  WeightedFairQueue<int> q;
+  for (int i = 0; i < 5; ++i) q.push(RequestPriority::bulk, i);
+  for (int i = 0; i < 5; ++i) EXPECT_EQ(q.pop(), i);  // FIFO within a class
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(RequestPriorityTest, IdleClassDoesNotBankCredit) {
+  WeightedFairQueue<RequestPriority> q({1, 1, 1}, 1h);
+  const auto now = Clock::now();
+  // Bulk runs alone for a while...
+  for (int i = 0; i < 50; ++i) {
+    q.push(RequestPriority::bulk, RequestPriority::bulk, now);
+  }
+  for (int i = 0; i < 40; ++i) q.pop(now);
+  // ...then interactive arrives: equal weights alternate rather than
+  // interactive taking 40 turns in a row.
+  for (int i = 0; i < 10; ++i) {
+    q.push(RequestPriority::interactive, RequestPriority::interactive, now);
+  }
+  int interactive = 0;
+  for (int i = 0; i < 10; ++i) {
+    if (q.pop(now) == RequestPriority::interactive) ++interactive;
+  }
+  EXPECT_LE(interactive, 6);
+  EXPECT_GE(interactive, 4);
+}
+
+TEST(RequestPriorityTest, StarvingWaiterJumpsTheQueue) {
+  WeightedFairQueue<int> q({1000, 1000, 1}, 100ms);
+  const auto t0 = Clock::now();
+  q.push(RequestPriority::bulk, -1, t0);
+  for (int i = 0; i < 10; ++i) {
+    q.push(RequestPriority::interactive, i, t0 + 80ms);
+  }
+  // Bulk has one turn in ~1000; the first pops go by weight.
+  EXPECT_EQ(q.pop(t0 + 80ms), 0);
+  EXPECT_EQ(q.pop(t0 + 80ms), 1);
+  // Once the bulk waiter is past max_wait it goes next.
+  EXPECT_EQ(q.pop(t0 + 150ms), -1);
+  EXPECT_EQ(q.pop(t0 + 150ms), 2);
+}
+
+TEST(RequestPriorityTest, SizePerClass) {
+  WeightedFairQueue<int> q;
+  q.push(RequestPriority::normal, 1);
+  q.push(RequestPriority::normal, 2);
+  q.push(RequestPriority::interactive, 3);
+  EXPECT_EQ(q.size(), 3u);
+  EXPECT_EQ(q.size(RequestPriority::normal), 2u);
+  EXPECT_EQ(q.size(RequestPriority::bulk), 0u);
+}
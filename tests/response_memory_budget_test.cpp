@@ -0,0 +1,337 @@
+#include "response_memory_budget.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using tcp = net::ip::tcp;
+using beast_pool::OriginId;
+using client_async::BudgetLease;
+using client_async::ResponseMemoryBudget;
+
+namespace {
+
+// Serves a fixed-size body for every request; `/chunked` switches to
+// chunked transfer encoding so the client cannot admit by Content-Length.
+struct LargeBodyServer {
+  net::io_context ioc{1};
+  tcp::acceptor acceptor;
+  std::thread thr;
+  unsigned short port{};
+  std::string body;
+
+  explicit LargeBodyServer(std::size_t body_size)
+      : acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0),
+                 true),
+        body(body_size, 'b') {
+    port = acceptor.local_endpoint().port();
+  }
+
+  ~LargeBodyServer() { stop(); }
+
+  void run_async() {
+    thr = std::thread([this] {
+      do_accept();
+      ioc.run();
+    });
+  }
+
+  void stop() {
+    net::post(ioc, [this] {
+      boost::system::error_code ec;
+      (void)acceptor.close(ec);
+    });
+    ioc.stop();
+    if (thr.joinable()) thr.join();
+  }
+
+  void do_accept() {
+    acceptor.async_accept(
+        [this](boost::system::error_code ec, tcp::socket sock) {
+          if (ec) return;
+          std::make_shared<Session>(std::move(sock), body)->start();
+          do_accept();
+        });
+  }
+
+  struct Session : public std::enable_shared_from_this<Session> {
+    tcp::socket sock;
+    const std::string& body;
+    boost::beast::flat_buffer buffer;
+    http::request<http::string_body> req;
+    http::response<http::string_body> res;
+
+    Session(tcp::socket s, const std::string& b)
+        : sock(std::move(s)), body(b) {}
+
+    void start() {
+      http::async_read(sock, buffer, req,
+                       [self = shared_from_this()](
+                           boost::system::error_code ec, std::size_t) {
+                         if (!ec) self->respond();
+                       });
+    }
+
+    void respond() {
+      res.version(11);
+      res.result(http::status::ok);
+      res.keep_alive(false);
+      res.body() = body;
+      if (req.target() == "/chunked") {
+        res.chunked(true);
+      } else {
+        res.prepare_payload();
+      }
+      http::async_write(sock, res,
+                        [self = shared_from_this()](
+                            boost::system::error_code, std::size_t) {
+                          boost::system::error_code ec;
+                          self->sock.shutdown(tcp::socket::shutdown_send, ec);
+                        });
+    }
+  };
+};
+
+// One client exchange reading its body through async_read_budgeted.
+struct BudgetedClient : public std::enable_shared_from_this<BudgetedClient> {
+  boost::beast::tcp_stream stream;
+  boost::beast::flat_buffer buffer;
+  http::request<http::empty_body> req;
+  std::optional<http::response_parser<http::string_body>> parser;
+  BudgetLease lease;
+  std::function<void(boost::beast::error_code, std::size_t)> done;
+
+  BudgetedClient(net::io_context& ioc, ResponseMemoryBudget& budget,
+                 OriginId origin)
+      : stream(net::make_strand(ioc)), lease(budget, origin) {}
+
+  void start(unsigned short port, const std::string& target) {
+    req = {http::verb::get, target, 11};
+    req.set(http::field::host, "127.0.0.1");
+    stream.async_connect(
+        tcp::endpoint(net::ip::make_address("127.0.0.1"), port),
+        [self = shared_from_this()](boost::system::error_code ec) {
+          if (ec) return self->done(ec, 0);
+          http::async_write(self->stream, self->req,
+                            [self](boost::system::error_code ec, std::size_t) {
+                              if (ec) return self->done(ec, 0);
+                              self->read();
+                            });
+        });
+  }
+
+  void read() {
+    parser.emplace();
+    parser->body_limit(16 * 1024 * 1024);
+    stream.expires_after(std::chrono::seconds(10));
+    client_async::async_read_budgeted(
+        stream, buffer, *parser, &lease, 16 * 1024 * 1024,
+        std::chrono::seconds(10),
+        [self = shared_from_this()](boost::beast::error_code ec) {
+          const std::size_t n = ec ? 0 : self->parser->get().body().size();
+          // Hold the body briefly so concurrent readers contend for budget.
+          auto timer = std::make_shared<net::steady_timer>(
+              self->stream.get_executor(), std::chrono::milliseconds(5));
+          timer->async_wait([self, timer, ec, n](boost::system::error_code) {
+            self->lease.reset();
+            self->parser.reset();
+            self->done(ec, n);
+          });
+        });
+  }
+};
+
+void run_clients(ResponseMemoryBudget& budget, unsigned short port,
+                 const std::string& target, int count,
+                 std::size_t expected_size) {
+  net::io_context ioc;
+  int ok = 0;
+  std::vector<std::shared_ptr<BudgetedClient>> clients;
+  for (int i = 0; i < count; ++i) {
+    // Two origins so the round-robin wake-up path is exercised.
+    auto c = std::make_shared<BudgetedClient>(
+        ioc, budget, i % 2 ? OriginId{1} : OriginId{2});
+    c->done = [&ok, expected_size](boost::beast::error_code ec,
+                                   std::size_t n) {
+      EXPECT_FALSE(ec) << ec.message();
+      EXPECT_EQ(n, expected_size);
+      if (!ec && n == expected_size) ++ok;
+    };
+    c->start(port, target);
+    clients.push_back(c);
+  }
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 4; ++i) threads.emplace_back([&ioc] { ioc.run(); });
+  for (auto& t : threads) t.join();
+  EXPECT_EQ(ok, count);
+}
+
+}  // namespace
+
+TEST(ResponseMemoryBudgetTest, ReserveReleaseAndGauges) {
+  ResponseMemoryBudget budget(100);
+  EXPECT_TRUE(budget.try_reserve(OriginId{1}, 60));
+  EXPECT_FALSE(budget.try_reserve(OriginId{2}, 60));
+  EXPECT_TRUE(budget.try_reserve(OriginId{2}, 40));
+  EXPECT_EQ(budget.reserved_bytes(), 100u);
+  EXPECT_EQ(budget.origin_reserved_bytes(OriginId{1}), 60u);
+  budget.release(OriginId{1}, 60);
+  budget.release(OriginId{2}, 40);
+  auto st = budget.stats();
+  EXPECT_EQ(st.reserved_bytes, 0u);
+  EXPECT_EQ(st.peak_reserved_bytes, 100u);
+  EXPECT_EQ(budget.origin_reserved_bytes(OriginId{1}), 0u);
+}
+
+TEST(ResponseMemoryBudgetTest, OversizedRequestAdmittedWhenIdle) {
+  ResponseMemoryBudget budget(10);
+  EXPECT_TRUE(budget.try_reserve(OriginId{0}, 1000));
+  EXPECT_FALSE(budget.try_reserve(OriginId{0}, 1));
+  budget.release(OriginId{0}, 1000);
+  EXPECT_TRUE(budget.try_reserve(OriginId{0}, 1));
+}
+
+TEST(ResponseMemoryBudgetTest, WaitersWokenRoundRobinPerOrigin) {
+  net::io_context ioc;
+  ResponseMemoryBudget budget(10);
+  constexpr OriginId kBusy = 0, kA = 1, kB = 2;
+  ASSERT_TRUE(budget.try_reserve(kBusy, 10));
+  std::vector<OriginId> order;
+  auto enqueue = [&](OriginId origin) {
+    budget.async_reserve(ioc.get_executor(), origin, 10,
+                         [&order, &budget, origin](bool granted) {
+                           ASSERT_TRUE(granted);
+                           order.push_back(origin);
+                           budget.release(origin, 10);
+                         });
+  };
+  enqueue(kA);
+  enqueue(kA);
+  enqueue(kA);
+  enqueue(kB);
+  EXPECT_EQ(budget.stats().waiting, 4u);
+  budget.release(kBusy, 10);
+  ioc.run();
+  ASSERT_EQ(order.size(), 4u);
+  // b must not wait behind every queued a request.
+  EXPECT_EQ(order[0], kA);
+  EXPECT_EQ(order[1], kB);
+  EXPECT_EQ(budget.reserved_bytes(), 0u);
+}
+
+TEST(ResponseMemoryBudgetTest, LeaseWaitTimesOut) {
+  net::io_context ioc;
+  ResponseMemoryBudget budget(10);
+  ASSERT_TRUE(budget.try_reserve(OriginId{1}, 10));
+  BudgetLease lease(budget, OriginId{0});
+  bool result = true;
+  lease.async_grow_to(ioc.get_executor(), 5, std::chrono::milliseconds(20),
+                      [&](bool ok) { result = ok; });
+  ioc.run();
+  EXPECT_FALSE(result);
+  EXPECT_EQ(lease.bytes(), 0u);
+  EXPECT_EQ(budget.stats().wait_timeouts_total, 1u);
+  EXPECT_EQ(budget.stats().waiting, 0u);
+}
+
+TEST(ResponseMemoryBudgetTest, LargeBodiesStayWithinBudget) {
+  constexpr std::size_t kBody = 256 * 1024;
+  LargeBodyServer server(kBody);
+  server.run_async();
+  ResponseMemoryBudget budget(512 * 1024);
+  run_clients(budget, server.port, "/", 16, kBody);
+  auto st = budget.stats();
+  EXPECT_LE(st.peak_reserved_bytes, 512u * 1024);
+  EXPECT_GT(st.waits_total, 0u);
+  EXPECT_EQ(st.reserved_bytes, 0u);
+  EXPECT_EQ(st.waiting, 0u);
+}
+
+TEST(ResponseMemoryBudgetTest, ChunkedBodiesReserveIncrementally) {
+  constexpr std::size_t kBody = 300 * 1024;
+  LargeBodyServer server(kBody);
+  server.run_async();
+  ResponseMemoryBudget budget(1024 * 1024);
+  run_clients(budget, server.port, "/chunked", 8, kBody);
+  auto st = budget.stats();
+  // Without Content-Length a single reader can overshoot the budget only
+  // while it is the sole holder.
+  EXPECT_LE(st.peak_reserved_bytes,
+            1024u * 1024 + kBody + 2 * client_async::kBudgetReadStep);
+  EXPECT_EQ(st.reserved_bytes, 0u);
+}
+
+TEST(ResponseMemoryBudgetTest, UnlimitedBudgetIsNotAccounted) {
+  constexpr std::size_t kBody = 64 * 1024;
+  LargeBodyServer server(kBody);
+  server.run_async();
+  ResponseMemoryBudget budget;  // capacity 0: reads skip the lease
+  run_clients(budget, server.port, "/", 4, kBody);
+  auto st = budget.stats();
+  EXPECT_EQ(st.peak_reserved_bytes, 0u);
+  EXPECT_EQ(st.waits_total, 0u);
+}
+
+// The stream deadline set before the read covers the whole response: a
+// server that keeps trickling bytes does not extend it.
+TEST(ResponseMemoryBudgetTest, DeadlineCoversTheWholeResponse) {
+  net::io_context ioc;
+  tcp::acceptor acceptor(ioc,
+                         tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+  tcp::socket server_sock(ioc);
+  net::steady_timer drip(ioc);
+  std::function<void()> send_byte = [&] {
+    drip.expires_after(std::chrono::milliseconds(20));
+    drip.async_wait([&](boost::system::error_code ec) {
+      if (ec) return;
+      net::async_write(server_sock, net::buffer("x", 1),
+                       [&](boost::system::error_code ec, std::size_t) {
+                         if (!ec) send_byte();
+                       });
+    });
+  };
+  acceptor.async_accept(server_sock, [&](boost::system::error_code ec) {
+    if (ec) return;
+    static const std::string head =
+        "HTTP/1.1 200 OK\r\nContent-Length: 1000\r\n\r\n";
+    net::async_write(server_sock, net::buffer(head),
+                     [&](boost::system::error_code ec, std::size_t) {
+                       if (!ec) send_byte();
+                     });
+  });
+
+  ResponseMemoryBudget budget(1024 * 1024);
+  BudgetLease lease(budget, OriginId{0});
+  boost::beast::tcp_stream stream(ioc);
+  boost::beast::flat_buffer buffer;
+  http::response_parser<http::string_body> parser;
+  boost::beast::error_code result;
+  const auto started = std::chrono::steady_clock::now();
+  std::chrono::steady_clock::duration took{};
+  stream.async_connect(acceptor.local_endpoint(), [&](
+                           boost::system::error_code ec) {
+    ASSERT_FALSE(ec);
+    stream.expires_after(std::chrono::milliseconds(200));
+    client_async::async_read_budgeted(
+        stream, buffer, parser, &lease, 1 << 20, std::chrono::seconds(1),
+        [&](boost::beast::error_code ec) {
+          result = ec;
+          took = std::chrono::steady_clock::now() - started;
+          drip.cancel();
+          boost::system::error_code ignored;
+          server_sock.close(ignored);
+        });
+  });
+  ioc.run();
+  EXPECT_EQ(result, boost::beast::error::timeout);
+  EXPECT_LT(took, std::chrono::seconds(1));
+}
@@ -0,0 +1,177 @@
+#include "sendfile_body.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+namespace fs = std::filesystem;
+using tcp = net::ip::tcp;
+using client_async::sendfile_body;
+
+namespace {
+
+// Accepts one connection, reads a request and records its body.
+struct UploadSink {
+  net::io_context ioc{1};
+  tcp::acceptor acceptor;
+  std::thread thr;
+  unsigned short port{};
+  std::string received;
+
+  UploadSink()
+      : acceptor(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0),
+                 true) {
+    port = acceptor.local_endpoint().port();
+    thr = std::thread([this] {
+      boost::system::error_code ec;
+      tcp::socket sock(ioc);
+      acceptor.accept(sock, ec);
+      if (ec) return;
+      boost::beast::flat_buffer buf;
+      http::request_parser<http::string_body> parser;
+      parser.body_limit(64 * 1024 * 1024);
+      http::read(sock, buf, parser, ec);
+      if (ec) return;
+      received = parser.get().body();
+      http::response<http::empty_body> res{http::status::ok, 11};
+      res.keep_alive(false);
+      http::write(sock, res, ec);
+    });
+  }
+
+  ~UploadSink() {
+    if (thr.joinable()) thr.join();
+  }
+};
+
+struct TempFile {
+  fs::path path;
+  std::string content;
+  explicit TempFile(std::size_t size) {
+    path = fs::temp_directory_path() /
+           ("sendfile_body_test_" + std::to_string(::getpid()) + "_" +
+            std::to_string(size));
+    content.resize(size);
+    for (std::size_t i = 0; i < size; ++i) {
+      content[i] = static_cast<char>('a' + (i * 7) % 26);
+    }
+    std::ofstream(path, std::ios::binary) << content;
+  }
+  ~TempFile() {
+    std::error_code ec;
+    fs::remove(path, ec);
+  }
+};
+
+std::string upload(http::request<sendfile_body>& req, unsigned short port,
+                   bool zero_copy) {
+  net::io_context ioc;
+  boost::beast::tcp_stream stream(ioc);
+  boost::beast::error_code result = net::error::would_block;
+  stream.async_connect(
+      tcp::endpoint(net::ip::make_address("127.0.0.1"), port),
+      [&](boost::system::error_code ec) {
+        if (ec) {
+          result = ec;
+          return;
+        }
+        auto done = [&](boost::beast::error_code ec, std::size_t) {
+          result = ec;
+        };
+        if (zero_copy) {
+          client_async::async_write_sendfile(stream, req,
+                                             std::chrono::seconds(10), done);
+        } else {
+          http::async_write(stream, req, done);
+        }
+      });
+  ioc.run();
+  return result.message();
+}
+
+}  // namespace
+
+TEST(SendfileBodyTest, ZeroCopyUploadOverPlainTcp) {
+  TempFile file(3 * 1024 * 1024 + 17);
+  std::string received;
+  const auto before = client_async::sendfile_counters().zero_copy_bytes.load();
+  {
+    UploadSink sink;
+    http::request<sendfile_body> req{http::verb::put, "/upload", 11};
+    boost::beast::error_code ec;
+    req.body().open(file.path.string().c_str(), ec);
+    ASSERT_FALSE(ec) << ec.message();
+    req.prepare_payload();
+    EXPECT_EQ(upload(req, sink.port, true),
+              boost::beast::error_code{}.message());
+    sink.thr.join();
+    received = sink.received;
+  }
+  EXPECT_EQ(received.size(), file.content.size());
+  EXPECT_TRUE(received == file.content);
+  const std::uint64_t expected =
+      HTTPCLIENT_HAS_SENDFILE ? file.content.size() : 0u;
+  EXPECT_EQ(client_async::sendfile_counters().zero_copy_bytes.load() - before,
+            expected);
+}
+
+TEST(SendfileBodyTest, RangeUploadMatchesFileSlice) {
+  TempFile file(200000);
+  std::string received;
+  {
+    UploadSink sink;
+    boost::beast::file f;
+    boost::beast::error_code ec;
+    f.open(file.path.string().c_str(), boost::beast::file_mode::scan, ec);
+    ASSERT_FALSE(ec);
+    http::request<sendfile_body> req{http::verb::put, "/upload", 11};
+    req.body().reset(std::move(f), 1000, 50000, ec);
+    ASSERT_FALSE(ec);
+    req.prepare_payload();
+    upload(req, sink.port, true);
+    sink.thr.join();
+    received = sink.received;
+  }
+  EXPECT_EQ(received, file.content.substr(1000, 50000));
+}
+
+TEST(SendfileBodyTest, BufferedFallbackWithPlainAsyncWrite) {
+  TempFile file(100000);
+  std::string received;
+  {
+    UploadSink sink;
+    http::request<sendfile_body> req{http::verb::post, "/upload", 11};
+    boost::beast::error_code ec;
+    req.body().open(file.path.string().c_str(), ec);
+    ASSERT_FALSE(ec);
+    req.prepare_payload();
+    const auto before = client_async::sendfile_counters().fallback_bytes.load();
+    upload(req, sink.port, false);
+    sink.thr.join();
+    received = sink.received;
+    EXPECT_EQ(client_async::sendfile_counters().fallback_bytes.load() - before,
+              file.content.size());
+  }
+  EXPECT_EQ(received, file.content);
+}
+
+TEST(SendfileBodyTest, RangeOutsideFileIsRejected) {
+  TempFile file(10);
+  boost::beast::file f;
+  boost::beast::error_code ec;
+  f.open(file.path.string().c_str(), boost::beast::file_mode::scan, ec);
+  ASSERT_FALSE(ec);
+  sendfile_body::value_type body;
+  body.reset(std::move(f), 5, 6, ec);
+  EXPECT_TRUE(ec);
+}
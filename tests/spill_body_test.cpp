@@ -0,0 +1,123 @@
+#include "response_body_policy.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/beast/core/flat_buffer.hpp>
+#include <boost/beast/http.hpp>
+#include <filesystem>
+#include <string>
+
+namespace http = boost::beast::http;
+using client_async::ResponseBodyPolicy;
+using client_async::spill_body;
+
+namespace {
+
+// Feed a raw response through a spill_body parser configured with `policy`.
+// When `chunk` > 0 the bytes are fed in slices to exercise incremental put().
+http::response<spill_body> parse_raw(const std::string& raw,
+                                     const ResponseBodyPolicy& policy,
+                                     std::size_t chunk = 0) {
+  http::response_parser<spill_body> parser;
+  parser.eager(true);
+  parser.body_limit(client_async::effective_body_limit<spill_body>(policy));
+  parser.get().body().set_spill_options(policy);
+  boost::beast::error_code ec;
+  std::size_t off = 0;
+  const std::size_t step = chunk == 0 ? raw.size() : chunk;
+  while (off < raw.size() && !parser.is_done()) {
+    std::size_t n = std::min(step, raw.size() - off);
+    std::size_t used =
+        parser.put(boost::asio::buffer(raw.data() + off, n), ec);
+    if (ec == http::error::need_more) {
+      ec = {};
+      if (used == 0 && n < raw.size() - off) {
+        // Not enough bytes to make progress; widen the window.
+        n = raw.size() - off;
+        used = parser.put(boost::asio::buffer(raw.data() + off, n), ec);
+        if (ec == http::error::need_more) ec = {};
+      }
+    }
+    EXPECT_FALSE(ec) << ec.message();
+    off += used;
+    if (ec) break;
+  }
+  EXPECT_TRUE(parser.is_done());
+  return parser.release();
+}
+
+std::string make_response(const std::string& body, bool chunked) {
+  std::string out = "HTTP/1.1 200 OK\r\n";
+  if (chunked) {
+    out += "Transfer-Encoding: chunked\r\n\r\n";
+    char size_hex[32];
+    std::snprintf(size_hex, sizeof(size_hex), "%zx", body.size());
+    out += std::string(size_hex) + "\r\n" + body + "\r\n0\r\n\r\n";
+  } else {
+    out += "Content-Length: " + std::to_string(body.size()) + "\r\n\r\n";
+    out += body;
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(SpillBodyTest, SmallBodyStaysInMemory) {
+  ResponseBodyPolicy policy;
+  policy.spill_threshold = 1024;
+  auto res = parse_raw(make_response("hello", false), policy);
+  EXPECT_FALSE(res.body().spilled());
+  EXPECT_EQ(res.body().view(), "hello");
+  EXPECT_EQ(res.body().size(), 5u);
+}
+
+TEST(SpillBodyTest, ContentLengthAboveThresholdSpillsImmediately) {
+  ResponseBodyPolicy policy;
+  policy.spill_threshold = 16;
+  std::string body(4096, 'x');
+  std::filesystem::path spilled;
+  {
+    auto res = parse_raw(make_response(body, false), policy);
+    ASSERT_TRUE(res.body().spilled());
+    spilled = res.body().path();
+    EXPECT_TRUE(std::filesystem::exists(spilled));
+    EXPECT_EQ(res.body().view(), body);
+  }
+  // Temp file is removed with the body.
+  EXPECT_FALSE(std::filesystem::exists(spilled));
+}
+
+TEST(SpillBodyTest, ChunkedBodySpillsWhenCrossingThreshold) {
+  ResponseBodyPolicy policy;
+  policy.spill_threshold = 100;
+  std::string body;
+  for (int i = 0; i < 50; ++i) body += "0123456789";
+  auto res = parse_raw(make_response(body, true), policy, 64);
+  ASSERT_TRUE(res.body().spilled());
+  EXPECT_EQ(res.body().size(), body.size());
+  EXPECT_EQ(res.body().str(), body);
+}
+
+TEST(SpillBodyTest, ReleaseFileTransfersOwnership) {
+  ResponseBodyPolicy policy;
+  policy.spill_threshold = 8;
+  auto res = parse_raw(make_response(std::string(64, 'y'), false), policy);
+  auto p = res.body().release_file();
+  ASSERT_FALSE(p.empty());
+  EXPECT_FALSE(res.body().spilled());
+  EXPECT_TRUE(std::filesystem::exists(p));
+  EXPECT_EQ(std::filesystem::file_size(p), 64u);
+  std::filesystem::remove(p);
+}
+
+TEST(SpillBodyTest, BodyLimitRejectsOversizedResponse) {
+  ResponseBodyPolicy policy;
+  policy.max_body_bytes = 10;
+  http::response_parser<spill_body> parser;
+  parser.body_limit(client_async::effective_body_limit<spill_body>(policy));
+  parser.get().body().set_spill_options(policy);
+  std::string raw = make_response(std::string(64, 'z'), false);
+  boost::beast::error_code ec;
+  parser.put(boost::asio::buffer(raw), ec);
+  EXPECT_EQ(ec, http::error::body_limit);
+}
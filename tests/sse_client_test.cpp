@@ -0,0 +1,151 @@
+#include "sse_client.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "client_ssl_ctx.hpp"
+#include "http_client_config_provider.hpp"
+#include "http_client_manager.hpp"
+#include "misc_util.hpp"
+
+namespace fs = std::filesystem;
+namespace net = boost::asio;
+using tcp = net::ip::tcp;
+
+static cjj365::ConfigSources& config_sources() {
+  static const fs::path config_dir =
+      fs::path(__FILE__).parent_path() / "config_dir";
+  static cjj365::ConfigSources instance({config_dir}, {});
+  return instance;
+}
+
+namespace {
+
+// Serves one canned event stream per connection, in order, and records the
+// Last-Event-ID each request carried. The last stream is held open.
+struct EventStreamServer {
+  net::io_context ioc;
+  tcp::acceptor acceptor{ioc,
+                         tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)};
+  std::vector<std::string> streams;
+  std::mutex mu;
+  std::vector<std::string> last_event_ids;
+  std::thread thr;
+  std::atomic<bool> done{false};
+
+  explicit EventStreamServer(std::vector<std::string> s)
+      : streams(std::move(s)) {
+    thr = std::thread([this] { serve(); });
+  }
+  ~EventStreamServer() {
+    done = true;
+    boost::system::error_code ec;
+    acceptor.close(ec);
+    if (thr.joinable()) thr.join();
+  }
+
+  std::string url() const {
+    return "http://127.0.0.1:" +
+           std::to_string(acceptor.local_endpoint().port()) + "/events";
+  }
+
+  void serve() {
+    std::vector<tcp::socket> held;
+    for (std::size_t i = 0; i < streams.size() && !done; ++i) {
+      boost::system::error_code ec;
+      tcp::socket sock(ioc);
+      acceptor.accept(sock, ec);
+      if (ec) return;
+      std::string request;
+      net::read_until(sock, net::dynamic_buffer(request), "\r\n\r\n", ec);
+      std::string id;
+      if (auto pos = request.find("Last-Event-ID: ");
+          pos != std::string::npos) {
+        pos += 15;
+        id = request.substr(pos, request.find("\r\n", pos) - pos);
+      }
+      {
+        std::lock_guard<std::mutex> lk(mu);
+        last_event_ids.push_back(id);
+      }
+      net::write(sock,
+                 net::buffer(std::string("HTTP/1.1 200 OK\r\n"
+                                         "Content-Type: text/event-stream\r\n"
+                                         "Cache-Control: no-cache\r\n"
+                                         "Connection: close\r\n\r\n") +
+                             streams[i]),
+                 ec);
+      if (i + 1 < streams.size()) {
+        sock.close(ec);  // drop the stream; the client must reconnect
+      } else {
+        held.push_back(std::move(sock));
+      }
+    }
+    while (!done) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+};
+
+}  // namespace
+
+TEST(SseClientTest, ReconnectsWithLastEventId) {
+  EventStreamServer server({
+      "retry: 20\nid: 1\ndata: one\n\n",
+      ": keep-alive\nid: 2\nevent: tick\ndata: two\n\n",
+  });
+  cjj365::AppProperties app_properties{config_sources()};
+  cjj365::HttpclientConfigProviderFile config_provider(app_properties,
+                                                       config_sources());
+  cjj365::ClientSSLContext ssl_ctx(config_provider);
+  client_async::HttpClientManager client(ssl_ctx, config_provider);
+
+  std::mutex mu;
+  std::vector<std::string> data;
+  int ticks = 0;
+  int opens = 0;
+  misc::ThreadNotifier notifier{5000};
+
+  auto sse =
+      client_async::SseClient::create(client, urls::url_view(server.url()));
+  sse->on_open([&] {
+    std::lock_guard<std::mutex> lk(mu);
+    ++opens;
+  });
+  sse->on_event([&](const client_async::SseEvent& ev) {
+    std::lock_guard<std::mutex> lk(mu);
+    data.emplace_back(ev.data);
+  });
+  // Typed handlers run after on_event for the same event.
+  sse->on("tick", [&](const client_async::SseEvent&) {
+    std::lock_guard<std::mutex> lk(mu);
+    ++ticks;
+    notifier.notify();
+  });
+  sse->start();
+  notifier.waitForNotification();
+
+  {
+    std::lock_guard<std::mutex> lk(mu);
+    EXPECT_EQ(data, (std::vector<std::string>{"one", "two"}));
+    EXPECT_EQ(ticks, 1);
+    EXPECT_EQ(opens, 2);
+  }
+  {
+    std::lock_guard<std::mutex> lk(server.mu);
+    EXPECT_EQ(server.last_event_ids, (std::vector<std::string>{"", "1"}));
+  }
+  EXPECT_EQ(sse->last_event_id(), "2");
+  EXPECT_EQ(sse->reconnects(), 1);
+
+  sse->stop();
+  EXPECT_FALSE(sse->running());
+  client.stop();
+}
@@ -0,0 +1,116 @@
+#include "sse_parser.hpp"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+using client_async::SseEvent;
+using client_async::SseParser;
+
+namespace {
+
+struct Seen {
+  std::string type;
+  std::string data;
+  std::string id;
+};
+
+// Feeds `chunks` in order and collects copies of the events.
+std::vector<Seen> parse_chunks(SseParser& parser,
+                               const std::vector<std::string>& chunks) {
+  std::vector<Seen> out;
+  for (auto const& chunk : chunks) {
+    EXPECT_TRUE(parser.feed(chunk, [&](const SseEvent& ev) {
+      out.push_back({std::string(ev.type), std::string(ev.data),
+                     std::string(ev.id)});
+    }));
+  }
+  return out;
+}
+
+}  // namespace
+
+TEST(SseParserTest, ParsesFieldsAndDefaults) {
+  SseParser parser;
+  auto events = parse_chunks(
+      parser, {": heartbeat\n"
+               "data: hello\n\n"
+               "event: status\n"
+               "id: 7\n"
+               "data:{\"a\":1}\n"
+               "retry: 2500\n\n"
+               "data\n\n"});
+  ASSERT_EQ(events.size(), 3u);
+  EXPECT_EQ(events[0].type, "message");
+  EXPECT_EQ(events[0].data, "hello");
+  EXPECT_EQ(events[0].id, "");
+  EXPECT_EQ(events[1].type, "status");
+  EXPECT_EQ(events[1].data, "{\"a\":1}");
+  EXPECT_EQ(events[1].id, "7");
+  EXPECT_EQ(events[2].data, "");  // "data" with no colon
+  EXPECT_EQ(events[2].id, "7");   // the ID persists
+  EXPECT_EQ(parser.retry(), std::chrono::milliseconds(2500));
+  EXPECT_EQ(parser.last_event_id(), "7");
+  EXPECT_EQ(parser.buffered(), 0u);
+}
+
+TEST(SseParserTest, JoinsDataLinesAndSkipsEmptyEvents) {
+  SseParser parser;
+  auto events = parse_chunks(
+      parser, {"data: a\ndata:  b\ndata\n\nevent: x\n\nid: 3\n\n"});
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].data, "a\n b\n");
+  // Events without data are not dispatched but still move the ID.
+  EXPECT_EQ(parser.last_event_id(), "3");
+}
+
+TEST(SseParserTest, HandlesEventsSplitAcrossChunks) {
+  const std::string stream =
+      "\xEF\xBB\xBF"
+      "id: 1\r\ndata: first\r\n\r\n"
+      "event: update\rdata: second\r\rdata: third\n\n";
+  // Every possible split point, including inside CRLF pairs.
+  for (std::size_t cut = 0; cut <= stream.size(); ++cut) {
+    SseParser parser;
+    auto events =
+        parse_chunks(parser, {stream.substr(0, cut), stream.substr(cut)});
+    ASSERT_EQ(events.size(), 3u) << "cut at " << cut;
+    EXPECT_EQ(events[0].data, "first");
+    EXPECT_EQ(events[0].id, "1");
+    EXPECT_EQ(events[1].type, "update");
+    EXPECT_EQ(events[1].data, "second");
+    EXPECT_EQ(events[2].type, "message");
+    EXPECT_EQ(events[2].data, "third");
+  }
+
+  // Byte at a time.
+  SseParser parser;
+  std::vector<std::string> bytes;
+  for (char ch : stream) bytes.emplace_back(1, ch);
+  EXPECT_EQ(parse_chunks(parser, bytes).size(), 3u);
+}
+
+TEST(SseParserTest, ResetDropsPartialEventButKeepsId) {
+  SseParser parser;
+  auto events = parse_chunks(parser, {"id: 5\ndata: ok\n\nid: 6\ndata: cut"});
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_GT(parser.buffered(), 0u);
+  parser.reset();  // connection dropped mid-event
+  EXPECT_EQ(parser.buffered(), 0u);
+  EXPECT_EQ(parser.last_event_id(), "5");
+  events = parse_chunks(parser, {"data: next\n\n"});
+  ASSERT_EQ(events.size(), 1u);
+  EXPECT_EQ(events[0].id, "5");
+}
+
+TEST(SseParserTest, RejectsOversizedEvents) {
+  SseParser parser(/*max_event_bytes=*/16);
+  int events = 0;
+  auto count = [&](const SseEvent&) { ++events; };
+  EXPECT_TRUE(parser.feed("data: short\n\n", count));
+  EXPECT_FALSE(parser.feed("data: this never ends", count));
+  EXPECT_EQ(parser.buffered(), 0u);
+  EXPECT_EQ(events, 1);
+}
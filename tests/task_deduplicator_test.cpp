@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "misc_util.hpp"
+
+using namespace std::chrono_literals;
+
+namespace {
+
+// Manually advanced clock so expiry can be tested without sleeping.
+struct FakeClock {
+  using duration = std::chrono::steady_clock::duration;
+  using rep = duration::rep;
+  using period = duration::period;
+  using time_point = std::chrono::time_point<FakeClock>;
+  static constexpr bool is_steady = true;
+  static inline time_point current{};
+  static time_point now() { return current; }
+};
+
+using Dedup = misc::TaskDeduplicator<std::string, int,
+                                     std::hash<std::string>, FakeClock>;
+
+}  // namespace
+
+TEST(TaskDeduplicatorTest, MarksExpireAfterTtl) {
+  FakeClock::current = {};
+  Dedup dedup(10s);
+  EXPECT_FALSE(dedup.is_running_or_mark("a"));
+  EXPECT_TRUE(dedup.is_running_or_mark("a"));
+  FakeClock::current += 5s;
+  EXPECT_FALSE(dedup.is_running_or_mark("b"));
+  FakeClock::current += 5s;
+  EXPECT_TRUE(dedup.is_running_or_mark("a"));  // exactly ttl: still held
+  FakeClock::current += 1s;
+  EXPECT_FALSE(dedup.is_running_or_mark("a"));  // expired, marked again
+  EXPECT_TRUE(dedup.is_running_or_mark("b"));
+  EXPECT_EQ(dedup.size(), 2u);
+
+  dedup.unmark("b");
+  EXPECT_FALSE(dedup.is_running_or_mark("b"));
+  // The first mark of "b" expiring must not drop the second one.
+  FakeClock::current += 6s;
+  EXPECT_TRUE(dedup.is_running_or_mark("b"));
+}
+
+TEST(TaskDeduplicatorTest, JoinersShareTheOwnersResult) {
+  FakeClock::current = {};
+  Dedup dedup(60s);
+  std::vector<std::optional<int>> got;
+  auto join = [&](const int* r) {
+    got.push_back(r ? std::optional<int>(*r) : std::nullopt);
+  };
+  EXPECT_FALSE(dedup.join_or_mark("job", join));  // owner
+  EXPECT_TRUE(dedup.join_or_mark("job", join));
+  EXPECT_TRUE(dedup.join_or_mark("job", join));
+  EXPECT_TRUE(got.empty());
+  dedup.complete("job", 42);
+  ASSERT_EQ(got.size(), 2u);
+  EXPECT_EQ(got[0], 42);
+  EXPECT_EQ(got[1], 42);
+
+  // A joiner hears null when the owner gives up or the mark expires.
+  got.clear();
+  EXPECT_FALSE(dedup.join_or_mark("job", join));
+  EXPECT_TRUE(dedup.join_or_mark("job", join));
+  dedup.unmark("job");
+  EXPECT_FALSE(dedup.join_or_mark("job", join));
+  EXPECT_TRUE(dedup.join_or_mark("job", join));
+  FakeClock::current += 61s;
+  EXPECT_FALSE(dedup.join_or_mark("job", join));
+  ASSERT_EQ(got.size(), 2u);
+  EXPECT_FALSE(got[0].has_value());
+  EXPECT_FALSE(got[1].has_value());
+}
+
+TEST(TaskDeduplicatorTest, ExpiryReachesJoinersOfIdleKeys) {
+  FakeClock::current = {};
+  Dedup dedup(10s);
+  int released = 0;
+  auto join = [&](const int* r) {
+    EXPECT_EQ(r, nullptr);
+    ++released;
+  };
+  EXPECT_FALSE(dedup.join_or_mark("stuck", join));
+  EXPECT_TRUE(dedup.join_or_mark("stuck", join));
+  FakeClock::current += 11s;
+  // A call for any other key drops the expired mark, whatever its shard.
+  EXPECT_FALSE(dedup.is_running_or_mark("other"));
+  EXPECT_EQ(released, 1);
+
+  EXPECT_FALSE(dedup.join_or_mark("stuck", join));
+  EXPECT_TRUE(dedup.join_or_mark("stuck", join));
+  FakeClock::current += 11s;
+  EXPECT_EQ(dedup.size(), 0u);
+  EXPECT_EQ(released, 2);
+}
+
+TEST(TaskDeduplicatorTest, OneOwnerPerKeyUnderContention) {
+  misc::TaskDeduplicator<int> dedup(60s);
+  constexpr int kKeys = 1000;
+  std::atomic<int> owners{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&] {
+      for (int k = 0; k < kKeys; ++k) {
+        if (!dedup.is_running_or_mark(k)) ++owners;
+      }
+    });
+  }
+  for (auto& th : threads) th.join();
+  EXPECT_EQ(owners.load(), kKeys);
+  EXPECT_EQ(dedup.size(), static_cast<std::size_t>(kKeys));
+}
@@ -0,0 +1,206 @@
+#include "traffic_record.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+#include "traffic_replay_server.hpp"
+
+namespace fs = std::filesystem;
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using client_async::TrafficLog;
+using client_async::TrafficRecorder;
+using tcp = net::ip::tcp;
+using namespace std::chrono_literals;
+
+namespace {
+
+fs::path temp_log(const std::string& name) {
+  auto p = fs::temp_directory_path() /
+           ("traffic_record_test_" + std::to_string(::getpid()) + "_" + name);
+  fs::remove(p);
+  return p;
+}
+
+// Records GET `target` answered with `status`/`body` after `rtt`.
+void record(TrafficRecorder& rec, const std::string& target, unsigned status,
+            const std::string& body, std::chrono::milliseconds rtt) {
+  http::request<http::string_body> req{http::verb::get, target, 11};
+  req.set(http::field::host, "api.example.com");
+  req.set(http::field::accept, "application/json");
+  http::response<http::string_body> res{static_cast<http::status>(status),
+                                        11};
+  res.set(http::field::content_type, "application/json");
+  res.body() = body;
+  res.prepare_payload();
+  const auto t0 = TrafficRecorder::clock::now();
+  auto pending = rec.begin("https", "api.example.com", 443, req, t0);
+  rec.finish(pending, &res, 0, t0 + rtt);
+}
+
+}  // namespace
+
+TEST(TrafficRecordTest, RoundTripsThroughTheMappedLog) {
+  const auto path = temp_log("roundtrip");
+  {
+    auto rec = TrafficRecorder::open(path);
+    ASSERT_TRUE(rec);
+    record(*rec, "/v1/items?page=1", 200, R"({"data":[1,2,3]})", 40ms);
+    http::request<http::string_body> post{http::verb::post, "/v1/items", 11};
+    post.body() = R"({"name":"x"})";
+    post.prepare_payload();
+    auto pending = rec->begin("https", "api.example.com", 443, post);
+    rec->finish<http::string_body, http::fields>(pending, nullptr, 4);
+    EXPECT_EQ(rec->records(), 2u);
+  }
+  {
+    // Reopening appends after the existing records.
+    auto rec = TrafficRecorder::open(path);
+    ASSERT_TRUE(rec);
+    record(*rec, "/v1/health", 204, "", 1ms);
+  }
+
+  TrafficLog log;
+  ASSERT_TRUE(log.open(path));
+  ASSERT_EQ(log.size(), 3u);
+  const auto& get = log.entries()[0];
+  EXPECT_EQ(get.method, "GET");
+  EXPECT_EQ(get.scheme, "https");
+  EXPECT_EQ(get.host, "api.example.com");
+  EXPECT_EQ(get.port, 443);
+  EXPECT_EQ(get.target, "/v1/items?page=1");
+  EXPECT_NE(get.request_headers.find("Accept: application/json\r\n"),
+            std::string_view::npos);
+  EXPECT_EQ(get.status, 200);
+  EXPECT_EQ(get.duration, 40ms);
+  EXPECT_EQ(get.response_body, R"({"data":[1,2,3]})");
+  EXPECT_NE(get.response_headers.find("Content-Type: application/json"),
+            std::string_view::npos);
+
+  const auto& failed = log.entries()[1];
+  EXPECT_EQ(failed.method, "POST");
+  EXPECT_EQ(failed.request_body, R"({"name":"x"})");
+  EXPECT_EQ(failed.status, 0);
+  EXPECT_EQ(failed.error, 4);
+  EXPECT_TRUE(failed.response_headers.empty());
+  EXPECT_GE(failed.start, get.start);
+
+  EXPECT_EQ(log.entries()[2].status, 204);
+  fs::remove(path);
+}
+
+TEST(TrafficRecordTest, DropsTruncatedTailAndRejectsForeignFiles) {
+  const auto path = temp_log("truncated");
+  {
+    auto rec = TrafficRecorder::open(path);
+    record(*rec, "/a", 200, "one", 1ms);
+    record(*rec, "/b", 200, "two", 1ms);
+  }
+  fs::resize_file(path, fs::file_size(path) - 2);  // crash mid-record
+  {
+    TrafficLog log;
+    ASSERT_TRUE(log.open(path));
+    ASSERT_EQ(log.size(), 1u);
+    EXPECT_EQ(log.entries()[0].response_body, "one");
+  }
+  {
+    // Reopening cuts the partial record off before appending.
+    auto rec = TrafficRecorder::open(path);
+    ASSERT_TRUE(rec);
+    record(*rec, "/c", 200, "three", 1ms);
+  }
+  TrafficLog log;
+  ASSERT_TRUE(log.open(path));
+  ASSERT_EQ(log.size(), 2u);
+  EXPECT_EQ(log.entries()[0].response_body, "one");
+  EXPECT_EQ(log.entries()[1].target, "/c");
+  EXPECT_EQ(log.entries()[1].response_body, "three");
+
+  const auto foreign = temp_log("foreign");
+  std::ofstream(foreign) << "not a traffic log";
+  EXPECT_FALSE(log.open(foreign));
+  EXPECT_EQ(log.size(), 0u);
+  EXPECT_FALSE(TrafficRecorder::open(foreign));
+  EXPECT_FALSE(log.open(temp_log("missing")));
+  fs::remove(path);
+  fs::remove(foreign);
+}
+
+TEST(TrafficRecordTest, ReplayServerServesRecordingWithTiming) {
+  const auto path = temp_log("replay");
+  {
+    auto rec = TrafficRecorder::open(path);
+    record(*rec, "/v1/items?page=1", 200, R"({"page":1})", 60ms);
+    record(*rec, "/v1/items?page=2", 429, "slow down", 1ms);
+  }
+  TrafficLog log;
+  ASSERT_TRUE(log.open(path));
+  cjj365::testsrv::ReplayServer server(log);
+
+  net::io_context ioc;
+  tcp::socket sock(ioc);
+  sock.connect({net::ip::make_address("127.0.0.1"), server.port()});
+  boost::beast::flat_buffer buf;
+  auto fetch = [&](const std::string& target) {
+    http::request<http::empty_body> req{http::verb::get, target, 11};
+    req.set(http::field::host, "127.0.0.1");
+    http::write(sock, req);
+    http::response<http::string_body> res;
+    http::read(sock, buf, res);
+    return res;
+  };
+
+  const auto start = std::chrono::steady_clock::now();
+  auto first = fetch("/v1/items?page=1");
+  EXPECT_GE(std::chrono::steady_clock::now() - start, 60ms);
+  EXPECT_EQ(first.result_int(), 200u);
+  EXPECT_EQ(first.body(), R"({"page":1})");
+  EXPECT_EQ(first[http::field::content_type], "application/json");
+  EXPECT_EQ(first.count(http::field::content_length), 1u);
+
+  auto second = fetch("/v1/items?page=2");
+  EXPECT_EQ(second.result_int(), 429u);
+  EXPECT_EQ(second.body(), "slow down");
+  EXPECT_EQ(server.requests(), 2);
+  fs::remove(path);
+}
+
+TEST(TrafficRecordTest, RedactsCredentialsUnlessAskedNotTo) {
+  const auto path = temp_log("redact");
+  http::request<http::string_body> req{http::verb::get, "/me", 11};
+  req.set(http::field::authorization, "Bearer secret-token");
+  req.set(http::field::proxy_authorization, "Basic dXNlcjpwYXNz");
+  req.set(http::field::cookie, "sid=abc123");
+  req.set(http::field::accept, "application/json");
+  for (const bool redact : {true, false}) {
+    auto rec = TrafficRecorder::open(path, redact);
+    ASSERT_TRUE(rec);
+    rec->finish<http::string_body, http::fields>(
+        rec->begin("https", "api.example.com", 443, req), nullptr, 0);
+  }
+
+  TrafficLog log;
+  ASSERT_TRUE(log.open(path));
+  ASSERT_EQ(log.size(), 2u);
+  const auto redacted = log.entries()[0].request_headers;
+  EXPECT_NE(redacted.find("Authorization: [redacted]\r\n"),
+            std::string_view::npos);
+  EXPECT_NE(redacted.find("Proxy-Authorization: [redacted]\r\n"),
+            std::string_view::npos);
+  EXPECT_NE(redacted.find("Cookie: [redacted]\r\n"), std::string_view::npos);
+  EXPECT_EQ(redacted.find("secret-token"), std::string_view::npos);
+  EXPECT_EQ(redacted.find("sid=abc123"), std::string_view::npos);
+  EXPECT_NE(redacted.find("Accept: application/json\r\n"),
+            std::string_view::npos);
+  EXPECT_NE(log.entries()[1].request_headers.find(
+                "Authorization: Bearer secret-token\r\n"),
+            std::string_view::npos);
+  fs::remove(path);
+}
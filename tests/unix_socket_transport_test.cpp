@@ -0,0 +1,225 @@
+#include <gtest/gtest.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "beast_connection_pool.hpp"
+#include "http_session_pooled.hpp"
+#include "http_session_stream.hpp"
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+using local = net::local::stream_protocol;
+using beast_pool::ConnectionPool;
+using beast_pool::Origin;
+using beast_pool::PoolConfig;
+
+namespace {
+
+std::string temp_socket_path(const char* tag) {
+  return "/tmp/httpclient_" + std::string(tag) + "_" +
+         std::to_string(::getpid()) + ".sock";
+}
+
+// Keep-alive HTTP server on a Unix domain socket. Echoes the request target
+// and counts accepted connections.
+class UnixHttpServer {
+ public:
+  explicit UnixHttpServer(std::string path)
+      : path_(std::move(path)), acceptor_(ioc_) {
+    ::unlink(path_.c_str());
+    acceptor_.open(local{});
+    acceptor_.bind(local::endpoint(path_));
+    acceptor_.listen();
+    thread_ = std::thread([this] {
+      do_accept();
+      ioc_.run();
+    });
+  }
+
+  ~UnixHttpServer() {
+    net::post(ioc_, [this] {
+      boost::system::error_code ec;
+      acceptor_.close(ec);
+    });
+    ioc_.stop();
+    if (thread_.joinable()) thread_.join();
+    ::unlink(path_.c_str());
+  }
+
+  const std::string& path() const { return path_; }
+  int connections() const { return connections_.load(); }
+
+ private:
+  struct Conn : std::enable_shared_from_this<Conn> {
+    explicit Conn(local::socket s) : sock(std::move(s)) {}
+    local::socket sock;
+    boost::beast::flat_buffer buf;
+    http::request<http::string_body> req;
+    http::response<http::string_body> res;
+
+    void read() {
+      req = {};
+      http::async_read(sock, buf, req,
+                       [self = shared_from_this()](
+                           boost::system::error_code ec, std::size_t) {
+                         if (ec) return;
+                         self->respond();
+                       });
+    }
+    void respond() {
+      res = {http::status::ok, req.version()};
+      res.keep_alive(req.keep_alive());
+      res.body() = std::string(req.target());
+      res.prepare_payload();
+      http::async_write(sock, res,
+                        [self = shared_from_this()](
+                            boost::system::error_code ec, std::size_t) {
+                          if (ec) return;
+                          self->read();
+                        });
+    }
+  };
+
+  void do_accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec,
+                                  local::socket sock) {
+      if (ec) return;
+      ++connections_;
+      std::make_shared<Conn>(std::move(sock))->read();
+      do_accept();
+    });
+  }
+
+  std::string path_;
+  net::io_context ioc_;
+  local::acceptor acceptor_;
+  std::thread thread_;
+  std::atomic<int> connections_{0};
+};
+
+PoolConfig test_pool_config() {
+  PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  cfg.connect_timeout = std::chrono::seconds(5);
+  cfg.io_timeout = std::chrono::seconds(5);
+  return cfg;
+}
+
+http::request<http::string_body> get(std::string target) {
+  http::request<http::string_body> req{http::verb::get, target, 11};
+  req.set(http::field::host, "localhost");
+  return req;
+}
+
+}  // namespace
+
+TEST(UnixSocketTransportTest, PoolReusesUnixConnection) {
+  UnixHttpServer server(temp_socket_path("pool"));
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  Origin origin{"http", "localhost", 80, server.path()};
+
+  std::string first, second;
+  pool.async_request(
+      origin, get("/one"),
+      [&](boost::system::error_code ec, auto, auto res) {
+        ASSERT_FALSE(ec) << ec.message();
+        first = res.body();
+        pool.async_request(
+            origin, get("/two"),
+            [&](boost::system::error_code ec, auto, auto res) {
+              ASSERT_FALSE(ec) << ec.message();
+              second = res.body();
+            });
+      });
+  ioc.run();
+  EXPECT_EQ(first, "/one");
+  EXPECT_EQ(second, "/two");
+  EXPECT_EQ(server.connections(), 1);
+}
+
+TEST(UnixSocketTransportTest, SocketPathIsPartOfOriginKey) {
+  UnixHttpServer a(temp_socket_path("a"));
+  UnixHttpServer b(temp_socket_path("b"));
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  int done = 0;
+  for (const auto* server : {&a, &b, &a, &b}) {
+    pool.async_request(Origin{"http", "localhost", 80, server->path()},
+                       get("/"),
+                       [&](boost::system::error_code ec, auto, auto) {
+                         EXPECT_FALSE(ec) << ec.message();
+                         ++done;
+                       });
+    ioc.run();
+    ioc.restart();
+  }
+  EXPECT_EQ(done, 4);
+  EXPECT_EQ(a.connections(), 1);
+  EXPECT_EQ(b.connections(), 1);
+}
+
+TEST(UnixSocketTransportTest, MissingSocketFailsAcquire) {
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  boost::system::error_code got;
+  pool.acquire(Origin{"http", "localhost", 80, temp_socket_path("missing")},
+               [&](boost::system::error_code ec, beast_pool::Connection::Ptr c) {
+                 got = ec;
+                 EXPECT_FALSE(c);
+               });
+  ioc.run();
+  EXPECT_TRUE(got);
+}
+
+TEST(UnixSocketTransportTest, PooledSessionOverUnixSocket) {
+  UnixHttpServer server(temp_socket_path("session"));
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  using Session = client_async::http_session_pooled<http::string_body,
+                                                    http::string_body>;
+  std::optional<Session::response_t> got;
+  int code = -1;
+  auto session = std::make_shared<Session>(
+      pool, Origin{"http", "localhost", 80, server.path()});
+  session->set_request(get("/v1/health?x=1"));
+  session->run([&](std::optional<Session::response_t>&& res, int c) {
+    got = std::move(res);
+    code = c;
+  });
+  ioc.run();
+  EXPECT_EQ(code, 0);
+  ASSERT_TRUE(got.has_value());
+  EXPECT_EQ(got->body(), "/v1/health?x=1");
+}
+
+TEST(UnixSocketTransportTest, StreamSessionOverUnixSocket) {
+  UnixHttpServer server(temp_socket_path("stream"));
+  net::io_context ioc;
+  using Session =
+      client_async::session_stream_unix<http::empty_body, std::allocator<char>>;
+  std::string chunks;
+  unsigned status = 0;
+  int code = -1;
+  auto session = std::make_shared<Session>(
+      ioc, boost::urls::url("http+unix://localhost/v1/events"),
+      client_async::HttpClientRequestParams{},
+      [&](Session::response_t&&, int c) { code = c; },
+      [&](Session::header_t&& h) { status = h.result_int(); },
+      [&](std::string&& chunk) { chunks += chunk; }, server.path());
+  session->set_req(http::request<http::empty_body>{http::verb::get,
+                                                   "/v1/events", 11});
+  session->run();
+  ioc.run();
+  EXPECT_EQ(code, 0);
+  EXPECT_EQ(status, 200u);
+  EXPECT_EQ(chunks, "/v1/events");
+}
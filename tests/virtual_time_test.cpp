@@ -0,0 +1,181 @@
+#include "virtual_time.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio.hpp>
+#include <chrono>
+#include <optional>
+#include <vector>
+
+#include "io_monad.hpp"
+#include "io_monad_poll_with_state.hpp"
+
+using namespace monad;
+using namespace std::chrono_literals;
+
+namespace {
+
+// Wall-clock budget for work that spans minutes of virtual time.
+constexpr auto kWallBudget = std::chrono::seconds(1);
+
+std::chrono::steady_clock::duration wall_since(
+    std::chrono::steady_clock::time_point start) {
+  return std::chrono::steady_clock::now() - start;
+}
+
+TEST(VirtualTimeTest, TimersFireInDeadlineOrder) {
+  boost::asio::io_context ioc;
+  std::vector<int> order;
+  VirtualTimer late(ioc, 10min);
+  VirtualTimer early(ioc, 5s);
+  VirtualTimer cancelled(ioc, 1s);
+  late.async_wait([&](boost::system::error_code ec) {
+    EXPECT_FALSE(ec);
+    order.push_back(2);
+  });
+  early.async_wait([&](boost::system::error_code ec) {
+    EXPECT_FALSE(ec);
+    order.push_back(1);
+  });
+  cancelled.async_wait([&](boost::system::error_code ec) {
+    EXPECT_EQ(ec, boost::asio::error::operation_aborted);
+    order.push_back(0);
+  });
+  cancelled.cancel();
+
+  run_virtual(ioc);
+  EXPECT_EQ(order, (std::vector<int>{0, 1, 2}));
+  EXPECT_EQ(VirtualClock::of(ioc).elapsed(), 10min);
+  EXPECT_EQ(VirtualClock::of(ioc).pending(), 0u);
+}
+
+TEST(VirtualTimeTest, RetryBackoffRunsInstantly) {
+  boost::asio::io_context ioc;
+  int attempts = 0;
+  std::vector<VirtualClock::duration> attempt_times;
+  auto flaky = IO<int>([&](IO<int>::Callback cb) {
+    attempt_times.push_back(VirtualClock::of(ioc).elapsed());
+    if (++attempts < 6) {
+      cb(Result<int, Error>::Err(Error{503, "unavailable"}));
+    } else {
+      cb(Result<int, Error>::Ok(42));
+    }
+  });
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  std::optional<Result<int, Error>> out;
+  std::move(flaky)
+      .retry_exponential_if<VirtualTimer>(
+          6, 30s, ioc, [](const Error& e) { return e.code == 503; })
+      .run([&](auto r) { out = std::move(r); });
+  run_virtual(ioc);
+
+  ASSERT_TRUE(out.has_value());
+  ASSERT_TRUE(out->is_ok()) << out->error();
+  EXPECT_EQ(out->value(), 42);
+  // 30s, 60s, 120s, 240s and 480s of backoff between the six attempts.
+  EXPECT_EQ(attempt_times,
+            (std::vector<VirtualClock::duration>{0s, 30s, 90s, 210s, 450s,
+                                                 930s}));
+  EXPECT_LT(wall_since(wall_start), kWallBudget);
+}
+
+TEST(VirtualTimeTest, TimeoutAndDelayUseVirtualClock) {
+  boost::asio::io_context ioc;
+  // Holds its callback but never completes: only the (virtual) timeout
+  // can finish it.
+  IO<int>::Callback parked;
+  auto hangs = IO<int>([&](IO<int>::Callback cb) { parked = std::move(cb); });
+  std::optional<Result<int, Error>> timed_out;
+  std::move(hangs).timeout<VirtualTimer>(ioc, 2h).run(
+      [&](auto r) { timed_out = std::move(r); });
+
+  std::optional<VirtualClock::duration> delayed_at;
+  delay_for<void, VirtualTimer>(ioc, 45min).run([&](auto r) {
+    EXPECT_TRUE(r.is_ok());
+    delayed_at = VirtualClock::of(ioc).elapsed();
+  });
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  run_virtual(ioc);
+  ASSERT_TRUE(timed_out.has_value());
+  ASSERT_TRUE(timed_out->is_err());
+  EXPECT_EQ(timed_out->error().code, 2);
+  EXPECT_EQ(delayed_at, std::optional<VirtualClock::duration>(45min));
+  EXPECT_EQ(VirtualClock::of(ioc).elapsed(), 2h);
+  EXPECT_LT(wall_since(wall_start), kWallBudget);
+}
+
+TEST(VirtualTimeTest, CompletedOperationBeatsTimeout) {
+  boost::asio::io_context ioc;
+  std::optional<Result<int, Error>> out;
+  IO<int>::pure(7)
+      .delay<VirtualTimer>(ioc, 1s)
+      .timeout<VirtualTimer>(ioc, 1min)
+      .run([&](auto r) { out = std::move(r); });
+  run_virtual(ioc);
+  ASSERT_TRUE(out.has_value());
+  ASSERT_TRUE(out->is_ok()) << out->error();
+  EXPECT_EQ(out->value(), 7);
+  // The cancelled timeout does not move the clock past the delay.
+  EXPECT_EQ(VirtualClock::of(ioc).elapsed(), 1s);
+}
+
+TEST(VirtualTimeTest, SynchronousResultArmsNoTimeout) {
+  boost::asio::io_context ioc;
+  std::optional<Result<int, Error>> out;
+  IO<int>::pure(3).timeout<VirtualTimer>(ioc, 1min).run(
+      [&](auto r) { out = std::move(r); });
+  ASSERT_TRUE(out.has_value());
+  EXPECT_EQ(out->value(), 3);
+  EXPECT_EQ(VirtualClock::of(ioc).pending(), 0u);
+}
+
+TEST(VirtualTimeTest, PollWithStateHonoursRetryAfter) {
+  boost::asio::io_context ioc;
+  struct State {
+    std::vector<VirtualClock::duration> seen;
+  };
+  auto job = [&ioc](int attempt, State& st) {
+    st.seen.push_back(VirtualClock::of(ioc).elapsed());
+    return IO<int>::pure(attempt);
+  };
+  // The "server" asks for a five minute pause once, then the default.
+  auto decide = [](int attempt, State&, const Result<int, Error>&) {
+    if (attempt == 4) return PollControl::done();
+    if (attempt == 2) return PollControl::retry(5min);
+    return PollControl::retry();
+  };
+
+  PollWithStateHooks<State> hooks;
+  std::vector<VirtualClock::duration> seen;
+  hooks.on_done = [&](int, const State& st) { seen = st.seen; };
+
+  const auto wall_start = std::chrono::steady_clock::now();
+  std::optional<Result<int, Error>> out;
+  poll_with_state<int, VirtualTimer>(10, 1min, ioc.get_executor(), State{},
+                                     job, decide, std::move(hooks))
+      .run([&](auto r) { out = std::move(r); });
+  run_virtual(ioc);
+
+  ASSERT_TRUE(out.has_value());
+  ASSERT_TRUE(out->is_ok()) << out->error();
+  EXPECT_EQ(out->value(), 4);
+  EXPECT_EQ(seen,
+            (std::vector<VirtualClock::duration>{0min, 1min, 6min, 7min}));
+  EXPECT_LT(wall_since(wall_start), kWallBudget);
+}
+
+TEST(VirtualTimeTest, DefaultTimerStillUsesRealTime) {
+  boost::asio::io_context ioc;
+  bool done = false;
+  IO<void>::pure().delay(ioc, 1ms).run([&](auto r) {
+    EXPECT_TRUE(r.is_ok());
+    done = true;
+  });
+  run_virtual(ioc);
+  EXPECT_TRUE(done);
+  EXPECT_EQ(VirtualClock::of(ioc).elapsed(), 0s);
+}
+
+}  // namespace
@@ -0,0 +1,174 @@
+#include "warm_start_state.hpp"
+
+#include <gtest/gtest.h>
+
+#include <boost/asio/ip/address.hpp>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using beast_pool::WarmOriginRef;
+using beast_pool::WarmStartState;
+using tcp = boost::asio::ip::tcp;
+using namespace std::chrono_literals;
+
+namespace {
+
+tcp::endpoint ep(const std::string& ip, unsigned short port = 443) {
+  return {boost::asio::ip::make_address(ip), port};
+}
+
+const WarmOriginRef kApi{"https", "api.example", 443};
+const WarmOriginRef kCdn{"https", "cdn.example", 443};
+const WarmOriginRef kLocal{"http", "localhost", 8080};
+
+class WarmStartStateTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    path_ = std::filesystem::temp_directory_path() /
+            ("warm_start_state_test_" +
+             std::to_string(std::chrono::steady_clock::now()
+                                .time_since_epoch()
+                                .count())) /
+            "state.bin";
+  }
+  void TearDown() override {
+    std::error_code ec;
+    std::filesystem::remove_all(path_.parent_path(), ec);
+  }
+
+  std::filesystem::path path_;
+};
+
+}  // namespace
+
+TEST_F(WarmStartStateTest, RoundTripsThroughFile) {
+  const auto now = WarmStartState::clock::now();
+  WarmStartState state;
+  state.note_use(kApi, now);
+  state.note_use(kApi, now);
+  state.set_addresses(kApi,
+                      std::vector<tcp::endpoint>{ep("10.0.0.1"), ep("::1")},
+                      300s, now);
+  state.set_tls_session(kApi, std::string("\x30\x82\x00\x01", 4),
+                        WarmStartState::unix_seconds(now + 1h));
+  state.note_use(kLocal, now);
+  EXPECT_TRUE(state.dirty());
+  ASSERT_TRUE(state.save(path_));  // creates the directory
+  EXPECT_FALSE(state.dirty());
+
+  WarmStartState loaded;
+  ASSERT_TRUE(loaded.load(path_));
+  EXPECT_EQ(loaded.size(), 2u);
+  EXPECT_EQ(loaded.addresses(kApi, now),
+            (std::vector<tcp::endpoint>{ep("10.0.0.1"), ep("::1")}));
+  EXPECT_EQ(loaded.tls_session(kApi, now), std::string("\x30\x82\x00\x01", 4));
+  auto top = loaded.top_origins(10);
+  ASSERT_EQ(top.size(), 2u);
+  EXPECT_EQ(top[0].host, "api.example");
+  EXPECT_EQ(top[0].uses, 2u);
+  EXPECT_EQ(top[1].host, "localhost");
+  EXPECT_EQ(top[1].port, 8080);
+}
+
+TEST_F(WarmStartStateTest, ExpiredEntriesAreNotServed) {
+  const auto now = WarmStartState::clock::now();
+  WarmStartState state;
+  state.set_addresses(kApi, std::vector<tcp::endpoint>{ep("10.0.0.1")}, 60s,
+                      now);
+  state.set_tls_session(kApi, "session",
+                        WarmStartState::unix_seconds(now + 1h));
+  EXPECT_FALSE(state.addresses(kApi, now + 30s).empty());
+  EXPECT_TRUE(state.addresses(kApi, now + 61s).empty());
+  EXPECT_EQ(state.tls_session(kApi, now + 30min), "session");
+  EXPECT_TRUE(state.tls_session(kApi, now + 2h).empty());
+  EXPECT_TRUE(state.addresses(kCdn, now).empty());  // never seen
+}
+
+TEST_F(WarmStartStateTest, TopOriginsRankByUseThenRecency) {
+  const auto now = WarmStartState::clock::now();
+  WarmStartState state;
+  state.note_use(kLocal, now - 1h);
+  state.note_use(kCdn, now);
+  for (int i = 0; i < 3; ++i) state.note_use(kApi, now - 2h);
+  auto top = state.top_origins(2);
+  ASSERT_EQ(top.size(), 2u);
+  EXPECT_EQ(top[0].host, "api.example");
+  EXPECT_EQ(top[1].host, "cdn.example");  // same uses, more recent
+}
+
+TEST_F(WarmStartStateTest, SaveKeepsOnlyMostUsedOrigins) {
+  WarmStartState state(/*max_origins=*/2);
+  state.note_use(kLocal);
+  state.note_use(kCdn);
+  state.note_use(kCdn);
+  state.note_use(kApi);
+  state.note_use(kApi);
+  ASSERT_TRUE(state.save(path_));
+  WarmStartState loaded;
+  ASSERT_TRUE(loaded.load(path_));
+  ASSERT_EQ(loaded.size(), 2u);
+  for (auto const& o : loaded.top_origins(2)) EXPECT_NE(o.host, "localhost");
+}
+
+TEST_F(WarmStartStateTest, FileIsOwnerOnly) {
+  WarmStartState state;
+  state.set_tls_session(kApi, "secret", 0);
+  ASSERT_TRUE(state.save(path_));
+  using std::filesystem::perms;
+  const auto mode = std::filesystem::status(path_).permissions();
+  EXPECT_EQ(mode & (perms::group_all | perms::others_all), perms::none);
+  EXPECT_EQ(mode & perms::owner_all, perms::owner_read | perms::owner_write);
+}
+
+TEST_F(WarmStartStateTest, MemoryStaysBoundedAcrossManyOrigins) {
+  WarmStartState state(/*max_origins=*/8);
+  state.note_use(kApi);
+  state.note_use(kApi);
+  for (int i = 0; i < 10000; ++i) {
+    state.note_use({"https", "host" + std::to_string(i) + ".example", 443});
+  }
+  EXPECT_LE(state.size(), 16u);
+  // The busiest origin survives every trim.
+  EXPECT_EQ(state.top_origins(1).at(0).host, "api.example");
+}
+
+TEST_F(WarmStartStateTest, RejectsMissingForeignAndTruncatedFiles) {
+  WarmStartState state;
+  EXPECT_FALSE(state.load(path_));  // missing
+
+  WarmStartState source;
+  source.note_use(kApi);
+  source.set_tls_session(kApi, std::string(64, 'x'), 0);
+  ASSERT_TRUE(source.save(path_));
+  std::string bytes;
+  {
+    std::ifstream in(path_, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), {});
+  }
+  auto write = [&](const std::string& data) {
+    std::ofstream out(path_, std::ios::binary | std::ios::trunc);
+    out << data;
+  };
+
+  // Another version.
+  std::string other = bytes;
+  other[4] = static_cast<char>(WarmStartState::kVersion + 1);
+  write(other);
+  state.note_use(kCdn);
+  EXPECT_FALSE(state.load(path_));
+  EXPECT_EQ(state.size(), 0u);  // stale contents are dropped too
+
+  // Cut off mid-entry, and with trailing garbage.
+  write(bytes.substr(0, bytes.size() - 10));
+  EXPECT_FALSE(state.load(path_));
+  write(bytes + "junk");
+  EXPECT_FALSE(state.load(path_));
+
+  write(bytes);
+  EXPECT_TRUE(state.load(path_));
+  EXPECT_EQ(state.size(), 1u);
+}
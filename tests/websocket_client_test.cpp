@@ -0,0 +1,288 @@
+#include "websocket_client.hpp"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/websocket.hpp>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace net = boost::asio;
+namespace http = boost::beast::http;
+namespace websocket = boost::beast::websocket;
+using tcp = net::ip::tcp;
+using beast_pool::ConnectionPool;
+using beast_pool::Origin;
+using beast_pool::PoolConfig;
+using client_async::WebSocketClient;
+using client_async::WebSocketMessage;
+
+namespace {
+
+// WebSocket echo server on 127.0.0.1 with permessage-deflate enabled.
+// Records the extensions each client offered.
+class EchoServer {
+ public:
+  EchoServer()
+      : acceptor_(ioc_, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)) {
+    thread_ = std::thread([this] {
+      do_accept();
+      ioc_.run();
+    });
+  }
+
+  ~EchoServer() {
+    net::post(ioc_, [this] {
+      boost::system::error_code ec;
+      acceptor_.close(ec);
+    });
+    ioc_.stop();
+    if (thread_.joinable()) thread_.join();
+  }
+
+  Origin origin() const {
+    return Origin{"http", "127.0.0.1", acceptor_.local_endpoint().port()};
+  }
+  int connections() const { return connections_.load(); }
+  std::vector<std::string> offers() {
+    std::lock_guard<std::mutex> lk(mu_);
+    return offers_;
+  }
+
+ private:
+  struct Conn : std::enable_shared_from_this<Conn> {
+    Conn(tcp::socket s, EchoServer& server)
+        : ws(std::move(s)), server(server) {}
+    websocket::stream<tcp::socket> ws;
+    EchoServer& server;
+    boost::beast::flat_buffer buf;
+    http::request<http::string_body> req;
+
+    void start() {
+      http::async_read(ws.next_layer(), buf, req,
+                       [self = shared_from_this()](
+                           boost::system::error_code ec, std::size_t) {
+                         if (ec) return;
+                         self->server.record_offer(
+                             self->req[http::field::sec_websocket_extensions]);
+                         websocket::permessage_deflate pmd;
+                         pmd.server_enable = true;
+                         self->ws.set_option(pmd);
+                         self->ws.async_accept(
+                             self->req, [self](boost::system::error_code ec) {
+                               if (!ec) self->read();
+                             });
+                       });
+    }
+    void read() {
+      buf.consume(buf.size());
+      ws.async_read(buf, [self = shared_from_this()](
+                             boost::system::error_code ec, std::size_t) {
+        if (ec) return;
+        self->ws.binary(self->ws.got_binary());
+        self->ws.async_write(
+            self->buf.data(),
+            [self](boost::system::error_code ec, std::size_t) {
+              if (!ec) self->read();
+            });
+      });
+    }
+  };
+
+  void record_offer(boost::beast::string_view extensions) {
+    std::lock_guard<std::mutex> lk(mu_);
+    offers_.emplace_back(extensions);
+  }
+
+  void do_accept() {
+    acceptor_.async_accept([this](boost::system::error_code ec,
+                                  tcp::socket sock) {
+      if (ec) return;
+      ++connections_;
+      std::make_shared<Conn>(std::move(sock), *this)->start();
+      do_accept();
+    });
+  }
+
+  net::io_context ioc_;
+  tcp::acceptor acceptor_;
+  std::thread thread_;
+  std::atomic<int> connections_{0};
+  std::mutex mu_;
+  std::vector<std::string> offers_;
+};
+
+PoolConfig test_pool_config() {
+  PoolConfig cfg;
+  cfg.idle_reap_interval = std::chrono::seconds(0);
+  cfg.connect_timeout = std::chrono::seconds(5);
+  cfg.io_timeout = std::chrono::seconds(5);
+  return cfg;
+}
+
+client_async::WebSocketOptions test_options() {
+  client_async::WebSocketOptions opts;
+  opts.handshake_timeout = std::chrono::seconds(5);
+  opts.idle_timeout = std::chrono::seconds(5);
+  return opts;
+}
+
+}  // namespace
+
+TEST(WebSocketClientTest, EchoesTextAndBinaryWithDeflate) {
+  EchoServer server;
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  const auto id = beast_pool::OriginTable::global().intern(server.origin());
+  auto ws = WebSocketClient::create(pool, id, "/echo", test_options());
+
+  std::vector<WebSocketMessage> got;
+  bool closed = false;
+  ws->on_close([&](boost::system::error_code ec,
+                   const websocket::close_reason&) {
+    EXPECT_FALSE(ec) << ec.message();
+    closed = true;
+  });
+  ws->connect([&](boost::system::error_code ec) {
+    ASSERT_FALSE(ec) << ec.message();
+    EXPECT_TRUE(ws->is_open());
+  });
+  const std::string big(4096, 'x');  // above the deflate threshold
+  ws->send("hello");
+  ws->send(std::string("\0\1\2", 3), /*binary=*/true);
+  ws->send(big);
+  for (int i = 0; i < 3; ++i) {
+    ws->receive([&](boost::system::error_code ec, WebSocketMessage&& m) {
+      ASSERT_FALSE(ec) << ec.message();
+      got.push_back(std::move(m));
+      if (got.size() == 3) ws->close();
+    });
+  }
+  ioc.run();
+
+  ASSERT_EQ(got.size(), 3u);
+  EXPECT_EQ(got[0].data, "hello");
+  EXPECT_FALSE(got[0].binary);
+  EXPECT_EQ(got[1].data, std::string("\0\1\2", 3));
+  EXPECT_TRUE(got[1].binary);
+  EXPECT_EQ(got[2].data, big);
+  EXPECT_TRUE(closed);
+  EXPECT_FALSE(ws->is_open());
+  ASSERT_EQ(server.offers().size(), 1u);
+  EXPECT_NE(server.offers()[0].find("permessage-deflate"), std::string::npos);
+}
+
+TEST(WebSocketClientTest, CoalescesQueuedMessages) {
+  EchoServer server;
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  const auto id = beast_pool::OriginTable::global().intern(server.origin());
+  auto ws = WebSocketClient::create(pool, id, "/", test_options());
+
+  constexpr int kMessages = 200;
+  std::vector<std::string> got;
+  int written = 0;
+  ws->on_message([&](WebSocketMessage&& m) {
+    got.push_back(std::move(m.data));
+    if (got.size() == kMessages) ws->close();
+  });
+  // Queued before the connection opens, so they go out in batches.
+  for (int i = 0; i < kMessages; ++i) {
+    ws->send("m" + std::to_string(i), false,
+             [&](boost::system::error_code ec) {
+               EXPECT_FALSE(ec) << ec.message();
+               ++written;
+             });
+  }
+  ws->connect([](boost::system::error_code ec) {
+    ASSERT_FALSE(ec) << ec.message();
+  });
+  ioc.run();
+
+  ASSERT_EQ(got.size(), static_cast<std::size_t>(kMessages));
+  for (int i = 0; i < kMessages; ++i) {
+    EXPECT_EQ(got[i], "m" + std::to_string(i));
+  }
+  EXPECT_EQ(written, kMessages);
+  const auto stats = ws->stats();
+  EXPECT_EQ(stats.messages_sent, static_cast<std::size_t>(kMessages));
+  EXPECT_EQ(stats.messages_received, static_cast<std::size_t>(kMessages));
+  // Handshake, one batch and the close frame, give or take.
+  EXPECT_LT(stats.transport_writes, 10u);
+}
+
+TEST(WebSocketClientTest, UpgradedConnectionLeavesThePool) {
+  EchoServer server;
+  net::io_context ioc;
+  PoolConfig cfg = test_pool_config();
+  cfg.max_active = 1;
+  ConnectionPool pool(ioc, cfg);
+  const auto id = beast_pool::OriginTable::global().intern(server.origin());
+  auto first = WebSocketClient::create(pool, id, "/a", test_options());
+  auto second = WebSocketClient::create(pool, id, "/b", test_options());
+
+  // With one active slot the second client only gets a connection if the
+  // first one's was detached.
+  int opened = 0;
+  auto on_open = [&](boost::system::error_code ec) {
+    ASSERT_FALSE(ec) << ec.message();
+    if (++opened == 2) {
+      first->close();
+      second->close();
+    }
+  };
+  first->connect(on_open);
+  second->connect(on_open);
+  ioc.run();
+  EXPECT_EQ(opened, 2);
+  EXPECT_EQ(server.connections(), 2);
+}
+
+TEST(WebSocketClientTest, IoApiRoundTrip) {
+  EchoServer server;
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  const auto id = beast_pool::OriginTable::global().intern(server.origin());
+  auto ws = WebSocketClient::create(pool, id, "/io", test_options());
+
+  std::string echoed;
+  ws->connect_io()
+      .then([ws] { return ws->send_io("ping"); })
+      .then([ws] { return ws->receive_io(); })
+      .run([&](monad::Result<WebSocketMessage, monad::Error> r) {
+        ASSERT_TRUE(r.is_ok());
+        echoed = r.value().data;
+        ws->close();
+      });
+  ioc.run();
+  EXPECT_EQ(echoed, "ping");
+}
+
+TEST(WebSocketClientTest, RefusedConnectionFailsOpenAndSends) {
+  net::io_context ioc;
+  ConnectionPool pool(ioc, test_pool_config());
+  // Bind then close to get a port nobody listens on.
+  std::uint16_t port;
+  {
+    tcp::acceptor a(ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0));
+    port = a.local_endpoint().port();
+  }
+  const auto id =
+      beast_pool::OriginTable::global().intern({"http", "127.0.0.1", port});
+  auto ws = WebSocketClient::create(pool, id, "/", test_options());
+  boost::system::error_code open_ec, send_ec;
+  ws->send("lost", false,
+           [&](boost::system::error_code ec) { send_ec = ec; });
+  ws->connect([&](boost::system::error_code ec) { open_ec = ec; });
+  ioc.run();
+  EXPECT_TRUE(open_ec);
+  EXPECT_TRUE(send_ec);
+  EXPECT_FALSE(ws->is_open());
+}